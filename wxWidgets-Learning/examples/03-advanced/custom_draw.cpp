@@ -11,161 +11,2483 @@
  */
 
 #include <wx/wx.h>
-#include <wx/dcbuffer.h>
+#include <wx/spinctrl.h>
+#include <wx/numdlg.h>
+#include <wx/filename.h>
+#include <wx/wfstream.h>
+#include <wx/progdlg.h>
+#include <wx/dcgraph.h>
+#include <wx/file.h>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <memory>
+#include <utility>
 #include <vector>
 
+#include "drawing/stroke_store.h"
+#include "drawing/spatial_grid.h"
+#include "drawing/stroke_filter.h"
+#include "drawing/bezier.h"
+#include "drawing/tile_renderer.h"
+#include "drawing/history.h"
+#include "drawing/stroke_file.h"
+#include "drawing/export_renderer.h"
+#include "drawing/viewport.h"
+#include "drawing/stroke_lod.h"
+#include "drawing/frame_stats.h"
+#include "drawing/input_trace.h"
+#include "drawing/shapes.h"
+#include "drawing/lru_cache.h"
+#include "drawing/fill_kernels.h"
+#include "drawing/flood_fill.h"
+#include "drawing/layers.h"
+#include "drawing/svg_writer.h"
+#include "drawing/stroke_timeline.h"
+#include "dc_renderer.h"
+
+// 画布主题：背景渐变和网格的配色
+struct CanvasTheme {
+    wxColour top;
+    wxColour bottom;
+    wxColour grid;
+    int gridStep;
+    
+    CanvasTheme()
+        : top(250, 250, 255), bottom(220, 220, 240),
+          grid(200, 200, 200), gridStep(50) {}
+    
+    bool operator==(const CanvasTheme& other) const {
+        return top == other.top && bottom == other.bottom &&
+               grid == other.grid && gridStep == other.gridStep;
+    }
+    bool operator!=(const CanvasTheme& other) const { return !(*this == other); }
+};
+
 // 自定义绘制面板
-class DrawPanel : public wxPanel {
+class DrawPanel : public wxPanel, private drawing::HistoryTarget {
 public:
     DrawPanel(wxWindow* parent);
+    
+    enum {
+        MODE_FREE = 0,
+        MODE_RECT,
+        MODE_CIRCLE,
+        MODE_LINE,
+        MODE_ERASER,   // 擦除光标下的整条笔画
+        MODE_SELECT,   // 选中光标下最上层的笔画
+        MODE_FILL      // 油漆桶：填充点击处颜色相近的连通区域
+    };
+    
+    enum {
+        BACKEND_DC = 0,  // 在 UI 线程上用 wxDC 绘制
+        BACKEND_TILES    // 分块后在线程池上软件光栅化
+    };
 
 private:
-    std::vector<wxPoint> m_points;  // 存储鼠标轨迹点
-    wxPoint m_currentPos;
+    drawing::StrokeStore m_strokes;      // 所有笔画，每条笔画有自己的样式
+    drawing::StrokeId m_currentStroke;   // 正在绘制的笔画
+    drawing::StrokeStyle m_penStyle;     // 新笔画使用的画笔
+    wxPoint m_currentPos;                // 当前笔画最后保存的点（屏幕坐标）
+    
+    // 输入管线：抽稀 + 平滑 + 提交时简化
+    drawing::StrokeFilter m_filter;
+    std::vector<drawing::StrokePoint> m_simplifyIn;
+    std::vector<drawing::StrokePoint> m_simplifyOut;
+    std::vector<char> m_simplifyKeep;
+    std::vector<std::pair<size_t, size_t> > m_simplifyStack;
+    // 现存手绘笔画的输入点数和简化后保存的点数：擦除、清空时减去，撤销时加回，
+    // 打开文件时归零，状态栏的压缩比只反映画布上还在的笔画
+    std::vector<uint32_t> m_inputPoints;  // 每条手绘笔画的输入点数，其他笔画为 0
+    size_t m_strokeRawStart;              // 当前笔画开始时过滤器的原始点计数
+    size_t m_rawPoints;
+    size_t m_keptPoints;
     bool m_drawing;
-    int m_drawMode;  // 0=自由绘制, 1=矩形, 2=圆形, 3=直线
+    bool m_erasing;
+    int m_drawMode;  // MODE_xxx
+    
+    // 矩形 / 圆 / 直线：拖动时只在屏幕上画预览，松开后作为笔画进入场景
+    bool m_shaping;
+    drawing::StrokePoint m_shapeStart;   // 世界坐标
+    drawing::StrokePoint m_shapeEnd;
+    wxRect m_previewRect;                // 上一次预览在屏幕上占的区域
+    std::vector<drawing::StrokePoint> m_shapePoints;
+    
+    // 油漆桶：按当前视口光栅化后做扫描线填充，结果保存为填充笔画（一组行程）
+    int m_fillTolerance;                 // 每个颜色通道允许的差值 0-255
+    std::vector<drawing::FillSpan> m_fillSpans;
+    
+    drawing::SpatialGrid m_index;               // 已完成笔画的空间索引
+    std::vector<drawing::StrokeId> m_queryIds;  // 索引查询结果，复用以免每次分配
+    drawing::StrokeId m_selected;
+    bool m_hasSelection;
+    
+    // 视图：笔画按世界坐标保存，缩放和平移只改变视图变换
+    drawing::ViewTransform m_view;
+    drawing::StrokeLod m_lod;   // 各笔画的简化版本，缩小时使用
+    int m_lodLevel;             // 当前缩放比例对应的细节级别
+    bool m_panning;
+    wxPoint m_panLast;          // 平移时上一次的鼠标位置
+    
+    // 帧调度：鼠标移动事件只把位置放进队列，定时器按目标帧率取出整批处理，
+    // 每帧只刷新一次。输入再密集，屏幕也不会被排队的重绘拖慢
+    wxTimer m_frameTimer;
+    int m_frameRate;                     // 目标帧率 (Hz)，0 表示每个事件立即处理
+    std::vector<wxPoint> m_pendingInput; // 还没处理的鼠标位置（屏幕坐标）
+    std::vector<double> m_pendingTimes;  // 与 m_pendingInput 一一对应，在 OnMouseMove 中记录的时刻
+    std::vector<wxPoint> m_newSegment;   // 本帧新增的折线，第一个点是上一帧的终点
+    
+    // 性能统计：每次 OnPaint 记一个样本，m_frame 累计两次绘制之间发生的绘制工作
+    drawing::FrameStats m_frameStats;
+    drawing::FrameSample m_frame;
+    double m_inputTime;                  // 最早的未显示输入的时刻，没有时为 -1
+    bool m_showStats;
+    wxTimer m_statsTimer;                // 叠加层显示时定期刷新
+    
+    // 输入录制：自由绘制的按下 / 移动 / 抬起事件，供 draw_bench 回放
+    drawing::InputTrace m_trace;
+    bool m_recording;
+    double m_traceStart;
+    
+    // 撤销 / 重做：命令日志 + 检查点，擦除的笔画只隐藏、不释放
+    drawing::StrokeHistory m_history;
+    std::vector<drawing::StrokeId> m_erasedIds;  // 本次橡皮擦拖动擦掉的笔画
+    bool m_bulkUpdate;                           // 一次改动很多笔画，结束后整体重绘
+    
+    // 打开的绘图文件：笔画先只登记样式和包围盒，第一次需要点数据时才解码
+    std::unique_ptr<drawing::DrawingReader> m_reader;
+    wxString m_readerPath;
+    std::vector<uint32_t> m_pendingRecord;  // 笔画 id → 文件中的记录序号，kNoRecord 表示已解码
+    size_t m_pendingCount;
+    
+    wxBitmap m_backBuffer;          // 保留的后台缓冲：背景 + 已画好的线段
+    wxRegion m_staleRegion;         // 后台缓冲中内容已过期、需要重新绘制的区域
+    
+    // 笔画绘制：整条笔画一次 DrawLines，画笔从共享的 GdiCache 中取。
+    // wxDC 的绘制代码在 dc_renderer.h 里，与 draw_bench 共用
+    bool m_batchedRendering;
+    std::vector<wxPoint> m_linePoints;
+    DcStrokeRenderer m_dcRenderer;
+    
+    // 多线程分块后端（首次使用时创建）
+    int m_renderBackend;
+    std::unique_ptr<drawing::TileRenderer> m_tiles;
+    std::vector<drawing::TileJob> m_tileJobs;
+    std::vector<drawing::StrokeId> m_tileExtra;
+    bool m_tileBgStale;
+    
+    // 图层：每个图层有自己的光栅，改动只重新光栅化所在图层的脏区域，
+    // 显示 / 隐藏、不透明度和混合模式只重新合成（drawing/layers.h）。
+    // 只有一个普通图层时与直接绘制等价，仍然走上面的两个后端
+    std::vector<drawing::Layer> m_layers;
+    std::vector<wxRegion> m_layerStale;      // 各图层光栅中过期的区域，只在逐层合成时记录
+    int m_activeLayer;                       // 新笔画画在这个图层上
+    std::vector<unsigned char> m_composite;  // 合成缓冲（RGBX）
+    std::vector<unsigned char> m_compositeRgb;
+    
+    // 回放：时间轴（drawing/stroke_timeline.h）按时刻定位到笔画和点，
+    // 定时器以固定帧率推进，每帧只把新露出的线段画在上一帧的缓存上；
+    // 拖动进度条往回退、或者视图变化时才按时间索引重建这一帧
+    drawing::StrokeTimeline m_timeline;
+    bool m_playing;                       // 处于回放模式（暂停时也是）
+    bool m_playRunning;                   // 正在播放
+    wxTimer m_playTimer;
+    double m_playTime;                    // 当前回放到的时刻（时间轴上的毫秒）
+    double m_playSpeed;
+    double m_playLastTick;                // 上一次推进时的实际时刻
+    drawing::PlaybackPosition m_playPos;  // m_playFrame 已经画到的位置
+    wxBitmap m_playFrame;
+    bool m_playFrameValid;
+    wxRect m_playDirty;                   // 本帧画过的区域
+    
+    // 背景层缓存（渐变 + 网格），以客户区尺寸和主题为键。
+    // 由填充内核直接写进 m_bgImage，分块后端也直接使用这份 RGB 数据
+    CanvasTheme m_theme;
+    wxImage m_bgImage;
+    wxBitmap m_bgCache;
+    wxSize m_bgCacheSize;
+    CanvasTheme m_bgCacheTheme;
+    unsigned long m_bgCacheHits;      // 用到背景缓存、而且没有现场重建的帧数（每次 OnPaint 最多一次）
+    unsigned long m_bgCacheRebuilds;  // 背景缓存重建的次数
+    bool m_bgCacheUsed;               // 这一帧重画时用到了背景缓存
     
     void OnPaint(wxPaintEvent& event);
     void OnMouseDown(wxMouseEvent& event);
     void OnMouseMove(wxMouseEvent& event);
     void OnMouseUp(wxMouseEvent& event);
     void OnEraseBackground(wxEraseEvent& event);
+    void OnSize(wxSizeEvent& event);
+    void OnMouseWheel(wxMouseEvent& event);
+    void OnMiddleDown(wxMouseEvent& event);
+    void OnMiddleUp(wxMouseEvent& event);
+    void OnFrameTimer(wxTimerEvent& event);
+    void OnStatsTimer(wxTimerEvent& event);
+    void OnPlayTimer(wxTimerEvent& event);
+    
+    void QueueInput(const wxPoint& pos, double timeMs);
+    void FlushInput();
+    void ApplyInput(const wxPoint* points, const double* times, size_t count);
+    void AppendStrokePoint(const drawing::StrokePoint& filtered, double timeMs);
+    void FlushSegments();
+    
+    void DrawBackground(const drawing::RgbBuffer& buffer);
+    void DrawGrid(const drawing::RgbBuffer& buffer);
+    void UpdateBackgroundCache();
+    void UpdateStatus();
+    void MarkInput();
+    void RecordInput(drawing::InputEvent::Type type, const wxPoint& pos);
+    wxRect GetStatsOverlayRect() const;
+    void DrawStatsOverlay(wxWindowDC& dc);
+    
+    void EnsureBackBuffer();
+    void RebuildBackBuffer();
+    void PrepareRegion(const wxRect& rect);
+    void RenderRegion(wxDC& dc, const wxRect& rect);
+    void RenderRegionDC(wxDC& dc, const wxRect& rect);
+    void RenderRegionTiled(wxDC& dc, const wxRect& rect);
+    void InvalidateCanvas(const wxRect& rect, int layer = drawing::kAllLayers);
+    
+    bool IsLayered() const { return m_layers.size() > 1 || !m_layers[0].IsPlain(); }
+    void RenderRegionLayered(wxDC& dc, const wxRect& rect);
+    void UpdateLayerRasters();
+    void RasterizeLayerRect(int layer, const wxRect& rect);
+    void BuildTileLods();
+    void RecompositeLayer(int layer, bool wasLayered);
+    void ResetLayers(int count);
+    bool CheckActiveLayerVisible();
+    DcStrokeRenderer& GetDcRenderer();
+    void DrawStroke(wxDC& dc, drawing::StrokeId id);
+    void DrawSegments(const std::vector<wxPoint>& points, const drawing::StrokeStyle& style);
+    
+    void CommitStroke();
+    drawing::ShapeKind GetShapeKind() const;
+    void BuildShapePoints(bool screen);
+    void UpdateShapePreview(const drawing::StrokePoint& end);
+    void DrawShapePreview(wxDC& dc);
+    void CommitShape();
+    void EraseAt(const wxPoint& pt);
+    void SelectAt(const wxPoint& pt);
+    void FillAt(const wxPoint& pt);
+    wxRect GetStrokeRect(drawing::StrokeId id) const;
+    
+    static const int kPlaybackFps = 60;
+    bool EnterPlayback();
+    void ShowPlaybackAt(double timeMs);
+    void RebuildPlayFrame();
+    void DrawPlayback(wxDC& dc, drawing::PlaybackPosition from, const drawing::PlaybackPosition& to);
+    void DrawStrokePoints(wxDC& dc, drawing::StrokeId id, size_t first, size_t last);
+    bool IsPlaybackVisible(drawing::StrokeId id) const;
+    void NotifyPlayback();
+    
+    static const uint32_t kNoRecord = 0xFFFFFFFF;
+    void EnsureLoaded(drawing::StrokeId id);
+    void LoadPending(const drawing::StrokeBox& region);
+    void LoadAllPending();
+    
+    // drawing::HistoryTarget
+    virtual void ShowStroke(drawing::StrokeId id);
+    virtual void HideStroke(drawing::StrokeId id);
+    virtual void BeginUpdate(size_t count);
+    virtual void EndUpdate();
+    
+public:
+    void SetDrawMode(int mode) { m_drawMode = mode; }
+    void SetPen(int size, const wxColour& colour);
+    void SetFilterOptions(const drawing::StrokeFilterOptions& options) { m_filter.SetOptions(options); }
+    const drawing::StrokeFilterOptions& GetFilterOptions() const { return m_filter.GetOptions(); }
+    
+    void SetBatchedRendering(bool batched) { m_batchedRendering = batched; }
+    bool IsBatchedRendering() const { return m_batchedRendering; }
+    void CompareRenderPaths(int repeats, double& batchedMs, double& perSegmentMs);
+    
+    void SetRenderBackend(int backend);
+    int GetRenderBackend() const { return m_renderBackend; }
+    void SetFrameRate(int hz);  // 0 = 不做帧调度，每个鼠标事件立即绘制
+    int GetFrameRate() const { return m_frameRate; }
+    
+    // 性能统计叠加层和 CSV 导出（最近 1024 帧）
+    void ShowStats(bool show);
+    bool IsStatsShown() const { return m_showStats; }
+    bool SaveStatsCsv(const wxString& path, wxString& error);
+    
+    // 录制输入轨迹（格式见 drawing/input_trace.h）
+    void StartRecording();
+    void StopRecording() { m_recording = false; }
+    bool IsRecording() const { return m_recording; }
+    const drawing::InputTrace& GetTrace() const { return m_trace; }
+    void SetTheme(const CanvasTheme& theme);
+    void Clear();  // 可以撤销
+    
+    void Undo();
+    void Redo();
+    void UndoAll();
+    bool CanUndo() const { return !IsBusy() && m_history.CanUndo(); }
+    bool CanRedo() const { return !IsBusy() && m_history.CanRedo(); }
+    bool IsBusy() const { return m_drawing || m_erasing || m_shaping; }  // 鼠标操作进行中
+    void SetHistoryLimit(size_t bytes);
+    size_t GetHistoryLimit() const { return m_history.GetLimit(); }
+    void SetFillTolerance(int tolerance) { m_fillTolerance = std::max(0, std::min(255, tolerance)); }
+    int GetFillTolerance() const { return m_fillTolerance; }
+    
+    // 读写绘图文件（格式见 drawing/stroke_file.h），失败时 error 为原因
+    bool LoadDrawing(const wxString& path, wxString& error);
+    bool SaveDrawing(const wxString& path, wxString& error);
+    
+    // 导出用：可见笔画的副本和当前视口覆盖的世界范围
+    void TakeSnapshot(drawing::StrokeSnapshot& snapshot);
+    drawing::StrokeBox GetExportArea() const;
+    
+    // 把视口范围流式导出为 SVG，每个可见图层一个 <g>；points 为写出的点数
+    bool ExportSvg(const wxString& path, uint64_t& points, wxString& error);
+    const CanvasTheme& GetTheme() const { return m_theme; }
+    
+    // 缩放以屏幕上的 anchor 为中心，平移以屏幕像素为单位
+    void ZoomAt(double factor, const wxPoint& anchor);
+    void ZoomReset();
+    void PanBy(int dx, int dy);
+    double GetZoom() const { return m_view.scale; }
+    
+    // 图层：编号越大越靠上，新建的图层放在最上面并成为当前图层
+    static const int kMaxLayers = 16;
+    int AddLayer();  // 已达上限时返回 -1
+    int GetLayerCount() const { return int(m_layers.size()); }
+    const drawing::Layer& GetLayer(int layer) const { return m_layers[layer]; }
+    void SetActiveLayer(int layer) { m_activeLayer = layer; }
+    int GetActiveLayer() const { return m_activeLayer; }
+    void SetLayerVisible(int layer, bool visible);
+    void SetLayerOpacity(int layer, int opacity);  // 0-255
+    void SetLayerBlend(int layer, drawing::BlendMode blend);
+    
+    // 回放绘制过程：跳转和播放都会进入回放模式，期间不能绘制；
+    // 播放到末尾时停在最后一帧，StopPlayback() 回到正常编辑
+    void SeekPlayback(double timeMs);
+    void SetPlaybackRunning(bool run);  // 在末尾开始播放时从头开始
+    void StopPlayback();
+    void SetPlaybackSpeed(double speed) { m_playSpeed = speed; }
+    bool IsPlaying() const { return m_playing; }
+    bool IsPlaybackRunning() const { return m_playRunning; }
+    double GetPlaybackTime() const { return m_playTime; }
+    double GetPlaybackDuration() const { return m_timeline.GetDuration(); }
+    
+    unsigned long GetBackgroundCacheHits() const { return m_bgCacheHits; }
+    unsigned long GetBackgroundCacheRebuilds() const { return m_bgCacheRebuilds; }
+};
+
+// 笔画输入管线参数对话框
+class StrokeOptionsDialog : public wxDialog {
+public:
+    StrokeOptionsDialog(wxWindow* parent, const drawing::StrokeFilterOptions& options);
+    
+    drawing::StrokeFilterOptions GetOptions() const;
+
+private:
+    wxSpinCtrlDouble* m_minDistance;
+    wxSpinCtrlDouble* m_smoothing;
+    wxSpinCtrlDouble* m_tolerance;
+};
+
+// 后台导出图像：光栅化和编码都在这个线程上进行，UI 线程只接收进度事件
+wxDEFINE_EVENT(EVT_EXPORT_PROGRESS, wxThreadEvent);  // GetInt(): 0-100 光栅化进度，-1 表示正在编码
+wxDEFINE_EVENT(EVT_EXPORT_DONE, wxThreadEvent);      // GetInt(): 1 成功，0 失败，-1 已取消
+
+// 回放的每一帧和状态变化都由 DrawPanel 向上发出，界面据此更新进度条和按钮
+wxDEFINE_EVENT(EVT_PLAYBACK, wxCommandEvent);
+
+class ExportThread : public wxThread {
+public:
+    ExportThread(wxEvtHandler* handler, drawing::StrokeSnapshot& snapshot,
+                 const drawing::StrokeBox& area, double scale, const CanvasTheme& theme,
+                 const wxString& path, wxBitmapType type);
+    
+    void Cancel() { m_cancel = true; }
+    bool IsCancelled() const { return m_cancel; }
+    void ReportEncoded(size_t bytes);
+    
+protected:
+    virtual ExitCode Entry();
+    
+private:
+    wxEvtHandler* m_handler;
+    drawing::StrokeSnapshot m_snapshot;
+    drawing::StrokeBox m_area;
+    double m_scale;
+    uint32_t m_top;
+    uint32_t m_bottom;
+    wxString m_path;
+    wxBitmapType m_type;
+    std::atomic<bool> m_cancel;
+    size_t m_encoded;      // 已编码的字节数
+    size_t m_lastPulse;
+    
+    void PostProgress(int value);
+    ExitCode Finish(int result, const wxString& message);
+};
+
+class MyApp : public wxApp {
+public:
+    virtual bool OnInit();
+    virtual int OnExit();
+};
+
+class MyFrame : public wxFrame {
+public:
+    MyFrame();
+
+private:
+    DrawPanel* m_drawPanel;
+    wxSlider* m_sizeSlider;
+    wxColourPickerCtrl* m_colorPicker;
+    wxChoice* m_layerChoice;
+    wxCheckBox* m_layerVisible;
+    wxSlider* m_layerOpacity;
+    wxChoice* m_layerBlend;
+    wxButton* m_playButton;
+    wxSlider* m_playSlider;
+    int m_penSize;
+    wxColour m_penColor;
+    wxString m_currentFile;
+    ExportThread* m_exportThread;        // 正在进行的导出，没有时为 NULL
+    wxProgressDialog* m_exportProgress;
+    
+    void OnOpen(wxCommandEvent& event);
+    void OnSave(wxCommandEvent& event);
+    void OnSaveAs(wxCommandEvent& event);
+    void SaveTo(const wxString& path);
+    void OnDrawMode(wxCommandEvent& event);
+    void OnClear(wxCommandEvent& event);
+    void OnSizeChanged(wxCommandEvent& event);
+    void OnColorChanged(wxColourPickerEvent& event);
+    void OnLayerSelect(wxCommandEvent& event);
+    void OnLayerAdd(wxCommandEvent& event);
+    void OnLayerVisible(wxCommandEvent& event);
+    void OnLayerOpacity(wxCommandEvent& event);
+    void OnLayerBlend(wxCommandEvent& event);
+    void SyncLayerControls();
+    void OnPlay(wxCommandEvent& event);
+    void OnPlaySeek(wxCommandEvent& event);
+    void OnPlaySpeed(wxCommandEvent& event);
+    void OnPlayStop(wxCommandEvent& event);
+    void OnPlayback(wxCommandEvent& event);
+    void OnStrokeOptions(wxCommandEvent& event);
+    void OnBatchedRendering(wxCommandEvent& event);
+    void OnCompareRender(wxCommandEvent& event);
+    void OnRenderBackend(wxCommandEvent& event);
+    void OnFrameRate(wxCommandEvent& event);
+    void OnShowStats(wxCommandEvent& event);
+    void OnExportStats(wxCommandEvent& event);
+    void OnRecordTrace(wxCommandEvent& event);
+    void OnUndo(wxCommandEvent& event);
+    void OnRedo(wxCommandEvent& event);
+    void OnUndoAll(wxCommandEvent& event);
+    void OnHistoryLimit(wxCommandEvent& event);
+    void OnFillTolerance(wxCommandEvent& event);
+    void OnUpdateUndoRedo(wxUpdateUIEvent& event);
+    void OnExportImage(wxCommandEvent& event);
+    void OnExportSvg(wxCommandEvent& event);
+    void OnExportProgress(wxThreadEvent& event);
+    void OnExportDone(wxThreadEvent& event);
+    void OnUpdateExport(wxUpdateUIEvent& event);
+    void OnClose(wxCloseEvent& event);
+    void OnZoom(wxCommandEvent& event);
+    
+    enum {
+        ID_MODE_FREE = 1,
+        ID_MODE_RECT,
+        ID_MODE_CIRCLE,
+        ID_MODE_LINE,
+        ID_MODE_ERASER,
+        ID_MODE_SELECT,
+        ID_MODE_FILL,
+        ID_CLEAR,
+        ID_SIZE_SLIDER,
+        ID_LAYER_CHOICE,
+        ID_LAYER_ADD,
+        ID_LAYER_VISIBLE,
+        ID_LAYER_OPACITY,
+        ID_LAYER_BLEND,
+        ID_PLAY,
+        ID_PLAY_SLIDER,
+        ID_PLAY_SPEED,
+        ID_PLAY_STOP,
+        ID_STROKE_OPTIONS,
+        ID_BATCHED_RENDER,
+        ID_COMPARE_RENDER,
+        ID_BACKEND_DC,
+        ID_BACKEND_TILES,
+        ID_UNDO_ALL,
+        ID_HISTORY_LIMIT,
+        ID_FILL_TOLERANCE,
+        ID_EXPORT_IMAGE,
+        ID_EXPORT_SVG,
+        ID_FRAME_60,
+        ID_FRAME_120,
+        ID_FRAME_UNPACED,
+        ID_SHOW_STATS,
+        ID_EXPORT_STATS,
+        ID_RECORD_TRACE
+    };
+};
+
+// ==================== DrawPanel 实现 ====================
+
+const uint32_t DrawPanel::kNoRecord;
+
+DrawPanel::DrawPanel(wxWindow* parent)
+    : wxPanel(parent, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxFULL_REPAINT_ON_RESIZE),
+      m_currentStroke(0), m_penStyle(0x0000FF, 2), m_strokeRawStart(0),
+      m_rawPoints(0), m_keptPoints(0),
+      m_drawing(false), m_erasing(false), m_drawMode(MODE_FREE), m_shaping(false),
+      m_fillTolerance(32),
+      m_selected(0), m_hasSelection(false), m_lodLevel(0), m_panning(false),
+      m_frameTimer(this), m_frameRate(60),
+      m_inputTime(-1), m_showStats(false), m_statsTimer(this),
+      m_recording(false), m_traceStart(0),
+      m_history(m_strokes), m_bulkUpdate(false), m_pendingCount(0), m_batchedRendering(true),
+      m_renderBackend(BACKEND_DC), m_tileBgStale(true), m_activeLayer(0),
+      m_playing(false), m_playRunning(false), m_playTimer(this), m_playTime(0), m_playSpeed(1),
+      m_playLastTick(0), m_playFrameValid(false),
+      m_bgCacheHits(0), m_bgCacheRebuilds(0), m_bgCacheUsed(false) {
+    
+    SetBackgroundStyle(wxBG_STYLE_PAINT);  // 避免闪烁
+    ResetLayers(1);
+    
+    Bind(wxEVT_PAINT, &DrawPanel::OnPaint, this);
+    Bind(wxEVT_LEFT_DOWN, &DrawPanel::OnMouseDown, this);
+    Bind(wxEVT_MOTION, &DrawPanel::OnMouseMove, this);
+    Bind(wxEVT_LEFT_UP, &DrawPanel::OnMouseUp, this);
+    Bind(wxEVT_ERASE_BACKGROUND, &DrawPanel::OnEraseBackground, this);
+    Bind(wxEVT_SIZE, &DrawPanel::OnSize, this);
+    Bind(wxEVT_MOUSEWHEEL, &DrawPanel::OnMouseWheel, this);
+    Bind(wxEVT_MIDDLE_DOWN, &DrawPanel::OnMiddleDown, this);
+    Bind(wxEVT_MIDDLE_UP, &DrawPanel::OnMiddleUp, this);
+    Bind(wxEVT_TIMER, &DrawPanel::OnFrameTimer, this, m_frameTimer.GetId());
+    Bind(wxEVT_TIMER, &DrawPanel::OnStatsTimer, this, m_statsTimer.GetId());
+    Bind(wxEVT_TIMER, &DrawPanel::OnPlayTimer, this, m_playTimer.GetId());
+    m_playPos.stroke = m_playPos.points = 0;
+}
+
+void DrawPanel::OnEraseBackground(wxEraseEvent& event) {
+    // 不做任何事，避免闪烁
+}
+
+void DrawPanel::OnPaint(wxPaintEvent& event) {
+    double paintStart = drawing::NowMs();
+    wxPaintDC dc(this);
+    
+    // 回放时显示回放帧，后台缓冲保持不动，结束回放后直接可用
+    if (m_playing) {
+        wxSize size = GetClientSize();
+        size.IncTo(wxSize(1, 1));
+        if (!m_playFrameValid || m_playFrame.GetSize() != size) {
+            RebuildPlayFrame();
+        }
+        wxMemoryDC memDC(m_playFrame);
+        for (wxRegionIterator upd(GetUpdateRegion()); upd; ++upd) {
+            wxRect r = upd.GetRect();
+            dc.Blit(r.x, r.y, r.width, r.height, &memDC, r.x, r.y);
+        }
+        return;
+    }
+    
+    // 更新区域碎成多少个矩形都只算一帧；对比测试留下的标记在这里清掉
+    unsigned long rebuilds = m_bgCacheRebuilds;
+    m_bgCacheUsed = false;
+    EnsureBackBuffer();
+    
+    wxMemoryDC memDC(m_backBuffer);
+    
+    // 先修复后台缓冲里过期的区域（例如被擦除的笔画），
+    // 通过空间索引只重画与这些区域相交的笔画
+    if (!m_staleRegion.IsEmpty()) {
+        for (wxRegionIterator it(m_staleRegion); it; ++it) {
+            RenderRegion(memDC, it.GetRect());
+        }
+        m_staleRegion.Clear();
+    }
+    if (m_bgCacheUsed && m_bgCacheRebuilds == rebuilds) {
+        m_bgCacheHits++;
+    }
+    
+    // 后台缓冲已经包含全部内容，这里只把无效区域拷贝到屏幕，
+    // 代价只与脏矩形面积有关，与已绘制的点数无关
+    for (wxRegionIterator upd(GetUpdateRegion()); upd; ++upd) {
+        wxRect r = upd.GetRect();
+        dc.Blit(r.x, r.y, r.width, r.height, &memDC, r.x, r.y);
+        m_frame.dirtyPixels += uint64_t(r.width) * r.height;
+    }
+    
+    // 选中框只画在屏幕上，不进入后台缓冲
+    if (m_hasSelection) {
+        dc.SetPen(GetGdiCache().GetPen(wxColour(255, 0, 0), 1, wxPENSTYLE_SHORT_DASH));
+        dc.SetBrush(*wxTRANSPARENT_BRUSH);
+        dc.DrawRectangle(GetStrokeRect(m_selected));
+    }
+    
+    // 形状预览也只画在屏幕上
+    if (m_shaping) {
+        DrawShapePreview(dc);
+    }
+    
+    // 记录这一帧；叠加层自身的绘制不计入
+    double now = drawing::NowMs();
+    m_frame.paintMs += now - paintStart;
+    m_frame.timeMs = now;
+    m_frame.latencyMs = m_inputTime >= 0 ? now - m_inputTime : -1;
+    m_frameStats.Add(m_frame);
+    m_frame = drawing::FrameSample();
+    m_inputTime = -1;
+    
+    if (m_showStats) {
+        DrawStatsOverlay(dc);
+    }
+}
+
+void DrawPanel::EnsureBackBuffer() {
+    wxSize size = GetClientSize();
+    size.IncTo(wxSize(1, 1));  // 0 尺寸的位图无效
+    
+    if (!m_backBuffer.IsOk() || m_backBuffer.GetSize() != size) {
+        RebuildBackBuffer();
+    }
+}
+
+void DrawPanel::RebuildBackBuffer() {
+    wxSize size = GetClientSize();
+    size.IncTo(wxSize(1, 1));
+    m_backBuffer.Create(size.x, size.y);
+    
+    // 完整重绘一次：只在首次显示、尺寸变化或清空时发生。
+    // 逐层合成时每个图层也都重新光栅化（隐藏的图层等到显示时）
+    if (IsLayered()) {
+        for (size_t i = 0; i < m_layers.size(); i++) {
+            m_layers[i].raster.ResetInk();
+            m_layerStale[i] = wxRegion(wxRect(size));
+        }
+    }
+    {
+        wxMemoryDC memDC(m_backBuffer);
+        RenderRegion(memDC, wxRect(size));
+    }
+    m_staleRegion.Clear();
+    
+    UpdateStatus();
+}
+
+// 绘制一个区域之前：准备好背景缓存，解码进入区域的笔画
+void DrawPanel::PrepareRegion(const wxRect& rect) {
+    // 背景层未命中时（还没收到过 wxEVT_SIZE）才现场生成
+    wxSize size = GetClientSize();
+    size.IncTo(wxSize(1, 1));
+    if (!m_bgCache.IsOk() || m_bgCacheSize != size || m_bgCacheTheme != m_theme) {
+        UpdateBackgroundCache();
+    }
+    m_bgCacheUsed = true;  // 命中按帧统计，在 OnPaint 里计数
+    
+    // 打开的文件里还没解码的笔画，进入重绘区域时才解码
+    if (m_pendingCount > 0) {
+        LoadPending(m_view.ToWorld(ToStrokeBox(rect)));
+    }
+}
+
+void DrawPanel::RenderRegion(wxDC& dc, const wxRect& rect) {
+    PrepareRegion(rect);
+    
+    if (IsLayered()) {
+        RenderRegionLayered(dc, rect);
+        return;
+    }
+    if (m_renderBackend == BACKEND_TILES) {
+        RenderRegionTiled(dc, rect);
+        return;
+    }
+    RenderRegionDC(dc, rect);
+}
+
+// wxDC 后端：背景位图 + 逐条笔画，m_batchedRendering 决定笔画按整条还是逐段提交
+void DrawPanel::RenderRegionDC(wxDC& dc, const wxRect& rect) {
+    // 正在绘制的笔画还没有进入索引，单独交给它
+    GetDcRenderer().RenderRegion(dc, rect, m_bgCache, m_strokes, m_index, m_frame,
+                                 m_drawing ? &m_currentStroke : NULL);
+}
+
+void DrawPanel::RenderRegionTiled(wxDC& dc, const wxRect& rect) {
+    if (!m_tiles) {
+        m_tiles.reset(new drawing::TileRenderer());
+    }
+    
+    // 光栅化在工作线程上进行，不能碰 wxBitmap，背景转成 RGB 数据交给它
+    if (m_tileBgStale || !m_tiles->HasBackground(m_bgCacheSize.x, m_bgCacheSize.y)) {
+        drawing::ScopedTimer timer(m_frame.backgroundMs);
+        m_tiles->SetBackground(m_bgImage.GetData(), m_bgImage.GetWidth(), m_bgImage.GetHeight());
+        m_tileBgStale = false;
+    }
+    
+    // 在 UI 线程上按块分箱，然后所有块并行光栅化，期间 UI 线程等待。
+    // 块里的背景填充也在光栅化中完成，统计时计入笔画
+    drawing::ScopedTimer timer(m_frame.strokesMs);
+    m_tileExtra.clear();
+    if (m_drawing) {
+        m_tileExtra.push_back(m_currentStroke);
+    }
+    m_tiles->SetView(m_view, &m_lod, m_lodLevel);
+    m_tiles->PrepareJobs(ToStrokeBox(rect), m_strokes, m_index, m_tileExtra, m_tileJobs);
+    BuildTileLods();
+    m_tiles->Render(m_strokes, m_tileJobs);
+    
+    // 只有与 rect 相交的块被重画，结果逐块拷贝进目标 DC
+    for (size_t i = 0; i < m_tileJobs.size(); i++) {
+        drawing::TileJob& job = m_tileJobs[i];
+        wxImage image(job.width, job.height, &job.rgb[0], true);  // 不拷贝，不接管内存
+        dc.DrawBitmap(wxBitmap(image), job.x, job.y);
+    }
+}
+
+void DrawPanel::BuildTileLods() {
+    // 工作线程只读 LOD，需要的级别先在这里生成好
+    for (size_t i = 0; i < m_tileJobs.size(); i++) {
+        const std::vector<drawing::StrokeId>& ids = m_tileJobs[i].strokes;
+        for (size_t k = 0; k < ids.size(); k++) {
+            const std::vector<drawing::StrokePoint>* lod = NULL;
+            if (m_lodLevel > 0 && !(m_drawing && ids[k] == m_currentStroke)) {
+                lod = m_lod.Build(m_strokes, ids[k], m_lodLevel);
+            }
+            size_t count = lod ? lod->size() : m_strokes.Get(ids[k]).count;
+            m_frame.segments += uint32_t(count > 1 ? count - 1 : 1);
+        }
+    }
+}
+
+// ==================== 图层 ====================
+
+void DrawPanel::RenderRegionLayered(wxDC& dc, const wxRect& rect) {
+    // 先补上各图层过期的部分，通常只有正在编辑的那个图层有
+    UpdateLayerRasters();
+    
+    wxRect r = rect;
+    r.Intersect(wxRect(m_bgCacheSize));
+    if (r.IsEmpty()) {
+        return;
+    }
+    
+    // 背景 + 可见图层合成到 RGBX 缓冲，再一次画进目标 DC。合成计入笔画耗时
+    drawing::ScopedTimer timer(m_frame.strokesMs);
+    size_t pixels = size_t(r.width) * r.height;
+    m_composite.resize(pixels * 4);
+    const unsigned char* bg = m_bgImage.GetData();
+    for (int y = 0; y < r.height; y++) {
+        drawing::RgbToRgbx(bg + (size_t(r.y + y) * m_bgImage.GetWidth() + r.x) * 3,
+                           &m_composite[size_t(y) * r.width * 4], r.width);
+    }
+    drawing::CompositeLayers(m_layers, ToStrokeBox(r), &m_composite[0]);
+    
+    m_compositeRgb.resize(pixels * 3);
+    drawing::RgbxToRgb(&m_composite[0], &m_compositeRgb[0], int(pixels));
+    wxImage image(r.width, r.height, &m_compositeRgb[0], true);
+    dc.DrawBitmap(wxBitmap(image), r.x, r.y);
+}
+
+void DrawPanel::UpdateLayerRasters() {
+    for (size_t i = 0; i < m_layers.size(); i++) {
+        drawing::LayerRaster& raster = m_layers[i].raster;
+        if (!raster.HasSize(m_bgCacheSize.x, m_bgCacheSize.y)) {
+            raster.Resize(m_bgCacheSize.x, m_bgCacheSize.y);
+            m_layerStale[i] = wxRegion(wxRect(m_bgCacheSize));
+        }
+        // 隐藏的图层不参与合成，过期的部分留到显示时再光栅化
+        if (!m_layers[i].visible || m_layerStale[i].IsEmpty()) {
+            continue;
+        }
+        for (wxRegionIterator it(m_layerStale[i]); it; ++it) {
+            RasterizeLayerRect(int(i), it.GetRect());
+        }
+        m_layerStale[i].Clear();
+    }
+}
+
+void DrawPanel::RasterizeLayerRect(int layer, const wxRect& rect) {
+    if (!m_tiles) {
+        m_tiles.reset(new drawing::TileRenderer());
+    }
+    
+    // 与分块后端共用渲染器：透明背景，只分箱这个图层的笔画
+    m_tiles->SetTransparentBackground();
+    m_tileBgStale = true;
+    m_tileExtra.clear();
+    if (m_drawing) {
+        m_tileExtra.push_back(m_currentStroke);
+    }
+    m_tiles->SetView(m_view, &m_lod, m_lodLevel);
+    m_tiles->PrepareJobs(ToStrokeBox(rect), m_strokes, m_index, m_tileExtra, m_tileJobs, layer);
+    BuildTileLods();
+    m_tiles->Render(m_strokes, m_tileJobs);
+    
+    drawing::LayerRaster& raster = m_layers[layer].raster;
+    for (size_t i = 0; i < m_tileJobs.size(); i++) {
+        raster.Store(m_tileJobs[i]);
+    }
+}
+
+static std::string LayerName(int layer) {
+    return std::string(wxString::Format("图层 %d", layer + 1).utf8_str());
+}
+
+void DrawPanel::ResetLayers(int count) {
+    m_layers.clear();
+    m_layerStale.clear();
+    for (int i = 0; i < count; i++) {
+        m_layers.push_back(drawing::Layer(LayerName(i)));
+        m_layerStale.push_back(wxRegion());
+    }
+    m_activeLayer = 0;
+}
+
+int DrawPanel::AddLayer() {
+    if (int(m_layers.size()) >= kMaxLayers) {
+        return -1;
+    }
+    bool wasLayered = IsLayered();
+    int layer = int(m_layers.size());
+    m_layers.push_back(drawing::Layer(LayerName(layer)));
+    m_layerStale.push_back(wxRegion());
+    m_activeLayer = layer;
+    
+    // 新图层是空的，不需要光栅化；第一次进入逐层合成时才整体重画
+    if (!wasLayered) {
+        m_backBuffer = wxNullBitmap;
+        Refresh(false);
+    }
+    return layer;
+}
+
+void DrawPanel::SetLayerVisible(int layer, bool visible) {
+    if (m_layers[layer].visible == visible) {
+        return;
+    }
+    bool wasLayered = IsLayered();
+    m_layers[layer].visible = visible;
+    m_playFrameValid = false;
+    RecompositeLayer(layer, wasLayered);
+}
+
+void DrawPanel::SetLayerOpacity(int layer, int opacity) {
+    opacity = std::max(0, std::min(255, opacity));
+    if (m_layers[layer].opacity == opacity) {
+        return;
+    }
+    bool wasLayered = IsLayered();
+    m_layers[layer].opacity = opacity;
+    RecompositeLayer(layer, wasLayered);
+}
+
+void DrawPanel::SetLayerBlend(int layer, drawing::BlendMode blend) {
+    if (m_layers[layer].blend == blend) {
+        return;
+    }
+    bool wasLayered = IsLayered();
+    m_layers[layer].blend = blend;
+    RecompositeLayer(layer, wasLayered);
+}
+
+void DrawPanel::RecompositeLayer(int layer, bool wasLayered) {
+    // 在直接绘制和逐层合成之间切换时整体重画一次
+    if (wasLayered != IsLayered()) {
+        m_backBuffer = wxNullBitmap;
+        Refresh(false);
+        return;
+    }
+    
+    // 其余情况只重新合成这个图层可能有内容的范围，不重新光栅化任何图层；
+    // 隐藏期间过期的部分在显示时由 UpdateLayerRasters() 补上
+    wxRect area;
+    const drawing::StrokeBox& ink = m_layers[layer].raster.GetInk();
+    if (!ink.IsEmpty()) {
+        area = ToWxRect(ink);
+    }
+    if (!m_layerStale[layer].IsEmpty()) {
+        area.Union(m_layerStale[layer].GetBox());
+    }
+    area.Intersect(wxRect(GetClientSize()));
+    if (!area.IsEmpty()) {
+        m_staleRegion.Union(area);
+        RefreshRect(area, false);
+    }
+}
+
+// 当前图层隐藏时不能在上面画，也不能擦
+bool DrawPanel::CheckActiveLayerVisible() {
+    if (m_layers[m_activeLayer].visible) {
+        return true;
+    }
+    wxFrame* frame = wxDynamicCast(wxGetTopLevelParent(this), wxFrame);
+    if (frame && frame->GetStatusBar()) {
+        frame->SetStatusText("当前图层已隐藏", 0);
+    }
+    return false;
+}
+
+void DrawPanel::SetRenderBackend(int backend) {
+    if (backend == m_renderBackend) {
+        return;
+    }
+    m_renderBackend = backend;
+    m_backBuffer = wxNullBitmap;  // 用新后端完整重绘一次
+    Refresh(false);
+}
+
+void DrawPanel::InvalidateCanvas(const wxRect& rect, int layer) {
+    m_staleRegion.Union(rect);
+    m_playFrameValid = false;
+    if (IsLayered()) {
+        for (size_t i = 0; i < m_layers.size(); i++) {
+            if (layer == drawing::kAllLayers || int(i) == layer) {
+                m_layerStale[i].Union(rect);
+            }
+        }
+    }
+    RefreshRect(rect, false);
+}
+
+// 笔画在屏幕上覆盖的矩形
+wxRect DrawPanel::GetStrokeRect(drawing::StrokeId id) const {
+    return ToWxRect(m_view.PaintedBox(m_strokes, id));
+}
+
+// 把当前的视图、细节级别和提交方式交给共用的 wxDC 绘制代码
+DcStrokeRenderer& DrawPanel::GetDcRenderer() {
+    m_dcRenderer.SetOptions(m_view, &m_lod, m_lodLevel, m_batchedRendering);
+    return m_dcRenderer;
+}
+
+void DrawPanel::DrawStroke(wxDC& dc, drawing::StrokeId id) {
+    // 正在绘制的笔画还在变化，不生成 LOD
+    GetDcRenderer().DrawStroke(dc, m_strokes, id, m_frame, m_drawing && id == m_currentStroke);
+}
+
+void DrawPanel::CompareRenderPaths(int repeats, double& batchedMs, double& perSegmentMs) {
+    // 在同一份笔画数据上分别用两种方式完整重绘，画到临时位图里，不影响屏幕。
+    // 分块和分层渲染都不看 m_batchedRendering，所以这里总是直接走 wxDC 路径
+    wxSize size = GetClientSize();
+    size.IncTo(wxSize(1, 1));
+    wxBitmap scratch(size.x, size.y);
+    wxMemoryDC memDC(scratch);
+    PrepareRegion(wxRect(size));
+    
+    // 对比测试不计入帧统计：先存下这一帧已经累计的数据，结束后原样放回
+    drawing::FrameSample frame = m_frame;
+    bool saved = m_batchedRendering;
+    for (int pass = 0; pass < 2; pass++) {
+        m_batchedRendering = (pass == 0);
+        
+        wxStopWatch sw;
+        for (int i = 0; i < repeats; i++) {
+            RenderRegionDC(memDC, wxRect(size));
+        }
+        double ms = double(sw.Time()) / repeats;
+        (pass == 0 ? batchedMs : perSegmentMs) = ms;
+    }
+    m_batchedRendering = saved;
+    m_frame = frame;
+}
+
+void DrawPanel::DrawSegments(const std::vector<wxPoint>& points,
+                             const drawing::StrokeStyle& style) {
+    // 新线段只光栅化一次，直接画进后台缓冲（points 是屏幕坐标）。
+    // 一帧里的多段作为一条折线提交，转角处也能正确连接
+    drawing::ScopedTimer paintTimer(m_frame.paintMs);
+    drawing::ScopedTimer strokesTimer(m_frame.strokesMs);
+    m_frame.segments += uint32_t(points.size() - 1);
+    
+    // 只刷新这些线段的包围盒（外扩画笔宽度以覆盖线帽）
+    wxRect dirty(points[0], points[0]);
+    for (size_t i = 1; i < points.size(); i++) {
+        dirty.Union(wxRect(points[i], points[i]));
+    }
+    dirty.Inflate(m_view.ScaleWidth(style.width) + 1);
+    
+    // 逐层合成时新线段可能被上面的图层盖住，也要按图层的不透明度显示，
+    // 所以重新光栅化当前图层的这一小块再合成，而不是直接画进后台缓冲
+    if (IsLayered()) {
+        InvalidateCanvas(dirty, m_strokes.GetLayer(m_currentStroke));
+        return;
+    }
+    {
+        wxMemoryDC memDC(m_backBuffer);
+        GetDcRenderer().DrawSegments(memDC, &points[0], points.size(), style);
+    }
+    RefreshRect(dirty, false);
+}
+
+void DrawPanel::SetPen(int size, const wxColour& colour) {
+    // 只影响之后的新笔画，已有笔画保留各自的样式
+    m_penStyle = drawing::StrokeStyle(ToStrokeColour(colour), size);
+}
+
+void DrawPanel::Clear() {
+    // 进行中的操作先正常结束，让它也进入历史；还没松开的形状直接放弃
+    FlushInput();
+    if (m_shaping) {
+        m_shaping = false;
+        RefreshRect(m_previewRect, false);
+    }
+    if (m_drawing) {
+        m_drawing = false;
+        CommitStroke();
+    }
+    if (m_erasing) {
+        m_erasing = false;
+        if (!m_erasedIds.empty()) {
+            m_history.Record(drawing::StrokeHistory::ERASE, m_erasedIds);
+            m_erasedIds.clear();
+        }
+    }
+    if (HasCapture()) {
+        ReleaseMouse();
+    }
+    
+    // 清空只是把所有可见笔画隐藏，撤销时再显示出来
+    std::vector<drawing::StrokeId> ids;
+    for (size_t id = 0; id < m_strokes.GetStrokeCount(); id++) {
+        if (!m_strokes.IsErased(drawing::StrokeId(id))) {
+            ids.push_back(drawing::StrokeId(id));
+        }
+    }
+    if (ids.empty()) {
+        return;
+    }
+    
+    m_bulkUpdate = true;
+    for (size_t i = 0; i < ids.size(); i++) {
+        HideStroke(ids[i]);
+    }
+    EndUpdate();
+    m_history.Record(drawing::StrokeHistory::CLEAR, ids);
+    UpdateStatus();
+}
+
+// ==================== 撤销 / 重做 ====================
+
+void DrawPanel::ShowStroke(drawing::StrokeId id) {
+    m_strokes.Restore(id);
+    if (id < m_inputPoints.size() && m_inputPoints[id] > 0) {
+        m_rawPoints += m_inputPoints[id];
+        m_keptPoints += m_strokes.Get(id).count;
+    }
+    m_index.Insert(id, drawing::GetPaintedBox(m_strokes, id));
+    if (!m_bulkUpdate) {
+        InvalidateCanvas(GetStrokeRect(id), m_strokes.GetLayer(id));
+    }
+}
+
+void DrawPanel::HideStroke(drawing::StrokeId id) {
+    wxRect rect = GetStrokeRect(id);
+    m_index.Remove(id, drawing::GetPaintedBox(m_strokes, id));
+    if (id < m_inputPoints.size() && m_inputPoints[id] > 0) {
+        m_rawPoints -= m_inputPoints[id];
+        m_keptPoints -= m_strokes.Get(id).count;
+    }
+    m_strokes.Erase(id);
+    m_lod.Invalidate(id);  // 隐藏的笔画不占 LOD 内存，再显示时按需重建
+    if (m_hasSelection && m_selected == id) {
+        m_hasSelection = false;
+    }
+    if (!m_bulkUpdate) {
+        InvalidateCanvas(rect, m_strokes.GetLayer(id));  // 只重画这条笔画覆盖的区域
+    }
+}
+
+void DrawPanel::BeginUpdate(size_t count) {
+    // 笔画很多时逐条合并脏区域反而比整体重绘慢
+    m_bulkUpdate = (count > 64);
+}
+
+void DrawPanel::EndUpdate() {
+    if (m_bulkUpdate) {
+        m_bulkUpdate = false;
+        m_hasSelection = false;
+        m_backBuffer = wxNullBitmap;
+        m_playFrameValid = false;
+        Refresh(false);
+    }
+}
+
+void DrawPanel::Undo() {
+    if (CanUndo()) {
+        m_history.Undo(*this);
+        UpdateStatus();
+    }
+}
+
+void DrawPanel::Redo() {
+    if (CanRedo()) {
+        m_history.Redo(*this);
+        UpdateStatus();
+    }
+}
+
+void DrawPanel::UndoAll() {
+    if (CanUndo()) {
+        m_history.Seek(0, *this);  // 借助检查点，不必逐条回放
+        UpdateStatus();
+    }
+}
+
+void DrawPanel::SetHistoryLimit(size_t bytes) {
+    m_history.SetLimit(bytes);
+    UpdateStatus();
+}
+
+void DrawPanel::OnSize(wxSizeEvent& event) {
+    // 背景层只在尺寸变化时重建，平时绘制直接命中缓存
+    UpdateBackgroundCache();
+    event.Skip();
+}
+
+void DrawPanel::SetTheme(const CanvasTheme& theme) {
+    if (theme == m_theme) {
+        return;
+    }
+    m_theme = theme;
+    UpdateBackgroundCache();
+    m_backBuffer = wxNullBitmap;  // 笔画需要叠加到新背景上
+    m_playFrameValid = false;
+    Refresh(false);
+}
+
+void DrawPanel::UpdateBackgroundCache() {
+    wxSize size = GetClientSize();
+    size.IncTo(wxSize(1, 1));
+    
+    if (m_bgCache.IsOk() && m_bgCacheSize == size && m_bgCacheTheme == m_theme) {
+        return;
+    }
+    
+    // 不经过 wxDC：填充内核直接写 wxImage 的像素，再转换成位图
+    if (!m_bgImage.IsOk() || m_bgImage.GetSize() != size) {
+        m_bgImage.Create(size.x, size.y, false);
+    }
+    drawing::RgbBuffer buffer(m_bgImage.GetData(), size.x, size.y);
+    {
+        drawing::ScopedTimer timer(m_frame.backgroundMs);
+        DrawBackground(buffer);
+    }
+    {
+        drawing::ScopedTimer timer(m_frame.gridMs);
+        DrawGrid(buffer);
+    }
+    {
+        drawing::ScopedTimer timer(m_frame.backgroundMs);
+        m_bgCache = wxBitmap(m_bgImage);
+    }
+    m_bgCacheSize = size;
+    m_bgCacheTheme = m_theme;
+    m_bgCacheRebuilds++;
+    m_tileBgStale = true;
+}
+
+void DrawPanel::UpdateStatus() {
+    wxFrame* frame = wxDynamicCast(wxGetTopLevelParent(this), wxFrame);
+    if (frame && frame->GetStatusBar()) {
+        frame->SetStatusText(wxString::Format("背景缓存: 命中 %lu 帧 / 重建 %lu 次",
+                                              m_bgCacheHits, m_bgCacheRebuilds), 1);
+        
+        double ratio = m_keptPoints > 0 ? double(m_rawPoints) / m_keptPoints : 1.0;
+        frame->SetStatusText(wxString::Format("输入 %lu 点 → 保存 %lu 点 (%.1fx)",
+                                              (unsigned long)m_rawPoints,
+                                              (unsigned long)m_keptPoints, ratio), 2);
+        
+        const double mb = 1024.0 * 1024.0;
+        frame->SetStatusText(wxString::Format("历史: %lu 步, %.1f / %.0f MB",
+                                              (unsigned long)m_history.GetUndoCount(),
+                                              m_history.GetMemoryUsage() / mb,
+                                              m_history.GetLimit() / mb), 3);
+        
+        frame->SetStatusText(wxString::Format("缩放 %.0f%% (LOD %d, 缓存 %lu 点)",
+                                              m_view.scale * 100, m_lodLevel,
+                                              (unsigned long)m_lod.GetPointCount()), 4);
+    }
+}
+
+void DrawPanel::DrawBackground(const drawing::RgbBuffer& buffer) {
+    // 渐变背景：效果与 GradientFillLinear(..., wxSOUTH) 相同，每行整行填充
+    drawing::FillLinearGradient(buffer, ToStrokeColour(m_theme.top),
+                                ToStrokeColour(m_theme.bottom), drawing::GRADIENT_VERTICAL);
+}
+
+void DrawPanel::DrawGrid(const drawing::RgbBuffer& buffer) {
+    // 点线网格，外观与 1 像素的 wxPENSTYLE_DOT 画笔接近
+    drawing::DrawDottedGrid(buffer, m_theme.gridStep, ToStrokeColour(m_theme.grid));
+}
+
+void DrawPanel::OnMouseDown(wxMouseEvent& event) {
+    if (m_panning || m_playing) {
+        return;
+    }
+    MarkInput();
+    m_currentPos = event.GetPosition();
+    
+    if (m_drawMode == MODE_SELECT) {
+        SelectAt(m_currentPos);
+        return;
+    }
+    if (!CheckActiveLayerVisible()) {
+        return;
+    }
+    if (m_drawMode == MODE_FILL) {
+        FillAt(m_currentPos);
+        return;
+    }
+    if (m_drawMode == MODE_ERASER) {
+        m_erasing = true;
+        EraseAt(m_currentPos);
+        CaptureMouse();
+        return;
+    }
+    if (m_drawMode == MODE_RECT || m_drawMode == MODE_CIRCLE || m_drawMode == MODE_LINE) {
+        m_shaping = true;
+        m_shapeStart = m_view.ToWorld(m_currentPos.x, m_currentPos.y);
+        m_shapeEnd = m_shapeStart;
+        m_previewRect = wxRect();
+        CaptureMouse();
+        return;
+    }
+    
+    // 输入管线在屏幕坐标上工作（抽稀距离等参数按屏幕像素计），
+    // 保存时才换算成世界坐标
+    m_drawing = true;
+    RecordInput(drawing::InputEvent::DOWN, m_currentPos);
+    m_currentStroke = m_strokes.BeginStroke(m_penStyle);
+    m_strokes.SetLayer(m_currentStroke, m_activeLayer);
+    m_strokeRawStart = m_filter.GetRawCount();
+    drawing::StrokePoint first = m_filter.Begin(ToStrokePoint(m_currentPos));
+    drawing::StrokePoint world = m_view.ToWorld(first.x, first.y);
+    m_strokes.AppendPoint(m_currentStroke, world);
+    m_timeline.BeginStroke(m_currentStroke, drawing::NowMs());
+    m_currentPos = ToWxPoint(m_view.ToScreen(world));
+    m_newSegment.clear();
+    CaptureMouse();
+}
+
+void DrawPanel::OnMouseMove(wxMouseEvent& event) {
+    // 拖动中的位置先排队，由帧定时器统一处理。时刻在这里记下，
+    // 排队等待的那一段不会算进笔画的节奏里，回放时与实际绘制一致
+    if ((m_panning || m_erasing || m_drawing || m_shaping) && event.Dragging()) {
+        if (m_drawing) {
+            RecordInput(drawing::InputEvent::MOVE, event.GetPosition());
+        }
+        QueueInput(event.GetPosition(), drawing::NowMs());
+    }
+}
+
+void DrawPanel::OnMouseUp(wxMouseEvent& event) {
+    FlushInput();  // 松开之前排队的位置先处理完
+    
+    if (m_drawing) {
+        RecordInput(drawing::InputEvent::UP, event.GetPosition());
+        drawing::StrokePoint last;
+        if (m_filter.End(ToStrokePoint(event.GetPosition()), last)) {
+            AppendStrokePoint(last, drawing::NowMs());
+            FlushSegments();
+        }
+        m_drawing = false;
+        CommitStroke();
+        ReleaseMouse();
+    } else if (m_shaping) {
+        m_shaping = false;
+        ReleaseMouse();
+        RefreshRect(m_previewRect, false);  // 去掉预览
+        m_shapeEnd = m_view.ToWorld(event.GetPosition().x, event.GetPosition().y);
+        CommitShape();
+    } else if (m_erasing) {
+        m_erasing = false;
+        ReleaseMouse();
+        
+        // 一次拖动擦掉的所有笔画作为一步撤销
+        if (!m_erasedIds.empty()) {
+            m_history.Record(drawing::StrokeHistory::ERASE, m_erasedIds);
+            m_erasedIds.clear();
+            UpdateStatus();
+        }
+    }
+}
+
+void DrawPanel::CommitStroke() {
+    // RDP 简化：保留的点是原有点的子集，新的包围盒不会超出旧的。
+    // 容差按屏幕像素给出，换算成世界单位
+    wxRect oldRect = GetStrokeRect(m_currentStroke);
+    m_strokes.CopyPoints(m_currentStroke, m_simplifyIn);
+    drawing::SimplifyPolyline(m_simplifyIn, m_filter.GetOptions().tolerance / m_view.scale,
+                              m_simplifyOut, m_simplifyKeep, m_simplifyStack);
+    if (m_simplifyOut.size() < m_simplifyIn.size()) {
+        m_strokes.ReplacePoints(m_currentStroke, m_simplifyOut);
+        InvalidateCanvas(oldRect, m_strokes.GetLayer(m_currentStroke));  // 差异在容差以内，重画一次保证屏幕与存储一致
+    }
+    m_timeline.EndStroke(m_simplifyOut.size() < m_simplifyIn.size() ? &m_simplifyKeep : NULL);
+    size_t raw = m_filter.GetRawCount() - m_strokeRawStart;
+    if (m_inputPoints.size() <= m_currentStroke) {
+        m_inputPoints.resize(m_currentStroke + 1, 0);
+    }
+    m_inputPoints[m_currentStroke] = uint32_t(raw);
+    m_rawPoints += raw;
+    m_keptPoints += m_simplifyOut.size();
+    
+    // 笔画完成后才进入索引和生成 LOD，绘制过程中点还在变化
+    m_lod.Invalidate(m_currentStroke);
+    m_index.Insert(m_currentStroke, drawing::GetPaintedBox(m_strokes, m_currentStroke));
+    m_history.Record(drawing::StrokeHistory::ADD,
+                     std::vector<drawing::StrokeId>(1, m_currentStroke));
+    UpdateStatus();
+}
+
+// ==================== 形状 ====================
+
+drawing::ShapeKind DrawPanel::GetShapeKind() const {
+    switch (m_drawMode) {
+        case MODE_RECT:   return drawing::SHAPE_RECT;
+        case MODE_CIRCLE: return drawing::SHAPE_CIRCLE;
+        default:          return drawing::SHAPE_LINE;
+    }
+}
+
+// 把当前形状展开到 m_shapePoints：screen 为 true 时是屏幕坐标（预览用），否则是世界坐标
+void DrawPanel::BuildShapePoints(bool screen) {
+    drawing::StrokePoint a = m_shapeStart, b = m_shapeEnd;
+    double tolerance = 0.5;  // 屏幕上半个像素
+    if (screen) {
+        a = m_view.ToScreen(a);
+        b = m_view.ToScreen(b);
+    } else {
+        tolerance /= m_view.scale;
+    }
+    drawing::ShapeToPolyline(GetShapeKind(), a, b, tolerance, m_shapePoints);
+}
+
+void DrawPanel::UpdateShapePreview(const drawing::StrokePoint& end) {
+    if (end.x == m_shapeEnd.x && end.y == m_shapeEnd.y) {
+        return;
+    }
+    m_shapeEnd = end;
+    
+    // 预览不进入后台缓冲：旧位置刷新后由后台缓冲恢复，新位置在 OnPaint 里叠加上去。
+    // 每次只重画新旧两个预览区域，与场景里有多少笔画无关。
+    // （XOR 绘制在 GTK3 和 macOS 上不可靠，所以用叠加的方式）
+    wxRect old = m_previewRect;
+    BuildShapePoints(true);
+    drawing::StrokeBox box;
+    for (size_t i = 0; i < m_shapePoints.size(); i++) {
+        box.Add(m_shapePoints[i]);
+    }
+    m_previewRect = ToWxRect(drawing::InflateBox(box, m_view.ScaleWidth(m_penStyle.width) / 2 + 2));
+    
+    if (!old.IsEmpty()) {
+        RefreshRect(old, false);
+    }
+    RefreshRect(m_previewRect, false);
+}
+
+void DrawPanel::DrawShapePreview(wxDC& dc) {
+    BuildShapePoints(true);
+    if (m_shapePoints.size() < 2) {
+        return;
+    }
+    m_linePoints.clear();
+    for (size_t i = 0; i < m_shapePoints.size(); i++) {
+        m_linePoints.push_back(ToWxPoint(m_shapePoints[i]));
+    }
+    drawing::StrokeStyle style = m_penStyle;
+    style.width = m_view.ScaleWidth(style.width);
+    dc.SetPen(GetStrokePen(style));
+    dc.DrawLines(int(m_linePoints.size()), &m_linePoints[0]);
+}
+
+void DrawPanel::CommitShape() {
+    BuildShapePoints(false);
+    if (m_shapePoints.size() < 2) {
+        return;  // 只点了一下，没有拖动
+    }
+    
+    // 形状就是一条普通笔画：同样进入空间索引和撤销历史，
+    // 重绘时也经过同样的剔除，只重画它覆盖的区域
+    drawing::StrokeId id = m_strokes.BeginStroke(m_penStyle);
+    m_strokes.SetLayer(id, m_activeLayer);
+    for (size_t i = 0; i < m_shapePoints.size(); i++) {
+        m_strokes.AppendPoint(id, m_shapePoints[i]);
+    }
+    m_timeline.AddStroke(id, m_shapePoints.size(), 0, drawing::NowMs());
+    m_index.Insert(id, drawing::GetPaintedBox(m_strokes, id));
+    m_history.Record(drawing::StrokeHistory::ADD, std::vector<drawing::StrokeId>(1, id));
+    InvalidateCanvas(GetStrokeRect(id), m_activeLayer);
+    UpdateStatus();
+}
+
+void DrawPanel::EraseAt(const wxPoint& screenPt) {
+    // 命中范围按屏幕像素给出，换算到世界坐标里测试
+    const int radius = int(std::ceil(std::max(4, m_penStyle.width) / m_view.scale));
+    drawing::StrokePoint pt = m_view.ToWorld(screenPt.x, screenPt.y);
+    drawing::StrokeBox probe;
+    probe.Add(pt);
+    
+    // 索引只给出候选笔画，再逐段精确判断
+    m_index.Query(drawing::InflateBox(probe, radius), m_queryIds);
+    for (size_t i = 0; i < m_queryIds.size(); i++) {
+        drawing::StrokeId id = m_queryIds[i];
+        if (m_strokes.GetLayer(id) != m_activeLayer) {
+            continue;  // 只擦当前图层
+        }
+        EnsureLoaded(id);
+        if (!drawing::HitTestStroke(m_strokes, id, pt.x, pt.y, radius)) {
+            continue;
+        }
+        HideStroke(id);
+        m_erasedIds.push_back(id);
+    }
+}
+
+void DrawPanel::SelectAt(const wxPoint& screenPt) {
+    const int radius = int(std::ceil(3 / m_view.scale));
+    drawing::StrokePoint pt = m_view.ToWorld(screenPt.x, screenPt.y);
+    drawing::StrokeBox probe;
+    probe.Add(pt);
+    
+    // 选中框只画在屏幕上，刷新旧框和新框即可，后台缓冲不受影响
+    if (m_hasSelection) {
+        RefreshRect(GetStrokeRect(m_selected).Inflate(1), false);
+        m_hasSelection = false;
+    }
+    
+    // 选最上面的笔画：图层靠上的优先，同一图层里后画的优先。隐藏的图层不参与
+    m_index.Query(drawing::InflateBox(probe, radius), m_queryIds);
+    for (size_t i = m_queryIds.size(); i-- > 0; ) {
+        drawing::StrokeId id = m_queryIds[i];
+        int layer = m_strokes.GetLayer(id);
+        if (!m_layers[layer].visible ||
+            (m_hasSelection && layer <= m_strokes.GetLayer(m_selected))) {
+            continue;
+        }
+        EnsureLoaded(id);
+        if (drawing::HitTestStroke(m_strokes, id, pt.x, pt.y, radius)) {
+            m_selected = id;
+            m_hasSelection = true;
+        }
+    }
+    if (m_hasSelection) {
+        RefreshRect(GetStrokeRect(m_selected).Inflate(1), false);
+    }
+}
+
+void DrawPanel::FillAt(const wxPoint& screenPt) {
+    // 填充范围是当前视口覆盖的世界区域，区域外的笔画不会挡住填充；
+    // 只看当前图层上的笔画。
+    // 缩得很小时以点击处为中心截取，光栅的大小有上限
+    const int kMaxFillSize = 4096;
+    wxStopWatch sw;
+    drawing::StrokePoint seed = m_view.ToWorld(screenPt.x, screenPt.y);
+    drawing::StrokeBox area = GetExportArea();
+    if (area.right - area.left + 1 > kMaxFillSize) {
+        area.left = std::max(area.left, std::min(seed.x - kMaxFillSize / 2, area.right - kMaxFillSize + 1));
+        area.right = area.left + kMaxFillSize - 1;
+    }
+    if (area.bottom - area.top + 1 > kMaxFillSize) {
+        area.top = std::max(area.top, std::min(seed.y - kMaxFillSize / 2, area.bottom - kMaxFillSize + 1));
+        area.bottom = area.top + kMaxFillSize - 1;
+    }
+    if (m_pendingCount > 0) {
+        LoadPending(area);
+    }
+    
+    // 光栅和遮罩只在这次填充中使用，用完就释放（4K 视口约 30 MB）
+    if (!m_tiles) {
+        m_tiles.reset(new drawing::TileRenderer());
+    }
+    std::vector<unsigned char> raster;
+    drawing::RasterizeLayer(m_strokes, m_index, area, m_activeLayer, *m_tiles, raster);
+    m_tileBgStale = true;  // 分块后端的背景和视图都被换掉了，下次绘制时恢复
+    
+    int width = area.right - area.left + 1;
+    int height = area.bottom - area.top + 1;
+    drawing::FloodFiller filler;
+    size_t pixels = filler.Fill(drawing::RgbBuffer(&raster[0], width, height),
+                                seed.x - area.left, seed.y - area.top, m_fillTolerance, m_fillSpans);
+    if (pixels == 0) {
+        return;
+    }
+    drawing::SortSpansForRuns(m_fillSpans);
+    
+    // 每一段保存为一对点：(x0, y) 和 (x1, y)，世界坐标
+    drawing::StrokeStyle style(m_penStyle.colour, 1);
+    drawing::StrokeId id = m_strokes.BeginStroke(style, drawing::STROKE_FILL);
+    m_strokes.SetLayer(id, m_activeLayer);
+    for (size_t i = 0; i < m_fillSpans.size(); i++) {
+        const drawing::FillSpan& span = m_fillSpans[i];
+        drawing::StrokePoint a = { area.left + span.x0, area.top + span.y };
+        drawing::StrokePoint b = { area.left + span.x1, area.top + span.y };
+        m_strokes.AppendPoint(id, a);
+        m_strokes.AppendPoint(id, b);
+    }
+    m_timeline.AddStroke(id, m_fillSpans.size() * 2, 0, drawing::NowMs());
+    m_index.Insert(id, drawing::GetPaintedBox(m_strokes, id));
+    m_history.Record(drawing::StrokeHistory::ADD, std::vector<drawing::StrokeId>(1, id));
+    InvalidateCanvas(GetStrokeRect(id), m_activeLayer);
+    UpdateStatus();
+    
+    wxFrame* frame = wxDynamicCast(wxGetTopLevelParent(this), wxFrame);
+    if (frame && frame->GetStatusBar()) {
+        frame->SetStatusText(wxString::Format("填充 %lu 像素, %lu 段 (%ld ms)",
+                                              (unsigned long)pixels,
+                                              (unsigned long)m_fillSpans.size(), sw.Time()), 0);
+    }
+}
+
+// ==================== 帧调度 ====================
+
+void DrawPanel::SetFrameRate(int hz) {
+    FlushInput();
+    m_frameRate = hz;
+    m_frameTimer.Stop();  // 下一个输入事件按新的间隔重新启动
+}
+
+void DrawPanel::QueueInput(const wxPoint& pos, double timeMs) {
+    MarkInput();
+    if (m_frameRate <= 0) {
+        ApplyInput(&pos, &timeMs, 1);
+        return;
+    }
+    m_pendingInput.push_back(pos);
+    m_pendingTimes.push_back(timeMs);
+    
+    // 定时器只在有输入时运行，一帧内没有新输入就停下。
+    // 注意 Windows 上定时器精度约 15 ms，120 Hz 实际会接近 64 Hz
+    if (!m_frameTimer.IsRunning()) {
+        m_frameTimer.Start(std::max(1, 1000 / m_frameRate));
+    }
+}
+
+void DrawPanel::OnFrameTimer(wxTimerEvent& event) {
+    if (m_pendingInput.empty()) {
+        m_frameTimer.Stop();
+        return;
+    }
+    FlushInput();
+    
+    // 立即绘制这一帧，从输入到显示的延迟不超过一个帧间隔
+    Update();
+}
+
+void DrawPanel::FlushInput() {
+    if (m_pendingInput.empty()) {
+        return;
+    }
+    // 处理过程中可能再次进入事件循环，先把队列换出来
+    std::vector<wxPoint> batch;
+    std::vector<double> times;
+    batch.swap(m_pendingInput);
+    times.swap(m_pendingTimes);
+    ApplyInput(&batch[0], &times[0], batch.size());
+    
+    batch.clear();
+    times.clear();
+    if (m_pendingInput.empty()) {
+        m_pendingInput.swap(batch);  // 保留容量，下一帧不再分配
+        m_pendingTimes.swap(times);
+    }
+}
+
+void DrawPanel::ApplyInput(const wxPoint* points, const double* times, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    
+    // 平移只关心最后的位置，一帧只移动一次
+    if (m_panning) {
+        wxPoint pos = points[count - 1];
+        PanBy(pos.x - m_panLast.x, pos.y - m_panLast.y);
+        m_panLast = pos;
+        return;
+    }
+    
+    if (m_erasing) {
+        for (size_t i = 0; i < count; i++) {
+            EraseAt(points[i]);
+        }
+        return;
+    }
+    
+    // 形状预览同样只关心最后的位置
+    if (m_shaping) {
+        wxPoint pos = points[count - 1];
+        UpdateShapePreview(m_view.ToWorld(pos.x, pos.y));
+        return;
+    }
+    
+    if (m_drawing) {
+        // 抖动和重复位置在这里就被过滤掉，不进入存储也不触发重绘
+        for (size_t i = 0; i < count; i++) {
+            drawing::StrokePoint filtered;
+            if (m_filter.Add(ToStrokePoint(points[i]), filtered)) {
+                AppendStrokePoint(filtered, times[i]);
+            }
+        }
+        FlushSegments();
+    }
+}
+
+void DrawPanel::AppendStrokePoint(const drawing::StrokePoint& filtered, double timeMs) {
+    // 放大时相邻几个屏幕像素可能落在同一个世界坐标上
+    drawing::StrokePoint world = m_view.ToWorld(filtered.x, filtered.y);
+    drawing::StrokePoint last = m_strokes.GetLastPoint(m_currentStroke);
+    if (world.x == last.x && world.y == last.y) {
+        return;
+    }
+    m_strokes.AppendPoint(m_currentStroke, world);
+    m_timeline.AddPoint(timeMs);
+    
+    if (m_newSegment.empty()) {
+        m_newSegment.push_back(m_currentPos);
+    }
+    m_newSegment.push_back(ToWxPoint(m_view.ToScreen(world)));
+}
+
+void DrawPanel::FlushSegments() {
+    if (m_newSegment.size() < 2) {
+        return;
+    }
+    
+    // 尺寸刚变化时 EnsureBackBuffer 会整体重建（已包含新点），
+    // 否则只增量画出这一帧新增的线段
+    if (m_backBuffer.IsOk() && m_backBuffer.GetSize() == GetClientSize()) {
+        DrawSegments(m_newSegment, m_strokes.GetStyle(m_currentStroke));
+    } else {
+        EnsureBackBuffer();
+        Refresh(false);
+    }
+    m_currentPos = m_newSegment.back();
+    m_newSegment.clear();
+}
+
+// ==================== 回放 ====================
+
+bool DrawPanel::EnterPlayback() {
+    if (m_playing) {
+        return true;
+    }
+    if (IsBusy()) {
+        return false;
+    }
+    FlushInput();
+    m_playing = true;
+    m_playTime = 0;
+    m_playFrameValid = false;
+    Refresh(false);
+    return true;
+}
+
+void DrawPanel::SeekPlayback(double timeMs) {
+    if (!EnterPlayback()) {
+        return;
+    }
+    ShowPlaybackAt(std::max(0.0, std::min(timeMs, m_timeline.GetDuration())));
+    m_playLastTick = drawing::NowMs();
+    NotifyPlayback();
+}
+
+void DrawPanel::SetPlaybackRunning(bool run) {
+    if (!EnterPlayback()) {
+        return;
+    }
+    if (run && m_playTime >= m_timeline.GetDuration()) {
+        ShowPlaybackAt(0);
+    }
+    m_playRunning = run;
+    if (run) {
+        m_playLastTick = drawing::NowMs();
+        m_playTimer.Start(1000 / kPlaybackFps);
+    } else {
+        m_playTimer.Stop();
+    }
+    NotifyPlayback();
+}
+
+void DrawPanel::StopPlayback() {
+    if (!m_playing) {
+        return;
+    }
+    m_playTimer.Stop();
+    m_playing = false;
+    m_playRunning = false;
+    m_playFrame = wxNullBitmap;
+    m_playFrameValid = false;
+    Refresh(false);
+    NotifyPlayback();
+}
+
+void DrawPanel::OnPlayTimer(wxTimerEvent& event) {
+    // 定时器只决定帧率，推进的时间按实际经过的时间算，定时器不准时回放速度也不变
+    double now = drawing::NowMs();
+    double t = m_playTime + (now - m_playLastTick) * m_playSpeed;
+    m_playLastTick = now;
+    if (t >= m_timeline.GetDuration()) {
+        t = m_timeline.GetDuration();
+        m_playRunning = false;
+        m_playTimer.Stop();
+    }
+    ShowPlaybackAt(t);
+    NotifyPlayback();
+}
+
+void DrawPanel::ShowPlaybackAt(double timeMs) {
+    m_playTime = timeMs;
+    wxSize size = GetClientSize();
+    size.IncTo(wxSize(1, 1));
+    if (!m_playFrameValid || m_playFrame.GetSize() != size) {
+        Refresh(false);  // 绘制时重建
+        return;
+    }
+    
+    // 往回退时重建；往前走时只补画两个位置之间新露出的部分
+    drawing::PlaybackPosition pos = m_timeline.Locate(timeMs);
+    if (pos < m_playPos) {
+        m_playFrameValid = false;
+        Refresh(false);
+        return;
+    }
+    if (!(m_playPos < pos)) {
+        return;
+    }
+    m_playDirty = wxRect();
+    {
+        wxMemoryDC memDC(m_playFrame);
+        DrawPlayback(memDC, m_playPos, pos);
+    }
+    m_playPos = pos;
+    if (!m_playDirty.IsEmpty()) {
+        RefreshRect(m_playDirty, false);
+    }
+}
+
+void DrawPanel::RebuildPlayFrame() {
+    wxSize size = GetClientSize();
+    size.IncTo(wxSize(1, 1));
+    if (!m_playFrame.IsOk() || m_playFrame.GetSize() != size) {
+        m_playFrame.Create(size.x, size.y);
+    }
+    if (!m_bgCache.IsOk() || m_bgCacheSize != size || m_bgCacheTheme != m_theme) {
+        UpdateBackgroundCache();
+    }
+    
+    wxMemoryDC memDC(m_playFrame);
+    {
+        wxMemoryDC bgDC(m_bgCache);
+        memDC.Blit(0, 0, size.x, size.y, &bgDC, 0, 0);
+    }
+    
+    // 时间索引给出已经画完的笔画数（id 小于 pos.stroke），不必从头重放；
+    // 再由空间索引只取视口里的笔画，查询结果已按 id 即时间顺序排好
+    drawing::PlaybackPosition pos = m_timeline.Locate(m_playTime);
+    drawing::StrokeBox world = m_view.ToWorld(ToStrokeBox(wxRect(size)));
+    if (m_pendingCount > 0) {
+        LoadPending(world);
+    }
+    m_index.Query(world, m_queryIds);
+    for (size_t i = 0; i < m_queryIds.size() && m_queryIds[i] < pos.stroke; i++) {
+        if (IsPlaybackVisible(m_queryIds[i])) {
+            DrawStroke(memDC, m_queryIds[i]);
+        }
+    }
+    if (pos.points > 0 && pos.stroke < m_strokes.GetStrokeCount()) {
+        DrawStrokePoints(memDC, drawing::StrokeId(pos.stroke), 0, pos.points);
+    }
+    m_playPos = pos;
+    m_playFrameValid = true;
+}
+
+void DrawPanel::DrawPlayback(wxDC& dc, drawing::PlaybackPosition from,
+                             const drawing::PlaybackPosition& to) {
+    size_t count = std::min(m_strokes.GetStrokeCount(), m_timeline.GetStrokeCount());
+    wxRect client(GetClientSize());
+    
+    // 上一帧停在一条笔画中间：从它最后画到的点接着画
+    if (from.points > 0 && from.stroke < count) {
+        size_t last = to.stroke > from.stroke ? size_t(-1) : to.points;
+        DrawStrokePoints(dc, drawing::StrokeId(from.stroke), from.points - 1, last);
+        from.stroke++;
+        from.points = 0;
+    }
+    
+    // 这一帧里整条出现的笔画（播放得快时可能有很多条），视口外的直接跳过
+    for (size_t i = from.stroke; i < to.stroke && i < count; i++) {
+        drawing::StrokeId id = drawing::StrokeId(i);
+        wxRect rect = GetStrokeRect(id);
+        if (IsPlaybackVisible(id) && rect.Intersects(client)) {
+            EnsureLoaded(id);
+            DrawStroke(dc, id);
+            m_playDirty.Union(rect);
+        }
+    }
+    
+    if (to.points > 0 && to.stroke >= from.stroke && to.stroke < count) {
+        DrawStrokePoints(dc, drawing::StrokeId(to.stroke), 0, to.points);
+    }
+}
+
+void DrawPanel::DrawStrokePoints(wxDC& dc, drawing::StrokeId id, size_t first, size_t last) {
+    // 只画笔画中 [first, last) 这些点连成的折线；填充笔画总是整条出现，不会走到这里
+    if (!IsPlaybackVisible(id) || m_strokes.IsFill(id)) {
+        return;
+    }
+    EnsureLoaded(id);
+    wxRect dirty = GetDcRenderer().DrawStrokePoints(dc, m_strokes, id, first, last);
+    if (!dirty.IsEmpty()) {
+        m_playDirty.Union(dirty);
+    }
+}
+
+bool DrawPanel::IsPlaybackVisible(drawing::StrokeId id) const {
+    // 擦掉的笔画和隐藏图层上的笔画不出现；图层的不透明度和混合模式在回放中不起作用
+    return !m_strokes.IsErased(id) && m_layers[m_strokes.GetLayer(id)].visible;
+}
+
+void DrawPanel::NotifyPlayback() {
+    wxCommandEvent event(EVT_PLAYBACK, GetId());
+    event.SetEventObject(this);
+    ProcessWindowEvent(event);
+}
+
+// ==================== 性能统计 ====================
+
+void DrawPanel::MarkInput() {
+    // 只记最早的一个：一帧合并多个事件时，延迟按等得最久的那个算
+    if (m_inputTime < 0) {
+        m_inputTime = drawing::NowMs();
+    }
+}
+
+void DrawPanel::ShowStats(bool show) {
+    m_showStats = show;
+    if (show) {
+        m_statsTimer.Start(250);  // 没有输入时也每秒更新 4 次
+    } else {
+        m_statsTimer.Stop();
+    }
+    RefreshRect(GetStatsOverlayRect(), false);
+}
+
+void DrawPanel::OnStatsTimer(wxTimerEvent& event) {
+    // 叠加层不进入后台缓冲，重画它所在的区域即可
+    RefreshRect(GetStatsOverlayRect(), false);
+}
+
+wxRect DrawPanel::GetStatsOverlayRect() const {
+    const int width = 300, height = 184, margin = 8;
+    return wxRect(GetClientSize().x - width - margin, margin, width, height);
+}
+
+void DrawPanel::DrawStatsOverlay(wxWindowDC& dc) {
+    // wxGCDC 支持 alpha，叠加层半透明，下面的内容仍然可见
+    wxGCDC gdc(dc);
+    wxRect box = GetStatsOverlayRect();
+    gdc.SetPen(*wxTRANSPARENT_PEN);
+    gdc.SetBrush(GetGdiCache().GetBrush(wxColour(0, 0, 0, 170)));
+    gdc.DrawRoundedRectangle(box, 6);
+    
+    const drawing::FrameStats& stats = m_frameStats;
+    size_t count = stats.GetCount();
+    double bg = 0, grid = 0, strokes = 0, segments = 0, dirty = 0;
+    for (size_t i = 0; i < count; i++) {
+        const drawing::FrameSample& s = stats.Get(i);
+        bg += s.backgroundMs;
+        grid += s.gridMs;
+        strokes += s.strokesMs;
+        segments += s.segments;
+        dirty += double(s.dirtyPixels);
+    }
+    double n = std::max<size_t>(1, count);
+    
+    gdc.SetFont(*wxSMALL_FONT);
+    gdc.SetTextForeground(*wxWHITE);
+    int x = box.x + 8, y = box.y + 6, line = gdc.GetCharHeight() + 1;
+    
+    gdc.DrawText(wxString::Format("最近 %lu 帧（共 %llu 帧）   F3 关闭",
+                                  (unsigned long)count,
+                                  (unsigned long long)stats.GetTotalFrames()), x, y);
+    y += line;
+    gdc.DrawText(wxString::Format("绘制 p50 %.2f  p95 %.2f  p99 %.2f ms",
+                                  stats.Percentile(50, &drawing::FrameSample::paintMs),
+                                  stats.Percentile(95, &drawing::FrameSample::paintMs),
+                                  stats.Percentile(99, &drawing::FrameSample::paintMs)), x, y);
+    y += line;
+    gdc.DrawText(wxString::Format("延迟 p50 %.1f  p95 %.1f  p99 %.1f ms",
+                                  stats.Percentile(50, &drawing::FrameSample::latencyMs),
+                                  stats.Percentile(95, &drawing::FrameSample::latencyMs),
+                                  stats.Percentile(99, &drawing::FrameSample::latencyMs)), x, y);
+    y += line;
+    gdc.DrawText(wxString::Format("平均: 背景 %.2f  网格 %.2f  笔画 %.2f ms",
+                                  bg / n, grid / n, strokes / n), x, y);
+    y += line;
+    gdc.DrawText(wxString::Format("平均: %.0f 段, 脏区 %.0f 像素", segments / n, dirty / n), x, y);
+    y += line;
+    const GdiCache& gdi = GetGdiCache();
+    gdc.DrawText(wxString::Format("画笔缓存 %.1f%% 命中 (%lu/%lu, 淘汰 %llu)  画刷 %.1f%%",
+                                  std::max(0.0, gdi.GetPens().GetHitRate()) * 100,
+                                  (unsigned long)gdi.GetPens().GetSize(),
+                                  (unsigned long)gdi.GetPens().GetCapacity(),
+                                  (unsigned long long)gdi.GetPens().GetEvictions(),
+                                  std::max(0.0, gdi.GetBrushes().GetHitRate()) * 100), x, y);
+    y += line + 4;
+    
+    // 输入延迟直方图：每格 2 ms，最后一格包括 60 ms 以上。
+    // 按目标帧间隔着色：一帧以内绿色，两帧以内黄色，更慢红色
+    const double binMs = 2.0;
+    std::vector<unsigned> bins(30);
+    stats.Histogram(&drawing::FrameSample::latencyMs, binMs, bins);
+    unsigned peak = std::max(1u, *std::max_element(bins.begin(), bins.end()));
+    double frameMs = 1000.0 / (m_frameRate > 0 ? m_frameRate : 60);
+    
+    int bottom = box.GetBottom() - line - 2;
+    int barWidth = (box.width - 16) / int(bins.size());
+    for (size_t b = 0; b < bins.size(); b++) {
+        double start = b * binMs;
+        wxColour colour = start < frameMs ? wxColour(80, 220, 100)
+                        : start < 2 * frameMs ? wxColour(240, 200, 60) : wxColour(240, 80, 70);
+        int h = int(double(bins[b]) / peak * (bottom - y));
+        gdc.SetBrush(GetGdiCache().GetBrush(colour));
+        gdc.DrawRectangle(x + int(b) * barWidth, bottom - h, barWidth - 1, h);
+    }
+    gdc.DrawText("0", x, bottom + 1);
+    wxString last = wxString::Format("%.0f+ ms", bins.size() * binMs);
+    gdc.DrawText(last, box.GetRight() - 8 - gdc.GetTextExtent(last).x, bottom + 1);
+}
+
+void DrawPanel::StartRecording() {
+    wxSize size = GetClientSize();
+    m_trace.Clear();
+    m_trace.SetCanvasSize(size.x, size.y);
+    m_traceStart = drawing::NowMs();
+    m_recording = true;
+}
+
+void DrawPanel::RecordInput(drawing::InputEvent::Type type, const wxPoint& pos) {
+    // 记录的是原始的屏幕坐标，回放时重新经过整个输入管线
+    if (m_recording) {
+        m_trace.Add(type, drawing::NowMs() - m_traceStart, pos.x, pos.y);
+    }
+}
+
+bool DrawPanel::SaveStatsCsv(const wxString& path, wxString& error) {
+    std::string csv = m_frameStats.FormatCsv();
+    wxLogNull noLog;
+    wxFile file;
+    if (!file.Create(path, true) || file.Write(csv.data(), csv.size()) != csv.size() ||
+        !file.Close()) {
+        error = "无法写入文件";
+        return false;
+    }
+    return true;
+}
+
+// ==================== 缩放与平移 ====================
+
+void DrawPanel::OnMouseWheel(wxMouseEvent& event) {
+    // 每格滚轮缩放 1.25 倍，以鼠标位置为中心
+    double steps = double(event.GetWheelRotation()) / event.GetWheelDelta();
+    MarkInput();
+    ZoomAt(std::pow(1.25, steps), event.GetPosition());
+}
+
+void DrawPanel::OnMiddleDown(wxMouseEvent& event) {
+    if (IsBusy()) {
+        return;
+    }
+    m_panning = true;
+    m_panLast = event.GetPosition();
+    CaptureMouse();
+    SetCursor(wxCursor(wxCURSOR_HAND));
+}
+
+void DrawPanel::OnMiddleUp(wxMouseEvent& event) {
+    FlushInput();
+    if (m_panning) {
+        m_panning = false;
+        ReleaseMouse();
+        SetCursor(wxNullCursor);
+    }
+}
+
+void DrawPanel::ZoomAt(double factor, const wxPoint& anchor) {
+    if (IsBusy()) {
+        return;
+    }
+    const double minScale = 1.0 / 64, maxScale = 16.0;
+    double scale = std::max(minScale, std::min(maxScale, m_view.scale * factor));
+    if (scale == m_view.scale) {
+        return;
+    }
+    
+    // anchor 下的世界坐标在缩放前后保持不动
+    double wx = anchor.x / m_view.scale + m_view.originX;
+    double wy = anchor.y / m_view.scale + m_view.originY;
+    m_view.scale = scale;
+    m_view.originX = wx - anchor.x / scale;
+    m_view.originY = wy - anchor.y / scale;
+    m_lodLevel = drawing::StrokeLod::LevelForScale(scale);
+    
+    m_backBuffer = wxNullBitmap;  // 缩放后所有内容都要重画
+    m_playFrameValid = false;
+    Refresh(false);
+    UpdateStatus();
+}
+
+void DrawPanel::ZoomReset() {
+    if (m_view.scale != 1.0) {
+        wxSize size = GetClientSize();
+        ZoomAt(1.0 / m_view.scale, wxPoint(size.x / 2, size.y / 2));
+    }
+}
+
+void DrawPanel::PanBy(int dx, int dy) {
+    if (dx == 0 && dy == 0) {
+        return;
+    }
+    m_view.originX -= dx / m_view.scale;
+    m_view.originY -= dy / m_view.scale;
+    
+    // 背景不随视图移动，不能简单地滚动后台缓冲；整个视口重画一次，
+    // 剔除和 LOD 让代价只与视口内的可见内容有关
+    InvalidateCanvas(wxRect(GetClientSize()));
+}
+
+drawing::StrokeBox DrawPanel::GetExportArea() const {
+    wxSize size = GetClientSize();
+    size.IncTo(wxSize(1, 1));
+    drawing::StrokeBox area;
+    area.left = int(std::floor(m_view.originX));
+    area.top = int(std::floor(m_view.originY));
+    area.right = area.left + std::max(1, int(std::ceil(size.x / m_view.scale))) - 1;
+    area.bottom = area.top + std::max(1, int(std::ceil(size.y / m_view.scale))) - 1;
+    return area;
+}
+
+// ==================== 绘图文件 ====================
+
+void DrawPanel::EnsureLoaded(drawing::StrokeId id) {
+    if (id >= m_pendingRecord.size() || m_pendingRecord[id] == kNoRecord) {
+        return;
+    }
+    uint32_t record = m_pendingRecord[id];
+    m_pendingRecord[id] = kNoRecord;
     
-    void DrawBackground(wxDC& dc);
-    void DrawGrid(wxDC& dc);
+    // 损坏的笔画只保留能解出的点
+    drawing::StrokeBox oldBox = drawing::GetPaintedBox(m_strokes, id);
+    m_reader->Decode(record, m_simplifyIn);
+    m_strokes.ReplacePoints(id, m_simplifyIn);
+    m_lod.Invalidate(id);
     
-public:
-    void SetDrawMode(int mode) { m_drawMode = mode; }
-    void Clear() { m_points.clear(); Refresh(); }
-};
+    // 文件里的包围盒与实际的点不一致时，按实际的点重新登记
+    drawing::StrokeBox newBox = drawing::GetPaintedBox(m_strokes, id);
+    if (!m_strokes.IsErased(id) &&
+        (newBox.left != oldBox.left || newBox.top != oldBox.top ||
+         newBox.right != oldBox.right || newBox.bottom != oldBox.bottom)) {
+        m_index.Remove(id, oldBox);
+        m_index.Insert(id, newBox);
+    }
+    
+    // 全部解码后就不再需要映射
+    if (--m_pendingCount == 0) {
+        m_reader.reset();
+        m_readerPath.clear();
+        m_pendingRecord.clear();
+    }
+}
 
-class MyApp : public wxApp {
-public:
-    virtual bool OnInit();
-};
+void DrawPanel::LoadPending(const drawing::StrokeBox& region) {
+    m_index.Query(region, m_queryIds);
+    for (size_t i = 0; i < m_queryIds.size(); i++) {
+        EnsureLoaded(m_queryIds[i]);
+    }
+}
 
-class MyFrame : public wxFrame {
-public:
-    MyFrame();
+void DrawPanel::LoadAllPending() {
+    for (size_t id = 0; id < m_pendingRecord.size() && m_pendingCount > 0; id++) {
+        EnsureLoaded(drawing::StrokeId(id));
+    }
+}
 
-private:
-    DrawPanel* m_drawPanel;
-    wxSlider* m_sizeSlider;
-    wxColourPickerCtrl* m_colorPicker;
-    int m_penSize;
-    wxColour m_penColor;
+bool DrawPanel::LoadDrawing(const wxString& path, wxString& error) {
+    std::unique_ptr<drawing::DrawingReader> reader(new drawing::DrawingReader);
+    if (!reader->Open(path.fn_str())) {
+        error = wxString::FromUTF8(reader->GetError().c_str());
+        return false;
+    }
     
-    void OnDrawMode(wxCommandEvent& event);
-    void OnClear(wxCommandEvent& event);
-    void OnSizeChanged(wxCommandEvent& event);
-    void OnColorChanged(wxColourPickerEvent& event);
+    // 打开文件不进入撤销历史，视图回到原点
+    StopPlayback();
+    m_strokes.Clear();
+    m_inputPoints.clear();
+    m_rawPoints = 0;
+    m_keptPoints = 0;
+    m_timeline.Clear();
+    m_index.Clear();
+    m_lod.Clear();
+    m_history.Reset();
+    m_hasSelection = false;
+    m_view = drawing::ViewTransform();
+    m_lodLevel = 0;
+    m_reader.reset();
     
-    enum {
-        ID_MODE_FREE = 1,
-        ID_MODE_RECT,
-        ID_MODE_CIRCLE,
-        ID_MODE_LINE,
-        ID_CLEAR,
-        ID_SIZE_SLIDER
-    };
-};
+    // 只登记样式和包围盒，代价与笔画数成正比，与点数无关。
+    // 文件里只有各笔画的图层编号，图层按用到的最大编号重新创建，属性都是默认值
+    size_t count = reader->GetStrokeCount();
+    m_pendingRecord.assign(count, kNoRecord);
+    int layers = 1;
+    for (size_t i = 0; i < count; i++) {
+        const drawing::StrokeRecord& record = reader->GetRecord(i);
+        drawing::StrokeId id = m_strokes.AddPlaceholder(record.style, record.bbox, record.kind);
+        int layer = std::min(record.layer, kMaxLayers - 1);
+        m_strokes.SetLayer(id, layer);
+        layers = std::max(layers, layer + 1);
+        
+        // 文件里没有时刻，回放时按点数估算每条笔画的时长
+        double duration = record.kind == drawing::STROKE_FILL
+            ? 0 : drawing::StrokeTimeline::EstimateDurationMs(record.pointCount);
+        m_timeline.AddStroke(id, record.pointCount, duration);
+        m_pendingRecord[id] = uint32_t(i);
+        m_index.Insert(id, drawing::GetPaintedBox(m_strokes, id));
+    }
+    ResetLayers(layers);
+    m_pendingCount = count;
+    if (count > 0) {
+        m_reader = std::move(reader);
+        m_readerPath = path;
+    } else {
+        m_pendingRecord.clear();
+    }
+    
+    m_backBuffer = wxNullBitmap;
+    Refresh(false);
+    UpdateStatus();
+    return true;
+}
 
-// ==================== DrawPanel 实现 ====================
+bool DrawPanel::SaveDrawing(const wxString& path, wxString& error) {
+    // 正在映射的文件不能一边读一边覆盖，先把剩下的笔画解码出来
+    if (m_reader && wxFileName(path).SameAs(wxFileName(m_readerPath))) {
+        LoadAllPending();
+    }
+    
+    drawing::DrawingWriter writer;
+    if (!writer.Open(path.fn_str())) {
+        error = "无法创建文件";
+        return false;
+    }
+    
+    // 只保存可见笔画；还没解码的笔画直接拷贝文件里的编码
+    for (size_t i = 0; i < m_strokes.GetStrokeCount(); i++) {
+        drawing::StrokeId id = drawing::StrokeId(i);
+        if (m_strokes.IsErased(id) || (m_drawing && id == m_currentStroke)) {
+            continue;
+        }
+        if (id < m_pendingRecord.size() && m_pendingRecord[id] != kNoRecord) {
+            uint32_t record = m_pendingRecord[id];
+            writer.WriteEncoded(m_reader->GetRecord(record), m_reader->GetPayload(record));
+        } else {
+            writer.WriteStroke(m_strokes, id);
+        }
+    }
+    
+    if (!writer.Close()) {
+        error = "写入文件失败";
+        return false;
+    }
+    return true;
+}
 
-DrawPanel::DrawPanel(wxWindow* parent)
-    : wxPanel(parent, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxFULL_REPAINT_ON_RESIZE),
-      m_drawing(false), m_drawMode(0) {
+bool DrawPanel::ExportSvg(const wxString& path, uint64_t& points, wxString& error) {
+    if (m_reader && wxFileName(path).SameAs(wxFileName(m_readerPath))) {
+        LoadAllPending();
+    }
     
-    SetBackgroundStyle(wxBG_STYLE_PAINT);  // 避免闪烁
+    drawing::StrokeBox area = GetExportArea();
+    drawing::SvgWriter writer;
+    if (!writer.Open(path.fn_str(), area, m_view.scale)) {
+        error = "无法创建文件";
+        return false;
+    }
+    writer.WriteBackground(ToStrokeColour(m_theme.top), ToStrokeColour(m_theme.bottom));
     
-    Bind(wxEVT_PAINT, &DrawPanel::OnPaint, this);
-    Bind(wxEVT_LEFT_DOWN, &DrawPanel::OnMouseDown, this);
-    Bind(wxEVT_MOTION, &DrawPanel::OnMouseMove, this);
-    Bind(wxEVT_LEFT_UP, &DrawPanel::OnMouseUp, this);
-    Bind(wxEVT_ERASE_BACKGROUND, &DrawPanel::OnEraseBackground, this);
+    // 边遍历边写：还没解码的笔画临时解到 m_simplifyIn，用完就丢，不放回 StrokeStore，
+    // 导出再大的文件内存也不会增长
+    for (size_t layer = 0; layer < m_layers.size(); layer++) {
+        const drawing::Layer& info = m_layers[layer];
+        if (!info.visible) {
+            continue;
+        }
+        writer.BeginGroup(info.opacity, info.blend);
+        for (size_t i = 0; i < m_strokes.GetStrokeCount(); i++) {
+            drawing::StrokeId id = drawing::StrokeId(i);
+            if (m_strokes.GetLayer(id) != int(layer) || m_strokes.IsErased(id) ||
+                (m_drawing && id == m_currentStroke) ||
+                !drawing::BoxesIntersect(drawing::GetPaintedBox(m_strokes, id), area)) {
+                continue;
+            }
+            if (id < m_pendingRecord.size() && m_pendingRecord[id] != kNoRecord) {
+                m_reader->Decode(m_pendingRecord[id], m_simplifyIn);
+                writer.BeginPath(m_strokes.GetStyle(id), m_strokes.Get(id).kind);
+                writer.AddPoints(m_simplifyIn.data(), m_simplifyIn.size());
+                writer.EndPath();
+            } else {
+                writer.WriteStroke(m_strokes, id);
+            }
+        }
+        writer.EndGroup();
+    }
+    
+    points = writer.GetPointCount();
+    if (!writer.Close()) {
+        error = "写入文件失败";
+        return false;
+    }
+    return true;
 }
 
-void DrawPanel::OnEraseBackground(wxEraseEvent& event) {
-    // 不做任何事，避免闪烁
+void DrawPanel::TakeSnapshot(drawing::StrokeSnapshot& snapshot) {
+    // 按图层从下到上拷贝可见图层的笔画；导出不做图层合成，不透明度和混合模式不起作用
+    LoadAllPending();
+    for (size_t layer = 0; layer < m_layers.size(); layer++) {
+        if (!m_layers[layer].visible) {
+            continue;
+        }
+        for (size_t i = 0; i < m_strokes.GetStrokeCount(); i++) {
+            drawing::StrokeId id = drawing::StrokeId(i);
+            if (m_strokes.GetLayer(id) == int(layer) && !m_strokes.IsErased(id) &&
+                !(m_drawing && id == m_currentStroke)) {
+                snapshot.Add(m_strokes, id);
+            }
+        }
+    }
 }
 
-void DrawPanel::OnPaint(wxPaintEvent& event) {
-    wxAutoBufferedPaintDC dc(this);  // 使用双缓冲避免闪烁
-    dc.Clear();
+// ==================== StrokeOptionsDialog 实现 ====================
+
+StrokeOptionsDialog::StrokeOptionsDialog(wxWindow* parent,
+                                         const drawing::StrokeFilterOptions& options)
+    : wxDialog(parent, wxID_ANY, "笔画简化参数") {
     
-    DrawBackground(dc);
-    DrawGrid(dc);
+    wxBoxSizer* mainSizer = new wxBoxSizer(wxVERTICAL);
     
-    // 绘制已保存的点
-    if (m_points.size() > 1) {
-        dc.SetPen(wxPen(wxColour(0, 0, 255), 2));
-        
-        for (size_t i = 1; i < m_points.size(); i++) {
-            dc.DrawLine(m_points[i-1], m_points[i]);
-        }
-    }
+    wxFlexGridSizer* formSizer = new wxFlexGridSizer(2, 10, 10);
+    formSizer->AddGrowableCol(1, 1);
+    
+    formSizer->Add(new wxStaticText(this, wxID_ANY, "抽稀距离 (像素):"),
+                  0, wxALIGN_CENTER_VERTICAL);
+    m_minDistance = new wxSpinCtrlDouble(this, wxID_ANY, "", wxDefaultPosition, wxDefaultSize,
+                                         wxSP_ARROW_KEYS, 0.0, 20.0, options.minDistance, 0.5);
+    formSizer->Add(m_minDistance, 1, wxEXPAND);
+    
+    formSizer->Add(new wxStaticText(this, wxID_ANY, "平滑强度 (0-0.95):"),
+                  0, wxALIGN_CENTER_VERTICAL);
+    m_smoothing = new wxSpinCtrlDouble(this, wxID_ANY, "", wxDefaultPosition, wxDefaultSize,
+                                       wxSP_ARROW_KEYS, 0.0, 0.95, options.smoothing, 0.05);
+    formSizer->Add(m_smoothing, 1, wxEXPAND);
+    
+    formSizer->Add(new wxStaticText(this, wxID_ANY, "简化容差 (像素):"),
+                  0, wxALIGN_CENTER_VERTICAL);
+    m_tolerance = new wxSpinCtrlDouble(this, wxID_ANY, "", wxDefaultPosition, wxDefaultSize,
+                                       wxSP_ARROW_KEYS, 0.0, 10.0, options.tolerance, 0.1);
+    formSizer->Add(m_tolerance, 1, wxEXPAND);
+    
+    mainSizer->Add(formSizer, 0, wxEXPAND | wxALL, 15);
+    
+    wxSizer* buttonSizer = CreateButtonSizer(wxOK | wxCANCEL);
+    mainSizer->Add(buttonSizer, 0, wxALIGN_RIGHT | wxALL, 10);
+    
+    SetSizerAndFit(mainSizer);
+    Centre();
 }
 
-void DrawPanel::DrawBackground(wxDC& dc) {
-    wxSize size = GetClientSize();
+drawing::StrokeFilterOptions StrokeOptionsDialog::GetOptions() const {
+    drawing::StrokeFilterOptions options;
+    options.minDistance = m_minDistance->GetValue();
+    options.smoothing = m_smoothing->GetValue();
+    options.tolerance = m_tolerance->GetValue();
+    return options;
+}
+
+// ==================== ExportThread 实现 ====================
+
+// 写入时检查取消标志：取消后让写入失败，图像编码器随之提前结束
+class CancellableOutputStream : public wxFilterOutputStream {
+public:
+    CancellableOutputStream(wxOutputStream& stream, ExportThread& thread)
+        : wxFilterOutputStream(stream), m_thread(thread) {}
+    
+protected:
+    virtual size_t OnSysWrite(const void* buffer, size_t size) {
+        if (m_thread.IsCancelled()) {
+            m_lasterror = wxSTREAM_WRITE_ERROR;
+            return 0;
+        }
+        size_t written = m_parent_o_stream->Write(buffer, size).LastWrite();
+        if (written != size) {
+            m_lasterror = wxSTREAM_WRITE_ERROR;
+        }
+        m_thread.ReportEncoded(written);
+        return written;
+    }
     
-    // 渐变背景
-    dc.GradientFillLinear(wxRect(0, 0, size.x, size.y),
-                         wxColour(250, 250, 255),
-                         wxColour(220, 220, 240),
-                         wxSOUTH);
+private:
+    ExportThread& m_thread;
+};
+
+ExportThread::ExportThread(wxEvtHandler* handler, drawing::StrokeSnapshot& snapshot,
+                           const drawing::StrokeBox& area, double scale, const CanvasTheme& theme,
+                           const wxString& path, wxBitmapType type)
+    : wxThread(wxTHREAD_JOINABLE), m_handler(handler), m_area(area),
+      m_scale(scale), m_top(ToStrokeColour(theme.top)), m_bottom(ToStrokeColour(theme.bottom)),
+      m_path(path.Clone()), m_type(type), m_cancel(false), m_encoded(0), m_lastPulse(0) {
+    m_snapshot = std::move(snapshot);  // 整个接管快照，不再拷贝一次，以后新增的字段也不会漏掉
 }
 
-void DrawPanel::DrawGrid(wxDC& dc) {
-    wxSize size = GetClientSize();
-    dc.SetPen(wxPen(wxColour(200, 200, 200), 1, wxPENSTYLE_DOT));
+wxThread::ExitCode ExportThread::Entry() {
+    wxLogNull noLog;  // 错误通过完成事件报告，不在工作线程上弹出日志窗口
+    
+    // 1. 光栅化：按输出尺寸缩放后，用线程池逐个行带绘制
+    drawing::ExportRenderer renderer(m_snapshot, m_area, m_scale);
+    m_snapshot = drawing::StrokeSnapshot();  // 缩放后的副本已经建好，释放快照
+    renderer.SetBackground(m_top, m_bottom);
+    
+    wxImage image;
+    if (!image.Create(renderer.GetWidth(), renderer.GetHeight(), false)) {
+        return Finish(0, wxString::Format("内存不足，无法创建 %d x %d 的图像",
+                                          renderer.GetWidth(), renderer.GetHeight()));
+    }
+    
+    bool rendered = renderer.Render(image.GetData(), [this](int done, int total) {
+        PostProgress(done * 100 / total);
+        return !IsCancelled();
+    });
+    if (!rendered) {
+        return Finish(-1, "");
+    }
     
-    // 绘制网格
-    for (int x = 0; x < size.x; x += 50) {
-        dc.DrawLine(x, 0, x, size.y);
+    // 2. 编码：先写临时文件，成功后再替换目标文件，取消或失败不会留下半个文件
+    wxString temp = m_path + ".part";
+    bool saved = false;
+    {
+        wxFileOutputStream file(temp);
+        if (file.IsOk()) {
+            CancellableOutputStream out(file, *this);
+            if (m_type == wxBITMAP_TYPE_JPEG) {
+                image.SetOption(wxIMAGE_OPTION_QUALITY, 90);
+            }
+            saved = image.SaveFile(out, m_type) && file.Close();
+        }
+    }
+    if (!saved) {
+        wxRemoveFile(temp);
+        return IsCancelled() ? Finish(-1, "") : Finish(0, "无法写入文件: " + m_path);
     }
-    for (int y = 0; y < size.y; y += 50) {
-        dc.DrawLine(0, y, size.x, y);
+    if (!wxRenameFile(temp, m_path, true)) {
+        wxRemoveFile(temp);
+        return Finish(0, "无法写入文件: " + m_path);
     }
+    return Finish(1, wxString::Format("%d x %d", renderer.GetWidth(), renderer.GetHeight()));
 }
 
-void DrawPanel::OnMouseDown(wxMouseEvent& event) {
-    m_drawing = true;
-    m_currentPos = event.GetPosition();
-    m_points.push_back(m_currentPos);
-    CaptureMouse();
+void ExportThread::PostProgress(int value) {
+    wxThreadEvent* event = new wxThreadEvent(EVT_EXPORT_PROGRESS);
+    event->SetInt(value);
+    wxQueueEvent(m_handler, event);
 }
 
-void DrawPanel::OnMouseMove(wxMouseEvent& event) {
-    if (m_drawing && event.Dragging()) {
-        wxPoint pos = event.GetPosition();
-        m_points.push_back(pos);
-        m_currentPos = pos;
-        Refresh();
+void ExportThread::ReportEncoded(size_t bytes) {
+    // 编码阶段不知道总量，每写出 256KB 通知一次，界面用不确定进度显示
+    m_encoded += bytes;
+    if (m_encoded - m_lastPulse >= 256 * 1024) {
+        m_lastPulse = m_encoded;
+        PostProgress(-1);
     }
 }
 
-void DrawPanel::OnMouseUp(wxMouseEvent& event) {
-    if (m_drawing) {
-        m_drawing = false;
-        ReleaseMouse();
-    }
+wxThread::ExitCode ExportThread::Finish(int result, const wxString& message) {
+    wxThreadEvent* event = new wxThreadEvent(EVT_EXPORT_DONE);
+    event->SetInt(result);
+    event->SetString(message);  // wxThreadEvent::SetString 会做深拷贝
+    wxQueueEvent(m_handler, event);
+    return (ExitCode)0;
 }
 
 // ==================== MyApp 实现 ====================
 
 bool MyApp::OnInit() {
+    wxInitAllImageHandlers();  // 导出 PNG / JPEG 需要
+    
     MyFrame* frame = new MyFrame();
     frame->Show(true);
     return true;
 }
 
+int MyApp::OnExit() {
+    // 缓存的画笔 / 画刷要在 wxWidgets 清理之前释放，不能留给静态对象的析构
+    GetGdiCache().Clear();
+    return wxApp::OnExit();
+}
+
 // ==================== MyFrame 实现 ====================
 
 MyFrame::MyFrame()
     : wxFrame(NULL, wxID_ANY, "自定义绘制示例", wxDefaultPosition, wxSize(900, 700)),
-      m_penSize(2), m_penColor(*wxBLACK) {
+      m_penSize(2), m_penColor(*wxBLACK), m_exportThread(NULL), m_exportProgress(NULL) {
+    
+    // ==================== 菜单栏 ====================
+    wxMenu* menuFile = new wxMenu;
+    menuFile->Append(wxID_OPEN, "打开...\tCtrl-O", "打开绘图文件");
+    menuFile->Append(wxID_SAVE, "保存\tCtrl-S", "保存绘图文件");
+    menuFile->Append(wxID_SAVEAS, "另存为...\tCtrl-Shift-S", "另存为新文件");
+    menuFile->AppendSeparator();
+    menuFile->Append(ID_EXPORT_IMAGE, "导出图像...\tCtrl-E", "在后台把画布导出为 PNG / JPEG 图像");
+    menuFile->Append(ID_EXPORT_SVG, "导出 SVG...", "把画布导出为矢量图（SVG）");
+    
+    wxMenu* menuOptions = new wxMenu;
+    menuOptions->Append(ID_STROKE_OPTIONS, "笔画简化参数...", "设置抽稀距离、平滑强度和简化容差");
+    menuOptions->AppendSeparator();
+    menuOptions->AppendCheckItem(ID_BATCHED_RENDER, "批量绘制折线",
+                                 "每条笔画一次 DrawLines，而不是每段一次 DrawLine");
+    menuOptions->Append(ID_COMPARE_RENDER, "比较绘制方式", "在当前画面上对比两种绘制方式的耗时");
+    menuOptions->Check(ID_BATCHED_RENDER, true);
+    menuOptions->AppendSeparator();
+    menuOptions->AppendRadioItem(ID_BACKEND_DC, "渲染后端: wxDC", "在 UI 线程上用 wxDC 绘制");
+    menuOptions->AppendRadioItem(ID_BACKEND_TILES, "渲染后端: 多线程分块",
+                                 "分块后在所有 CPU 核上并行光栅化（抗锯齿）");
+    menuOptions->AppendSeparator();
+    menuOptions->AppendRadioItem(ID_FRAME_60, "输入帧率: 60 Hz", "鼠标移动合并后每秒最多绘制 60 次");
+    menuOptions->AppendRadioItem(ID_FRAME_120, "输入帧率: 120 Hz", "鼠标移动合并后每秒最多绘制 120 次");
+    menuOptions->AppendRadioItem(ID_FRAME_UNPACED, "输入帧率: 不限",
+                                 "每个鼠标移动事件立即绘制（用于对比）");
+    menuOptions->AppendSeparator();
+    menuOptions->AppendCheckItem(ID_RECORD_TRACE, "录制输入轨迹",
+                                 "记录自由绘制的鼠标事件，停止时保存，可用 draw_bench 回放");
+    
+    wxMenu* menuEdit = new wxMenu;
+    menuEdit->Append(wxID_UNDO, "撤销(&U)\tCtrl-Z", "撤销上一步操作");
+    menuEdit->Append(wxID_REDO, "重做(&R)\tCtrl-Y", "重做刚撤销的操作");
+    menuEdit->Append(ID_UNDO_ALL, "全部撤销", "回到历史记录中最早的状态");
+    menuEdit->AppendSeparator();
+    menuEdit->Append(ID_HISTORY_LIMIT, "历史记录上限...", "设置撤销历史最多占用的内存");
+    menuEdit->Append(ID_FILL_TOLERANCE, "填充容差...", "油漆桶把颜色差在容差以内的像素视为同一区域");
+    
+    wxMenu* menuView = new wxMenu;
+    menuView->Append(wxID_ZOOM_IN, "放大\tCtrl-=", "以画布中心放大（也可以用鼠标滚轮）");
+    menuView->Append(wxID_ZOOM_OUT, "缩小\tCtrl--", "以画布中心缩小");
+    menuView->Append(wxID_ZOOM_100, "实际大小\tCtrl-0", "恢复 100% 缩放（按住鼠标中键拖动可平移）");
+    menuView->AppendSeparator();
+    menuView->AppendCheckItem(ID_SHOW_STATS, "性能统计\tF3",
+                              "显示每帧绘制耗时、输入延迟的分位数和直方图");
+    menuView->Append(ID_EXPORT_STATS, "导出帧统计 (CSV)...", "把最近的帧统计保存为 CSV 文件");
+    
+    wxMenuBar* menuBar = new wxMenuBar;
+    menuBar->Append(menuFile, "文件(&F)");
+    menuBar->Append(menuEdit, "编辑(&E)");
+    menuBar->Append(menuView, "视图(&V)");
+    menuBar->Append(menuOptions, "选项(&O)");
+    SetMenuBar(menuBar);
     
     wxPanel* panel = new wxPanel(this);
     wxBoxSizer* mainSizer = new wxBoxSizer(wxVERTICAL);
@@ -179,12 +2501,18 @@ MyFrame::MyFrame()
     wxRadioButton* radioRect = new wxRadioButton(panel, ID_MODE_RECT, "矩形");
     wxRadioButton* radioCircle = new wxRadioButton(panel, ID_MODE_CIRCLE, "圆形");
     wxRadioButton* radioLine = new wxRadioButton(panel, ID_MODE_LINE, "直线");
+    wxRadioButton* radioEraser = new wxRadioButton(panel, ID_MODE_ERASER, "橡皮擦");
+    wxRadioButton* radioSelect = new wxRadioButton(panel, ID_MODE_SELECT, "选择");
+    wxRadioButton* radioFill = new wxRadioButton(panel, ID_MODE_FILL, "油漆桶");
     radioFree->SetValue(true);
     
     toolBox->Add(radioFree, 0, wxALL, 5);
     toolBox->Add(radioRect, 0, wxALL, 5);
     toolBox->Add(radioCircle, 0, wxALL, 5);
     toolBox->Add(radioLine, 0, wxALL, 5);
+    toolBox->Add(radioEraser, 0, wxALL, 5);
+    toolBox->Add(radioSelect, 0, wxALL, 5);
+    toolBox->Add(radioFill, 0, wxALL, 5);
     toolBox->AddSpacer(20);
     
     // 画笔大小
@@ -208,23 +2536,66 @@ MyFrame::MyFrame()
     
     mainSizer->Add(toolBox, 0, wxEXPAND | wxALL, 5);
     
+    // ==================== 图层 ====================
+    wxStaticBoxSizer* layerBox = new wxStaticBoxSizer(wxHORIZONTAL, panel, "图层");
+    m_layerChoice = new wxChoice(panel, ID_LAYER_CHOICE, wxDefaultPosition, wxSize(100, -1));
+    layerBox->Add(m_layerChoice, 0, wxALIGN_CENTER_VERTICAL | wxALL, 5);
+    layerBox->Add(new wxButton(panel, ID_LAYER_ADD, "新建图层"), 0, wxALL, 5);
+    m_layerVisible = new wxCheckBox(panel, ID_LAYER_VISIBLE, "可见");
+    layerBox->Add(m_layerVisible, 0, wxALIGN_CENTER_VERTICAL | wxALL, 5);
+    
+    layerBox->Add(new wxStaticText(panel, wxID_ANY, "不透明度:"),
+                  0, wxALIGN_CENTER_VERTICAL | wxLEFT, 10);
+    m_layerOpacity = new wxSlider(panel, ID_LAYER_OPACITY, 100, 0, 100,
+                                  wxDefaultPosition, wxSize(100, -1));
+    layerBox->Add(m_layerOpacity, 0, wxALIGN_CENTER_VERTICAL | wxLEFT | wxRIGHT, 5);
+    
+    layerBox->Add(new wxStaticText(panel, wxID_ANY, "混合:"),
+                  0, wxALIGN_CENTER_VERTICAL | wxLEFT, 10);
+    wxString blendNames[] = { "正常", "正片叠底", "滤色" };  // 与 drawing::BlendMode 的顺序一致
+    m_layerBlend = new wxChoice(panel, ID_LAYER_BLEND, wxDefaultPosition, wxDefaultSize,
+                                WXSIZEOF(blendNames), blendNames);
+    layerBox->Add(m_layerBlend, 0, wxALIGN_CENTER_VERTICAL | wxALL, 5);
+    mainSizer->Add(layerBox, 0, wxEXPAND | wxLEFT | wxRIGHT, 5);
+    
+    // ==================== 回放 ====================
+    wxStaticBoxSizer* playBox = new wxStaticBoxSizer(wxHORIZONTAL, panel, "回放");
+    m_playButton = new wxButton(panel, ID_PLAY, "播放");
+    playBox->Add(m_playButton, 0, wxALL, 5);
+    m_playSlider = new wxSlider(panel, ID_PLAY_SLIDER, 0, 0, 1000);  // 千分比
+    playBox->Add(m_playSlider, 1, wxALIGN_CENTER_VERTICAL | wxLEFT | wxRIGHT, 5);
+    playBox->Add(new wxStaticText(panel, wxID_ANY, "速度:"),
+                 0, wxALIGN_CENTER_VERTICAL | wxLEFT, 10);
+    wxString speedNames[] = { "0.5x", "1x", "2x", "4x", "8x", "16x" };
+    wxChoice* speedChoice = new wxChoice(panel, ID_PLAY_SPEED, wxDefaultPosition, wxDefaultSize,
+                                         WXSIZEOF(speedNames), speedNames);
+    speedChoice->SetSelection(1);
+    playBox->Add(speedChoice, 0, wxALIGN_CENTER_VERTICAL | wxALL, 5);
+    playBox->Add(new wxButton(panel, ID_PLAY_STOP, "结束回放"), 0, wxALL, 5);
+    mainSizer->Add(playBox, 0, wxEXPAND | wxLEFT | wxRIGHT, 5);
+    
     // ==================== 绘制区域 ====================
     m_drawPanel = new DrawPanel(panel);
+    m_drawPanel->SetPen(m_penSize, m_penColor);
     mainSizer->Add(m_drawPanel, 1, wxEXPAND | wxALL, 5);
+    SyncLayerControls();
     
     // ==================== 示例绘制区 ====================
     wxStaticBoxSizer* exampleBox = new wxStaticBoxSizer(wxHORIZONTAL, panel, "绘制示例");
     
     // 创建示例面板
+    // 渐变矩形只生成一次：填充内核写进 wxImage，之后每次绘制只是一次位图拷贝
+    wxImage gradientImage(130, 80, false);
+    drawing::FillLinearGradient(drawing::RgbBuffer(gradientImage.GetData(), 130, 80),
+                                0xFF6464, 0x6464FF, drawing::GRADIENT_HORIZONTAL);
+    wxBitmap gradient(gradientImage);
+    
     wxPanel* example1 = new wxPanel(panel, wxID_ANY, wxDefaultPosition, wxSize(150, 100));
-    example1->Bind(wxEVT_PAINT, [](wxPaintEvent& evt) {
+    example1->Bind(wxEVT_PAINT, [gradient](wxPaintEvent& evt) {
         wxPaintDC dc((wxPanel*)evt.GetEventObject());
         
         // 绘制渐变矩形
-        dc.GradientFillLinear(wxRect(10, 10, 130, 80),
-                             wxColour(255, 100, 100),
-                             wxColour(100, 100, 255),
-                             wxEAST);
+        dc.DrawBitmap(gradient, 10, 10);
         
         dc.SetTextForeground(*wxWHITE);
         dc.DrawText("渐变", 60, 40);
@@ -235,11 +2606,11 @@ MyFrame::MyFrame()
         wxPaintDC dc((wxPanel*)evt.GetEventObject());
         
         // 绘制圆形和线条
-        dc.SetPen(wxPen(*wxBLUE, 3));
+        dc.SetPen(GetGdiCache().GetPen(*wxBLUE, 3));
         dc.SetBrush(*wxCYAN_BRUSH);
         dc.DrawCircle(wxPoint(75, 50), 30);
         
-        dc.SetPen(wxPen(*wxRED, 2));
+        dc.SetPen(GetGdiCache().GetPen(*wxRED, 2));
         dc.DrawLine(10, 10, 140, 90);
         dc.DrawLine(140, 10, 10, 90);
     });
@@ -257,8 +2628,8 @@ MyFrame::MyFrame()
             wxPoint(10, 50)
         };
         
-        dc.SetPen(wxPen(*wxBLACK, 2));
-        dc.SetBrush(wxBrush(wxColour(255, 200, 100)));
+        dc.SetPen(GetGdiCache().GetPen(*wxBLACK, 2));
+        dc.SetBrush(GetGdiCache().GetBrush(wxColour(255, 200, 100)));
         dc.DrawPolygon(5, points);
         
         dc.SetTextForeground(*wxBLACK);
@@ -270,27 +2641,26 @@ MyFrame::MyFrame()
         wxPaintDC dc((wxPanel*)evt.GetEventObject());
         
         // 绘制贝塞尔曲线
-        dc.SetPen(wxPen(wxColour(0, 150, 0), 3));
+        dc.SetPen(GetGdiCache().GetPen(wxColour(0, 150, 0), 3));
+        
+        drawing::CubicBezier curve(drawing::CurvePoint(10, 90),    // 起点
+                                   drawing::CurvePoint(10, 10),    // 控制点 1
+                                   drawing::CurvePoint(140, 10),   // 控制点 2
+                                   drawing::CurvePoint(140, 90));  // 终点
         
-        wxPoint start(10, 90);
-        wxPoint control1(10, 10);
-        wxPoint control2(140, 10);
-        wxPoint end(140, 90);
+        // 按 0.25 像素的平坦度容差自适应展平：弯曲处点密、平直处点疏，
+        // 不会出现固定步长取点时的缺口，最后一次 DrawLines 画完
+        std::vector<drawing::CurvePoint> flattened;
+        drawing::FlattenAdaptive(curve, 0.25, flattened);
+        std::vector<drawing::StrokePoint> pixels;
+        drawing::ToPixelPolyline(flattened, pixels);
         
-        // 手动绘制贝塞尔曲线
-        for (double t = 0; t <= 1.0; t += 0.01) {
-            double mt = 1.0 - t;
-            double mt2 = mt * mt;
-            double mt3 = mt2 * mt;
-            double t2 = t * t;
-            double t3 = t2 * t;
-            
-            int x = mt3 * start.x + 3 * mt2 * t * control1.x +
-                   3 * mt * t2 * control2.x + t3 * end.x;
-            int y = mt3 * start.y + 3 * mt2 * t * control1.y +
-                   3 * mt * t2 * control2.y + t3 * end.y;
-            
-            dc.DrawPoint(x, y);
+        std::vector<wxPoint> points;
+        for (size_t i = 0; i < pixels.size(); i++) {
+            points.push_back(ToWxPoint(pixels[i]));
+        }
+        if (points.size() > 1) {
+            dc.DrawLines(int(points.size()), &points[0]);
         }
         
         dc.SetTextForeground(*wxBLACK);
@@ -311,20 +2681,246 @@ MyFrame::MyFrame()
     Bind(wxEVT_RADIOBUTTON, &MyFrame::OnDrawMode, this, ID_MODE_RECT);
     Bind(wxEVT_RADIOBUTTON, &MyFrame::OnDrawMode, this, ID_MODE_CIRCLE);
     Bind(wxEVT_RADIOBUTTON, &MyFrame::OnDrawMode, this, ID_MODE_LINE);
+    Bind(wxEVT_RADIOBUTTON, &MyFrame::OnDrawMode, this, ID_MODE_ERASER);
+    Bind(wxEVT_RADIOBUTTON, &MyFrame::OnDrawMode, this, ID_MODE_SELECT);
+    Bind(wxEVT_RADIOBUTTON, &MyFrame::OnDrawMode, this, ID_MODE_FILL);
     Bind(wxEVT_BUTTON, &MyFrame::OnClear, this, ID_CLEAR);
     Bind(wxEVT_SLIDER, &MyFrame::OnSizeChanged, this, ID_SIZE_SLIDER);
+    Bind(wxEVT_CHOICE, &MyFrame::OnLayerSelect, this, ID_LAYER_CHOICE);
+    Bind(wxEVT_BUTTON, &MyFrame::OnLayerAdd, this, ID_LAYER_ADD);
+    Bind(wxEVT_CHECKBOX, &MyFrame::OnLayerVisible, this, ID_LAYER_VISIBLE);
+    Bind(wxEVT_SLIDER, &MyFrame::OnLayerOpacity, this, ID_LAYER_OPACITY);
+    Bind(wxEVT_CHOICE, &MyFrame::OnLayerBlend, this, ID_LAYER_BLEND);
+    Bind(wxEVT_BUTTON, &MyFrame::OnPlay, this, ID_PLAY);
+    Bind(wxEVT_SLIDER, &MyFrame::OnPlaySeek, this, ID_PLAY_SLIDER);
+    Bind(wxEVT_CHOICE, &MyFrame::OnPlaySpeed, this, ID_PLAY_SPEED);
+    Bind(wxEVT_BUTTON, &MyFrame::OnPlayStop, this, ID_PLAY_STOP);
+    Bind(EVT_PLAYBACK, &MyFrame::OnPlayback, this);
     m_colorPicker->Bind(wxEVT_COLOURPICKER_CHANGED, &MyFrame::OnColorChanged, this);
+    Bind(wxEVT_MENU, &MyFrame::OnStrokeOptions, this, ID_STROKE_OPTIONS);
+    Bind(wxEVT_MENU, &MyFrame::OnBatchedRendering, this, ID_BATCHED_RENDER);
+    Bind(wxEVT_MENU, &MyFrame::OnCompareRender, this, ID_COMPARE_RENDER);
+    Bind(wxEVT_MENU, &MyFrame::OnRenderBackend, this, ID_BACKEND_DC);
+    Bind(wxEVT_MENU, &MyFrame::OnRenderBackend, this, ID_BACKEND_TILES);
+    Bind(wxEVT_MENU, &MyFrame::OnFrameRate, this, ID_FRAME_60);
+    Bind(wxEVT_MENU, &MyFrame::OnFrameRate, this, ID_FRAME_120);
+    Bind(wxEVT_MENU, &MyFrame::OnFrameRate, this, ID_FRAME_UNPACED);
+    Bind(wxEVT_MENU, &MyFrame::OnShowStats, this, ID_SHOW_STATS);
+    Bind(wxEVT_MENU, &MyFrame::OnExportStats, this, ID_EXPORT_STATS);
+    Bind(wxEVT_MENU, &MyFrame::OnRecordTrace, this, ID_RECORD_TRACE);
+    Bind(wxEVT_MENU, &MyFrame::OnOpen, this, wxID_OPEN);
+    Bind(wxEVT_MENU, &MyFrame::OnSave, this, wxID_SAVE);
+    Bind(wxEVT_MENU, &MyFrame::OnSaveAs, this, wxID_SAVEAS);
+    Bind(wxEVT_MENU, &MyFrame::OnExportImage, this, ID_EXPORT_IMAGE);
+    Bind(wxEVT_UPDATE_UI, &MyFrame::OnUpdateExport, this, ID_EXPORT_IMAGE);
+    Bind(wxEVT_MENU, &MyFrame::OnExportSvg, this, ID_EXPORT_SVG);
+    Bind(EVT_EXPORT_PROGRESS, &MyFrame::OnExportProgress, this);
+    Bind(EVT_EXPORT_DONE, &MyFrame::OnExportDone, this);
+    Bind(wxEVT_CLOSE_WINDOW, &MyFrame::OnClose, this);
+    Bind(wxEVT_MENU, &MyFrame::OnUndo, this, wxID_UNDO);
+    Bind(wxEVT_MENU, &MyFrame::OnRedo, this, wxID_REDO);
+    Bind(wxEVT_MENU, &MyFrame::OnUndoAll, this, ID_UNDO_ALL);
+    Bind(wxEVT_MENU, &MyFrame::OnHistoryLimit, this, ID_HISTORY_LIMIT);
+    Bind(wxEVT_MENU, &MyFrame::OnFillTolerance, this, ID_FILL_TOLERANCE);
+    Bind(wxEVT_UPDATE_UI, &MyFrame::OnUpdateUndoRedo, this, wxID_UNDO);
+    Bind(wxEVT_UPDATE_UI, &MyFrame::OnUpdateUndoRedo, this, wxID_REDO);
+    Bind(wxEVT_UPDATE_UI, &MyFrame::OnUpdateUndoRedo, this, ID_UNDO_ALL);
+    Bind(wxEVT_MENU, &MyFrame::OnZoom, this, wxID_ZOOM_IN);
+    Bind(wxEVT_MENU, &MyFrame::OnZoom, this, wxID_ZOOM_OUT);
+    Bind(wxEVT_MENU, &MyFrame::OnZoom, this, wxID_ZOOM_100);
+    
+    // 状态栏：0 = 提示信息，1 = 背景缓存统计，2 = 点数精简统计，3 = 撤销历史，4 = 缩放
+    CreateStatusBar(5);
+    SetStatusText("就绪", 0);
     
     Centre();
 }
 
+void MyFrame::OnOpen(wxCommandEvent& event) {
+    wxFileDialog openFileDialog(this, "打开绘图", "", "",
+                               "绘图文件 (*.wxd)|*.wxd|所有文件 (*.*)|*.*",
+                               wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+    if (openFileDialog.ShowModal() == wxID_CANCEL) {
+        return;
+    }
+    
+    wxString filename = openFileDialog.GetPath();
+    wxString error;
+    wxStopWatch sw;
+    if (!m_drawPanel->LoadDrawing(filename, error)) {
+        wxMessageBox("无法打开文件: " + error, "错误", wxOK | wxICON_ERROR, this);
+        return;
+    }
+    m_currentFile = filename;
+    SyncLayerControls();
+    SetTitle("自定义绘制示例 - " + wxFileName(filename).GetFullName());
+    SetStatusText(wxString::Format("已打开: %s (%ld ms)", filename, sw.Time()), 0);
+}
+
+void MyFrame::OnSave(wxCommandEvent& event) {
+    if (m_currentFile.IsEmpty()) {
+        OnSaveAs(event);
+    } else {
+        SaveTo(m_currentFile);
+    }
+}
+
+void MyFrame::OnSaveAs(wxCommandEvent& event) {
+    wxFileDialog saveFileDialog(this, "另存为", "", "",
+                               "绘图文件 (*.wxd)|*.wxd",
+                               wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if (saveFileDialog.ShowModal() == wxID_CANCEL) {
+        return;
+    }
+    SaveTo(saveFileDialog.GetPath());
+}
+
+void MyFrame::SaveTo(const wxString& path) {
+    wxString error;
+    wxStopWatch sw;
+    if (!m_drawPanel->SaveDrawing(path, error)) {
+        wxMessageBox("无法保存文件: " + error, "错误", wxOK | wxICON_ERROR, this);
+        return;
+    }
+    m_currentFile = path;
+    SetTitle("自定义绘制示例 - " + wxFileName(path).GetFullName());
+    SetStatusText(wxString::Format("已保存: %s (%s, %ld ms)", path,
+                                   wxFileName(path).GetHumanReadableSize(), sw.Time()), 0);
+}
+
+void MyFrame::OnExportImage(wxCommandEvent& event) {
+    // 导出当前视口看到的世界范围，1x 与屏幕上的缩放比例一致
+    drawing::StrokeBox area = m_drawPanel->GetExportArea();
+    double zoom = m_drawPanel->GetZoom();
+    int width = int(std::floor((area.right - area.left + 1) * zoom + 0.5));
+    int height = int(std::floor((area.bottom - area.top + 1) * zoom + 0.5));
+    width = std::max(1, width);
+    height = std::max(1, height);
+    
+    // 输出尺寸：视口的整数倍，或者宽 7680 像素的 8K 海报
+    double poster = 7680.0 / width;
+    wxArrayString choices;
+    choices.Add(wxString::Format("1x (%d x %d)", width, height));
+    choices.Add(wxString::Format("2x (%d x %d)", width * 2, height * 2));
+    choices.Add(wxString::Format("4x (%d x %d)", width * 4, height * 4));
+    choices.Add(wxString::Format("8K 海报 (7680 x %d)", int(height * poster + 0.5)));
+    int choice = wxGetSingleChoiceIndex("导出尺寸:", "导出图像", choices, this);
+    if (choice < 0) {
+        return;
+    }
+    const double scales[] = { zoom, 2 * zoom, 4 * zoom, poster * zoom };
+    
+    wxFileDialog saveFileDialog(this, "导出图像", "", "",
+                               "PNG 图像 (*.png)|*.png|JPEG 图像 (*.jpg)|*.jpg",
+                               wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if (saveFileDialog.ShowModal() == wxID_CANCEL) {
+        return;
+    }
+    wxBitmapType type = saveFileDialog.GetFilterIndex() == 1 ? wxBITMAP_TYPE_JPEG
+                                                              : wxBITMAP_TYPE_PNG;
+    
+    // UI 线程上只拷贝笔画数据，其余工作都交给导出线程
+    drawing::StrokeSnapshot snapshot;
+    m_drawPanel->TakeSnapshot(snapshot);
+    m_exportThread = new ExportThread(this, snapshot, area, scales[choice],
+                                      m_drawPanel->GetTheme(), saveFileDialog.GetPath(), type);
+    if (m_exportThread->Run() != wxTHREAD_NO_ERROR) {
+        delete m_exportThread;
+        m_exportThread = NULL;
+        wxMessageBox("无法启动导出线程", "错误", wxOK | wxICON_ERROR, this);
+        return;
+    }
+    
+    // 进度对话框只禁用本窗口的输入，事件循环照常运行，画面仍会刷新
+    m_exportProgress = new wxProgressDialog("导出图像", "正在光栅化...", 100, this,
+                                            wxPD_CAN_ABORT | wxPD_ELAPSED_TIME | wxPD_SMOOTH);
+}
+
+void MyFrame::OnExportSvg(wxCommandEvent& event) {
+    wxFileDialog saveFileDialog(this, "导出 SVG", "", "",
+                               "SVG 图像 (*.svg)|*.svg",
+                               wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if (saveFileDialog.ShowModal() == wxID_CANCEL) {
+        return;
+    }
+    
+    // 写文件是顺序 I/O，几百万个点也只要零点几秒，直接在 UI 线程上完成
+    wxString path = saveFileDialog.GetPath();
+    wxString error;
+    uint64_t points = 0;
+    wxBusyCursor busy;
+    wxStopWatch sw;
+    if (!m_drawPanel->ExportSvg(path, points, error)) {
+        wxMessageBox("无法导出 SVG: " + error, "错误", wxOK | wxICON_ERROR, this);
+        return;
+    }
+    SetStatusText(wxString::Format("已导出 SVG: %s (%llu 个点, %s, %ld ms)", path,
+                                   (unsigned long long)points,
+                                   wxFileName(path).GetHumanReadableSize(), sw.Time()), 0);
+}
+
+void MyFrame::OnExportProgress(wxThreadEvent& event) {
+    if (!m_exportProgress || !m_exportThread) {
+        return;
+    }
+    bool keepGoing = event.GetInt() >= 0
+        ? m_exportProgress->Update(event.GetInt(), "正在光栅化...")
+        : m_exportProgress->Pulse("正在编码...");
+    if (!keepGoing) {
+        m_exportThread->Cancel();  // 线程在下一个行带或下一次写入时停下
+        m_exportProgress->Update(m_exportProgress->GetValue(), "正在取消...");
+    }
+}
+
+void MyFrame::OnExportDone(wxThreadEvent& event) {
+    if (m_exportThread) {
+        m_exportThread->Wait();  // 完成事件是线程发出的最后一件事，这里很快返回
+        delete m_exportThread;
+        m_exportThread = NULL;
+    }
+    if (m_exportProgress) {
+        m_exportProgress->Destroy();
+        m_exportProgress = NULL;
+    }
+    
+    switch (event.GetInt()) {
+        case 1:
+            SetStatusText("已导出图像: " + event.GetString(), 0);
+            break;
+        case -1:
+            SetStatusText("导出已取消", 0);
+            break;
+        default:
+            wxMessageBox(event.GetString(), "导出失败", wxOK | wxICON_ERROR, this);
+            break;
+    }
+}
+
+void MyFrame::OnUpdateExport(wxUpdateUIEvent& event) {
+    event.Enable(m_exportThread == NULL);
+}
+
+void MyFrame::OnClose(wxCloseEvent& event) {
+    // 导出线程还持有本窗口的指针，先让它停下
+    if (m_exportThread) {
+        m_exportThread->Cancel();
+        m_exportThread->Wait();
+        delete m_exportThread;
+        m_exportThread = NULL;
+    }
+    event.Skip();
+}
+
 void MyFrame::OnDrawMode(wxCommandEvent& event) {
-    int mode = 0;
+    int mode = DrawPanel::MODE_FREE;
     switch (event.GetId()) {
-        case ID_MODE_FREE: mode = 0; break;
-        case ID_MODE_RECT: mode = 1; break;
-        case ID_MODE_CIRCLE: mode = 2; break;
-        case ID_MODE_LINE: mode = 3; break;
+        case ID_MODE_FREE: mode = DrawPanel::MODE_FREE; break;
+        case ID_MODE_RECT: mode = DrawPanel::MODE_RECT; break;
+        case ID_MODE_CIRCLE: mode = DrawPanel::MODE_CIRCLE; break;
+        case ID_MODE_LINE: mode = DrawPanel::MODE_LINE; break;
+        case ID_MODE_ERASER: mode = DrawPanel::MODE_ERASER; break;
+        case ID_MODE_SELECT: mode = DrawPanel::MODE_SELECT; break;
+        case ID_MODE_FILL: mode = DrawPanel::MODE_FILL; break;
     }
     m_drawPanel->SetDrawMode(mode);
 }
@@ -335,10 +2931,222 @@ void MyFrame::OnClear(wxCommandEvent& event) {
 
 void MyFrame::OnSizeChanged(wxCommandEvent& event) {
     m_penSize = m_sizeSlider->GetValue();
+    m_drawPanel->SetPen(m_penSize, m_penColor);
 }
 
 void MyFrame::OnColorChanged(wxColourPickerEvent& event) {
     m_penColor = event.GetColour();
+    m_drawPanel->SetPen(m_penSize, m_penColor);
+}
+
+// ==================== 图层控件 ====================
+
+void MyFrame::SyncLayerControls() {
+    // 列表从上到下显示图层，最上面的图层（编号最大）排在第一个
+    int count = m_drawPanel->GetLayerCount();
+    m_layerChoice->Clear();
+    for (int i = count - 1; i >= 0; i--) {
+        m_layerChoice->Append(wxString::FromUTF8(m_drawPanel->GetLayer(i).name.c_str()));
+    }
+    int active = m_drawPanel->GetActiveLayer();
+    m_layerChoice->SetSelection(count - 1 - active);
+
+    const drawing::Layer& layer = m_drawPanel->GetLayer(active);
+    m_layerVisible->SetValue(layer.visible);
+    m_layerOpacity->SetValue((layer.opacity * 100 + 127) / 255);
+    m_layerBlend->SetSelection(int(layer.blend));
+}
+
+void MyFrame::OnLayerSelect(wxCommandEvent& event) {
+    m_drawPanel->SetActiveLayer(m_drawPanel->GetLayerCount() - 1 - event.GetSelection());
+    SyncLayerControls();
+}
+
+void MyFrame::OnLayerAdd(wxCommandEvent& event) {
+    if (m_drawPanel->AddLayer() < 0) {
+        SetStatusText(wxString::Format("最多 %d 个图层", int(DrawPanel::kMaxLayers)), 0);
+        return;
+    }
+    SyncLayerControls();
+}
+
+void MyFrame::OnLayerVisible(wxCommandEvent& event) {
+    m_drawPanel->SetLayerVisible(m_drawPanel->GetActiveLayer(), event.IsChecked());
+}
+
+void MyFrame::OnLayerOpacity(wxCommandEvent& event) {
+    // 拖动时连续触发：只重新合成，不重新光栅化
+    m_drawPanel->SetLayerOpacity(m_drawPanel->GetActiveLayer(), (event.GetInt() * 255 + 50) / 100);
+}
+
+void MyFrame::OnLayerBlend(wxCommandEvent& event) {
+    m_drawPanel->SetLayerBlend(m_drawPanel->GetActiveLayer(),
+                               drawing::BlendMode(event.GetSelection()));
+}
+
+// ==================== 回放控件 ====================
+
+void MyFrame::OnPlay(wxCommandEvent& event) {
+    m_drawPanel->SetPlaybackRunning(!m_drawPanel->IsPlaybackRunning());
+    if (!m_drawPanel->IsPlaying()) {
+        SetStatusText("正在绘制，松开鼠标后才能回放", 0);
+    }
+}
+
+void MyFrame::OnPlaySeek(wxCommandEvent& event) {
+    // 拖动进度条时连续触发：每次按时间索引定位，不从头重放
+    m_drawPanel->SeekPlayback(m_drawPanel->GetPlaybackDuration() * event.GetInt() / 1000.0);
+}
+
+void MyFrame::OnPlaySpeed(wxCommandEvent& event) {
+    const double speeds[] = { 0.5, 1, 2, 4, 8, 16 };
+    m_drawPanel->SetPlaybackSpeed(speeds[event.GetSelection()]);
+}
+
+void MyFrame::OnPlayStop(wxCommandEvent& event) {
+    m_drawPanel->StopPlayback();
+}
+
+void MyFrame::OnPlayback(wxCommandEvent& event) {
+    double duration = m_drawPanel->GetPlaybackDuration();
+    double time = m_drawPanel->GetPlaybackTime();
+    m_playButton->SetLabel(m_drawPanel->IsPlaybackRunning() ? "暂停" : "播放");
+    if (!m_drawPanel->IsPlaying()) {
+        m_playSlider->SetValue(0);
+        SetStatusText("回放结束", 0);
+        return;
+    }
+    m_playSlider->SetValue(duration > 0 ? int(time / duration * 1000 + 0.5) : 0);
+    SetStatusText(wxString::Format("回放 %.1f / %.1f 秒", time / 1000, duration / 1000), 0);
+}
+
+void MyFrame::OnStrokeOptions(wxCommandEvent& event) {
+    StrokeOptionsDialog dialog(this, m_drawPanel->GetFilterOptions());
+    if (dialog.ShowModal() == wxID_OK) {
+        m_drawPanel->SetFilterOptions(dialog.GetOptions());
+        SetStatusText("笔画简化参数已更新", 0);
+    }
+}
+
+void MyFrame::OnBatchedRendering(wxCommandEvent& event) {
+    m_drawPanel->SetBatchedRendering(event.IsChecked());
+    SetStatusText(event.IsChecked() ? "绘制方式: 批量折线" : "绘制方式: 逐段", 0);
+}
+
+void MyFrame::OnCompareRender(wxCommandEvent& event) {
+    wxBusyCursor busy;
+    double batchedMs = 0, perSegmentMs = 0;
+    m_drawPanel->CompareRenderPaths(10, batchedMs, perSegmentMs);
+    SetStatusText(wxString::Format("完整重绘: 批量 %.2f ms / 逐段 %.2f ms",
+                                   batchedMs, perSegmentMs), 0);
+}
+
+void MyFrame::OnRenderBackend(wxCommandEvent& event) {
+    bool tiles = (event.GetId() == ID_BACKEND_TILES);
+    m_drawPanel->SetRenderBackend(tiles ? DrawPanel::BACKEND_TILES : DrawPanel::BACKEND_DC);
+    SetStatusText(tiles ? "渲染后端: 多线程分块" : "渲染后端: wxDC", 0);
+}
+
+void MyFrame::OnFrameRate(wxCommandEvent& event) {
+    int hz = 0;
+    switch (event.GetId()) {
+        case ID_FRAME_60:  hz = 60; break;
+        case ID_FRAME_120: hz = 120; break;
+        default:           hz = 0; break;
+    }
+    m_drawPanel->SetFrameRate(hz);
+    SetStatusText(hz > 0 ? wxString::Format("输入帧率: %d Hz", hz) : wxString("输入帧率: 不限"), 0);
+}
+
+void MyFrame::OnShowStats(wxCommandEvent& event) {
+    m_drawPanel->ShowStats(event.IsChecked());
+}
+
+void MyFrame::OnExportStats(wxCommandEvent& event) {
+    wxFileDialog saveFileDialog(this, "导出帧统计", "", "frame_stats.csv",
+                               "CSV 文件 (*.csv)|*.csv", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if (saveFileDialog.ShowModal() == wxID_CANCEL) {
+        return;
+    }
+    wxString error;
+    if (!m_drawPanel->SaveStatsCsv(saveFileDialog.GetPath(), error)) {
+        wxMessageBox("无法导出帧统计: " + error, "错误", wxOK | wxICON_ERROR, this);
+        return;
+    }
+    SetStatusText("已导出帧统计: " + saveFileDialog.GetPath(), 0);
+}
+
+void MyFrame::OnRecordTrace(wxCommandEvent& event) {
+    if (event.IsChecked()) {
+        m_drawPanel->StartRecording();
+        SetStatusText("正在录制输入轨迹，再次点击菜单项停止", 0);
+        return;
+    }
+    
+    m_drawPanel->StopRecording();
+    const drawing::InputTrace& trace = m_drawPanel->GetTrace();
+    if (trace.GetCount() == 0) {
+        SetStatusText("没有录制到自由绘制的输入", 0);
+        return;
+    }
+    wxFileDialog saveFileDialog(this, "保存输入轨迹", "", "input.trace",
+                               "输入轨迹 (*.trace)|*.trace", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if (saveFileDialog.ShowModal() == wxID_CANCEL) {
+        return;
+    }
+    if (!trace.Save(saveFileDialog.GetPath().fn_str())) {
+        wxMessageBox("无法保存输入轨迹", "错误", wxOK | wxICON_ERROR, this);
+        return;
+    }
+    SetStatusText(wxString::Format("已保存 %lu 个输入事件: %s",
+                                   (unsigned long)trace.GetCount(), saveFileDialog.GetPath()), 0);
+}
+
+void MyFrame::OnUndo(wxCommandEvent& event) {
+    m_drawPanel->Undo();
+}
+
+void MyFrame::OnRedo(wxCommandEvent& event) {
+    m_drawPanel->Redo();
+}
+
+void MyFrame::OnUndoAll(wxCommandEvent& event) {
+    m_drawPanel->UndoAll();
+}
+
+void MyFrame::OnHistoryLimit(wxCommandEvent& event) {
+    long current = long(m_drawPanel->GetHistoryLimit() / (1024 * 1024));
+    long mb = wxGetNumberFromUser("撤销历史最多占用的内存，超出后丢弃最旧的步骤。",
+                                  "上限 (MB):", "历史记录上限", current, 1, 4096, this);
+    if (mb > 0) {
+        m_drawPanel->SetHistoryLimit(size_t(mb) * 1024 * 1024);
+        SetStatusText(wxString::Format("历史记录上限: %ld MB", mb), 0);
+    }
+}
+
+void MyFrame::OnFillTolerance(wxCommandEvent& event) {
+    long value = wxGetNumberFromUser("各颜色通道与点击处相差不超过容差的像素会被一起填充。\n"
+                                     "0 只填完全相同的颜色，抗锯齿的边缘需要 30 左右。",
+                                     "容差 (0-255):", "填充容差",
+                                     m_drawPanel->GetFillTolerance(), 0, 255, this);
+    if (value >= 0) {
+        m_drawPanel->SetFillTolerance(int(value));
+        SetStatusText(wxString::Format("填充容差: %ld", value), 0);
+    }
+}
+
+void MyFrame::OnUpdateUndoRedo(wxUpdateUIEvent& event) {
+    event.Enable(event.GetId() == wxID_REDO ? m_drawPanel->CanRedo() : m_drawPanel->CanUndo());
+}
+
+void MyFrame::OnZoom(wxCommandEvent& event) {
+    wxSize size = m_drawPanel->GetClientSize();
+    wxPoint center(size.x / 2, size.y / 2);
+    switch (event.GetId()) {
+        case wxID_ZOOM_IN:  m_drawPanel->ZoomAt(2.0, center); break;
+        case wxID_ZOOM_OUT: m_drawPanel->ZoomAt(0.5, center); break;
+        default:            m_drawPanel->ZoomReset(); break;
+    }
 }
 
 wxIMPLEMENT_APP(MyApp);
@@ -369,9 +3177,10 @@ wxIMPLEMENT_APP(MyApp);
  *    - SetTextForeground(color): 文本颜色
  * 
  * 4. 避免闪烁
- *    - 使用 wxAutoBufferedPaintDC
+ *    - 使用 wxAutoBufferedPaintDC，或自己维护后台缓冲位图（本例 DrawPanel）
  *    - SetBackgroundStyle(wxBG_STYLE_PAINT)
  *    - 不在 OnEraseBackground 中绘制
+ *    - 增量绘制：新内容画进后台缓冲，再用 RefreshRect() 只刷新变化的区域
  * 
  * 5. 坐标系统
  *    - 默认：左上角 (0,0)，向右向下递增
@@ -382,10 +3191,90 @@ wxIMPLEMENT_APP(MyApp);
  *    - GradientFillLinear(): 线性渐变
  *    - GradientFillConcentric(): 径向渐变
  * 
+ * 7. 曲线
+ *    - 曲线先展平成折线，再一次 DrawLines 画出（drawing/bezier.h）
+ *    - 自适应细分按平坦度容差决定点数，前向差分适合均匀取点
+ * 
+ * 8. 空间索引
+ *    - 笔画按包围盒登记到均匀网格（drawing/spatial_grid.h）
+ *    - 重绘、擦除、选择都只查询相关格子，不遍历全部笔画
+ * 
+ * 9. 撤销 / 重做
+ *    - 历史只记录命令（添加 / 擦除 / 清空涉及的笔画 id），擦除只隐藏笔画（drawing/history.h）
+ *    - 撤销一步的代价与涉及的笔画大小成正比；检查点让"全部撤销"不必逐条回放
+ *    - 历史占用有上限，超出时丢弃最旧的步骤并释放再也用不到的点数据
+ * 
+ * 10. 文件格式
+ *    - 点坐标存成相邻点的差值，zigzag + varint 编码后每个点约 2 字节（drawing/stroke_file.h）
+ *    - 保存时逐个点块编码写出；打开时内存映射文件，只读笔画头，
+ *      笔画第一次出现在重绘区域时才解码
+ * 
+ * 11. 后台导出
+ *    - UI 线程只拷贝笔画数据，缩放、光栅化、PNG / JPEG 编码都在 wxThread 上进行
+ *    - 进度通过 wxQueueEvent 发回 UI 线程；取消时让输出流写入失败，编码器随之中止
+ *
+ * 12. 缩放与平移
+ *    - 笔画以世界坐标保存，缩放 / 平移只改变视图变换（drawing/viewport.h）
+ *    - 重绘时把屏幕区域换算成世界范围去查询空间索引，视口外的笔画不会被访问
+ *    - 缩小时使用逐级简化的笔画（drawing/stroke_lod.h），绘制的顶点数与缩放比例相关，
+ *      而不是与原始点数相关；各级别第一次用到时才生成
+ *
+ * 13. 帧调度
+ *    - 鼠标移动事件只把位置放进队列；wxTimer 按目标帧率（60 / 120 Hz）取出整批，
+ *      一次画进后台缓冲、一次刷新，再用 Update() 立即绘制
+ *    - 输入越密集，每帧处理的点越多，但重绘次数固定，延迟不会随输入量增长
+ *
+ * 14. 性能统计
+ *    - 每次 OnPaint 记录耗时（背景 / 网格 / 笔画）、线段数、脏区面积和输入延迟，
+ *      放进固定容量的环形缓冲（drawing/frame_stats.h）
+ *    - F3 显示半透明叠加层：分位数比平均值更能说明偶发的卡顿；也可以导出 CSV
+ *
+ * 15. 回放基准
+ *    - "选项 → 录制输入轨迹"记录鼠标事件（drawing/input_trace.h）
+ *    - draw_bench 不创建窗口，把轨迹回放进同一套绘图引擎，报告吞吐量、
+ *      每帧耗时分布和内存峰值，可以在发布前发现绘制性能的回退
+ *
+ * 16. 形状
+ *    - 拖动时预览只叠加在屏幕上，每次只刷新新旧两个预览区域
+ *    - 松开后展开成折线（drawing/shapes.h），作为普通笔画进入场景，
+ *      与手绘笔画共用索引、撤销、文件格式和导出
+ *
+ * 17. 样式与画笔缓存
+ *    - 笔画样式在 StrokeStore 中去重，笔画只保存样式编号
+ *    - 画笔 / 画刷从 GdiCache 中取：相同组合共用一个对象，LRU 限制数量，
+ *      F3 统计里可以看到命中率和淘汰次数
+ *
+ * 18. 填充内核
+ *    - 背景渐变和网格不经过 wxDC，由 drawing/fill_kernels.h 直接写 wxImage 的像素
+ *    - SSE2 / AVX2 / 标量版本在运行时选择，fill_bench 与 wxDC 的结果对比
+ *
+ * 19. 油漆桶
+ *    - 把视口内的笔画按 1:1 光栅化（空白的块不进线程池），从点击处做扫描线填充，
+ *      种子放在显式的栈里，迷宫一样的区域也不会递归过深
+ *    - 结果是一组行程，保存为填充笔画：缩放后仍然对齐，撤销、文件和导出都照常工作
+ *
+ * 20. 图层
+ *    - 每个图层单独光栅化成预乘 alpha 的 RGBA（分块渲染器的透明背景模式），
+ *      笔画的改动只让所在图层的那一块过期
+ *    - 合成器（drawing/layers.h）用 SSE2 / AVX2 把背景和各图层叠加起来，
+ *      只处理脏区域；显示 / 隐藏、不透明度、混合模式只重新合成
+ *    - 只有一个普通图层时结果与直接绘制相同，仍然使用原来的后端
+ *
+ * 21. SVG 导出
+ *    - drawing/svg_writer.h 边遍历笔画边写文件，经 64KB 缓冲输出，不拼整个文档
+ *    - path 数据用相对坐标和定点小数（"M10 20l3-2 4 5"），每个点平均四五个字节
+ *    - 未解码的笔画临时解码后直接写出，内存占用与点数无关
+ *
+ * 22. 回放
+ *    - 鼠标移动的时刻在 OnMouseMove 中记下，随点一起进入时间轴（drawing/stroke_timeline.h），
+ *      RDP 简化时与点一起压缩；笔画之间的长时间停顿在时间轴上被压缩掉
+ *    - 拖动进度条时在笔画开始时刻上二分定位，只重画视口里已经画完的笔画，不从头重放
+ *    - 播放时定时器以固定的 60 Hz 推进，每帧只把新露出的线段画在上一帧上
+ *
  * 练习：
- * 1. 实现矩形、圆形、直线绘制模式
- * 2. 添加橡皮擦功能
- * 3. 实现撤销/重做
- * 4. 保存绘制结果为图片
+ * 1. 给矩形和圆加上填充，或者让矩形模式按住 Shift 时画正方形
+ * 2. 橡皮擦目前删除整条笔画，试着改成只擦掉光标经过的那一段（把笔画切成两条）
+ * 3. 撤销 / 重做只覆盖了笔画，试着让画笔颜色、主题等设置也能撤销
+ * 4. 导出时给图像加上网格，或者只导出选中的笔画
  * 5. 添加更多绘制工具（文本、箭头等）
  */
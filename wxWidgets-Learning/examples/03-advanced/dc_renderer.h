@@ -0,0 +1,295 @@
+/*
+ * wxDC 笔画绘制（custom_draw 的 DrawPanel 和 draw_bench 的 dc 后端共用）
+ *
+ * - 坐标与颜色在 wx 类型和 drawing 类型之间的转换
+ * - GdiCache：相同的 (颜色, 宽度, 线型) 只创建一个 wxPen，数量有上限（drawing::LruCache）
+ * - DcStrokeRenderer：把笔画转成屏幕坐标画到 wxDC 上、重画一块区域
+ *   （背景位图 + 空间索引查到的笔画）、把新增的线段直接画进后台缓冲
+ *
+ * 基准和程序走的是同一份绘制代码、同一个画笔缓存，这里的性能回退
+ * 会直接反映在 draw_bench 的结果里。
+ *
+ * 与 drawing/ 下的头文件不同，本文件依赖 wxWidgets。
+ */
+
+#ifndef DC_RENDERER_H
+#define DC_RENDERER_H
+
+#include <wx/wx.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "drawing/stroke_store.h"
+#include "drawing/spatial_grid.h"
+#include "drawing/viewport.h"
+#include "drawing/stroke_lod.h"
+#include "drawing/frame_stats.h"
+#include "drawing/lru_cache.h"
+
+// ==================== 坐标与颜色转换 ====================
+
+static inline drawing::StrokePoint ToStrokePoint(const wxPoint& pt) {
+    drawing::StrokePoint sp = { pt.x, pt.y };
+    return sp;
+}
+
+static inline wxPoint ToWxPoint(const drawing::StrokePoint& pt) {
+    return wxPoint(pt.x, pt.y);
+}
+
+static inline uint32_t ToStrokeColour(const wxColour& c) {
+    return (uint32_t(c.Red()) << 16) | (uint32_t(c.Green()) << 8) | uint32_t(c.Blue());
+}
+
+static inline wxColour ToWxColour(uint32_t c) {
+    return wxColour((c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF);
+}
+
+static inline uint32_t PackColour(const wxColour& c) {
+    return (uint32_t(c.Alpha()) << 24) | ToStrokeColour(c);
+}
+
+static inline drawing::StrokeBox ToStrokeBox(const wxRect& r) {
+    drawing::StrokeBox box;
+    box.left = r.x;
+    box.top = r.y;
+    box.right = r.x + r.width - 1;
+    box.bottom = r.y + r.height - 1;
+    return box;
+}
+
+static inline wxRect ToWxRect(const drawing::StrokeBox& box) {
+    if (box.IsEmpty()) {
+        return wxRect();
+    }
+    return wxRect(box.left, box.top, box.right - box.left + 1, box.bottom - box.top + 1);
+}
+
+// ==================== 画笔 / 画刷缓存 ====================
+
+// 程序里所有绘制共用一份：相同的 (颜色, 宽度, 线型) 只创建一个 wxPen，
+// 相同的颜色只创建一个 wxBrush。数量有上限，超出时淘汰最久没用的。
+// 只在 UI 线程上使用
+class GdiCache {
+public:
+    GdiCache() : m_pens(256), m_brushes(64) {}
+
+    const wxPen& GetPen(const wxColour& colour, int width, wxPenStyle style = wxPENSTYLE_SOLID) {
+        // 颜色 32 位 | 宽度 16 位 | 线型 16 位
+        uint64_t key = (uint64_t(PackColour(colour)) << 32) |
+                       (uint64_t(std::min(width, 0xFFFF)) << 16) | uint64_t(style & 0xFFFF);
+        wxPen* pen = m_pens.Find(key);
+        return pen ? *pen : m_pens.Insert(key, wxPen(colour, width, style));
+    }
+
+    const wxBrush& GetBrush(const wxColour& colour) {
+        uint64_t key = PackColour(colour);
+        wxBrush* brush = m_brushes.Find(key);
+        return brush ? *brush : m_brushes.Insert(key, wxBrush(colour));
+    }
+
+    void Clear() {
+        m_pens.Clear();
+        m_brushes.Clear();
+    }
+
+    const drawing::LruCache<wxPen>& GetPens() const { return m_pens; }
+    const drawing::LruCache<wxBrush>& GetBrushes() const { return m_brushes; }
+
+private:
+    drawing::LruCache<wxPen> m_pens;
+    drawing::LruCache<wxBrush> m_brushes;
+};
+
+inline GdiCache& GetGdiCache() {
+    static GdiCache cache;
+    return cache;
+}
+
+// 笔画样式对应的画笔（宽度已经是屏幕像素）
+inline const wxPen& GetStrokePen(const drawing::StrokeStyle& style) {
+    return GetGdiCache().GetPen(ToWxColour(style.colour), style.width);
+}
+
+// ==================== 笔画绘制 ====================
+
+class DcStrokeRenderer {
+public:
+    DcStrokeRenderer() : m_lod(NULL), m_lodLevel(0), m_batched(true) {}
+
+    // 绘制之前由调用方设置：视图变换、缩小时使用的简化版本（lod 为 NULL 或
+    // level 为 0 时不用）、整条笔画作为一条折线提交还是逐段提交
+    void SetOptions(const drawing::ViewTransform& view, drawing::StrokeLod* lod, int level,
+                    bool batched) {
+        m_view = view;
+        m_lod = lod;
+        m_lodLevel = level;
+        m_batched = batched;
+    }
+
+    // 画出一条笔画。live 表示正在绘制、还在变化的笔画，不生成 LOD
+    void DrawStroke(wxDC& dc, const drawing::StrokeStore& store, drawing::StrokeId id,
+                    drawing::FrameSample& sample, bool live = false) {
+        if (store.IsFill(id)) {
+            DrawFill(dc, store, id, sample);
+            return;
+        }
+        const drawing::Stroke& stroke = store.Get(id);
+        drawing::StrokeStyle style = store.GetStyle(id);
+        style.width = m_view.ScaleWidth(style.width);
+        dc.SetPen(GetStrokePen(style));
+
+        // 缩小时改用简化过的版本，顶点数取决于笔画在屏幕上的大小而不是原始点数
+        const std::vector<drawing::StrokePoint>* lod = NULL;
+        if (m_lod && m_lodLevel > 0 && !live) {
+            lod = m_lod->Build(store, id, m_lodLevel);
+        }
+
+        // 转成屏幕坐标，缩小后落在同一像素上的相邻点只保留一个
+        m_linePoints.clear();
+        m_linePoints.reserve(lod ? lod->size() : stroke.count);
+        if (lod) {
+            for (size_t i = 0; i < lod->size(); i++) {
+                AddScreenPoint((*lod)[i]);
+            }
+        } else {
+            store.ForEachChunk(id, [this](const drawing::StrokePoint* points, size_t count) {
+                for (size_t i = 0; i < count; i++) {
+                    AddScreenPoint(points[i]);
+                }
+            });
+        }
+        if (m_linePoints.size() < 2) {
+            return;
+        }
+        sample.segments += uint32_t(m_linePoints.size() - 1);
+
+        if (m_batched) {
+            // 整条笔画作为一条折线提交，后端只需一次调用，转角处也能正确连接
+            dc.DrawLines(int(m_linePoints.size()), &m_linePoints[0]);
+            return;
+        }
+
+        // 逐段绘制：每段一次后端调用，保留下来用于对比
+        for (size_t i = 1; i < m_linePoints.size(); i++) {
+            dc.DrawLine(m_linePoints[i - 1], m_linePoints[i]);
+        }
+    }
+
+    // 只画笔画中 [first, last) 这些点连成的折线，返回画到的屏幕矩形（外扩了画笔宽度），
+    // 不足两个点时返回空矩形
+    wxRect DrawStrokePoints(wxDC& dc, const drawing::StrokeStore& store, drawing::StrokeId id,
+                            size_t first, size_t last) {
+        m_linePoints.clear();
+        size_t index = 0;
+        store.ForEachChunk(id, [&](const drawing::StrokePoint* points, size_t count) {
+            for (size_t i = 0; i < count && index < last; i++, index++) {
+                if (index >= first) {
+                    AddScreenPoint(points[i]);
+                }
+            }
+        });
+        if (m_linePoints.size() < 2) {
+            return wxRect();
+        }
+
+        drawing::StrokeStyle style = store.GetStyle(id);
+        style.width = m_view.ScaleWidth(style.width);
+        dc.SetPen(GetStrokePen(style));
+        dc.DrawLines(int(m_linePoints.size()), &m_linePoints[0]);
+
+        wxRect dirty(m_linePoints[0], m_linePoints[0]);
+        for (size_t i = 1; i < m_linePoints.size(); i++) {
+            dirty.Union(wxRect(m_linePoints[i], m_linePoints[i]));
+        }
+        return dirty.Inflate(style.width + 1);
+    }
+
+    // 新线段（屏幕坐标）只光栅化一次，直接画进 dc。
+    // 一帧里的多段作为一条折线提交，转角处也能正确连接；style 的宽度是世界单位
+    void DrawSegments(wxDC& dc, const wxPoint* points, size_t count,
+                      const drawing::StrokeStyle& style) {
+        drawing::StrokeStyle scaled = style;
+        scaled.width = m_view.ScaleWidth(style.width);
+        dc.SetPen(GetStrokePen(scaled));
+        dc.DrawLines(int(count), points);
+    }
+
+    // 重画 rect（屏幕坐标）：拷贝背景位图，再画出包围盒与该区域相交的笔画。
+    // live 是正在绘制、还没有进入索引的笔画，没有时传 NULL
+    void RenderRegion(wxDC& dc, const wxRect& rect, const wxBitmap& background,
+                      const drawing::StrokeStore& store, drawing::SpatialGrid& index,
+                      drawing::FrameSample& sample, const drawing::StrokeId* live = NULL) {
+        wxDCClipper clip(dc, rect);
+
+        // 背景 + 网格只需一次位图拷贝
+        {
+            drawing::ScopedTimer timer(sample.backgroundMs);
+            wxMemoryDC bgDC(background);
+            dc.Blit(rect.x, rect.y, rect.width, rect.height, &bgDC, rect.x, rect.y);
+        }
+
+        // 视口以外的笔画不会被查到，查询结果已按绘制顺序排好
+        drawing::ScopedTimer timer(sample.strokesMs);
+        drawing::StrokeBox region = ToStrokeBox(rect);
+        index.Query(m_view.ToWorld(region), m_queryIds);
+        for (size_t i = 0; i < m_queryIds.size(); i++) {
+            drawing::StrokeId id = m_queryIds[i];
+            if (!store.IsErased(id) &&
+                drawing::BoxesIntersect(m_view.PaintedBox(store, id), region)) {
+                DrawStroke(dc, store, id, sample);
+            }
+        }
+        if (live && drawing::BoxesIntersect(m_view.PaintedBox(store, *live), region)) {
+            DrawStroke(dc, store, *live, sample, true);
+        }
+    }
+
+private:
+    drawing::ViewTransform m_view;
+    drawing::StrokeLod* m_lod;
+    int m_lodLevel;
+    bool m_batched;
+    std::vector<wxPoint> m_linePoints;            // 屏幕坐标，复用以免每次分配
+    std::vector<drawing::StrokeId> m_queryIds;    // 索引查询结果
+
+    void DrawFill(wxDC& dc, const drawing::StrokeStore& store, drawing::StrokeId id,
+                  drawing::FrameSample& sample) {
+        // 行程已按 (x0, x1, y) 排好，x 范围相同的连续行合并成一个矩形，
+        // 一块规则的区域只需要几次 DrawRectangle
+        dc.SetPen(*wxTRANSPARENT_PEN);
+        dc.SetBrush(GetGdiCache().GetBrush(ToWxColour(store.GetStyle(id).colour)));
+        drawing::StrokeBox run;
+        bool open = false;
+        auto flush = [&]() {
+            dc.DrawRectangle(ToWxRect(m_view.SpanBox(run)));
+            sample.segments++;
+        };
+        store.ForEachSpan(id, [&](const drawing::StrokePoint& a, const drawing::StrokePoint& b) {
+            if (open && a.x == run.left && b.x == run.right && a.y == run.bottom + 1) {
+                run.bottom = a.y;
+                return;
+            }
+            if (open) {
+                flush();
+            }
+            run.left = a.x;
+            run.right = b.x;
+            run.top = run.bottom = a.y;
+            open = true;
+        });
+        if (open) {
+            flush();
+        }
+    }
+
+    void AddScreenPoint(const drawing::StrokePoint& pt) {
+        wxPoint p = ToWxPoint(m_view.ToScreen(pt));
+        if (m_linePoints.empty() || m_linePoints.back() != p) {
+            m_linePoints.push_back(p);
+        }
+    }
+};
+
+#endif // DC_RENDERER_H
@@ -0,0 +1,485 @@
+/*
+ * 绘图引擎回放基准
+ *
+ * 把录制的输入轨迹（custom_draw 的"选项 → 录制输入轨迹"，格式见
+ * drawing/input_trace.h）回放进 custom_draw 使用的绘图引擎，画到离屏位图上，
+ * 报告吞吐量、内存峰值和每帧耗时分布。整个过程不创建任何窗口。
+ *
+ * 用法：draw_bench [选项] [轨迹文件...]
+ *   --backend dc|tiles  dc（默认）：用 wxMemoryDC 绘制，调用的就是 DrawPanel 的 wxDC 绘制代码
+ *                       （dc_renderer.h，包括画笔缓存），需要图形环境，服务器上可以用 xvfb-run 运行；
+ *                       tiles：多线程分块软件光栅化，完全不需要图形环境
+ *   --rate <Hz>         按这个帧率把事件分批，默认 60
+ *   --synthetic <n>     没有轨迹文件时生成 n 条随机笔画，默认 200
+ *   --csv <文件>        把最后一个轨迹的逐帧数据导出为 CSV
+ *   --max-p95 <毫秒>    每帧耗时的 p95 超过这个值时返回 2，用于发布前检查性能回退
+ *                       （读取轨迹失败也返回 2，参数错误返回 1）
+ *
+ * 编译：g++ -std=c++11 -O2 -o draw_bench draw_bench.cpp `wx-config --cxxflags --libs` -pthread
+ *       或 CMake 目标 draw_bench
+ */
+
+#include <wx/wx.h>
+#include <wx/file.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "drawing/stroke_store.h"
+#include "drawing/spatial_grid.h"
+#include "drawing/tile_renderer.h"
+#include "drawing/frame_stats.h"
+#include "drawing/input_trace.h"
+#include "drawing/replay.h"
+#include "drawing/fill_kernels.h"
+#include "dc_renderer.h"
+
+// 与 custom_draw 的默认主题一致
+static const int kGridStep = 50;
+static const unsigned char kTop[3] = { 250, 250, 255 };
+static const unsigned char kBottom[3] = { 220, 220, 240 };
+static const unsigned char kGrid[3] = { 200, 200, 200 };
+
+static uint32_t PackRgb(const unsigned char* rgb) {
+    return (uint32_t(rgb[0]) << 16) | (uint32_t(rgb[1]) << 8) | rgb[2];
+}
+
+// ==================== 后端 ====================
+
+// 每帧的绘制分三步：新增线段画进后台缓冲，需要时重画一块区域，
+// 最后把脏区域拷贝到"屏幕"（另一块离屏缓冲，对应 OnPaint 里的 Blit）
+class BenchBackend {
+public:
+    virtual ~BenchBackend() {}
+    virtual wxString GetName() const = 0;
+
+    virtual void DrawNewSegments(const drawing::ReplayFrame& frame, drawing::TraceReplayer& replay,
+                                 drawing::FrameSample& sample) = 0;
+    virtual void RenderRegion(const drawing::StrokeBox& box, drawing::TraceReplayer& replay,
+                              const drawing::ReplayFrame& frame, drawing::FrameSample& sample) = 0;
+    virtual void Present(const drawing::StrokeBox& box, drawing::FrameSample& sample) = 0;
+};
+
+// 限制在画布范围内
+static drawing::StrokeBox ClipBox(const drawing::StrokeBox& box, int width, int height) {
+    drawing::StrokeBox r = box;
+    r.left = std::max(r.left, 0);
+    r.top = std::max(r.top, 0);
+    r.right = std::min(r.right, width - 1);
+    r.bottom = std::min(r.bottom, height - 1);
+    return r;
+}
+
+// ---------- wxDC：DrawPanel 的 wxDC 后端，绘制代码与它共用 ----------
+
+class DcBackend : public BenchBackend {
+public:
+    DcBackend(int width, int height)
+        : m_width(width), m_height(height),
+          m_background(width, height), m_backBuffer(width, height), m_screen(width, height) {
+        // 背景层：渐变 + 网格，与 DrawPanel 一样由填充内核生成，只生成一次
+        {
+            wxImage image(width, height, false);
+            drawing::RgbBuffer buffer(image.GetData(), width, height);
+            drawing::FillLinearGradient(buffer, PackRgb(kTop), PackRgb(kBottom),
+                                        drawing::GRADIENT_VERTICAL);
+            drawing::DrawDottedGrid(buffer, kGridStep, PackRgb(kGrid));
+            m_background = wxBitmap(image);
+        }
+        wxMemoryDC src(m_background);
+        wxMemoryDC dst(m_backBuffer);
+        dst.Blit(0, 0, width, height, &src, 0, 0);
+    }
+
+    virtual wxString GetName() const { return "dc (wxMemoryDC)"; }
+
+    virtual void DrawNewSegments(const drawing::ReplayFrame& frame, drawing::TraceReplayer& replay,
+                                 drawing::FrameSample& sample) {
+        const drawing::StrokeStyle& style = replay.GetStore().GetStyle(frame.stroke);
+        wxMemoryDC memDC(m_backBuffer);
+        for (size_t i = 0; i < frame.starts.size(); i++) {
+            size_t begin = frame.starts[i];
+            size_t end = i + 1 < frame.starts.size() ? frame.starts[i + 1] : frame.points.size();
+            if (end - begin < 2) {
+                continue;
+            }
+            m_linePoints.clear();
+            for (size_t k = begin; k < end; k++) {
+                m_linePoints.push_back(ToWxPoint(frame.points[k]));
+            }
+            m_renderer.DrawSegments(memDC, &m_linePoints[0], m_linePoints.size(), style);
+            sample.segments += uint32_t(m_linePoints.size() - 1);
+        }
+    }
+
+    // 背景和笔画的耗时由 DcStrokeRenderer 分别记到 backgroundMs / strokesMs
+    virtual void RenderRegion(const drawing::StrokeBox& box, drawing::TraceReplayer& replay,
+                              const drawing::ReplayFrame& frame, drawing::FrameSample& sample) {
+        drawing::StrokeBox region = ClipBox(box, m_width, m_height);
+        if (region.IsEmpty()) {
+            return;
+        }
+        wxMemoryDC memDC(m_backBuffer);
+        m_renderer.RenderRegion(memDC, ToWxRect(region), m_background, replay.GetStore(),
+                                replay.GetIndex(), sample, frame.drawing ? &frame.stroke : NULL);
+    }
+
+    virtual void Present(const drawing::StrokeBox& box, drawing::FrameSample& sample) {
+        drawing::StrokeBox r = ClipBox(box, m_width, m_height);
+        if (r.IsEmpty()) {
+            return;
+        }
+        int w = r.right - r.left + 1, h = r.bottom - r.top + 1;
+        wxMemoryDC src(m_backBuffer);
+        wxMemoryDC dst(m_screen);
+        dst.Blit(r.left, r.top, w, h, &src, r.left, r.top);
+        sample.dirtyPixels += uint64_t(w) * h;
+    }
+
+private:
+    int m_width;
+    int m_height;
+    wxBitmap m_background;
+    wxBitmap m_backBuffer;
+    wxBitmap m_screen;
+    DcStrokeRenderer m_renderer;  // 默认设置：不缩放、不用 LOD、整条提交，与 DrawPanel 的默认状态相同
+    std::vector<wxPoint> m_linePoints;
+};
+
+// ---------- 多线程分块：不依赖任何图形环境 ----------
+
+class TilesBackend : public BenchBackend {
+public:
+    TilesBackend(int width, int height)
+        : m_width(width), m_height(height),
+          m_backBuffer(size_t(width) * height * 3), m_screen(size_t(width) * height * 3) {
+        // 背景层：渐变 + 点线网格，与 DcBackend 的外观大致相同
+        std::vector<unsigned char> bg(size_t(width) * height * 3);
+        drawing::RgbBuffer buffer(&bg[0], width, height);
+        drawing::FillLinearGradient(buffer, PackRgb(kTop), PackRgb(kBottom), drawing::GRADIENT_VERTICAL);
+        drawing::DrawDottedGrid(buffer, kGridStep, PackRgb(kGrid));
+        m_tiles.SetBackground(&bg[0], width, height);
+        m_backBuffer = bg;
+    }
+
+    virtual wxString GetName() const {
+        return wxString::Format("tiles (%u 线程)", m_tiles.GetThreadCount());
+    }
+
+    // 分块后端没有增量画线，新增线段所在的块整块重画
+    virtual void DrawNewSegments(const drawing::ReplayFrame& frame, drawing::TraceReplayer& replay,
+                                 drawing::FrameSample& sample) {
+        drawing::StrokeBox box;
+        for (size_t i = 0; i < frame.points.size(); i++) {
+            box.Add(frame.points[i]);
+        }
+        int width = replay.GetStore().GetStyle(frame.stroke).width;
+        RenderTiles(drawing::InflateBox(box, width / 2 + 1), replay, frame, sample);
+    }
+
+    virtual void RenderRegion(const drawing::StrokeBox& box, drawing::TraceReplayer& replay,
+                              const drawing::ReplayFrame& frame, drawing::FrameSample& sample) {
+        drawing::ScopedTimer timer(sample.strokesMs);
+        RenderTiles(box, replay, frame, sample);
+    }
+
+    virtual void Present(const drawing::StrokeBox& box, drawing::FrameSample& sample) {
+        drawing::StrokeBox r = ClipBox(box, m_width, m_height);
+        if (r.IsEmpty()) {
+            return;
+        }
+        size_t rowBytes = size_t(r.right - r.left + 1) * 3;
+        for (int y = r.top; y <= r.bottom; y++) {
+            size_t offset = (size_t(y) * m_width + r.left) * 3;
+            memcpy(&m_screen[offset], &m_backBuffer[offset], rowBytes);
+        }
+        sample.dirtyPixels += uint64_t(r.right - r.left + 1) * (r.bottom - r.top + 1);
+    }
+
+private:
+    int m_width;
+    int m_height;
+    drawing::TileRenderer m_tiles;
+    std::vector<drawing::TileJob> m_jobs;
+    std::vector<drawing::StrokeId> m_extra;
+    std::vector<unsigned char> m_backBuffer;
+    std::vector<unsigned char> m_screen;
+
+    void RenderTiles(const drawing::StrokeBox& box, drawing::TraceReplayer& replay,
+                     const drawing::ReplayFrame& frame, drawing::FrameSample& sample) {
+        drawing::StrokeBox region = ClipBox(box, m_width, m_height);
+        if (region.IsEmpty()) {
+            return;
+        }
+        m_extra.clear();
+        if (frame.drawing) {
+            m_extra.push_back(frame.stroke);
+        }
+        const drawing::StrokeStore& store = replay.GetStore();
+        m_tiles.PrepareJobs(region, store, replay.GetIndex(), m_extra, m_jobs);
+        m_tiles.Render(store, m_jobs);
+
+        for (size_t i = 0; i < m_jobs.size(); i++) {
+            const drawing::TileJob& job = m_jobs[i];
+            for (size_t k = 0; k < job.strokes.size(); k++) {
+                size_t count = store.Get(job.strokes[k]).count;
+                sample.segments += uint32_t(count > 1 ? count - 1 : 1);
+            }
+            for (int row = 0; row < job.height; row++) {
+                memcpy(&m_backBuffer[(size_t(job.y + row) * m_width + job.x) * 3],
+                       &job.rgb[size_t(row) * job.width * 3], size_t(job.width) * 3);
+            }
+        }
+    }
+};
+
+// ==================== 工具函数 ====================
+
+// 进程的内存峰值（字节），取不到时为 0
+static size_t PeakMemoryBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return size_t(usage.ru_maxrss);          // macOS 上单位是字节
+#else
+    return size_t(usage.ru_maxrss) * 1024;   // Linux 上单位是 KB
+#endif
+#endif
+}
+
+// 生成随机笔画：鼠标每 8 ms 报告一次位置（125 Hz），笔画之间停顿 200 ms
+static void MakeSyntheticTrace(int strokes, int width, int height, drawing::InputTrace& trace) {
+    std::mt19937 rng(12345);  // 固定种子，每次运行的轨迹相同，结果可以互相比较
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    trace.Clear();
+    trace.SetCanvasSize(width, height);
+    double t = 0;
+    for (int s = 0; s < strokes; s++) {
+        double x = unit(rng) * width, y = unit(rng) * height;
+        double angle = unit(rng) * 6.2832, speed = 2 + unit(rng) * 6;
+        int points = 60 + int(unit(rng) * 340);
+
+        trace.Add(drawing::InputEvent::DOWN, t, int(x), int(y));
+        for (int i = 0; i < points; i++) {
+            angle += (unit(rng) - 0.5) * 0.3;
+            x = std::min(std::max(x + std::cos(angle) * speed, 0.0), width - 1.0);
+            y = std::min(std::max(y + std::sin(angle) * speed, 0.0), height - 1.0);
+            t += 8;
+            trace.Add(drawing::InputEvent::MOVE, t, int(x + unit(rng) - 0.5), int(y + unit(rng) - 0.5));
+        }
+        t += 8;
+        trace.Add(drawing::InputEvent::UP, t, int(x), int(y));
+        t += 200;
+    }
+}
+
+struct BenchOptions {
+    wxString backend;
+    double frameRate;
+    int synthetic;
+    wxString csvPath;
+    double maxP95;  // <= 0 表示不检查
+
+    BenchOptions() : backend("dc"), frameRate(60), synthetic(200), maxP95(0) {}
+};
+
+// ==================== 回放 ====================
+
+// 回放一个轨迹并打印报告；超过 --max-p95 时返回 false
+static bool RunTrace(const wxString& name, const drawing::InputTrace& trace,
+                     const BenchOptions& options) {
+    int width = trace.GetWidth() > 0 ? trace.GetWidth() : 1280;
+    int height = trace.GetHeight() > 0 ? trace.GetHeight() : 800;
+
+    std::unique_ptr<BenchBackend> backend;
+    if (options.backend == "tiles") {
+        backend.reset(new TilesBackend(width, height));
+    } else {
+        backend.reset(new DcBackend(width, height));
+    }
+
+    drawing::ReplayOptions replayOptions;
+    replayOptions.frameRate = options.frameRate;
+    drawing::TraceReplayer replay(trace, replayOptions);
+    drawing::FrameStats stats(1 << 16);
+    drawing::ReplayFrame frame;
+
+    // 按帧回放，事件处理和绘制都计入这一帧的耗时
+    double start = drawing::NowMs();
+    size_t frames = 0;
+    while (true) {
+        drawing::FrameSample sample;
+        double frameStart = drawing::NowMs();
+        if (!replay.NextFrame(frame)) {
+            break;
+        }
+
+        drawing::StrokeBox dirty;
+        if (!frame.points.empty()) {
+            drawing::ScopedTimer timer(sample.strokesMs);
+            backend->DrawNewSegments(frame, replay, sample);
+            for (size_t i = 0; i < frame.points.size(); i++) {
+                dirty.Add(frame.points[i]);
+            }
+            dirty = drawing::InflateBox(dirty, replayOptions.style.width + 1);
+        }
+        if (!frame.repaint.IsEmpty()) {
+            // 后端自己记录耗时：dc 后端把背景和笔画分开计
+            backend->RenderRegion(frame.repaint, replay, frame, sample);
+            drawing::StrokePoint a = { frame.repaint.left, frame.repaint.top };
+            drawing::StrokePoint b = { frame.repaint.right, frame.repaint.bottom };
+            dirty.Add(a);
+            dirty.Add(b);
+        }
+        if (!dirty.IsEmpty()) {
+            backend->Present(dirty, sample);
+        }
+
+        double end = drawing::NowMs();
+        sample.paintMs = end - frameStart;
+        sample.timeMs = end;
+        // 延迟 = 事件在轨迹时间里等到帧时刻的时间 + 这一帧实际的处理时间
+        sample.latencyMs = (frame.tickMs - frame.firstEventMs) + sample.paintMs;
+        stats.Add(sample);
+        frames++;
+    }
+    double totalMs = std::max(1e-3, drawing::NowMs() - start);
+
+    // 整个画布完整重绘几次，对应窗口尺寸变化、切换主题等情况
+    drawing::StrokeBox canvas;
+    canvas.left = 0;
+    canvas.top = 0;
+    canvas.right = width - 1;
+    canvas.bottom = height - 1;
+    const int fullRepeats = 5;
+    double fullStart = drawing::NowMs();
+    for (int i = 0; i < fullRepeats; i++) {
+        drawing::FrameSample ignored;
+        backend->RenderRegion(canvas, replay, frame, ignored);
+    }
+    double fullMs = (drawing::NowMs() - fullStart) / fullRepeats;
+
+    const drawing::StrokeStore& store = replay.GetStore();
+    double p95 = stats.Percentile(95, &drawing::FrameSample::paintMs);
+    wxPrintf("轨迹: %s (%lu 事件, %lu 笔画, %d x %d)\n", name,
+             (unsigned long)trace.GetCount(), (unsigned long)store.GetStrokeCount(), width, height);
+    wxPrintf("  后端: %s, 帧率 %.0f Hz\n", backend->GetName(), options.frameRate);
+    wxPrintf("  回放: %lu 帧, 耗时 %.1f ms\n", (unsigned long)frames, totalMs);
+    wxPrintf("  吞吐量: %.0f 点/秒, %.0f 帧/秒\n",
+             replay.GetRawPoints() * 1000.0 / totalMs, frames * 1000.0 / totalMs);
+    wxPrintf("  每帧耗时: p50 %.3f  p95 %.3f  p99 %.3f  最大 %.3f ms\n",
+             stats.Percentile(50, &drawing::FrameSample::paintMs), p95,
+             stats.Percentile(99, &drawing::FrameSample::paintMs),
+             stats.Percentile(100, &drawing::FrameSample::paintMs));
+    wxPrintf("  输入延迟: p50 %.2f  p95 %.2f  p99 %.2f ms\n",
+             stats.Percentile(50, &drawing::FrameSample::latencyMs),
+             stats.Percentile(95, &drawing::FrameSample::latencyMs),
+             stats.Percentile(99, &drawing::FrameSample::latencyMs));
+    wxPrintf("  点数: 输入 %lu → 保存 %lu\n",
+             (unsigned long)replay.GetRawPoints(), (unsigned long)replay.GetKeptPoints());
+    wxPrintf("  完整重绘: %.2f ms\n", fullMs);
+    wxPrintf("  内存: 笔画存储 %.1f MB, 进程峰值 %.1f MB\n",
+             store.GetReservedBytes() / (1024.0 * 1024.0), PeakMemoryBytes() / (1024.0 * 1024.0));
+
+    if (!options.csvPath.empty()) {
+        std::string csv = stats.FormatCsv();
+        wxFile file;
+        if (!file.Create(options.csvPath, true) || file.Write(csv.data(), csv.size()) != csv.size()) {
+            wxPrintf("  无法写入 %s\n", options.csvPath);
+        }
+    }
+
+    if (options.maxP95 > 0 && p95 > options.maxP95) {
+        wxPrintf("  失败: 每帧耗时 p95 %.3f ms 超过上限 %.3f ms\n", p95, options.maxP95);
+        return false;
+    }
+    return true;
+}
+
+static void PrintUsage() {
+    wxPrintf("用法: draw_bench [--backend dc|tiles] [--rate Hz] [--synthetic n]\n"
+             "                  [--csv 文件] [--max-p95 毫秒] [轨迹文件...]\n");
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    std::vector<wxString> files;
+    for (int i = 1; i < argc; i++) {
+        wxString arg = wxString::FromUTF8(argv[i]);
+        bool hasValue = i + 1 < argc;
+        if (arg == "--backend" && hasValue) {
+            options.backend = wxString::FromUTF8(argv[++i]);
+        } else if (arg == "--rate" && hasValue) {
+            options.frameRate = std::max(1.0, atof(argv[++i]));
+        } else if (arg == "--synthetic" && hasValue) {
+            options.synthetic = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--csv" && hasValue) {
+            options.csvPath = wxString::FromUTF8(argv[++i]);
+        } else if (arg == "--max-p95" && hasValue) {
+            options.maxP95 = atof(argv[++i]);
+        } else if (arg.StartsWith("--")) {
+            PrintUsage();
+            return 1;
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (options.backend != "dc" && options.backend != "tiles") {
+        PrintUsage();
+        return 1;
+    }
+
+    // wxMemoryDC 需要初始化 GUI（但不创建窗口）；分块后端只用到标准库，不初始化
+    bool gui = (options.backend == "dc");
+    if (gui) {
+        wxApp::SetInstance(new wxApp());
+        if (!wxEntryStart(argc, argv)) {
+            wxPrintf("无法初始化图形环境。没有显示器时请用 xvfb-run 运行，或者使用 --backend tiles\n");
+            return 1;
+        }
+    }
+
+    bool ok = true;
+    if (files.empty()) {
+        drawing::InputTrace trace;
+        MakeSyntheticTrace(options.synthetic, 1280, 800, trace);
+        ok = RunTrace(wxString::Format("随机生成 %d 条笔画", options.synthetic), trace, options);
+    }
+    for (size_t i = 0; i < files.size(); i++) {
+        drawing::InputTrace trace;
+        if (!trace.Load(files[i].fn_str())) {
+            wxPrintf("无法读取轨迹: %s\n", files[i]);
+            ok = false;
+            continue;
+        }
+        ok = RunTrace(files[i], trace, options) && ok;
+    }
+
+    if (gui) {
+        wxEntryCleanup();
+    }
+    return ok ? 0 : 2;
+}
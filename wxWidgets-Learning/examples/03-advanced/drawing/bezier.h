@@ -0,0 +1,350 @@
+/*
+ * 贝塞尔曲线展平（custom_draw 示例使用）
+ *
+ * 绘制曲线最终都要变成折线交给 DrawLines()。这里提供三种展平方式：
+ *
+ * - FlattenAdaptive()：按平坦度容差自适应细分。弯曲处细分得多，
+ *   平直处几乎不细分，保证折线与曲线的偏差不超过 tolerance
+ * - FlattenForwardDiff()：用 Wang 公式算出所需段数，再用前向差分
+ *   逐点推进，每个点只需几次加法
+ * - CubicBatch::Flatten()：一次展平大量曲线。数据按结构体数组（SoA）
+ *   排列，内层循环对所有曲线做同样的运算，编译器可以自动向量化
+ *
+ * 同时支持二次和三次曲线，自由绘制以后可以用它们拟合笔画。
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef DRAWING_BEZIER_H
+#define DRAWING_BEZIER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "stroke_store.h"
+
+namespace drawing {
+
+struct CurvePoint {
+    double x;
+    double y;
+
+    CurvePoint() : x(0), y(0) {}
+    CurvePoint(double px, double py) : x(px), y(py) {}
+};
+
+inline CurvePoint Lerp(const CurvePoint& a, const CurvePoint& b, double t) {
+    return CurvePoint(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t);
+}
+
+inline CurvePoint Midpoint(const CurvePoint& a, const CurvePoint& b) {
+    return CurvePoint((a.x + b.x) * 0.5, (a.y + b.y) * 0.5);
+}
+
+struct QuadBezier {
+    CurvePoint p0, p1, p2;
+
+    QuadBezier() {}
+    QuadBezier(const CurvePoint& a, const CurvePoint& b, const CurvePoint& c)
+        : p0(a), p1(b), p2(c) {}
+
+    CurvePoint Evaluate(double t) const {
+        double mt = 1.0 - t;
+        return CurvePoint(mt * mt * p0.x + 2 * mt * t * p1.x + t * t * p2.x,
+                          mt * mt * p0.y + 2 * mt * t * p1.y + t * t * p2.y);
+    }
+
+    // 曲线到弦的最大偏差是 |p0 - 2p1 + p2| / 4
+    bool IsFlat(double tolerance) const {
+        double dx = p0.x - 2 * p1.x + p2.x;
+        double dy = p0.y - 2 * p1.y + p2.y;
+        return dx * dx + dy * dy <= 16 * tolerance * tolerance;
+    }
+
+    // de Casteljau 在 t = 0.5 处一分为二
+    void Split(QuadBezier& left, QuadBezier& right) const {
+        CurvePoint a = Midpoint(p0, p1);
+        CurvePoint b = Midpoint(p1, p2);
+        CurvePoint m = Midpoint(a, b);
+        left = QuadBezier(p0, a, m);
+        right = QuadBezier(m, b, p2);
+    }
+};
+
+struct CubicBezier {
+    CurvePoint p0, p1, p2, p3;
+
+    CubicBezier() {}
+    CubicBezier(const CurvePoint& a, const CurvePoint& b,
+                const CurvePoint& c, const CurvePoint& d)
+        : p0(a), p1(b), p2(c), p3(d) {}
+
+    // 二次曲线升阶为等价的三次曲线
+    static CubicBezier FromQuad(const QuadBezier& q) {
+        return CubicBezier(q.p0, Lerp(q.p0, q.p1, 2.0 / 3.0),
+                           Lerp(q.p2, q.p1, 2.0 / 3.0), q.p2);
+    }
+
+    CurvePoint Evaluate(double t) const {
+        double mt = 1.0 - t;
+        double a = mt * mt * mt;
+        double b = 3 * mt * mt * t;
+        double c = 3 * mt * t * t;
+        double d = t * t * t;
+        return CurvePoint(a * p0.x + b * p1.x + c * p2.x + d * p3.x,
+                          a * p0.y + b * p1.y + c * p2.y + d * p3.y);
+    }
+
+    // 平坦度判定（Roger Willcocks）：两个控制点相对弦的偏移都足够小。
+    // 满足时曲线与弦的距离不超过 tolerance
+    bool IsFlat(double tolerance) const {
+        double ux = 3 * p1.x - 2 * p0.x - p3.x;
+        double uy = 3 * p1.y - 2 * p0.y - p3.y;
+        double vx = 3 * p2.x - p0.x - 2 * p3.x;
+        double vy = 3 * p2.y - p0.y - 2 * p3.y;
+        ux *= ux;
+        uy *= uy;
+        vx *= vx;
+        vy *= vy;
+        return std::max(ux, vx) + std::max(uy, vy) <= 16 * tolerance * tolerance;
+    }
+
+    void Split(CubicBezier& left, CubicBezier& right) const {
+        CurvePoint a = Midpoint(p0, p1);
+        CurvePoint b = Midpoint(p1, p2);
+        CurvePoint c = Midpoint(p2, p3);
+        CurvePoint ab = Midpoint(a, b);
+        CurvePoint bc = Midpoint(b, c);
+        CurvePoint m = Midpoint(ab, bc);
+        left = CubicBezier(p0, a, ab, m);
+        right = CubicBezier(m, bc, c, p3);
+    }
+};
+
+// ==================== 自适应细分 ====================
+
+namespace detail {
+
+// 用显式栈做深度优先细分，右半先入栈，保证输出按 t 递增
+template <typename Curve, typename EndPoint>
+void FlattenAdaptiveImpl(const Curve& curve, double tolerance,
+                         std::vector<CurvePoint>& out, EndPoint endOf) {
+    const int kMaxDepth = 16;  // 最多 65536 段，防止退化输入无限细分
+
+    std::vector<std::pair<Curve, int> > stack;
+    stack.push_back(std::make_pair(curve, 0));
+    while (!stack.empty()) {
+        Curve c = stack.back().first;
+        int depth = stack.back().second;
+        stack.pop_back();
+
+        if (depth >= kMaxDepth || c.IsFlat(tolerance)) {
+            out.push_back(endOf(c));
+            continue;
+        }
+        Curve left, right;
+        c.Split(left, right);
+        stack.push_back(std::make_pair(right, depth + 1));
+        stack.push_back(std::make_pair(left, depth + 1));
+    }
+}
+
+inline CurvePoint QuadEnd(const QuadBezier& c) { return c.p2; }
+inline CurvePoint CubicEnd(const CubicBezier& c) { return c.p3; }
+
+} // namespace detail
+
+// 结果追加到 out；includeStart 为 false 时不输出起点，方便首尾相接的曲线拼成一条折线
+inline void FlattenAdaptive(const QuadBezier& curve, double tolerance,
+                            std::vector<CurvePoint>& out, bool includeStart = true) {
+    if (includeStart) {
+        out.push_back(curve.p0);
+    }
+    detail::FlattenAdaptiveImpl(curve, tolerance, out, detail::QuadEnd);
+}
+
+inline void FlattenAdaptive(const CubicBezier& curve, double tolerance,
+                            std::vector<CurvePoint>& out, bool includeStart = true) {
+    if (includeStart) {
+        out.push_back(curve.p0);
+    }
+    detail::FlattenAdaptiveImpl(curve, tolerance, out, detail::CubicEnd);
+}
+
+// ==================== 前向差分 ====================
+
+namespace detail {
+
+const int kMaxUniformSegments = 4096;
+
+// ceil(sqrt(k * m / tolerance))，限制在 1..kMaxUniformSegments。
+// tolerance 不是正数（或是 NaN）、m 是无穷大时商为 inf / NaN，转成 int 是未定义行为，
+// 所以先在浮点里截断再转换
+inline int UniformSegments(double k, double m, double tolerance) {
+    if (!(tolerance > 0)) {
+        return kMaxUniformSegments;
+    }
+    double n = std::ceil(std::sqrt(k * m / tolerance));
+    if (!(n < kMaxUniformSegments)) {
+        return kMaxUniformSegments;
+    }
+    return std::max(1, int(n));
+}
+
+} // namespace detail
+
+// Wang 公式：n 次曲线用 ceil(sqrt(n(n-1)/8 * M / tolerance)) 段均匀折线逼近，
+// 误差不超过 tolerance，M 是控制点二阶差分的最大长度
+inline int SegmentsForTolerance(const QuadBezier& c, double tolerance) {
+    double dx = c.p0.x - 2 * c.p1.x + c.p2.x;
+    double dy = c.p0.y - 2 * c.p1.y + c.p2.y;
+    double m = std::sqrt(dx * dx + dy * dy);
+    return detail::UniformSegments(0.25, m, tolerance);
+}
+
+inline int SegmentsForTolerance(const CubicBezier& c, double tolerance) {
+    double ax = c.p0.x - 2 * c.p1.x + c.p2.x;
+    double ay = c.p0.y - 2 * c.p1.y + c.p2.y;
+    double bx = c.p1.x - 2 * c.p2.x + c.p3.x;
+    double by = c.p1.y - 2 * c.p2.y + c.p3.y;
+    double m = std::sqrt(std::max(ax * ax + ay * ay, bx * bx + by * by));
+    return detail::UniformSegments(0.75, m, tolerance);
+}
+
+// 三次多项式在等步长上的前向差分：每一步只做 6 次加法
+inline void FlattenForwardDiff(const CubicBezier& c, int segments,
+                               std::vector<CurvePoint>& out, bool includeStart = true) {
+    double h = 1.0 / segments;
+    double h2 = h * h;
+    double h3 = h2 * h;
+
+    // 幂基系数：B(t) = a t^3 + b t^2 + k t + p0
+    double ax = -c.p0.x + 3 * c.p1.x - 3 * c.p2.x + c.p3.x;
+    double ay = -c.p0.y + 3 * c.p1.y - 3 * c.p2.y + c.p3.y;
+    double bx = 3 * c.p0.x - 6 * c.p1.x + 3 * c.p2.x;
+    double by = 3 * c.p0.y - 6 * c.p1.y + 3 * c.p2.y;
+    double kx = -3 * c.p0.x + 3 * c.p1.x;
+    double ky = -3 * c.p0.y + 3 * c.p1.y;
+
+    double x = c.p0.x, y = c.p0.y;
+    double d1x = ax * h3 + bx * h2 + kx * h;
+    double d1y = ay * h3 + by * h2 + ky * h;
+    double d2x = 6 * ax * h3 + 2 * bx * h2;
+    double d2y = 6 * ay * h3 + 2 * by * h2;
+    double d3x = 6 * ax * h3;
+    double d3y = 6 * ay * h3;
+
+    if (includeStart) {
+        out.push_back(c.p0);
+    }
+    for (int i = 1; i < segments; i++) {
+        x += d1x;
+        y += d1y;
+        d1x += d2x;
+        d1y += d2y;
+        d2x += d3x;
+        d2y += d3y;
+        out.push_back(CurvePoint(x, y));
+    }
+    out.push_back(c.p3);  // 终点直接取控制点，避免累积误差
+}
+
+inline void FlattenForwardDiff(const CubicBezier& c, double tolerance,
+                               std::vector<CurvePoint>& out, bool includeStart = true) {
+    FlattenForwardDiff(c, SegmentsForTolerance(c, tolerance), out, includeStart);
+}
+
+inline void FlattenForwardDiff(const QuadBezier& c, double tolerance,
+                               std::vector<CurvePoint>& out, bool includeStart = true) {
+    FlattenForwardDiff(CubicBezier::FromQuad(c), SegmentsForTolerance(c, tolerance),
+                       out, includeStart);
+}
+
+// ==================== 批量求值 ====================
+
+// 大量三次曲线按 SoA 排列；同一个 t 对所有曲线求值时，内层循环是
+// 没有分支、没有别名的纯算术，-O2/-O3 下编译器会生成 SIMD 指令
+class CubicBatch {
+public:
+    void Clear() {
+        for (int i = 0; i < 4; i++) {
+            m_x[i].clear();
+            m_y[i].clear();
+        }
+    }
+
+    void Add(const CubicBezier& c) {
+        m_x[0].push_back(c.p0.x); m_y[0].push_back(c.p0.y);
+        m_x[1].push_back(c.p1.x); m_y[1].push_back(c.p1.y);
+        m_x[2].push_back(c.p2.x); m_y[2].push_back(c.p2.y);
+        m_x[3].push_back(c.p3.x); m_y[3].push_back(c.p3.y);
+    }
+
+    void Add(const QuadBezier& q) { Add(CubicBezier::FromQuad(q)); }
+
+    size_t GetCount() const { return m_x[0].size(); }
+
+    // 所有曲线在同一个 t 处求值，结果写入 outX/outY（长度为 GetCount()）
+    void Evaluate(double t, double* outX, double* outY) const {
+        double mt = 1.0 - t;
+        double a = mt * mt * mt;
+        double b = 3 * mt * mt * t;
+        double c = 3 * mt * t * t;
+        double d = t * t * t;
+
+        size_t n = GetCount();
+        const double* x0 = n ? &m_x[0][0] : NULL;
+        const double* x1 = n ? &m_x[1][0] : NULL;
+        const double* x2 = n ? &m_x[2][0] : NULL;
+        const double* x3 = n ? &m_x[3][0] : NULL;
+        const double* y0 = n ? &m_y[0][0] : NULL;
+        const double* y1 = n ? &m_y[1][0] : NULL;
+        const double* y2 = n ? &m_y[2][0] : NULL;
+        const double* y3 = n ? &m_y[3][0] : NULL;
+        for (size_t i = 0; i < n; i++) {
+            outX[i] = a * x0[i] + b * x1[i] + c * x2[i] + d * x3[i];
+            outY[i] = a * y0[i] + b * y1[i] + c * y2[i] + d * y3[i];
+        }
+    }
+
+    // 每条曲线展平为 segments 段，第 i 条曲线的折线写入 out[i]
+    void Flatten(int segments, std::vector<std::vector<CurvePoint> >& out) const {
+        size_t n = GetCount();
+        out.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            out[i].clear();
+            out[i].reserve(segments + 1);
+        }
+
+        std::vector<double> xs(n), ys(n);
+        for (int s = 0; s <= segments; s++) {
+            Evaluate(double(s) / segments, n ? &xs[0] : NULL, n ? &ys[0] : NULL);
+            for (size_t i = 0; i < n; i++) {
+                out[i].push_back(CurvePoint(xs[i], ys[i]));
+            }
+        }
+    }
+
+private:
+    std::vector<double> m_x[4];
+    std::vector<double> m_y[4];
+};
+
+// ==================== 转换为整数折线 ====================
+
+// 四舍五入到像素，并合并落在同一像素上的相邻点
+inline void ToPixelPolyline(const std::vector<CurvePoint>& in, std::vector<StrokePoint>& out) {
+    out.clear();
+    out.reserve(in.size());
+    for (size_t i = 0; i < in.size(); i++) {
+        StrokePoint p = { int(std::floor(in[i].x + 0.5)), int(std::floor(in[i].y + 0.5)) };
+        if (out.empty() || out.back().x != p.x || out.back().y != p.y) {
+            out.push_back(p);
+        }
+    }
+}
+
+} // namespace drawing
+
+#endif // DRAWING_BEZIER_H
@@ -0,0 +1,167 @@
+/*
+ * 导出任意分辨率的图像（custom_draw 示例使用）
+ *
+ * 导出分两步：
+ *
+ * 1. UI 线程上把可见笔画拷贝成 StrokeSnapshot（只是连续拷贝点数据，很快），
+ *    之后画布可以继续编辑，不影响导出结果
+ * 2. 工作线程上按输出尺寸缩放快照，建立自己的存储和空间索引，再用
+ *    TileRenderer 逐个行带（一行块）并行光栅化进 RGB 缓冲
+ *
+ * 逐行带进行是为了能汇报进度、及时响应取消，同时不需要为整张图
+ * 再分配一份块缓冲：8K 图像本身就有约 100MB。
+ *
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef DRAWING_EXPORT_RENDERER_H
+#define DRAWING_EXPORT_RENDERER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "stroke_store.h"
+#include "spatial_grid.h"
+#include "tile_renderer.h"
+#include "fill_kernels.h"
+
+namespace drawing {
+
+// 笔画数据的只读副本，所有点连续存放
+struct StrokeSnapshot {
+    std::vector<StrokeStyle> styles;
+    std::vector<StrokeKind> kinds;
+    std::vector<size_t> starts;  // 第 i 条笔画的点是 points[starts[i], starts[i + 1])
+    std::vector<StrokePoint> points;
+
+    StrokeSnapshot() : starts(1, 0) {}
+
+    void Add(const StrokeStore& store, StrokeId id) {
+        styles.push_back(store.GetStyle(id));
+        kinds.push_back(store.Get(id).kind);
+        store.ForEachChunk(id, [this](const StrokePoint* pts, size_t count) {
+            points.insert(points.end(), pts, pts + count);
+        });
+        starts.push_back(points.size());
+    }
+
+    size_t GetStrokeCount() const { return styles.size(); }
+};
+
+class ExportRenderer {
+public:
+    // 把快照中 area 范围内的内容放大 scale 倍，输出图像的左上角对应 area 的左上角
+    ExportRenderer(const StrokeSnapshot& snapshot, const StrokeBox& area, double scale)
+        : m_index(256), m_top(0xFFFFFF), m_bottom(0xFFFFFF) {
+        m_width = std::max(1, int(std::floor((area.right - area.left + 1) * scale + 0.5)));
+        m_height = std::max(1, int(std::floor((area.bottom - area.top + 1) * scale + 0.5)));
+
+        for (size_t s = 0; s < snapshot.GetStrokeCount(); s++) {
+            if (snapshot.kinds[s] == STROKE_FILL) {
+                AddScaledFill(snapshot, s, area, scale);
+                continue;
+            }
+            StrokeStyle style = snapshot.styles[s];
+            style.width = std::max(1, int(std::floor(style.width * scale + 0.5)));
+            StrokeId id = m_store.BeginStroke(style);
+
+            StrokePoint last = { 0, 0 };
+            for (size_t i = snapshot.starts[s]; i < snapshot.starts[s + 1]; i++) {
+                StrokePoint pt = {
+                    int(std::floor((snapshot.points[i].x - area.left) * scale + 0.5)),
+                    int(std::floor((snapshot.points[i].y - area.top) * scale + 0.5))
+                };
+                // 缩小时相邻的点可能落到同一个像素上
+                if (m_store.Get(id).count == 0 || pt.x != last.x || pt.y != last.y) {
+                    m_store.AppendPoint(id, pt);
+                    last = pt;
+                }
+            }
+            m_index.Insert(id, GetPaintedBox(m_store, id));
+        }
+    }
+
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+
+    // 背景为从上到下的线性渐变（颜色为 0xRRGGBB）
+    void SetBackground(uint32_t top, uint32_t bottom) {
+        m_top = top;
+        m_bottom = bottom;
+    }
+
+    // 光栅化到 rgb（m_width * m_height * 3 字节）。每完成一个行带调用一次
+    // progress(已完成, 总数)，它返回 false 时停止并返回 false
+    bool Render(unsigned char* rgb, const std::function<bool(int, int)>& progress) {
+        TileRenderer tiles;
+        int height = m_height;
+        uint32_t top = m_top, bottom = m_bottom;
+        tiles.SetBackgroundFiller([height, top, bottom](int, int y, int width, unsigned char* dst) {
+            double t = height > 1 ? double(y) / (height - 1) : 0.0;
+            FillRow(dst, width, LerpColour(top, bottom, t));
+        });
+
+        int band = tiles.GetTileSize();
+        int bands = (m_height + band - 1) / band;
+        std::vector<StrokeId> noExtra;
+        std::vector<TileJob> jobs;
+        for (int b = 0; b < bands; b++) {
+            StrokeBox area;
+            area.left = 0;
+            area.top = b * band;
+            area.right = m_width - 1;
+            area.bottom = std::min(m_height, (b + 1) * band) - 1;
+
+            tiles.PrepareJobs(area, m_store, m_index, noExtra, jobs);
+            tiles.Render(m_store, jobs);
+
+            for (size_t i = 0; i < jobs.size(); i++) {
+                const TileJob& job = jobs[i];
+                for (int row = 0; row < job.height; row++) {
+                    memcpy(rgb + (size_t(job.y + row) * m_width + job.x) * 3,
+                           &job.rgb[size_t(row) * job.width * 3], size_t(job.width) * 3);
+                }
+            }
+
+            if (!progress(b + 1, bands)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    int m_width;
+    int m_height;
+    StrokeStore m_store;
+    SpatialGrid m_index;
+    uint32_t m_top;
+    uint32_t m_bottom;
+
+    // 填充区域按像素块缩放：一段放大后覆盖若干行，每行一段；缩小时重复的段无害
+    void AddScaledFill(const StrokeSnapshot& snapshot, size_t s, const StrokeBox& area, double scale) {
+        StrokeId id = m_store.BeginStroke(snapshot.styles[s], STROKE_FILL);
+        for (size_t i = snapshot.starts[s]; i + 1 < snapshot.starts[s + 1]; i += 2) {
+            const StrokePoint& a = snapshot.points[i];
+            const StrokePoint& b = snapshot.points[i + 1];
+            int x0 = int(std::floor((a.x - area.left) * scale));
+            int x1 = std::max(x0, int(std::floor((b.x + 1 - area.left) * scale)) - 1);
+            int y0 = int(std::floor((a.y - area.top) * scale));
+            int y1 = std::max(y0, int(std::floor((a.y + 1 - area.top) * scale)) - 1);
+            for (int y = y0; y <= y1; y++) {
+                StrokePoint p0 = { x0, y }, p1 = { x1, y };
+                m_store.AppendPoint(id, p0);
+                m_store.AppendPoint(id, p1);
+            }
+        }
+        m_index.Insert(id, GetPaintedBox(m_store, id));
+    }
+};
+
+} // namespace drawing
+
+#endif // DRAWING_EXPORT_RENDERER_H
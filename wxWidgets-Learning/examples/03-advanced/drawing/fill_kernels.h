@@ -0,0 +1,354 @@
+/*
+ * 背景填充内核（custom_draw 和 draw_bench / fill_bench 使用）
+ *
+ * 直接写 RGB 缓冲区（wxImage 的内存布局：每像素 3 字节，行与行紧挨着），
+ * 不经过 wxDC：纯色、线性渐变、径向渐变、棋盘格和点线网格。
+ *
+ * - 纯色和线性渐变归结为"把一行填成同一个颜色"：3 字节的像素先拼成
+ *   48 字节（SSE2，16 像素）或 96 字节（AVX2，32 像素）的图案，
+ *   之后每次整块写入，不再逐像素写
+ * - 径向渐变每个像素都要开方：SIMD 一次算 4 / 8 个像素到圆心的距离，
+ *   换算成 0..255 的下标，再从预先算好的 256 级颜色表里取颜色
+ *   （8 位颜色分量本来也只有 256 级）
+ * - 横向渐变、棋盘格只算出一行，其余行整行拷贝
+ *
+ * 指令集在运行时检测：x86-64 上有 AVX2 用 AVX2，否则用 SSE2（x86-64 一定有）；
+ * 其他平台只有标量版本。SetFillIsa() 可以强制使用较低的指令集，用于对比测试。
+ *
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef DRAWING_FILL_KERNELS_H
+#define DRAWING_FILL_KERNELS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define DRAWING_FILL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define DRAWING_TARGET_AVX2
+#else
+#define DRAWING_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace drawing {
+
+// ==================== 指令集选择 ====================
+
+enum FillIsa {
+    FILL_SCALAR,
+    FILL_SSE2,
+    FILL_AVX2
+};
+
+inline const char* FillIsaName(FillIsa isa) {
+    switch (isa) {
+        case FILL_AVX2: return "avx2";
+        case FILL_SSE2: return "sse2";
+        default:        return "scalar";
+    }
+}
+
+// 当前 CPU 和操作系统支持的最高指令集
+inline FillIsa DetectFillIsa() {
+#ifdef DRAWING_FILL_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] >= 7) {
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        __cpuidex(info, 7, 0);
+        bool avx2 = (info[1] & (1 << 5)) != 0;
+        // 操作系统必须保存 YMM 寄存器（XCR0 的第 1、2 位）
+        if (osxsave && avx && avx2 && (_xgetbv(0) & 6) == 6) {
+            return FILL_AVX2;
+        }
+    }
+    return FILL_SSE2;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? FILL_AVX2 : FILL_SSE2;
+#endif
+#else
+    return FILL_SCALAR;
+#endif
+}
+
+namespace detail {
+inline FillIsa& ActiveFillIsa() {
+    static FillIsa isa = DetectFillIsa();
+    return isa;
+}
+} // namespace detail
+
+inline FillIsa GetFillIsa() { return detail::ActiveFillIsa(); }
+
+// 高于硬件支持的请求会被降到支持的最高级别。只应在开始绘制之前调用
+inline void SetFillIsa(FillIsa isa) {
+    detail::ActiveFillIsa() = std::min(isa, DetectFillIsa());
+}
+
+// ==================== 缓冲区与颜色 ====================
+
+// RGB 缓冲区，stride 为每行字节数
+struct RgbBuffer {
+    unsigned char* data;
+    int width;
+    int height;
+    size_t stride;
+
+    RgbBuffer(unsigned char* d, int w, int h)
+        : data(d), width(w), height(h), stride(size_t(w) * 3) {}
+
+    unsigned char* Row(int y) const { return data + size_t(y) * stride; }
+};
+
+// 颜色为 0xRRGGBB，t = 0 得到 a，t = 1 得到 b
+inline uint32_t LerpColour(uint32_t a, uint32_t b, double t) {
+    uint32_t c = 0;
+    for (int shift = 16; shift >= 0; shift -= 8) {
+        double ca = (a >> shift) & 0xFF;
+        double cb = (b >> shift) & 0xFF;
+        c |= uint32_t(ca + (cb - ca) * t + 0.5) << shift;
+    }
+    return c;
+}
+
+inline void PutPixel(unsigned char* dst, uint32_t colour) {
+    dst[0] = (unsigned char)(colour >> 16);
+    dst[1] = (unsigned char)(colour >> 8);
+    dst[2] = (unsigned char)colour;
+}
+
+// ==================== 内核 ====================
+
+namespace detail {
+
+inline void FillRowScalar(unsigned char* dst, int count, uint32_t colour) {
+    for (int i = 0; i < count; i++) {
+        PutPixel(dst + size_t(i) * 3, colour);
+    }
+}
+
+// 把颜色重复成 bytes 字节的图案（bytes 是 3 的倍数）
+inline void MakePattern(unsigned char* pattern, int bytes, uint32_t colour) {
+    for (int i = 0; i < bytes; i += 3) {
+        PutPixel(pattern + i, colour);
+    }
+}
+
+// 径向渐变一行：index[i] = min(255, round(dist(x0 + i, row) * scale))
+inline void RadialIndexScalar(int* index, int count, float x0, float dy2, float scale) {
+    for (int i = 0; i < count; i++) {
+        float dx = x0 + float(i);
+        float t = std::min(255.0f, std::sqrt(dx * dx + dy2) * scale);
+        index[i] = int(t + 0.5f);
+    }
+}
+
+#ifdef DRAWING_FILL_X86
+
+inline void FillRowSse2(unsigned char* dst, int count, uint32_t colour) {
+    unsigned char pattern[48];
+    MakePattern(pattern, 48, colour);
+    __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern));
+    __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern + 16));
+    __m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern + 32));
+    int i = 0;
+    for (; i + 16 <= count; i += 16, dst += 48) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), p0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), p1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 32), p2);
+    }
+    FillRowScalar(dst, count - i, colour);
+}
+
+DRAWING_TARGET_AVX2
+inline void FillRowAvx2(unsigned char* dst, int count, uint32_t colour) {
+    unsigned char pattern[96];
+    MakePattern(pattern, 96, colour);
+    __m256i p0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pattern));
+    __m256i p1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pattern + 32));
+    __m256i p2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pattern + 64));
+    int i = 0;
+    for (; i + 32 <= count; i += 32, dst += 96) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), p0);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 32), p1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 64), p2);
+    }
+    FillRowScalar(dst, count - i, colour);
+}
+
+// SIMD 版本先在浮点里截到 255 再转整数：_mm_cvtps_epi32 遇到 2^31 以上的值
+// 返回 0x80000000，转换之后再截就成了负的下标
+inline void RadialIndexSse2(int* index, int count, float x0, float dy2, float scale) {
+    const __m128 kLimit = _mm_set1_ps(255.0f);
+    __m128 dx = _mm_add_ps(_mm_set1_ps(x0), _mm_set_ps(3, 2, 1, 0));
+    __m128 step = _mm_set1_ps(4);
+    __m128 vdy2 = _mm_set1_ps(dy2);
+    __m128 vscale = _mm_set1_ps(scale);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 d = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), vdy2));
+        __m128i t = _mm_cvtps_epi32(_mm_min_ps(_mm_mul_ps(d, vscale), kLimit));  // 四舍五入
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(index + i), t);
+        dx = _mm_add_ps(dx, step);
+    }
+    RadialIndexScalar(index + i, count - i, x0 + float(i), dy2, scale);
+}
+
+DRAWING_TARGET_AVX2
+inline void RadialIndexAvx2(int* index, int count, float x0, float dy2, float scale) {
+    const __m256 kLimit = _mm256_set1_ps(255.0f);
+    __m256 dx = _mm256_add_ps(_mm256_set1_ps(x0), _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0));
+    __m256 step = _mm256_set1_ps(8);
+    __m256 vdy2 = _mm256_set1_ps(dy2);
+    __m256 vscale = _mm256_set1_ps(scale);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 d = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), vdy2));
+        __m256i t = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_mul_ps(d, vscale), kLimit));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(index + i), t);
+        dx = _mm256_add_ps(dx, step);
+    }
+    RadialIndexScalar(index + i, count - i, x0 + float(i), dy2, scale);
+}
+
+#endif // DRAWING_FILL_X86
+
+} // namespace detail
+
+// 从 dst 开始填 count 个像素
+inline void FillRow(unsigned char* dst, int count, uint32_t colour) {
+#ifdef DRAWING_FILL_X86
+    switch (GetFillIsa()) {
+        case FILL_AVX2: detail::FillRowAvx2(dst, count, colour); return;
+        case FILL_SSE2: detail::FillRowSse2(dst, count, colour); return;
+        default: break;
+    }
+#endif
+    detail::FillRowScalar(dst, count, colour);
+}
+
+inline void FillSolid(const RgbBuffer& buf, uint32_t colour) {
+    for (int y = 0; y < buf.height; y++) {
+        FillRow(buf.Row(y), buf.width, colour);
+    }
+}
+
+enum GradientAxis {
+    GRADIENT_VERTICAL,    // from 在上，to 在下（wxSOUTH）
+    GRADIENT_HORIZONTAL   // from 在左，to 在右（wxEAST）
+};
+
+// 与 GradientFillLinear 相同的效果：第一行 / 列是 from，最后一行 / 列是 to
+inline void FillLinearGradient(const RgbBuffer& buf, uint32_t from, uint32_t to, GradientAxis axis) {
+    if (buf.width <= 0 || buf.height <= 0) {
+        return;
+    }
+    if (axis == GRADIENT_VERTICAL) {
+        for (int y = 0; y < buf.height; y++) {
+            double t = buf.height > 1 ? double(y) / (buf.height - 1) : 0.0;
+            FillRow(buf.Row(y), buf.width, LerpColour(from, to, t));
+        }
+        return;
+    }
+    unsigned char* first = buf.Row(0);
+    for (int x = 0; x < buf.width; x++) {
+        double t = buf.width > 1 ? double(x) / (buf.width - 1) : 0.0;
+        PutPixel(first + size_t(x) * 3, LerpColour(from, to, t));
+    }
+    for (int y = 1; y < buf.height; y++) {
+        memcpy(buf.Row(y), first, size_t(buf.width) * 3);
+    }
+}
+
+// 圆心 (cx, cy) 处为 inner，到 radius 处过渡到 outer，更远的地方都是 outer
+inline void FillRadialGradient(const RgbBuffer& buf, double cx, double cy, double radius,
+                               uint32_t inner, uint32_t outer) {
+    unsigned char lut[256][3];
+    for (int i = 0; i < 256; i++) {
+        PutPixel(lut[i], LerpColour(inner, outer, i / 255.0));
+    }
+    // 半径为 0 或极小时整个画布都是 outer；scale 保持有限，圆心处 0 × scale 才不会是 NaN
+    float scale = float(radius > 0 ? std::min(255.0 / radius, 1e9) : 1e9);
+
+    // 每次处理一段，下标放在栈上
+    const int kSpan = 256;
+    int index[kSpan];
+    for (int y = 0; y < buf.height; y++) {
+        float dy = float(y - cy);
+        unsigned char* dst = buf.Row(y);
+        for (int x = 0; x < buf.width; x += kSpan) {
+            int count = std::min(kSpan, buf.width - x);
+            float x0 = float(x - cx);
+#ifdef DRAWING_FILL_X86
+            FillIsa isa = GetFillIsa();
+            if (isa == FILL_AVX2) {
+                detail::RadialIndexAvx2(index, count, x0, dy * dy, scale);
+            } else if (isa == FILL_SSE2) {
+                detail::RadialIndexSse2(index, count, x0, dy * dy, scale);
+            } else
+#endif
+            {
+                detail::RadialIndexScalar(index, count, x0, dy * dy, scale);
+            }
+            for (int i = 0; i < count; i++, dst += 3) {
+                memcpy(dst, lut[index[i]], 3);
+            }
+        }
+    }
+}
+
+// cell × cell 的方格，左上角是 a
+inline void FillCheckerboard(const RgbBuffer& buf, int cell, uint32_t a, uint32_t b) {
+    cell = std::max(1, cell);
+    for (int y = 0; y < buf.height; y++) {
+        // 每 2 × cell 行重复一次，前两种行各生成一次
+        if (y >= 2 * cell) {
+            memcpy(buf.Row(y), buf.Row(y - 2 * cell), size_t(buf.width) * 3);
+            continue;
+        }
+        if (y % cell != 0) {
+            memcpy(buf.Row(y), buf.Row(y - 1), size_t(buf.width) * 3);
+            continue;
+        }
+        bool odd = (y / cell) % 2 != 0;
+        unsigned char* dst = buf.Row(y);
+        for (int x = 0; x < buf.width; x += cell) {
+            bool useA = ((x / cell) % 2 != 0) == odd;
+            FillRow(dst + size_t(x) * 3, std::min(cell, buf.width - x), useA ? a : b);
+        }
+    }
+}
+
+// 在已有内容上画点线网格：线在 step 的整数倍上，线上隔一个像素画一个点
+// （与 wxPENSTYLE_DOT 的 1 像素画笔外观接近）
+inline void DrawDottedGrid(const RgbBuffer& buf, int step, uint32_t colour) {
+    step = std::max(1, step);
+    for (int y = 0; y < buf.height; y++) {
+        unsigned char* dst = buf.Row(y);
+        if (y % step == 0) {
+            for (int x = 0; x < buf.width; x += 2) {
+                PutPixel(dst + size_t(x) * 3, colour);
+            }
+        } else if (y % 2 == 0) {
+            for (int x = 0; x < buf.width; x += step) {
+                PutPixel(dst + size_t(x) * 3, colour);
+            }
+        }
+    }
+}
+
+} // namespace drawing
+
+#endif // DRAWING_FILL_KERNELS_H
@@ -0,0 +1,214 @@
+/*
+ * 油漆桶填充（custom_draw 示例使用）
+ *
+ * 分两步：
+ *
+ * 1. RasterizeLayer() 用 TileRenderer 把一块世界坐标范围内、一个图层上的笔画
+ *    按 1:1 光栅化到白底的 RGB 缓冲里（不含背景渐变和网格，否则渐变本身就会挡住填充）
+ * 2. FloodFiller 从种子点开始做扫描线填充：每次取出一个种子，向左右扩展成
+ *    一整段，再在上下两行里为每一段相连的可填像素各压一个种子。
+ *    种子放在显式的栈（std::vector）里，不递归，区域再大也不会栈溢出
+ *
+ * 与种子颜色各通道之差都不超过容差的像素算作可填。结果是一组行程（段），
+ * 整理成"同一 x 范围的连续行排在一起"的顺序，绘制时可以合并成矩形。
+ * 一块 4K 的空白区域只有两千多段，保存成填充笔画只要几十 KB。
+ *
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef DRAWING_FLOOD_FILL_H
+#define DRAWING_FLOOD_FILL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "fill_kernels.h"
+#include "spatial_grid.h"
+#include "stroke_store.h"
+#include "tile_renderer.h"
+#include "viewport.h"
+
+namespace drawing {
+
+// 一行上的一段像素 [x0, x1]
+struct FillSpan {
+    int y;
+    int x0;
+    int x1;
+};
+
+// 把 world 范围内 layer 图层上的笔画按 1:1 画到 rgb 中（width × height × 3 字节，白底）
+inline void RasterizeLayer(const StrokeStore& store, SpatialGrid& index, const StrokeBox& world,
+                           int layer, TileRenderer& tiles, std::vector<unsigned char>& rgb) {
+    int width = world.right - world.left + 1;
+    int height = world.bottom - world.top + 1;
+    rgb.resize(size_t(width) * height * 3);
+
+    ViewTransform view;
+    view.originX = world.left;
+    view.originY = world.top;
+    tiles.SetView(view, NULL, 0);
+    tiles.SetBackgroundFiller([](int, int, int count, unsigned char* dst) {
+        FillRow(dst, count, 0xFFFFFF);
+    });
+
+    StrokeBox area;
+    area.left = area.top = 0;
+    area.right = width - 1;
+    area.bottom = height - 1;
+    std::vector<StrokeId> noExtra;
+    std::vector<TileJob> jobs;
+    tiles.PrepareJobs(area, store, index, noExtra, jobs, layer);
+
+    // 没有笔画的块直接填白色，只把有笔画的块交给光栅化
+    std::vector<TileJob> busy;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const TileJob& job = jobs[i];
+        if (!job.strokes.empty()) {
+            busy.push_back(job);
+            continue;
+        }
+        for (int row = 0; row < job.height; row++) {
+            FillRow(&rgb[(size_t(job.y + row) * width + job.x) * 3], job.width, 0xFFFFFF);
+        }
+    }
+    tiles.Render(store, busy);
+    for (size_t i = 0; i < busy.size(); i++) {
+        const TileJob& job = busy[i];
+        for (int row = 0; row < job.height; row++) {
+            memcpy(&rgb[(size_t(job.y + row) * width + job.x) * 3],
+                   &job.rgb[size_t(row) * job.width * 3], size_t(job.width) * 3);
+        }
+    }
+}
+
+class FloodFiller {
+public:
+    FloodFiller() : m_image(NULL, 0, 0), m_width(0) {}
+
+    // 从 (sx, sy) 开始填充，结果追加到 spans（先清空），返回填充的像素数。
+    // 种子在图像外时什么也不做
+    size_t Fill(const RgbBuffer& image, int sx, int sy, int tolerance, std::vector<FillSpan>& spans) {
+        spans.clear();
+        if (sx < 0 || sy < 0 || sx >= image.width || sy >= image.height) {
+            return 0;
+        }
+        PrepareMask(image, image.Row(sy) + size_t(sx) * 3, std::max(0, tolerance));
+        m_stack.clear();
+        Seed first = { sx, sy };
+        m_stack.push_back(first);
+
+        size_t pixels = 0;
+        while (!m_stack.empty()) {
+            Seed s = m_stack.back();
+            m_stack.pop_back();
+            unsigned char* row = MaskRow(s.y);
+            if (!row[s.x]) {
+                continue;  // 压栈之后已经被别的段填过
+            }
+
+            // 向左右扩展成一段，填过的像素从遮罩中清掉
+            int left = s.x, right = s.x;
+            while (left > 0 && row[left - 1]) {
+                left--;
+            }
+            while (right < m_width - 1 && row[right + 1]) {
+                right++;
+            }
+            memset(row + left, 0, size_t(right - left + 1));
+            FillSpan span = { s.y, left, right };
+            spans.push_back(span);
+            pixels += size_t(right - left + 1);
+
+            // 上下两行中与这一段相接的部分，每段连续的可填像素压一个种子
+            if (s.y > 0) {
+                PushRuns(left, right, s.y - 1);
+            }
+            if (s.y < image.height - 1) {
+                PushRuns(left, right, s.y + 1);
+            }
+        }
+        return pixels;
+    }
+
+    // 当前缓冲占用的内存，用于观察
+    size_t GetScratchBytes() const {
+        return m_mask.capacity() + m_rowReady.capacity() + m_stack.capacity() * sizeof(Seed);
+    }
+
+private:
+    struct Seed {
+        int x;
+        int y;
+    };
+
+    RgbBuffer m_image;
+    int m_width;
+    unsigned char m_near[3][256];       // 各通道的值与种子是否相近
+    std::vector<unsigned char> m_mask;  // 1 表示可填且还没填过，多次填充之间复用
+    std::vector<char> m_rowReady;       // 遮罩的这一行是否已经算过
+    std::vector<Seed> m_stack;
+
+    void PrepareMask(const RgbBuffer& image, const unsigned char* seed, int tolerance) {
+        m_image = image;
+        m_width = image.width;
+        for (int c = 0; c < 3; c++) {
+            for (int v = 0; v < 256; v++) {
+                m_near[c][v] = std::abs(v - seed[c]) <= tolerance;
+            }
+        }
+        m_mask.resize(size_t(image.width) * image.height);
+        m_rowReady.assign(image.height, 0);
+    }
+
+    // 遮罩按行在第一次用到时才计算，小区域的填充不必扫描整张图。
+    // 之后的扫描每个像素只读一个字节，比较颜色变成三次查表
+    unsigned char* MaskRow(int y) {
+        unsigned char* m = &m_mask[size_t(y) * m_width];
+        if (!m_rowReady[y]) {
+            const unsigned char* p = m_image.Row(y);
+            for (int x = 0; x < m_width; x++, p += 3) {
+                m[x] = m_near[0][p[0]] & m_near[1][p[1]] & m_near[2][p[2]];
+            }
+            m_rowReady[y] = 1;
+        }
+        return m;
+    }
+
+    void PushRuns(int left, int right, int y) {
+        const unsigned char* row = MaskRow(y);
+        bool inRun = false;
+        for (int x = left; x <= right; x++) {
+            if (row[x]) {
+                if (!inRun) {
+                    Seed s = { x, y };
+                    m_stack.push_back(s);
+                    inRun = true;
+                }
+            } else {
+                inRun = false;
+            }
+        }
+    }
+};
+
+// 按 (x0, x1, y) 排序：x 范围相同的连续行排在一起，绘制时合并成一个矩形
+inline void SortSpansForRuns(std::vector<FillSpan>& spans) {
+    std::sort(spans.begin(), spans.end(), [](const FillSpan& a, const FillSpan& b) {
+        if (a.x0 != b.x0) {
+            return a.x0 < b.x0;
+        }
+        if (a.x1 != b.x1) {
+            return a.x1 < b.x1;
+        }
+        return a.y < b.y;
+    });
+}
+
+} // namespace drawing
+
+#endif // DRAWING_FLOOD_FILL_H
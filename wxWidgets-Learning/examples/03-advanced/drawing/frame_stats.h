@@ -0,0 +1,150 @@
+/*
+ * 绘制性能统计（custom_draw 示例使用）
+ *
+ * 每次 OnPaint 记录一帧：总耗时以及其中背景、网格、笔画各占多少，
+ * 画了多少条线段，脏矩形面积，以及从输入事件到这一帧画完的延迟。
+ * 样本放进固定容量的环形缓冲，满了以后覆盖最旧的，记录本身不分配内存。
+ *
+ * 卡顿通常只出现在少数帧上，平均值看不出来，所以这里提供分位数
+ * （p50 / p95 / p99）和直方图；也可以导出 CSV 交给其他工具分析。
+ *
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef DRAWING_FRAME_STATS_H
+#define DRAWING_FRAME_STATS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace drawing {
+
+// 单调时钟，单位毫秒
+inline double NowMs() {
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+struct FrameSample {
+    double timeMs;        // 帧结束的时刻（NowMs()）
+    double paintMs;       // OnPaint 总耗时
+    double backgroundMs;  // 其中背景（渐变或缓存拷贝）
+    double gridMs;        // 其中网格（只有背景缓存重建时才会画）
+    double strokesMs;     // 其中笔画
+    double latencyMs;     // 最早的未显示输入到这一帧画完，没有输入时为 -1
+    uint32_t segments;    // 画出的线段数
+    uint64_t dirtyPixels; // 拷贝到屏幕的脏矩形面积
+
+    FrameSample()
+        : timeMs(0), paintMs(0), backgroundMs(0), gridMs(0), strokesMs(0), latencyMs(-1),
+          segments(0), dirtyPixels(0) {}
+};
+
+// 把作用域内的耗时累加到 total 上
+class ScopedTimer {
+public:
+    explicit ScopedTimer(double& total) : m_total(total), m_start(NowMs()) {}
+    ~ScopedTimer() { m_total += NowMs() - m_start; }
+
+private:
+    double& m_total;
+    double m_start;
+
+    ScopedTimer(const ScopedTimer&);
+    ScopedTimer& operator=(const ScopedTimer&);
+};
+
+class FrameStats {
+public:
+    explicit FrameStats(size_t capacity = 1024)
+        : m_samples(std::max<size_t>(1, capacity)), m_next(0), m_count(0), m_total(0) {}
+
+    void Add(const FrameSample& sample) {
+        m_samples[m_next] = sample;
+        m_next = (m_next + 1) % m_samples.size();
+        m_count = std::min(m_count + 1, m_samples.size());
+        m_total++;
+    }
+
+    void Clear() {
+        m_next = 0;
+        m_count = 0;
+    }
+
+    size_t GetCount() const { return m_count; }
+    size_t GetCapacity() const { return m_samples.size(); }
+    uint64_t GetTotalFrames() const { return m_total; }  // 包括已被覆盖的
+
+    // i = 0 是缓冲中最旧的样本
+    const FrameSample& Get(size_t i) const {
+        return m_samples[(m_next + m_samples.size() - m_count + i) % m_samples.size()];
+    }
+
+    // field（例如 &FrameSample::paintMs）的第 p 百分位（0..100），忽略负值；没有样本时返回 -1
+    double Percentile(double p, double FrameSample::* field) const {
+        std::vector<double> values;
+        Collect(field, values);
+        if (values.empty()) {
+            return -1;
+        }
+        size_t k = size_t(std::min(1.0, std::max(0.0, p / 100.0)) * (values.size() - 1) + 0.5);
+        std::nth_element(values.begin(), values.begin() + k, values.end());
+        return values[k];
+    }
+
+    // 按 binMs 宽度统计 field 的分布，超出范围的计入最后一个桶
+    void Histogram(double FrameSample::* field, double binMs, std::vector<unsigned>& bins) const {
+        std::fill(bins.begin(), bins.end(), 0u);
+        if (bins.empty()) {
+            return;
+        }
+        std::vector<double> values;
+        Collect(field, values);
+        for (size_t i = 0; i < values.size(); i++) {
+            size_t b = std::min(bins.size() - 1, size_t(values[i] / binMs));
+            bins[b]++;
+        }
+    }
+
+    // 第一行为列名，之后每帧一行，时间相对第一个样本
+    std::string FormatCsv() const {
+        std::string csv = "frame,time_ms,paint_ms,background_ms,grid_ms,strokes_ms,"
+                          "segments,dirty_pixels,latency_ms\n";
+        double t0 = m_count > 0 ? Get(0).timeMs : 0;
+        char line[256];
+        for (size_t i = 0; i < m_count; i++) {
+            const FrameSample& s = Get(i);
+            int n = snprintf(line, sizeof(line), "%llu,%.3f,%.3f,%.3f,%.3f,%.3f,%u,%llu,%.3f\n",
+                             (unsigned long long)(m_total - m_count + i), s.timeMs - t0,
+                             s.paintMs, s.backgroundMs, s.gridMs, s.strokesMs,
+                             (unsigned)s.segments, (unsigned long long)s.dirtyPixels, s.latencyMs);
+            csv.append(line, std::min(size_t(std::max(n, 0)), sizeof(line) - 1));
+        }
+        return csv;
+    }
+
+private:
+    std::vector<FrameSample> m_samples;
+    size_t m_next;
+    size_t m_count;
+    uint64_t m_total;
+
+    void Collect(double FrameSample::* field, std::vector<double>& values) const {
+        values.reserve(m_count);
+        for (size_t i = 0; i < m_count; i++) {
+            double v = Get(i).*field;
+            if (v >= 0) {
+                values.push_back(v);
+            }
+        }
+    }
+};
+
+} // namespace drawing
+
+#endif // DRAWING_FRAME_STATS_H
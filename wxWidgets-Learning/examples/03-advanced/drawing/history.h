@@ -0,0 +1,285 @@
+/*
+ * 画布的撤销 / 重做（custom_draw 示例使用）
+ *
+ * 历史记录是一串命令（添加笔画、擦除笔画、清空画布），每条命令只记录
+ * 涉及的笔画 id。笔画被擦除时并不释放点数据，只是隐藏，所以撤销和重做
+ * 只需要显示或隐藏这些笔画，代价与笔画大小成正比，而不是拷贝整张画布。
+ *
+ * 每 kCheckpointInterval 条命令保存一个检查点：当时可见笔画的位图
+ * （每条笔画 1 bit）。跨越很多步的跳转（例如"全部撤销"）直接恢复到
+ * 最近的检查点再补做剩余命令，不必逐条回放。
+ *
+ * 内存上限：历史占用 = 被隐藏笔画的点数据 + 命令 + 检查点。超过上限时
+ * 从最旧的一段（到下一个检查点为止）开始丢弃；不再被任何命令引用、
+ * 又处于隐藏状态的笔画随即释放点块。
+ *
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef DRAWING_HISTORY_H
+#define DRAWING_HISTORY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "stroke_store.h"
+
+namespace drawing {
+
+// 撤销 / 重做时由画布实现的回调：负责更新存储、索引和重绘
+class HistoryTarget {
+public:
+    virtual ~HistoryTarget() {}
+
+    virtual void ShowStroke(StrokeId id) = 0;
+    virtual void HideStroke(StrokeId id) = 0;
+
+    // 一次要改动 count 条笔画，画布可以据此决定整体重绘
+    virtual void BeginUpdate(size_t /*count*/) {}
+    virtual void EndUpdate() {}
+};
+
+class StrokeHistory {
+public:
+    enum Type {
+        ADD,    // 新增笔画
+        ERASE,  // 擦除笔画
+        CLEAR   // 清空画布（ids 为清空前全部可见笔画）
+    };
+
+    static const size_t kCheckpointInterval = 64;
+
+    explicit StrokeHistory(StrokeStore& store, size_t limitBytes = 64 * 1024 * 1024)
+        : m_store(store), m_limit(limitBytes), m_base(0), m_position(0), m_entryBytes(0) {
+        AddCheckpoint();
+    }
+
+    void SetLimit(size_t bytes) {
+        m_limit = bytes;
+        Compact();
+    }
+    size_t GetLimit() const { return m_limit; }
+
+    bool CanUndo() const { return m_position > m_base; }
+    bool CanRedo() const { return m_position < m_base + m_entries.size(); }
+    size_t GetUndoCount() const { return m_position - m_base; }
+    size_t GetRedoCount() const { return m_base + m_entries.size() - m_position; }
+
+    size_t GetMemoryUsage() const {
+        size_t bytes = m_entryBytes + m_store.GetHiddenPointCount() * sizeof(StrokePoint);
+        for (size_t i = 0; i < m_checkpoints.size(); i++) {
+            bytes += m_checkpoints[i].bits.size() * sizeof(uint64_t);
+        }
+        return bytes;
+    }
+
+    // 命令已经作用到画布上之后调用。会丢弃当前位置之后的重做分支
+    void Record(Type type, const std::vector<StrokeId>& ids) {
+        while (CanRedo()) {
+            DropNewest();
+        }
+
+        Entry entry;
+        entry.type = type;
+        entry.ids = ids;
+        AddRefs(entry);
+        m_entryBytes += EntryBytes(entry);
+        m_entries.push_back(entry);
+        m_position++;
+
+        if ((m_position - m_base) % kCheckpointInterval == 0) {
+            AddCheckpoint();
+        }
+        Compact();
+    }
+
+    void Undo(HistoryTarget& target) {
+        if (!CanUndo()) {
+            return;
+        }
+        const Entry& entry = m_entries[m_position - 1 - m_base];
+        Apply(entry, entry.type != ADD, target);  // 撤销添加 = 隐藏，撤销擦除 / 清空 = 显示
+        m_position--;
+    }
+
+    void Redo(HistoryTarget& target) {
+        if (!CanRedo()) {
+            return;
+        }
+        const Entry& entry = m_entries[m_position - m_base];
+        Apply(entry, entry.type == ADD, target);
+        m_position++;
+    }
+
+    // 跳到历史中的任意位置（GetUndoCount() 的取值范围内，0 = 最早）
+    void Seek(size_t undoCount, HistoryTarget& target) {
+        size_t goal = m_base + undoCount;
+        if (goal > m_base + m_entries.size()) {
+            goal = m_base + m_entries.size();
+        }
+
+        // 找 goal 之前最近的检查点；比逐条回放更近时先恢复到检查点
+        const Checkpoint* best = NULL;
+        for (size_t i = 0; i < m_checkpoints.size(); i++) {
+            if (m_checkpoints[i].position <= goal) {
+                best = &m_checkpoints[i];
+            }
+        }
+        size_t stepDistance = goal > m_position ? goal - m_position : m_position - goal;
+        if (best && goal - best->position + kCheckpointInterval < stepDistance) {
+            RestoreCheckpoint(*best, target);
+            m_position = best->position;
+        }
+
+        while (m_position > goal) {
+            Undo(target);
+        }
+        while (m_position < goal) {
+            Redo(target);
+        }
+    }
+
+    // 画布整体重置（例如打开新文件）时调用，笔画存储由调用方清空
+    void Reset() {
+        m_entries.clear();
+        m_checkpoints.clear();
+        m_refs.clear();
+        m_base = m_position = 0;
+        m_entryBytes = 0;
+        AddCheckpoint();
+    }
+
+private:
+    struct Entry {
+        Type type;
+        std::vector<StrokeId> ids;
+    };
+
+    struct Checkpoint {
+        size_t position;             // 绝对位置：此前已执行的命令数
+        std::vector<uint64_t> bits;  // 第 id 位为 1 表示该笔画可见
+    };
+
+    StrokeStore& m_store;
+    size_t m_limit;
+    std::deque<Entry> m_entries;  // m_entries[0] 的绝对位置是 m_base
+    std::deque<Checkpoint> m_checkpoints;
+    std::vector<uint32_t> m_refs;  // 每条笔画被多少条命令引用
+    size_t m_base;
+    size_t m_position;
+    size_t m_entryBytes;
+
+    static size_t EntryBytes(const Entry& entry) {
+        return sizeof(Entry) + entry.ids.capacity() * sizeof(StrokeId);
+    }
+
+    void AddRefs(const Entry& entry) {
+        for (size_t i = 0; i < entry.ids.size(); i++) {
+            StrokeId id = entry.ids[i];
+            if (id >= m_refs.size()) {
+                m_refs.resize(id + 1, 0);
+            }
+            m_refs[id]++;
+        }
+    }
+
+    // 命令被丢弃后，隐藏且无人引用的笔画再也回不来了，释放它的点块
+    void ReleaseRefs(const Entry& entry) {
+        for (size_t i = 0; i < entry.ids.size(); i++) {
+            StrokeId id = entry.ids[i];
+            if (--m_refs[id] == 0 && m_store.IsErased(id)) {
+                m_store.Release(id);
+            }
+        }
+    }
+
+    void Apply(const Entry& entry, bool show, HistoryTarget& target) {
+        target.BeginUpdate(entry.ids.size());
+        for (size_t i = 0; i < entry.ids.size(); i++) {
+            if (show) {
+                target.ShowStroke(entry.ids[i]);
+            } else {
+                target.HideStroke(entry.ids[i]);
+            }
+        }
+        target.EndUpdate();
+    }
+
+    void AddCheckpoint() {
+        Checkpoint cp;
+        cp.position = m_position;
+        size_t count = m_store.GetStrokeCount();
+        cp.bits.assign((count + 63) / 64, 0);
+        for (size_t id = 0; id < count; id++) {
+            if (!m_store.IsErased(StrokeId(id))) {
+                cp.bits[id / 64] |= uint64_t(1) << (id % 64);
+            }
+        }
+        m_checkpoints.push_back(cp);
+    }
+
+    void RestoreCheckpoint(const Checkpoint& cp, HistoryTarget& target) {
+        size_t count = m_store.GetStrokeCount();
+        target.BeginUpdate(count);
+        for (size_t id = 0; id < count; id++) {
+            bool want = id / 64 < cp.bits.size() && (cp.bits[id / 64] >> (id % 64)) & 1;
+            bool have = !m_store.IsErased(StrokeId(id));
+            if (want && !have) {
+                target.ShowStroke(StrokeId(id));
+            } else if (!want && have) {
+                target.HideStroke(StrokeId(id));
+            }
+        }
+        target.EndUpdate();
+    }
+
+    void DropNewest() {
+        const Entry& entry = m_entries.back();
+        m_entryBytes -= EntryBytes(entry);
+        ReleaseRefs(entry);
+        m_entries.pop_back();
+        size_t end = m_base + m_entries.size();
+        while (!m_checkpoints.empty() && m_checkpoints.back().position > end) {
+            m_checkpoints.pop_back();
+        }
+    }
+
+    void DropOldest() {
+        const Entry& entry = m_entries.front();
+        m_entryBytes -= EntryBytes(entry);
+        ReleaseRefs(entry);
+        m_entries.pop_front();
+        m_base++;
+        // 早于新起点的检查点已经无法到达
+        while (!m_checkpoints.empty() && m_checkpoints.front().position < m_base) {
+            m_checkpoints.pop_front();
+        }
+    }
+
+    // 超出上限时压缩：先丢最旧的撤销步骤（有检查点时整段丢到下一个检查点，
+    // 让新的起点正好有快照），仍然超出时再丢最远的重做步骤
+    void Compact() {
+        while (GetMemoryUsage() > m_limit && CanUndo()) {
+            size_t cut = m_base + 1;
+            for (size_t i = 0; i < m_checkpoints.size(); i++) {
+                if (m_checkpoints[i].position > m_base) {
+                    cut = std::min(m_checkpoints[i].position, m_position);
+                    break;
+                }
+            }
+            while (m_base < cut) {
+                DropOldest();
+            }
+        }
+        while (GetMemoryUsage() > m_limit && CanRedo()) {
+            DropNewest();
+        }
+    }
+};
+
+} // namespace drawing
+
+#endif // DRAWING_HISTORY_H
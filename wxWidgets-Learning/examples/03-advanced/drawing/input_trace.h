@@ -0,0 +1,120 @@
+/*
+ * 输入轨迹：录制下来的鼠标按下 / 移动 / 抬起事件（custom_draw 录制，draw_bench 回放）
+ *
+ * 文本格式，每行一个事件，# 开头的行是注释：
+ *
+ *   size <宽> <高>          录制时画布的客户区尺寸
+ *   d <毫秒> <x> <y>        按下
+ *   m <毫秒> <x> <y>        移动（拖动中）
+ *   u <毫秒> <x> <y>        抬起
+ *
+ * 时间相对录制开始，坐标是屏幕坐标。文本格式便于用脚本生成或修改轨迹。
+ *
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef DRAWING_INPUT_TRACE_H
+#define DRAWING_INPUT_TRACE_H
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+#include "mapped_file.h"
+
+namespace drawing {
+
+struct InputEvent {
+    enum Type { DOWN, MOVE, UP };
+
+    Type type;
+    double timeMs;
+    int x;
+    int y;
+};
+
+class InputTrace {
+public:
+    InputTrace() : m_width(0), m_height(0) {}
+
+    void SetCanvasSize(int width, int height) {
+        m_width = width;
+        m_height = height;
+    }
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+
+    void Add(InputEvent::Type type, double timeMs, int x, int y) {
+        InputEvent e = { type, timeMs, x, y };
+        m_events.push_back(e);
+    }
+
+    void Clear() { m_events.clear(); }
+    const std::vector<InputEvent>& GetEvents() const { return m_events; }
+    size_t GetCount() const { return m_events.size(); }
+
+    bool Save(const PathChar* path) const {
+        std::FILE* file = Open(path, false);
+        if (!file) {
+            return false;
+        }
+        std::fprintf(file, "# custom_draw input trace\n");
+        std::fprintf(file, "size %d %d\n", m_width, m_height);
+        static const char kTypes[] = { 'd', 'm', 'u' };
+        for (size_t i = 0; i < m_events.size(); i++) {
+            const InputEvent& e = m_events[i];
+            std::fprintf(file, "%c %.3f %d %d\n", kTypes[e.type], e.timeMs, e.x, e.y);
+        }
+        bool ok = !std::ferror(file);
+        return std::fclose(file) == 0 && ok;
+    }
+
+    // 无法识别的行直接跳过；时间必须单调不减
+    bool Load(const PathChar* path) {
+        std::FILE* file = Open(path, true);
+        if (!file) {
+            return false;
+        }
+        m_events.clear();
+        char line[256];
+        while (std::fgets(line, sizeof(line), file)) {
+            char type = 0;
+            InputEvent e;
+            if (std::sscanf(line, "size %d %d", &m_width, &m_height) == 2) {
+                continue;
+            }
+            if (std::sscanf(line, " %c %lf %d %d", &type, &e.timeMs, &e.x, &e.y) != 4) {
+                continue;
+            }
+            switch (type) {
+                case 'd': e.type = InputEvent::DOWN; break;
+                case 'm': e.type = InputEvent::MOVE; break;
+                case 'u': e.type = InputEvent::UP; break;
+                default: continue;
+            }
+            if (!m_events.empty() && e.timeMs < m_events.back().timeMs) {
+                e.timeMs = m_events.back().timeMs;
+            }
+            m_events.push_back(e);
+        }
+        std::fclose(file);
+        return true;
+    }
+
+private:
+    std::vector<InputEvent> m_events;
+    int m_width;
+    int m_height;
+
+    static std::FILE* Open(const PathChar* path, bool read) {
+#ifdef _WIN32
+        return _wfopen(path, read ? L"r" : L"w");
+#else
+        return std::fopen(path, read ? "r" : "w");
+#endif
+    }
+};
+
+} // namespace drawing
+
+#endif // DRAWING_INPUT_TRACE_H
@@ -0,0 +1,323 @@
+/*
+ * 图层与合成（custom_draw 示例使用）
+ *
+ * 每个图层有自己的光栅（LayerRaster）：与视口一样大的预乘 alpha RGBA 缓冲，
+ * 由 TileRenderer 以透明背景光栅化。改动一个图层的笔画只重新光栅化这个图层的
+ * 脏区域，其他图层的光栅原样保留；显示 / 隐藏、不透明度和混合模式只影响合成，
+ * 不需要重新光栅化任何图层。
+ *
+ * 合成时背景（不透明）在最下面，图层按顺序逐层叠加。设 s 为图层预乘过的颜色、
+ * a 为它的 alpha、d 为下面已经合成好的颜色（都是 0..255），三种混合模式
+ * 都只需要乘法和加法：
+ *
+ *   正常      d' = s + d × (255 - a) / 255
+ *   正片叠底  d' = d × (255 - a) / 255 + d × s / 255
+ *   滤色      d' = d + s - d × s / 255
+ *
+ * 图层的不透明度先乘到 s 和 a 上。除以 255 用 (t + (t >> 8)) >> 8，其中
+ * t = x × y + 128，结果与四舍五入相同。SIMD 版本把 8 位分量展开成 16 位计算，
+ * SSE2 一次 4 个像素、AVX2 一次 8 个；一组像素全透明时直接跳过（笔画稀疏的图层
+ * 大部分都是这样），正常模式下全不透明时直接拷贝。指令集与 fill_kernels.h 共用。
+ *
+ * 合成的目标每像素 4 字节（RGBX，第 4 字节保持 255），与图层光栅对齐，
+ * 交给 wxImage 之前再转换成 RGB。
+ *
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef DRAWING_LAYERS_H
+#define DRAWING_LAYERS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "fill_kernels.h"
+#include "stroke_store.h"
+#include "tile_renderer.h"
+
+namespace drawing {
+
+enum BlendMode {
+    BLEND_NORMAL,
+    BLEND_MULTIPLY,  // 正片叠底：只会变暗
+    BLEND_SCREEN     // 滤色：只会变亮
+};
+
+// ==================== 图层光栅 ====================
+
+// 与视口同样大小的预乘 alpha RGBA 缓冲，屏幕坐标
+class LayerRaster {
+public:
+    LayerRaster() : m_width(0), m_height(0) {}
+
+    // 尺寸变化时清成全透明
+    void Resize(int width, int height) {
+        m_width = width;
+        m_height = height;
+        m_pixels.assign(size_t(width) * height * 4, 0);
+        m_ink = StrokeBox();
+    }
+
+    bool HasSize(int width, int height) const { return m_width == width && m_height == height; }
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    size_t GetBytes() const { return m_pixels.size(); }
+
+    unsigned char* Row(int y) { return &m_pixels[size_t(y) * m_width * 4]; }
+    const unsigned char* Row(int y) const { return &m_pixels[size_t(y) * m_width * 4]; }
+
+    // 写入一个以透明背景光栅化的块，超出光栅的部分丢弃
+    void Store(const TileJob& job) {
+        int x0 = std::max(job.x, 0), x1 = std::min(job.x + job.width, m_width);
+        int y0 = std::max(job.y, 0), y1 = std::min(job.y + job.height, m_height);
+        if (x0 >= x1 || y0 >= y1) {
+            return;
+        }
+        for (int y = y0; y < y1; y++) {
+            const unsigned char* src = &job.rgb[(size_t(y - job.y) * job.width + (x0 - job.x)) * 4];
+            memcpy(Row(y) + size_t(x0) * 4, src, size_t(x1 - x0) * 4);
+        }
+        if (!job.strokes.empty()) {
+            StrokePoint a = { x0, y0 };
+            StrokePoint b = { x1 - 1, y1 - 1 };
+            m_ink.Add(a);
+            m_ink.Add(b);
+        }
+    }
+
+    // 可能有内容的范围：写入过笔画的块的并集。只增不减，
+    // 整个光栅重新光栅化之前可以 ResetInk()
+    const StrokeBox& GetInk() const { return m_ink; }
+    void ResetInk() { m_ink = StrokeBox(); }
+
+private:
+    std::vector<unsigned char> m_pixels;
+    int m_width;
+    int m_height;
+    StrokeBox m_ink;
+};
+
+// 图层的属性和光栅
+struct Layer {
+    std::string name;  // UTF-8
+    bool visible;
+    int opacity;       // 0-255
+    BlendMode blend;
+    LayerRaster raster;
+
+    explicit Layer(const std::string& n)
+        : name(n), visible(true), opacity(255), blend(BLEND_NORMAL) {}
+
+    // 可见、不透明、正常混合：只有一个这样的图层时，直接画在背景上的结果与合成相同
+    bool IsPlain() const { return visible && opacity == 255 && blend == BLEND_NORMAL; }
+};
+
+// ==================== 合成内核 ====================
+
+namespace detail {
+
+inline unsigned Mul255(unsigned x, unsigned y) {
+    unsigned t = x * y + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+inline void CompositeRowScalar(unsigned char* dst, const unsigned char* src, int count,
+                               int opacity, BlendMode mode) {
+    for (int i = 0; i < count; i++, dst += 4, src += 4) {
+        unsigned a = src[3];
+        if (a == 0) {
+            continue;
+        }
+        if (opacity < 255) {
+            a = Mul255(a, opacity);
+        }
+        for (int c = 0; c < 3; c++) {
+            unsigned s = opacity < 255 ? Mul255(src[c], opacity) : src[c];
+            unsigned d = dst[c];
+            switch (mode) {
+                case BLEND_MULTIPLY: d = Mul255(d, 255 - a) + Mul255(d, s); break;
+                case BLEND_SCREEN:   d = d + s - Mul255(d, s); break;
+                default:             d = s + Mul255(d, 255 - a); break;
+            }
+            dst[c] = (unsigned char)d;
+        }
+    }
+}
+
+#ifdef DRAWING_FILL_X86
+
+inline __m128i Mul255Sse2(__m128i x, __m128i y) {
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, y), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// 两个像素，每个分量 16 位。alpha 分量的结果总是 255
+template <BlendMode Mode>
+inline __m128i BlendSse2(__m128i d, __m128i s, __m128i opacity, bool scale) {
+    if (scale) {
+        s = Mul255Sse2(s, opacity);
+    }
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)),
+                                    _MM_SHUFFLE(3, 3, 3, 3));
+    __m128i inv = _mm_sub_epi16(_mm_set1_epi16(255), a);
+    switch (Mode) {
+        case BLEND_MULTIPLY: return _mm_add_epi16(Mul255Sse2(d, inv), Mul255Sse2(d, s));
+        case BLEND_SCREEN:   return _mm_sub_epi16(_mm_add_epi16(d, s), Mul255Sse2(d, s));
+        default:             return _mm_add_epi16(s, Mul255Sse2(d, inv));
+    }
+}
+
+template <BlendMode Mode>
+inline void CompositeRowSse2(unsigned char* dst, const unsigned char* src, int count, int opacity) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = _mm_set1_epi32(int(0xFF000000u));
+    const __m128i vopacity = _mm_set1_epi16(short(opacity));
+    const bool scale = opacity < 255;
+    int i = 0;
+    for (; i + 4 <= count; i += 4, dst += 16, src += 16) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        __m128i sa = _mm_and_si128(s, alpha);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(sa, zero)) == 0xFFFF) {
+            continue;  // 4 个像素全透明
+        }
+        if (Mode == BLEND_NORMAL && !scale && _mm_movemask_epi8(_mm_cmpeq_epi32(sa, alpha)) == 0xFFFF) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), s);  // 全不透明，直接覆盖
+            continue;
+        }
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst));
+        __m128i lo = BlendSse2<Mode>(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero),
+                                     vopacity, scale);
+        __m128i hi = BlendSse2<Mode>(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero),
+                                     vopacity, scale);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(lo, hi));
+    }
+    CompositeRowScalar(dst, src, count - i, opacity, Mode);
+}
+
+DRAWING_TARGET_AVX2
+inline __m256i Mul255Avx2(__m256i x, __m256i y) {
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(x, y), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+// 四个像素（两个 128 位通道各两个），与 BlendSse2 相同
+template <BlendMode Mode>
+DRAWING_TARGET_AVX2
+inline __m256i BlendAvx2(__m256i d, __m256i s, __m256i opacity, bool scale) {
+    if (scale) {
+        s = Mul255Avx2(s, opacity);
+    }
+    __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)),
+                                       _MM_SHUFFLE(3, 3, 3, 3));
+    __m256i inv = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+    switch (Mode) {
+        case BLEND_MULTIPLY: return _mm256_add_epi16(Mul255Avx2(d, inv), Mul255Avx2(d, s));
+        case BLEND_SCREEN:   return _mm256_sub_epi16(_mm256_add_epi16(d, s), Mul255Avx2(d, s));
+        default:             return _mm256_add_epi16(s, Mul255Avx2(d, inv));
+    }
+}
+
+// unpack / pack 都在各自的 128 位通道内进行，像素顺序前后一致
+template <BlendMode Mode>
+DRAWING_TARGET_AVX2
+inline void CompositeRowAvx2(unsigned char* dst, const unsigned char* src, int count, int opacity) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha = _mm256_set1_epi32(int(0xFF000000u));
+    const __m256i vopacity = _mm256_set1_epi16(short(opacity));
+    const bool scale = opacity < 255;
+    int i = 0;
+    for (; i + 8 <= count; i += 8, dst += 32, src += 32) {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+        __m256i sa = _mm256_and_si256(s, alpha);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, zero)) == -1) {
+            continue;
+        }
+        if (Mode == BLEND_NORMAL && !scale &&
+            _mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, alpha)) == -1) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), s);
+            continue;
+        }
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst));
+        __m256i lo = BlendAvx2<Mode>(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero),
+                                     vopacity, scale);
+        __m256i hi = BlendAvx2<Mode>(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero),
+                                     vopacity, scale);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_packus_epi16(lo, hi));
+    }
+    CompositeRowSse2<Mode>(dst, src, count - i, opacity);
+}
+
+#endif // DRAWING_FILL_X86
+
+template <BlendMode Mode>
+inline void CompositeRowAs(unsigned char* dst, const unsigned char* src, int count, int opacity) {
+#ifdef DRAWING_FILL_X86
+    switch (GetFillIsa()) {
+        case FILL_AVX2: CompositeRowAvx2<Mode>(dst, src, count, opacity); return;
+        case FILL_SSE2: CompositeRowSse2<Mode>(dst, src, count, opacity); return;
+        default: break;
+    }
+#endif
+    CompositeRowScalar(dst, src, count, opacity, Mode);
+}
+
+} // namespace detail
+
+// 把一行预乘的 RGBA（src）按 opacity（0-255）和 mode 叠加到 RGBX（dst）上
+inline void CompositeRow(unsigned char* dst, const unsigned char* src, int count,
+                         int opacity, BlendMode mode) {
+    if (opacity <= 0 || count <= 0) {
+        return;
+    }
+    opacity = std::min(opacity, 255);
+    switch (mode) {
+        case BLEND_MULTIPLY: detail::CompositeRowAs<BLEND_MULTIPLY>(dst, src, count, opacity); break;
+        case BLEND_SCREEN:   detail::CompositeRowAs<BLEND_SCREEN>(dst, src, count, opacity); break;
+        default:             detail::CompositeRowAs<BLEND_NORMAL>(dst, src, count, opacity); break;
+    }
+}
+
+inline void RgbToRgbx(const unsigned char* rgb, unsigned char* rgbx, int count) {
+    for (int i = 0; i < count; i++, rgb += 3, rgbx += 4) {
+        rgbx[0] = rgb[0];
+        rgbx[1] = rgb[1];
+        rgbx[2] = rgb[2];
+        rgbx[3] = 255;
+    }
+}
+
+inline void RgbxToRgb(const unsigned char* rgbx, unsigned char* rgb, int count) {
+    for (int i = 0; i < count; i++, rgb += 3, rgbx += 4) {
+        rgb[0] = rgbx[0];
+        rgb[1] = rgbx[1];
+        rgb[2] = rgbx[2];
+    }
+}
+
+// 把可见图层按顺序叠加到 frame 上。frame 是屏幕上 rect 范围的 RGBX，
+// 调用前已经填好背景；每个图层只合成 rect 与它的内容范围相交的部分
+inline void CompositeLayers(const std::vector<Layer>& layers, const StrokeBox& rect,
+                            unsigned char* frame) {
+    int width = rect.right - rect.left + 1;
+    for (size_t i = 0; i < layers.size(); i++) {
+        const Layer& layer = layers[i];
+        const StrokeBox& ink = layer.raster.GetInk();
+        if (!layer.visible || layer.opacity <= 0 || ink.IsEmpty()) {
+            continue;
+        }
+        int x0 = std::max(rect.left, ink.left), x1 = std::min(rect.right, ink.right);
+        int y0 = std::max(rect.top, ink.top), y1 = std::min(rect.bottom, ink.bottom);
+        for (int y = y0; y <= y1; y++) {
+            unsigned char* dst = frame + (size_t(y - rect.top) * width + (x0 - rect.left)) * 4;
+            CompositeRow(dst, layer.raster.Row(y) + size_t(x0) * 4, x1 - x0 + 1,
+                         layer.opacity, layer.blend);
+        }
+    }
+}
+
+} // namespace drawing
+
+#endif // DRAWING_LAYERS_H
@@ -0,0 +1,93 @@
+/*
+ * 有容量上限的 LRU 缓存（custom_draw 示例用来缓存画笔和画刷）
+ *
+ * 每个不同的画笔 / 画刷都对应一个 GDI 对象，创建代价不小，数量也有限。
+ * 绘制时按键（例如颜色 + 宽度 + 线型）查找，相同的组合共用一个对象；
+ * 缓存满了以后淘汰最久没有用过的那个。
+ *
+ * 命中时只在链表内移动节点（splice），不分配内存。同时统计命中、
+ * 未命中和淘汰次数，用来判断容量是否合适：命中率低说明同时在用的
+ * 样式比容量多，每帧都在反复创建和销毁对象。
+ *
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef DRAWING_LRU_CACHE_H
+#define DRAWING_LRU_CACHE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace drawing {
+
+template <typename T>
+class LruCache {
+public:
+    explicit LruCache(size_t capacity)
+        : m_capacity(std::max<size_t>(1, capacity)), m_hits(0), m_misses(0), m_evictions(0) {}
+
+    // 找到时把它标记为最近使用；没找到返回 NULL
+    T* Find(uint64_t key) {
+        typename Map::iterator it = m_map.find(key);
+        if (it == m_map.end()) {
+            m_misses++;
+            return NULL;
+        }
+        m_hits++;
+        m_items.splice(m_items.begin(), m_items, it->second);
+        return &it->second->second;
+    }
+
+    // 插入一个 Find() 没有找到的键，必要时先淘汰最久没用的项。
+    // 返回的引用在下一次 Insert() 之前有效
+    T& Insert(uint64_t key, const T& value) {
+        if (m_map.size() >= m_capacity) {
+            m_map.erase(m_items.back().first);
+            m_items.pop_back();
+            m_evictions++;
+        }
+        m_items.push_front(std::make_pair(key, value));
+        m_map[key] = m_items.begin();
+        return m_items.front().second;
+    }
+
+    void Clear() {
+        m_items.clear();
+        m_map.clear();
+    }
+
+    void ResetStats() {
+        m_hits = m_misses = m_evictions = 0;
+    }
+
+    size_t GetSize() const { return m_map.size(); }
+    size_t GetCapacity() const { return m_capacity; }
+    uint64_t GetHits() const { return m_hits; }
+    uint64_t GetMisses() const { return m_misses; }
+    uint64_t GetEvictions() const { return m_evictions; }
+
+    // 命中率 0..1，还没有查找过时返回 -1
+    double GetHitRate() const {
+        uint64_t lookups = m_hits + m_misses;
+        return lookups > 0 ? double(m_hits) / lookups : -1;
+    }
+
+private:
+    typedef std::list<std::pair<uint64_t, T> > List;  // 最近使用的在前
+    typedef std::unordered_map<uint64_t, typename List::iterator> Map;
+
+    List m_items;
+    Map m_map;
+    size_t m_capacity;
+    uint64_t m_hits;
+    uint64_t m_misses;
+    uint64_t m_evictions;
+};
+
+} // namespace drawing
+
+#endif // DRAWING_LRU_CACHE_H
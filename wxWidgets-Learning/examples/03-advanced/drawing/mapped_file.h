@@ -0,0 +1,125 @@
+/*
+ * 只读内存映射文件
+ *
+ * 把整个文件映射进地址空间，按需由操作系统分页读入：打开大文件时
+ * 不需要先把内容读进内存，只访问到的部分才真正产生磁盘读取。
+ *
+ * 路径类型 PathChar 与 wxString::fn_str() 一致：Windows 上是 wchar_t，
+ * 其他平台是 char（UTF-8）。
+ *
+ * 本文件只依赖标准库和操作系统 API，不依赖 wxWidgets。
+ */
+
+#ifndef DRAWING_MAPPED_FILE_H
+#define DRAWING_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace drawing {
+
+#ifdef _WIN32
+typedef wchar_t PathChar;
+#else
+typedef char PathChar;
+#endif
+
+class MappedFile {
+public:
+    MappedFile() : m_data(NULL), m_size(0), m_open(false) {}
+    ~MappedFile() { Close(); }
+
+    // 空文件也能打开成功，此时 GetData() 为 NULL、GetSize() 为 0
+    bool Open(const PathChar* path) {
+        Close();
+#ifdef _WIN32
+        HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || uint64_t(size.QuadPart) > uint64_t(SIZE_MAX)) {
+            CloseHandle(file);
+            return false;
+        }
+        m_size = size_t(size.QuadPart);
+        if (m_size > 0) {
+            HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping) {
+                m_data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                CloseHandle(mapping);  // 视图本身会保持映射
+            }
+        }
+        CloseHandle(file);
+#else
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || uint64_t(st.st_size) > uint64_t(SIZE_MAX)) {
+            close(fd);
+            return false;
+        }
+        m_size = size_t(st.st_size);
+        if (m_size > 0) {
+            void* p = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                m_data = static_cast<const uint8_t*>(p);
+            }
+        }
+        close(fd);  // 映射建立后文件描述符就不再需要
+#endif
+        if (m_size > 0 && !m_data) {
+            m_size = 0;
+            return false;
+        }
+        m_open = true;
+        return true;
+    }
+
+    void Close() {
+        if (m_data) {
+#ifdef _WIN32
+            UnmapViewOfFile(m_data);
+#else
+            munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+        }
+        m_data = NULL;
+        m_size = 0;
+        m_open = false;
+    }
+
+    bool IsOpen() const { return m_open; }
+    const uint8_t* GetData() const { return m_data; }
+    size_t GetSize() const { return m_size; }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    bool m_open;
+
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+} // namespace drawing
+
+#endif // DRAWING_MAPPED_FILE_H
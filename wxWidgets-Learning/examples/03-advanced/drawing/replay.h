@@ -0,0 +1,187 @@
+/*
+ * 输入轨迹回放（draw_bench 使用）
+ *
+ * 按 DrawPanel 的处理方式把轨迹里的自由绘制事件送进绘图引擎：
+ *
+ *   按下   开始新笔画，第一个点原样保留
+ *   移动   抽稀 + 平滑（StrokeFilter），通过的点追加到笔画
+ *   抬起   补上终点，RDP 简化后进入空间索引
+ *
+ * 事件按目标帧率分批：时刻落在同一帧间隔内的事件在一帧里处理，
+ * 与 DrawPanel 的帧调度一致。每帧给出新增的线段和需要重画的区域，
+ * 由调用方决定用哪个后端绘制，本文件不涉及任何绘制。
+ *
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef DRAWING_REPLAY_H
+#define DRAWING_REPLAY_H
+
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "input_trace.h"
+#include "spatial_grid.h"
+#include "stroke_filter.h"
+#include "stroke_store.h"
+
+namespace drawing {
+
+struct ReplayOptions {
+    double frameRate;              // 分批的帧率 (Hz)
+    StrokeStyle style;             // 回放笔画使用的画笔
+    StrokeFilterOptions filter;
+
+    ReplayOptions() : frameRate(60), style(0x0000FF, 2) {}
+};
+
+// 一帧的处理结果
+struct ReplayFrame {
+    double tickMs;                         // 这一帧的时刻（轨迹时间）
+    double firstEventMs;                   // 帧内最早的事件时刻
+    size_t events;                         // 帧内的事件数
+    // 本帧新增的折线：第 i 条是 points[starts[i], starts[i + 1])，
+    // 接着上一帧的笔画时第一个点是上一帧的终点
+    std::vector<StrokePoint> points;
+    std::vector<size_t> starts;
+    StrokeBox repaint;                     // 需要重画的区域（提交的笔画被简化过）
+    bool drawing;                          // 帧结束时是否还在绘制笔画
+    StrokeId stroke;                       // 正在绘制或刚提交的笔画
+};
+
+class TraceReplayer {
+public:
+    TraceReplayer(const InputTrace& trace, const ReplayOptions& options)
+        : m_events(trace.GetEvents()), m_options(options), m_index(256), m_next(0),
+          m_tick(0), m_drawing(false), m_open(false), m_stroke(0), m_rawPoints(0), m_keptPoints(0) {
+        m_filter.SetOptions(options.filter);
+        if (!m_events.empty()) {
+            m_tick = m_events[0].timeMs;
+        }
+    }
+
+    // 处理下一帧的事件，轨迹结束时返回 false
+    bool NextFrame(ReplayFrame& frame) {
+        if (m_next >= m_events.size()) {
+            return false;
+        }
+        // 跳过没有事件的帧间隔，它们不会产生绘制
+        double interval = 1000.0 / m_options.frameRate;
+        if (m_events[m_next].timeMs >= m_tick + interval) {
+            m_tick += std::floor((m_events[m_next].timeMs - m_tick) / interval) * interval;
+        }
+        m_tick += interval;
+
+        frame.tickMs = m_tick;
+        frame.firstEventMs = m_events[m_next].timeMs;
+        frame.events = 0;
+        frame.points.clear();
+        frame.starts.clear();
+        frame.repaint = StrokeBox();
+        m_open = false;
+        while (m_next < m_events.size() && m_events[m_next].timeMs < m_tick) {
+            Apply(m_events[m_next], frame);
+            m_next++;
+            frame.events++;
+        }
+        frame.drawing = m_drawing;
+        frame.stroke = m_stroke;
+        return true;
+    }
+
+    const StrokeStore& GetStore() const { return m_store; }
+    SpatialGrid& GetIndex() { return m_index; }
+    size_t GetRawPoints() const { return m_rawPoints; }    // 送入的原始点数
+    size_t GetKeptPoints() const { return m_keptPoints; }  // 简化后保存的点数
+
+private:
+    const std::vector<InputEvent>& m_events;
+    ReplayOptions m_options;
+    StrokeStore m_store;
+    SpatialGrid m_index;
+    StrokeFilter m_filter;
+    size_t m_next;
+    double m_tick;
+    bool m_drawing;
+    bool m_open;  // 当前笔画在本帧已经有一条折线
+    StrokeId m_stroke;
+    size_t m_rawPoints;
+    size_t m_keptPoints;
+
+    std::vector<StrokePoint> m_simplifyIn;
+    std::vector<StrokePoint> m_simplifyOut;
+    std::vector<char> m_simplifyKeep;
+    std::vector<std::pair<size_t, size_t> > m_simplifyStack;
+
+    void Apply(const InputEvent& e, ReplayFrame& frame) {
+        StrokePoint pt = { e.x, e.y };
+        StrokePoint out;
+        switch (e.type) {
+            case InputEvent::DOWN:
+                if (m_drawing) {
+                    Commit(frame);  // 缺了抬起事件的轨迹
+                }
+                m_drawing = true;
+                m_stroke = m_store.BeginStroke(m_options.style);
+                m_store.AppendPoint(m_stroke, m_filter.Begin(pt));
+                m_rawPoints++;
+                frame.starts.push_back(frame.points.size());
+                frame.points.push_back(pt);
+                m_open = true;
+                break;
+            case InputEvent::MOVE:
+                if (!m_drawing) {
+                    break;
+                }
+                m_rawPoints++;
+                if (m_filter.Add(pt, out)) {
+                    Append(out, frame);
+                }
+                break;
+            case InputEvent::UP:
+                if (!m_drawing) {
+                    break;
+                }
+                m_rawPoints++;
+                if (m_filter.End(pt, out)) {
+                    Append(out, frame);
+                }
+                Commit(frame);
+                break;
+        }
+    }
+
+    void Append(const StrokePoint& pt, ReplayFrame& frame) {
+        if (!m_open) {
+            frame.starts.push_back(frame.points.size());
+            frame.points.push_back(m_store.GetLastPoint(m_stroke));
+            m_open = true;
+        }
+        m_store.AppendPoint(m_stroke, pt);
+        frame.points.push_back(pt);
+    }
+
+    void Commit(ReplayFrame& frame) {
+        m_drawing = false;
+        m_open = false;
+        StrokeBox oldBox = GetPaintedBox(m_store, m_stroke);
+        m_store.CopyPoints(m_stroke, m_simplifyIn);
+        SimplifyPolyline(m_simplifyIn, m_options.filter.tolerance, m_simplifyOut,
+                         m_simplifyKeep, m_simplifyStack);
+        if (m_simplifyOut.size() < m_simplifyIn.size()) {
+            m_store.ReplacePoints(m_stroke, m_simplifyOut);
+            StrokePoint a = { oldBox.left, oldBox.top };
+            StrokePoint b = { oldBox.right, oldBox.bottom };
+            frame.repaint.Add(a);
+            frame.repaint.Add(b);
+        }
+        m_keptPoints += m_simplifyOut.size();
+        m_index.Insert(m_stroke, GetPaintedBox(m_store, m_stroke));
+    }
+};
+
+} // namespace drawing
+
+#endif // DRAWING_REPLAY_H
@@ -0,0 +1,215 @@
+/*
+ * 笔画空间索引：均匀网格（custom_draw 示例使用）
+ *
+ * 画布按 cellSize 划分成格子，每条笔画登记到它的包围盒覆盖的所有格子里。
+ * 区域查询只访问查询矩形覆盖的格子，代价与查询面积和命中数量相关，
+ * 与画布上笔画的总数无关。格子用哈希表保存，画布没有边界限制。
+ *
+ * 用途：
+ * - 重绘时剔除与脏矩形不相交的笔画
+ * - 橡皮擦 / 选择工具的命中测试
+ */
+
+#ifndef DRAWING_SPATIAL_GRID_H
+#define DRAWING_SPATIAL_GRID_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+
+#include "stroke_store.h"
+
+namespace drawing {
+
+inline bool BoxesIntersect(const StrokeBox& a, const StrokeBox& b) {
+    return !a.IsEmpty() && !b.IsEmpty() &&
+           a.left <= b.right && b.left <= a.right &&
+           a.top <= b.bottom && b.top <= a.bottom;
+}
+
+// 向四周扩展 d 个像素
+inline StrokeBox InflateBox(const StrokeBox& box, int d) {
+    StrokeBox r = box;
+    if (!r.IsEmpty()) {
+        r.left -= d;
+        r.top -= d;
+        r.right += d;
+        r.bottom += d;
+    }
+    return r;
+}
+
+// 笔画实际覆盖的范围：点的包围盒加上半个画笔宽度（填充区域就是段覆盖的像素）
+inline StrokeBox GetPaintedBox(const StrokeStore& store, StrokeId id) {
+    if (store.IsFill(id)) {
+        return store.Get(id).bbox;
+    }
+    return InflateBox(store.Get(id).bbox, store.GetStyle(id).width / 2 + 1);
+}
+
+// 点到线段距离的平方
+inline double DistanceToSegmentSq(double px, double py,
+                                  const StrokePoint& a, const StrokePoint& b) {
+    double dx = b.x - a.x;
+    double dy = b.y - a.y;
+    double len2 = dx * dx + dy * dy;
+    double t = 0.0;
+    if (len2 > 0.0) {
+        t = ((px - a.x) * dx + (py - a.y) * dy) / len2;
+        t = std::max(0.0, std::min(1.0, t));
+    }
+    double cx = a.x + t * dx - px;
+    double cy = a.y + t * dy - py;
+    return cx * cx + cy * cy;
+}
+
+// 点 (x, y) 是否落在笔画上（考虑画笔宽度和额外的容差 radius）
+inline bool HitTestStroke(const StrokeStore& store, StrokeId id,
+                          int x, int y, int radius) {
+    const Stroke& stroke = store.Get(id);
+    if (stroke.kind == STROKE_FILL) {
+        bool inside = false;
+        store.ForEachSpan(id, [&](const StrokePoint& a, const StrokePoint& b) {
+            if (!inside && std::abs(a.y - y) <= radius && x >= a.x - radius && x <= b.x + radius) {
+                inside = true;
+            }
+        });
+        return inside;
+    }
+    double reach = store.GetStyle(id).width / 2.0 + radius;
+    double reach2 = reach * reach;
+
+    if (stroke.count == 1) {
+        StrokePoint p = store.GetLastPoint(id);
+        return DistanceToSegmentSq(x, y, p, p) <= reach2;
+    }
+
+    bool hit = false;
+    store.ForEachSegment(id, [&](const StrokePoint& a, const StrokePoint& b) {
+        if (!hit && DistanceToSegmentSq(x, y, a, b) <= reach2) {
+            hit = true;
+        }
+    });
+    return hit;
+}
+
+class SpatialGrid {
+public:
+    explicit SpatialGrid(int cellSize = 128) : m_cellSize(cellSize), m_queryStamp(0) {}
+
+    void Insert(StrokeId id, const StrokeBox& box) {
+        if (box.IsEmpty()) {
+            return;
+        }
+        if (id >= m_stamps.size()) {
+            m_stamps.resize(id + 1, 0);
+        }
+
+        int cx0, cy0, cx1, cy1;
+        CellRange(box, cx0, cy0, cx1, cy1);
+        for (int cy = cy0; cy <= cy1; cy++) {
+            for (int cx = cx0; cx <= cx1; cx++) {
+                m_cells[Key(cx, cy)].push_back(id);
+            }
+        }
+    }
+
+    // box 必须与 Insert() 时相同
+    void Remove(StrokeId id, const StrokeBox& box) {
+        if (box.IsEmpty()) {
+            return;
+        }
+
+        int cx0, cy0, cx1, cy1;
+        CellRange(box, cx0, cy0, cx1, cy1);
+        for (int cy = cy0; cy <= cy1; cy++) {
+            for (int cx = cx0; cx <= cx1; cx++) {
+                CellMap::iterator it = m_cells.find(Key(cx, cy));
+                if (it == m_cells.end()) {
+                    continue;
+                }
+                std::vector<StrokeId>& ids = it->second;
+                std::vector<StrokeId>::iterator pos = std::find(ids.begin(), ids.end(), id);
+                if (pos != ids.end()) {
+                    *pos = ids.back();
+                    ids.pop_back();
+                }
+                if (ids.empty()) {
+                    m_cells.erase(it);
+                }
+            }
+        }
+    }
+
+    // 找出所在格子与 box 相交的候选笔画，按 id 升序（即绘制顺序）写入 out。
+    // 结果是保守的：调用方需要时再用包围盒或逐段测试做精确判断
+    void Query(const StrokeBox& box, std::vector<StrokeId>& out) {
+        out.clear();
+        if (box.IsEmpty() || m_cells.empty()) {
+            return;
+        }
+
+        // 同一笔画可能登记在多个格子里，用查询序号去重，无需额外的 set
+        if (++m_queryStamp == 0) {
+            std::fill(m_stamps.begin(), m_stamps.end(), 0);
+            m_queryStamp = 1;
+        }
+
+        int cx0, cy0, cx1, cy1;
+        CellRange(box, cx0, cy0, cx1, cy1);
+        for (int cy = cy0; cy <= cy1; cy++) {
+            for (int cx = cx0; cx <= cx1; cx++) {
+                CellMap::const_iterator it = m_cells.find(Key(cx, cy));
+                if (it == m_cells.end()) {
+                    continue;
+                }
+                const std::vector<StrokeId>& ids = it->second;
+                for (size_t i = 0; i < ids.size(); i++) {
+                    if (m_stamps[ids[i]] != m_queryStamp) {
+                        m_stamps[ids[i]] = m_queryStamp;
+                        out.push_back(ids[i]);
+                    }
+                }
+            }
+        }
+        std::sort(out.begin(), out.end());
+    }
+
+    void Clear() {
+        m_cells.clear();
+        m_stamps.clear();
+        m_queryStamp = 0;
+    }
+
+    size_t GetCellCount() const { return m_cells.size(); }
+
+private:
+    typedef std::unordered_map<uint64_t, std::vector<StrokeId> > CellMap;
+
+    int m_cellSize;
+    CellMap m_cells;
+    std::vector<uint32_t> m_stamps;  // 每条笔画最近一次被查询命中的序号
+    uint32_t m_queryStamp;
+
+    // 向下取整的除法，负坐标也落在正确的格子里
+    int CellOf(int v) const {
+        return v >= 0 ? v / m_cellSize : -((-v + m_cellSize - 1) / m_cellSize);
+    }
+
+    void CellRange(const StrokeBox& box, int& cx0, int& cy0, int& cx1, int& cy1) const {
+        cx0 = CellOf(box.left);
+        cy0 = CellOf(box.top);
+        cx1 = CellOf(box.right);
+        cy1 = CellOf(box.bottom);
+    }
+
+    static uint64_t Key(int cx, int cy) {
+        return (uint64_t(uint32_t(cx)) << 32) | uint32_t(cy);
+    }
+};
+
+} // namespace drawing
+
+#endif // DRAWING_SPATIAL_GRID_H
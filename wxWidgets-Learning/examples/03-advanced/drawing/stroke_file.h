@@ -0,0 +1,435 @@
+/*
+ * 绘图文件格式（custom_draw 示例使用）
+ *
+ * 二进制、小端序，结构如下：
+ *
+ *   文件头（16 字节）
+ *     u32 魔数 "WXDR"    u16 版本号    u16 文件头长度
+ *     u32 笔画数          u16 笔画头长度 u16 保留
+ *   每条笔画：
+ *     笔画头（36 字节）
+ *       u32 颜色 0xRRGGBB   u32 宽度
+ *       i32 包围盒 left / top / right / bottom
+ *       u32 点数            u32 点数据字节数
+ *       u32 标志（版本 2 起；版本 1 的笔画头只有 32 字节）：
+ *           第 0 位为 1 表示填充区域，第 8-15 位是图层编号
+ *     点数据：每个点相对前一个点的差值（第一个点相对原点），
+ *       x、y 各自先 zigzag 再 varint 编码
+ *
+ * 手绘笔画相邻两点通常只差几个像素，差值几乎都能放进 1 个字节，
+ * 每个点约 2 字节，而文本格式 "123,456\n" 要 8 字节左右。
+ *
+ * 两个头的长度都写在文件里，以后的版本可以在末尾追加字段，
+ * 旧版本读取时按长度跳过即可。
+ *
+ * - DrawingWriter 边遍历点块边编码，经 64KB 缓冲写出，不在内存里拼整个文件
+ * - DrawingReader 内存映射文件，打开时只扫描笔画头，点数据用到时才解码
+ *
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef DRAWING_STROKE_FILE_H
+#define DRAWING_STROKE_FILE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "stroke_store.h"
+
+namespace drawing {
+
+const uint32_t kDrawingMagic = 0x52445857;  // 文件中的字节为 "WXDR"
+const uint16_t kDrawingVersion = 2;
+const size_t kDrawingHeaderSize = 16;
+const size_t kStrokeHeaderSize = 36;
+const size_t kStrokeHeaderSizeV1 = 32;  // 没有标志字段
+const uint32_t kStrokeFlagFill = 1;
+const int kStrokeLayerShift = 8;
+const int kMaxFileLayers = 256;  // 图层编号在标志里占 8 位
+
+// 读取时对笔画头做的合理性检查：包围盒直接用于空间索引登记（按格子循环），
+// 宽度用于绘制，损坏的文件不能让它们变成天文数字或负数。
+// 界面上缩到 1/64 时一条笔画在世界坐标中也只有几十万个单位
+const int kMaxFileStrokeWidth = 1024;
+const int32_t kMaxFileCoordinate = 1 << 30;
+const int32_t kMaxFileStrokeExtent = 1 << 20;
+
+// 文件中一条笔画的描述，点数据还在映射的文件里
+struct StrokeRecord {
+    StrokeStyle style;
+    StrokeKind kind;
+    int layer;
+    StrokeBox bbox;
+    uint32_t pointCount;
+    uint32_t payloadBytes;
+    size_t offset;  // 点数据在文件中的偏移
+};
+
+// ==================== 编码工具 ====================
+
+// zigzag：把小的负数映射成小的正数，-1 → 1，1 → 2
+inline uint32_t ZigZagEncode(int32_t v) {
+    return (uint32_t(v) << 1) ^ uint32_t(v >> 31);
+}
+
+inline int32_t ZigZagDecode(uint32_t v) {
+    return int32_t(v >> 1) ^ -int32_t(v & 1);
+}
+
+// varint：每字节 7 位有效数据，最高位表示后面还有字节
+inline size_t VarintSize(uint32_t v) {
+    size_t n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+inline uint8_t* PutVarint(uint8_t* p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = uint8_t(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = uint8_t(v);
+    return p;
+}
+
+// 数据截断或超过 5 字节时返回 NULL
+inline const uint8_t* GetVarint(const uint8_t* p, const uint8_t* end, uint32_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (p == end) {
+            return NULL;
+        }
+        uint8_t b = *p++;
+        v |= uint32_t(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// 差值用无符号运算，坐标相差很大时也不会有符号溢出
+inline int32_t PointDelta(int cur, int prev) {
+    return int32_t(uint32_t(cur) - uint32_t(prev));
+}
+
+inline uint32_t ReadU32(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+inline uint16_t ReadU16(const uint8_t* p) {
+    return uint16_t(p[0] | (p[1] << 8));
+}
+
+inline uint8_t* WriteU32(uint8_t* p, uint32_t v) {
+    p[0] = uint8_t(v);
+    p[1] = uint8_t(v >> 8);
+    p[2] = uint8_t(v >> 16);
+    p[3] = uint8_t(v >> 24);
+    return p + 4;
+}
+
+inline uint8_t* WriteU16(uint8_t* p, uint16_t v) {
+    p[0] = uint8_t(v);
+    p[1] = uint8_t(v >> 8);
+    return p + 2;
+}
+
+inline std::FILE* OpenFileForWrite(const PathChar* path) {
+#ifdef _WIN32
+    return _wfopen(path, L"wb");
+#else
+    return std::fopen(path, "wb");
+#endif
+}
+
+// ==================== 写入 ====================
+
+class DrawingWriter {
+public:
+    DrawingWriter() : m_file(NULL), m_used(0), m_strokeCount(0), m_bytesWritten(0), m_ok(false) {}
+    ~DrawingWriter() {
+        if (m_file) {
+            std::fclose(m_file);
+        }
+    }
+
+    bool Open(const PathChar* path) {
+        m_file = OpenFileForWrite(path);
+        if (!m_file) {
+            return false;
+        }
+        m_ok = true;
+        m_buffer.resize(kBufferSize);
+        m_used = 0;
+        m_strokeCount = 0;
+        m_bytesWritten = 0;
+        WriteFileHeader();  // 笔画数先写 0，Close() 时回填
+        return m_ok;
+    }
+
+    // 从存储中流式写出一条笔画：先数一遍编码长度写进笔画头，
+    // 再逐个点块编码进缓冲区
+    void WriteStroke(const StrokeStore& store, StrokeId id) {
+        const Stroke& stroke = store.Get(id);
+
+        size_t payload = 0;
+        StrokePoint prev = { 0, 0 };
+        store.ForEachChunk(id, [&payload, &prev](const StrokePoint* points, size_t count) {
+            for (size_t i = 0; i < count; i++) {
+                payload += VarintSize(ZigZagEncode(PointDelta(points[i].x, prev.x)));
+                payload += VarintSize(ZigZagEncode(PointDelta(points[i].y, prev.y)));
+                prev = points[i];
+            }
+        });
+
+        WriteStrokeHeader(store.GetStyle(id), stroke.kind, stroke.layer, stroke.bbox,
+                          uint32_t(stroke.count), uint32_t(payload));
+
+        prev.x = prev.y = 0;
+        store.ForEachChunk(id, [this, &prev](const StrokePoint* points, size_t count) {
+            for (size_t i = 0; i < count; i++) {
+                Reserve(10);  // 一个点最多 2 × 5 字节
+                uint8_t* p = &m_buffer[m_used];
+                p = PutVarint(p, ZigZagEncode(PointDelta(points[i].x, prev.x)));
+                p = PutVarint(p, ZigZagEncode(PointDelta(points[i].y, prev.y)));
+                m_used = p - &m_buffer[0];
+                prev = points[i];
+            }
+        });
+    }
+
+    // 写出一条已经编码好的笔画（例如从打开的文件里原样拷贝尚未解码的笔画）
+    void WriteEncoded(const StrokeRecord& record, const uint8_t* payload) {
+        WriteStrokeHeader(record.style, record.kind, record.layer, record.bbox, record.pointCount,
+                          record.payloadBytes);
+        Put(payload, record.payloadBytes);
+    }
+
+    // 回填笔画数并关闭文件；中间任何一次写入失败都会返回 false
+    bool Close() {
+        if (!m_file) {
+            return false;
+        }
+        Flush();
+        uint8_t count[4];
+        WriteU32(count, m_strokeCount);
+        if (std::fseek(m_file, 8, SEEK_SET) != 0 || std::fwrite(count, 1, 4, m_file) != 4) {
+            m_ok = false;
+        }
+        if (std::fclose(m_file) != 0) {
+            m_ok = false;
+        }
+        m_file = NULL;
+        return m_ok;
+    }
+
+    uint32_t GetStrokeCount() const { return m_strokeCount; }
+    uint64_t GetBytesWritten() const { return m_bytesWritten + m_used; }
+
+private:
+    static const size_t kBufferSize = 64 * 1024;
+
+    std::FILE* m_file;
+    std::vector<uint8_t> m_buffer;
+    size_t m_used;
+    uint32_t m_strokeCount;
+    uint64_t m_bytesWritten;  // 已经交给 fwrite 的字节数
+    bool m_ok;
+
+    void Flush() {
+        if (m_used > 0 && m_ok) {
+            if (std::fwrite(&m_buffer[0], 1, m_used, m_file) != m_used) {
+                m_ok = false;
+            }
+        }
+        m_bytesWritten += m_used;
+        m_used = 0;
+    }
+
+    void Reserve(size_t bytes) {
+        if (m_used + bytes > m_buffer.size()) {
+            Flush();
+        }
+    }
+
+    void Put(const uint8_t* data, size_t size) {
+        while (size > 0) {
+            Reserve(1);
+            size_t n = std::min(size, m_buffer.size() - m_used);
+            std::copy(data, data + n, &m_buffer[m_used]);
+            m_used += n;
+            data += n;
+            size -= n;
+        }
+    }
+
+    void WriteFileHeader() {
+        uint8_t header[kDrawingHeaderSize];
+        uint8_t* p = WriteU32(header, kDrawingMagic);
+        p = WriteU16(p, kDrawingVersion);
+        p = WriteU16(p, uint16_t(kDrawingHeaderSize));
+        p = WriteU32(p, 0);
+        p = WriteU16(p, uint16_t(kStrokeHeaderSize));
+        WriteU16(p, 0);
+        Put(header, sizeof(header));
+    }
+
+    void WriteStrokeHeader(const StrokeStyle& style, StrokeKind kind, int layer, const StrokeBox& bbox,
+                           uint32_t pointCount, uint32_t payloadBytes) {
+        uint8_t header[kStrokeHeaderSize];
+        uint8_t* p = WriteU32(header, style.colour);
+        p = WriteU32(p, uint32_t(style.width));
+        p = WriteU32(p, uint32_t(bbox.left));
+        p = WriteU32(p, uint32_t(bbox.top));
+        p = WriteU32(p, uint32_t(bbox.right));
+        p = WriteU32(p, uint32_t(bbox.bottom));
+        p = WriteU32(p, pointCount);
+        p = WriteU32(p, payloadBytes);
+        uint32_t flags = kind == STROKE_FILL ? kStrokeFlagFill : 0;
+        flags |= uint32_t(std::max(0, std::min(layer, kMaxFileLayers - 1))) << kStrokeLayerShift;
+        WriteU32(p, flags);
+        Put(header, sizeof(header));
+        m_strokeCount++;
+    }
+
+    DrawingWriter(const DrawingWriter&);
+    DrawingWriter& operator=(const DrawingWriter&);
+};
+
+// ==================== 读取 ====================
+
+class DrawingReader {
+public:
+    // 映射文件并扫描全部笔画头，代价与笔画数成正比，与点数无关
+    bool Open(const PathChar* path) {
+        Close();
+        m_error.clear();
+        if (!m_file.Open(path)) {
+            return Fail("无法打开文件");
+        }
+
+        const uint8_t* data = m_file.GetData();
+        size_t size = m_file.GetSize();
+        if (size < kDrawingHeaderSize || ReadU32(data) != kDrawingMagic) {
+            return Fail("不是绘图文件");
+        }
+        if (ReadU16(data + 4) > kDrawingVersion) {
+            return Fail("文件由更新的版本保存，无法读取");
+        }
+        size_t headerSize = ReadU16(data + 6);
+        uint32_t strokeCount = ReadU32(data + 8);
+        size_t strokeHeaderSize = ReadU16(data + 12);
+        if (headerSize < kDrawingHeaderSize || headerSize > size ||
+            strokeHeaderSize < kStrokeHeaderSizeV1) {
+            return Fail("文件头已损坏");
+        }
+        // 每条笔画至少有一个笔画头，笔画数不可能超过这个值
+        if (strokeCount > (size - headerSize) / strokeHeaderSize) {
+            return Fail("文件已截断");
+        }
+
+        m_records.reserve(strokeCount);
+        size_t offset = headerSize;
+        for (uint32_t i = 0; i < strokeCount; i++) {
+            if (size - offset < strokeHeaderSize) {
+                return Fail("文件已截断");
+            }
+            const uint8_t* p = data + offset;
+            StrokeRecord record;
+            record.style.colour = ReadU32(p);
+            record.style.width = int(ReadU32(p + 4));
+            record.bbox.left = int32_t(ReadU32(p + 8));
+            record.bbox.top = int32_t(ReadU32(p + 12));
+            record.bbox.right = int32_t(ReadU32(p + 16));
+            record.bbox.bottom = int32_t(ReadU32(p + 20));
+            record.pointCount = ReadU32(p + 24);
+            record.payloadBytes = ReadU32(p + 28);
+            uint32_t flags = strokeHeaderSize >= kStrokeHeaderSize ? ReadU32(p + 32) : 0;
+            record.kind = (flags & kStrokeFlagFill) ? STROKE_FILL : STROKE_LINE;
+            record.layer = int((flags >> kStrokeLayerShift) & 0xFF);
+            record.offset = offset + strokeHeaderSize;
+
+            // 每个点至少 2 字节、至多 10 字节
+            if (!IsSaneHeader(record) ||
+                record.payloadBytes > size - record.offset ||
+                uint64_t(record.pointCount) * 2 > record.payloadBytes ||
+                uint64_t(record.pointCount) * 10 < record.payloadBytes) {
+                return Fail("笔画数据已损坏");
+            }
+            m_records.push_back(record);
+            offset = record.offset + record.payloadBytes;
+        }
+        return true;
+    }
+
+    void Close() {
+        m_records.clear();
+        m_file.Close();
+    }
+
+    bool IsOpen() const { return m_file.IsOpen(); }
+    const std::string& GetError() const { return m_error; }
+    size_t GetFileSize() const { return m_file.GetSize(); }
+
+    size_t GetStrokeCount() const { return m_records.size(); }
+    const StrokeRecord& GetRecord(size_t index) const { return m_records[index]; }
+    const uint8_t* GetPayload(size_t index) const { return m_file.GetData() + m_records[index].offset; }
+
+    // 解码一条笔画的点；数据损坏时返回 false，out 中只保留已解出的点
+    bool Decode(size_t index, std::vector<StrokePoint>& out) const {
+        const StrokeRecord& record = m_records[index];
+        const uint8_t* p = GetPayload(index);
+        const uint8_t* end = p + record.payloadBytes;
+
+        out.clear();
+        out.reserve(record.pointCount);
+        uint32_t x = 0, y = 0;
+        for (uint32_t i = 0; i < record.pointCount; i++) {
+            uint32_t dx, dy;
+            if (!(p = GetVarint(p, end, dx)) || !(p = GetVarint(p, end, dy))) {
+                return false;
+            }
+            x += uint32_t(ZigZagDecode(dx));
+            y += uint32_t(ZigZagDecode(dy));
+            StrokePoint pt = { int(int32_t(x)), int(int32_t(y)) };
+            out.push_back(pt);
+        }
+        return p == end;
+    }
+
+private:
+    MappedFile m_file;
+    std::vector<StrokeRecord> m_records;
+    std::string m_error;
+
+    bool Fail(const char* message) {
+        m_error = message;
+        Close();
+        return false;
+    }
+
+    // 宽度和包围盒必须在合理范围内，否则按损坏处理
+    static bool IsSaneHeader(const StrokeRecord& record) {
+        const StrokeBox& b = record.bbox;
+        return record.style.width >= 1 && record.style.width <= kMaxFileStrokeWidth &&
+               b.left <= b.right && b.top <= b.bottom &&
+               b.left >= -kMaxFileCoordinate && b.right <= kMaxFileCoordinate &&
+               b.top >= -kMaxFileCoordinate && b.bottom <= kMaxFileCoordinate &&
+               // 两端各到 ±2^30 时差值是 2^31，int 会溢出，先扩成 64 位再减
+               int64_t(b.right) - b.left <= kMaxFileStrokeExtent &&
+               int64_t(b.bottom) - b.top <= kMaxFileStrokeExtent;
+    }
+};
+
+} // namespace drawing
+
+#endif // DRAWING_STROKE_FILE_H
@@ -0,0 +1,178 @@
+/*
+ * 自由绘制的输入管线（custom_draw 示例使用）
+ *
+ * 鼠标移动事件里有大量亚像素抖动和重复位置，直接保存既浪费内存也拖慢绘制。
+ * 每个点依次经过三个阶段：
+ *
+ * 1. 抽稀：距离上一个采纳点不足 minDistance 的输入直接丢弃
+ * 2. 平滑：对采纳的点做指数滑动平均，去掉手抖产生的锯齿
+ * 3. 简化：抬起鼠标提交笔画时，用 Ramer–Douglas–Peucker 算法
+ *    删除偏离折线不超过 tolerance 的点
+ *
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef DRAWING_STROKE_FILTER_H
+#define DRAWING_STROKE_FILTER_H
+
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "stroke_store.h"
+
+namespace drawing {
+
+struct StrokeFilterOptions {
+    double minDistance;  // 抽稀距离（像素），0 表示不抽稀
+    double smoothing;    // 平滑强度 [0, 1)，0 表示不平滑
+    double tolerance;    // RDP 简化容差（像素），0 表示不简化
+
+    StrokeFilterOptions() : minDistance(2.0), smoothing(0.5), tolerance(0.8) {}
+};
+
+// ==================== 1 + 2：实时抽稀与平滑 ====================
+
+class StrokeFilter {
+public:
+    StrokeFilter() : m_sx(0), m_sy(0), m_rawCount(0) {}
+
+    void SetOptions(const StrokeFilterOptions& options) { m_options = options; }
+    const StrokeFilterOptions& GetOptions() const { return m_options; }
+
+    // 笔画的第一个点原样保留
+    StrokePoint Begin(const StrokePoint& pt) {
+        m_lastRaw = pt;
+        m_lastOut = pt;
+        m_sx = pt.x;
+        m_sy = pt.y;
+        m_rawCount++;
+        return pt;
+    }
+
+    // 送入一个原始点；需要追加到笔画时返回 true，并把结果写入 out
+    bool Add(const StrokePoint& pt, StrokePoint& out) {
+        m_rawCount++;
+
+        double dx = pt.x - m_lastRaw.x;
+        double dy = pt.y - m_lastRaw.y;
+        if (dx * dx + dy * dy < m_options.minDistance * m_options.minDistance) {
+            return false;
+        }
+        m_lastRaw = pt;
+
+        double alpha = 1.0 - m_options.smoothing;
+        m_sx += alpha * (pt.x - m_sx);
+        m_sy += alpha * (pt.y - m_sy);
+
+        StrokePoint smoothed = { int(std::floor(m_sx + 0.5)), int(std::floor(m_sy + 0.5)) };
+        if (smoothed.x == m_lastOut.x && smoothed.y == m_lastOut.y) {
+            return false;  // 平滑后落在同一个像素上
+        }
+        m_lastOut = smoothed;
+        out = smoothed;
+        return true;
+    }
+
+    // 平滑会让笔迹落后于光标，抬起时补上最后一个原始点，让笔画终点对齐
+    bool End(const StrokePoint& pt, StrokePoint& out) {
+        if (pt.x == m_lastOut.x && pt.y == m_lastOut.y) {
+            return false;
+        }
+        m_lastOut = pt;
+        out = pt;
+        return true;
+    }
+
+    // 从程序启动起送入的原始点总数
+    size_t GetRawCount() const { return m_rawCount; }
+
+private:
+    StrokeFilterOptions m_options;
+    StrokePoint m_lastRaw;
+    StrokePoint m_lastOut;
+    double m_sx;
+    double m_sy;
+    size_t m_rawCount;
+};
+
+// ==================== 3：提交时的 RDP 简化 ====================
+
+// 点到直线 ab 的距离平方（a == b 时退化为点距）
+inline double DistanceToLineSq(const StrokePoint& p, const StrokePoint& a, const StrokePoint& b) {
+    double dx = b.x - a.x;
+    double dy = b.y - a.y;
+    double len2 = dx * dx + dy * dy;
+    double px = p.x - a.x;
+    double py = p.y - a.y;
+    if (len2 == 0.0) {
+        return px * px + py * py;
+    }
+    double cross = px * dy - py * dx;
+    return cross * cross / len2;
+}
+
+// Ramer–Douglas–Peucker 简化。用显式栈代替递归，长笔画也不会栈溢出；
+// keep 和 stack 由调用方传入以便复用内存
+inline void SimplifyPolyline(const std::vector<StrokePoint>& in, double tolerance,
+                             std::vector<StrokePoint>& out,
+                             std::vector<char>& keep,
+                             std::vector<std::pair<size_t, size_t> >& stack) {
+    out.clear();
+    if (in.size() <= 2 || tolerance <= 0.0) {
+        out = in;
+        return;
+    }
+
+    keep.assign(in.size(), 0);
+    keep.front() = 1;
+    keep.back() = 1;
+
+    double tol2 = tolerance * tolerance;
+    stack.clear();
+    stack.push_back(std::make_pair(size_t(0), in.size() - 1));
+
+    while (!stack.empty()) {
+        size_t first = stack.back().first;
+        size_t last = stack.back().second;
+        stack.pop_back();
+
+        double maxDist = 0.0;
+        size_t index = first;
+        for (size_t i = first + 1; i < last; i++) {
+            double d = DistanceToLineSq(in[i], in[first], in[last]);
+            if (d > maxDist) {
+                maxDist = d;
+                index = i;
+            }
+        }
+
+        if (maxDist > tol2) {
+            keep[index] = 1;
+            if (index - first > 1) {
+                stack.push_back(std::make_pair(first, index));
+            }
+            if (last - index > 1) {
+                stack.push_back(std::make_pair(index, last));
+            }
+        }
+    }
+
+    for (size_t i = 0; i < in.size(); i++) {
+        if (keep[i]) {
+            out.push_back(in[i]);
+        }
+    }
+}
+
+inline void SimplifyPolyline(const std::vector<StrokePoint>& in, double tolerance,
+                             std::vector<StrokePoint>& out) {
+    std::vector<char> keep;
+    std::vector<std::pair<size_t, size_t> > stack;
+    SimplifyPolyline(in, tolerance, out, keep, stack);
+}
+
+} // namespace drawing
+
+#endif // DRAWING_STROKE_FILTER_H
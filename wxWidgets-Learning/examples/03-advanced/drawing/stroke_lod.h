@@ -0,0 +1,127 @@
+/*
+ * 笔画的多级细节（LOD, level of detail）
+ *
+ * 缩小视图时，一个屏幕像素对应很多世界单位，原始点里的大部分细节
+ * 根本看不见。每条笔画按级别保存简化后的版本：
+ *
+ *   级别 0   原始点
+ *   级别 k   在级别 k - 1 的基础上做 RDP 简化，容差 0.25 * 2^k 个世界单位
+ *
+ * 缩放比例在 (2^-(k+1), 2^-k] 时使用级别 k，累计误差不超过半个屏幕像素；
+ * 缩得越小，每条笔画剩下的顶点越少，最后只剩两个端点，绘制的顶点总数
+ * 与笔画的原始点数无关。
+ *
+ * 各级别在第一次用到时生成并缓存，笔画内容变化时调用 Invalidate()。
+ * Find() 只读，可以在工作线程上与其他 Find() 并发调用；Build() 不行。
+ *
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef DRAWING_STROKE_LOD_H
+#define DRAWING_STROKE_LOD_H
+
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "stroke_store.h"
+#include "stroke_filter.h"
+
+namespace drawing {
+
+class StrokeLod {
+public:
+    static const int kMaxLevel = 8;  // 缩放到 1/256 以下时都使用最高级别
+
+    StrokeLod() : m_pointCount(0) {}
+
+    static int LevelForScale(double scale) {
+        int level = 0;
+        while (level < kMaxLevel && scale <= 0.5) {
+            scale *= 2.0;
+            level++;
+        }
+        return level;
+    }
+
+    static double ToleranceForLevel(int level) {
+        return 0.25 * std::ldexp(1.0, level);
+    }
+
+    // 取得笔画在 level 级别的点，必要时生成。级别 0 返回 NULL，表示直接使用原始点。
+    // 填充区域的点不是折线，不能简化，也返回 NULL
+    const std::vector<StrokePoint>* Build(const StrokeStore& store, StrokeId id, int level) {
+        if (level <= 0 || store.IsFill(id)) {
+            return NULL;
+        }
+        if (id >= m_entries.size()) {
+            m_entries.resize(id + 1);
+        }
+        std::unique_ptr<Levels>& entry = m_entries[id];
+        if (!entry) {
+            entry.reset(new Levels());
+        }
+
+        for (int k = entry->built + 1; k <= level; k++) {
+            const std::vector<StrokePoint>* source = &m_original;
+            if (k == 1) {
+                store.CopyPoints(id, m_original);
+            } else {
+                source = &entry->points[k - 2];
+            }
+            std::vector<StrokePoint>& out = entry->points[k - 1];
+            SimplifyPolyline(*source, ToleranceForLevel(k), out, m_keep, m_stack);
+            out.shrink_to_fit();
+            m_pointCount += out.size();
+            entry->built = k;
+        }
+        return &entry->points[level - 1];
+    }
+
+    // 只查找已经生成的级别，找不到时返回 NULL
+    const std::vector<StrokePoint>* Find(StrokeId id, int level) const {
+        if (level <= 0 || id >= m_entries.size() || !m_entries[id] || m_entries[id]->built < level) {
+            return NULL;
+        }
+        return &m_entries[id]->points[level - 1];
+    }
+
+    void Invalidate(StrokeId id) {
+        if (id < m_entries.size() && m_entries[id]) {
+            for (int k = 0; k < m_entries[id]->built; k++) {
+                m_pointCount -= m_entries[id]->points[k].size();
+            }
+            m_entries[id].reset();
+        }
+    }
+
+    void Clear() {
+        m_entries.clear();
+        m_pointCount = 0;
+    }
+
+    // 所有缓存级别的点数之和
+    size_t GetPointCount() const { return m_pointCount; }
+
+private:
+    struct Levels {
+        std::vector<StrokePoint> points[kMaxLevel];  // points[k - 1] 是级别 k
+        int built;                                   // 已经生成到第几级
+
+        Levels() : built(0) {}
+    };
+
+    std::vector<std::unique_ptr<Levels> > m_entries;  // 按笔画 id 索引，没用到的笔画只占一个指针
+    size_t m_pointCount;
+
+    // 简化用的临时缓冲，复用以免每次分配
+    std::vector<StrokePoint> m_original;
+    std::vector<char> m_keep;
+    std::vector<std::pair<size_t, size_t> > m_stack;
+};
+
+} // namespace drawing
+
+#endif // DRAWING_STROKE_LOD_H
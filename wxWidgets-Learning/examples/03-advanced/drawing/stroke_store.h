@@ -0,0 +1,374 @@
+/*
+ * 笔画存储（custom_draw 示例使用）
+ *
+ * - 每条笔画独立保存自己的画笔宽度和颜色：样式按值去重（StyleTable），
+ *   笔画里只存一个样式编号，相同样式的笔画共用一份
+ * - 除了折线，笔画也可以是填充区域（STROKE_FILL）：点两两一组，每组是
+ *   一行上的一段像素 [a.x, b.x]（a.y == b.y），即区域的行程编码
+ * - 每条笔画属于一个图层，这里只记图层编号，图层的属性由使用者管理
+ * - 点保存在固定大小的点块（PointChunk）中，点块从 ChunkArena 批量分配：
+ *   追加点时从不移动已有数据，也就没有 std::vector 扩容时的整体拷贝
+ * - Clear() 只重置分配游标，复杂度 O(1)，内存留给后续笔画复用
+ *
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef DRAWING_STROKE_STORE_H
+#define DRAWING_STROKE_STORE_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace drawing {
+
+struct StrokePoint {
+    int x;
+    int y;
+};
+
+// 轴对齐包围盒，right/bottom 为闭区间
+struct StrokeBox {
+    int left;
+    int top;
+    int right;
+    int bottom;
+
+    StrokeBox() : left(1), top(1), right(0), bottom(0) {}  // 空盒
+
+    bool IsEmpty() const { return right < left || bottom < top; }
+
+    void Add(const StrokePoint& pt) {
+        if (IsEmpty()) {
+            left = right = pt.x;
+            top = bottom = pt.y;
+        } else {
+            left = std::min(left, pt.x);
+            top = std::min(top, pt.y);
+            right = std::max(right, pt.x);
+            bottom = std::max(bottom, pt.y);
+        }
+    }
+};
+
+// 颜色按 0xRRGGBB 保存
+struct StrokeStyle {
+    uint32_t colour;
+    int width;
+
+    StrokeStyle() : colour(0), width(1) {}
+    StrokeStyle(uint32_t c, int w) : colour(c), width(w) {}
+    
+    bool operator==(const StrokeStyle& other) const {
+        return colour == other.colour && width == other.width;
+    }
+    // 颜色和宽度拼成一个 64 位键
+    uint64_t Key() const { return (uint64_t(colour) << 32) | uint32_t(width); }
+};
+
+// ==================== 样式表 ====================
+
+typedef uint32_t StyleId;
+
+// 相同的样式只保存一次，编号从 0 开始连续分配，之后不再改变
+class StyleTable {
+public:
+    StyleId Intern(const StrokeStyle& style) {
+        std::unordered_map<uint64_t, StyleId>::iterator it = m_ids.find(style.Key());
+        if (it != m_ids.end()) {
+            return it->second;
+        }
+        StyleId id = static_cast<StyleId>(m_styles.size());
+        m_styles.push_back(style);
+        m_ids.insert(std::make_pair(style.Key(), id));
+        return id;
+    }
+
+    const StrokeStyle& Get(StyleId id) const { return m_styles[id]; }
+    size_t GetCount() const { return m_styles.size(); }
+
+    void Clear() {
+        m_styles.clear();
+        m_ids.clear();
+    }
+
+private:
+    std::vector<StrokeStyle> m_styles;
+    std::unordered_map<uint64_t, StyleId> m_ids;
+};
+
+// ==================== 点块与分配器 ====================
+
+struct PointChunk {
+    static const size_t kCapacity = 256;
+
+    PointChunk* next;
+    size_t count;
+    StrokePoint points[kCapacity];
+};
+
+class ChunkArena {
+public:
+    static const size_t kChunksPerSlab = 64;  // 每块约 128KB
+
+    ChunkArena() : m_slabIndex(0), m_slabCursor(0), m_freeList(NULL) {}
+    ~ChunkArena() {
+        for (size_t i = 0; i < m_slabs.size(); i++) {
+            delete[] m_slabs[i];
+        }
+    }
+
+    PointChunk* Allocate() {
+        PointChunk* chunk = m_freeList;
+        if (chunk) {
+            m_freeList = chunk->next;
+        } else {
+            if (m_slabIndex < m_slabs.size() && m_slabCursor == kChunksPerSlab) {
+                m_slabIndex++;
+                m_slabCursor = 0;
+            }
+            if (m_slabIndex == m_slabs.size()) {
+                m_slabs.push_back(new PointChunk[kChunksPerSlab]);
+                m_slabCursor = 0;
+            }
+            chunk = &m_slabs[m_slabIndex][m_slabCursor++];
+        }
+        chunk->next = NULL;
+        chunk->count = 0;
+        return chunk;
+    }
+
+    // 把 [head, tail] 这条链整体放回空闲链表，O(1)
+    void Release(PointChunk* head, PointChunk* tail) {
+        if (!head) {
+            return;
+        }
+        tail->next = m_freeList;
+        m_freeList = head;
+    }
+
+    // 逻辑上释放全部点块：已申请的内存块保留下来按顺序复用
+    void Reset() {
+        m_slabIndex = 0;
+        m_slabCursor = 0;
+        m_freeList = NULL;
+    }
+
+    size_t GetReservedBytes() const {
+        return m_slabs.size() * kChunksPerSlab * sizeof(PointChunk);
+    }
+
+private:
+    std::vector<PointChunk*> m_slabs;
+    size_t m_slabIndex;
+    size_t m_slabCursor;
+    PointChunk* m_freeList;
+
+    ChunkArena(const ChunkArena&);
+    ChunkArena& operator=(const ChunkArena&);
+};
+
+// ==================== 笔画 ====================
+
+typedef uint32_t StrokeId;
+
+enum StrokeKind {
+    STROKE_LINE,  // 折线，按画笔宽度描边
+    STROKE_FILL   // 填充区域，点两两一组表示一行上的一段，只使用样式的颜色
+};
+
+const int kAllLayers = -1;  // 按图层筛选笔画时表示不筛选
+
+struct Stroke {
+    StyleId style;  // StrokeStore::GetStyle() 取出实际的样式
+    StrokeKind kind;
+    int layer;      // 图层编号，从 0 开始，越大越靠上
+    PointChunk* head;
+    PointChunk* tail;
+    size_t count;
+    StrokeBox bbox;
+    bool erased;
+};
+
+class StrokeStore {
+public:
+    StrokeStore() : m_pointCount(0), m_hiddenPointCount(0) {}
+
+    StrokeId BeginStroke(const StrokeStyle& style, StrokeKind kind = STROKE_LINE) {
+        Stroke stroke;
+        stroke.style = m_styles.Intern(style);
+        stroke.kind = kind;
+        stroke.layer = 0;
+        stroke.head = stroke.tail = NULL;
+        stroke.count = 0;
+        stroke.erased = false;
+        m_strokes.push_back(stroke);
+        return static_cast<StrokeId>(m_strokes.size() - 1);
+    }
+
+    // 先只登记样式和包围盒，点数据之后用 ReplacePoints() 填入（例如按需从文件解码）
+    StrokeId AddPlaceholder(const StrokeStyle& style, const StrokeBox& bbox,
+                            StrokeKind kind = STROKE_LINE) {
+        StrokeId id = BeginStroke(style, kind);
+        m_strokes[id].bbox = bbox;
+        return id;
+    }
+
+    void AppendPoint(StrokeId id, const StrokePoint& pt) {
+        Stroke& stroke = m_strokes[id];
+        if (!stroke.tail || stroke.tail->count == PointChunk::kCapacity) {
+            PointChunk* chunk = m_arena.Allocate();
+            if (stroke.tail) {
+                stroke.tail->next = chunk;
+            } else {
+                stroke.head = chunk;
+            }
+            stroke.tail = chunk;
+        }
+        stroke.tail->points[stroke.tail->count++] = pt;
+        stroke.count++;
+        stroke.bbox.Add(pt);
+        m_pointCount++;
+    }
+
+    // 用新的点序列替换笔画内容（例如提交时的简化结果），样式和 id 不变
+    void ReplacePoints(StrokeId id, const std::vector<StrokePoint>& points) {
+        Stroke& stroke = m_strokes[id];
+        m_arena.Release(stroke.head, stroke.tail);
+        m_pointCount -= stroke.count;
+        stroke.head = stroke.tail = NULL;
+        stroke.count = 0;
+        stroke.bbox = StrokeBox();
+        for (size_t i = 0; i < points.size(); i++) {
+            AppendPoint(id, points[i]);
+        }
+        if (stroke.erased) {
+            // 隐藏的笔画也可能被填入点数据，计入隐藏点数
+            m_pointCount -= stroke.count;
+            m_hiddenPointCount += stroke.count;
+        }
+    }
+
+    void CopyPoints(StrokeId id, std::vector<StrokePoint>& out) const {
+        out.clear();
+        out.reserve(m_strokes[id].count);
+        ForEachChunk(id, [&out](const StrokePoint* points, size_t count) {
+            out.insert(out.end(), points, points + count);
+        });
+    }
+
+    // 擦除只是隐藏，点数据保留下来供撤销时 Restore()；
+    // id 保持不变，后面的笔画 id 不受影响
+    void Erase(StrokeId id) {
+        Stroke& stroke = m_strokes[id];
+        if (stroke.erased) {
+            return;
+        }
+        m_pointCount -= stroke.count;
+        m_hiddenPointCount += stroke.count;
+        stroke.erased = true;
+    }
+
+    void Restore(StrokeId id) {
+        Stroke& stroke = m_strokes[id];
+        if (!stroke.erased) {
+            return;
+        }
+        m_hiddenPointCount -= stroke.count;
+        m_pointCount += stroke.count;
+        stroke.erased = false;
+    }
+
+    // 已擦除、且再也不会被恢复的笔画：点块还给分配器
+    void Release(StrokeId id) {
+        Stroke& stroke = m_strokes[id];
+        if (!stroke.erased || !stroke.head) {
+            return;
+        }
+        m_arena.Release(stroke.head, stroke.tail);
+        m_hiddenPointCount -= stroke.count;
+        stroke.head = stroke.tail = NULL;
+        stroke.count = 0;
+    }
+
+    void SetLayer(StrokeId id, int layer) { m_strokes[id].layer = layer; }
+
+    const Stroke& Get(StrokeId id) const { return m_strokes[id]; }
+    const StrokeStyle& GetStyle(StrokeId id) const { return m_styles.Get(m_strokes[id].style); }
+    size_t GetStyleCount() const { return m_styles.GetCount(); }  // 不同样式的数量
+    bool IsErased(StrokeId id) const { return m_strokes[id].erased; }
+    bool IsFill(StrokeId id) const { return m_strokes[id].kind == STROKE_FILL; }
+    int GetLayer(StrokeId id) const { return m_strokes[id].layer; }
+    size_t GetStrokeCount() const { return m_strokes.size(); }
+    size_t GetPointCount() const { return m_pointCount; }              // 可见笔画的点数
+    size_t GetHiddenPointCount() const { return m_hiddenPointCount; }  // 已擦除但尚未释放的点数
+    size_t GetReservedBytes() const { return m_arena.GetReservedBytes(); }
+
+    // 最后一个点（笔画非空时有效）
+    StrokePoint GetLastPoint(StrokeId id) const {
+        const Stroke& stroke = m_strokes[id];
+        assert(stroke.count > 0);
+        return stroke.tail->points[stroke.tail->count - 1];
+    }
+
+    // 按点块遍历：fn(const StrokePoint* points, size_t count)
+    template <typename Fn>
+    void ForEachChunk(StrokeId id, Fn fn) const {
+        for (const PointChunk* chunk = m_strokes[id].head; chunk; chunk = chunk->next) {
+            fn(chunk->points, chunk->count);
+        }
+    }
+
+    // 按线段遍历，跨点块的线段也会被访问到：fn(const StrokePoint& a, const StrokePoint& b)
+    template <typename Fn>
+    void ForEachSegment(StrokeId id, Fn fn) const {
+        const StrokePoint* prev = NULL;
+        for (const PointChunk* chunk = m_strokes[id].head; chunk; chunk = chunk->next) {
+            for (size_t i = 0; i < chunk->count; i++) {
+                if (prev) {
+                    fn(*prev, chunk->points[i]);
+                }
+                prev = &chunk->points[i];
+            }
+        }
+    }
+
+    // 按段遍历填充区域：fn(const StrokePoint& a, const StrokePoint& b)，a、b 是一段的两端
+    template <typename Fn>
+    void ForEachSpan(StrokeId id, Fn fn) const {
+        const StrokePoint* first = NULL;
+        for (const PointChunk* chunk = m_strokes[id].head; chunk; chunk = chunk->next) {
+            for (size_t i = 0; i < chunk->count; i++) {
+                if (first) {
+                    fn(*first, chunk->points[i]);
+                    first = NULL;
+                } else {
+                    first = &chunk->points[i];
+                }
+            }
+        }
+    }
+
+    // Stroke 可平凡析构，clear() 不逐个析构，和 Reset() 一样是 O(1)
+    void Clear() {
+        m_strokes.clear();
+        m_styles.Clear();
+        m_arena.Reset();
+        m_pointCount = 0;
+        m_hiddenPointCount = 0;
+    }
+
+private:
+    std::vector<Stroke> m_strokes;  // 只保存笔画头，点数据在 m_arena 中
+    StyleTable m_styles;
+    ChunkArena m_arena;
+    size_t m_pointCount;
+    size_t m_hiddenPointCount;
+};
+
+} // namespace drawing
+
+#endif // DRAWING_STROKE_STORE_H
@@ -0,0 +1,182 @@
+/*
+ * 笔画时间轴（custom_draw 的回放使用）
+ *
+ * 记录每条笔画开始 / 结束的时刻和每个点出现的时刻，回放时按时刻 t 定位：
+ * 哪些笔画已经画完，正在画的那条画到了第几个点。
+ *
+ * - 笔画按 id 顺序登记，时刻单调不减，各笔画的开始时刻本身就是有序的时间索引。
+ *   Locate() 先在笔画上二分，再在那条笔画的点时刻上二分，
+ *   拖动进度条到任何位置都是 O(log n)，不需要从头重放
+ * - 时间轴上的时刻不是墙钟时间：两条笔画之间超过 kMaxPlaybackGapMs 的停顿被压缩掉，
+ *   回放不会长时间停在空白上；笔画内部的节奏保持原样
+ * - 点的时刻保存为相对笔画开始的 float 毫秒，每个点 4 字节。笔画提交时经过
+ *   RDP 简化，时刻按同一组 keep 标记压缩，与保存下来的点一一对应
+ * - 形状、填充这类一次生成的笔画整条同时出现；从文件打开的笔画没有时刻，
+ *   按点数估算时长，点在这段时间内均匀出现
+ *
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef DRAWING_STROKE_TIMELINE_H
+#define DRAWING_STROKE_TIMELINE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "stroke_store.h"
+
+namespace drawing {
+
+const double kMaxPlaybackGapMs = 400.0;  // 笔画之间的停顿最多保留这么长
+const double kEstimatedPointMs = 8.0;    // 没有时刻的笔画按每点 8 ms（约 125 Hz 的鼠标）估算
+const double kMaxEstimatedMs = 3000.0;
+
+// 时刻 t 的回放进度：id 小于 stroke 的笔画已经画完，stroke 这条画了 points 个点
+struct PlaybackPosition {
+    size_t stroke;
+    size_t points;
+};
+
+inline bool operator==(const PlaybackPosition& a, const PlaybackPosition& b) {
+    return a.stroke == b.stroke && a.points == b.points;
+}
+
+inline bool operator<(const PlaybackPosition& a, const PlaybackPosition& b) {
+    return a.stroke < b.stroke || (a.stroke == b.stroke && a.points < b.points);
+}
+
+class StrokeTimeline {
+public:
+    StrokeTimeline() : m_lastWall(-1), m_strokeWall(0) {}
+
+    void Clear() {
+        m_entries.clear();
+        m_times.clear();
+        m_lastWall = -1;
+    }
+
+    // 自由绘制：BeginStroke() 登记第一个点，之后每追加一个点调用一次 AddPoint()，
+    // 提交时 EndStroke() 传入简化用的 keep 标记（没有删掉点时传 NULL）
+    void BeginStroke(StrokeId id, double wallMs) {
+        Entry& e = Append(id, wallMs);
+        e.firstTime = uint32_t(m_times.size());
+        e.count = 1;
+        e.timed = true;
+        m_times.push_back(0.0f);
+        m_strokeWall = wallMs;
+    }
+
+    void AddPoint(double wallMs) {
+        Entry& e = m_entries.back();
+        double offset = std::max(double(m_times.back()), wallMs - m_strokeWall);
+        m_times.push_back(float(offset));
+        e.count++;
+        e.end = e.start + offset;
+        m_lastWall = wallMs;
+    }
+
+    void EndStroke(const std::vector<char>* keep) {
+        Entry& e = m_entries.back();
+        if (keep && keep->size() == e.count) {
+            size_t out = e.firstTime;
+            for (size_t i = 0; i < e.count; i++) {
+                if ((*keep)[i]) {
+                    m_times[out++] = m_times[e.firstTime + i];
+                }
+            }
+            e.count = uint32_t(out - e.firstTime);
+            m_times.resize(out);
+        }
+    }
+
+    // 一次生成的笔画：count 个点在 durationMs 内均匀出现，0 表示同时出现。
+    // wallMs < 0 表示没有实际时刻（例如从文件打开），与前一条笔画隔一个固定的停顿
+    void AddStroke(StrokeId id, size_t count, double durationMs, double wallMs = -1) {
+        Entry& e = Append(id, wallMs);
+        e.count = uint32_t(count);
+        e.end = e.start + std::max(0.0, durationMs);
+        if (wallMs >= 0) {
+            m_lastWall = wallMs;
+        }
+    }
+
+    static double EstimateDurationMs(size_t count) {
+        return std::min(kMaxEstimatedMs, count * kEstimatedPointMs);
+    }
+
+    // 二分查找，O(log 笔画数 + log 点数)
+    PlaybackPosition Locate(double t) const {
+        PlaybackPosition pos = { 0, 0 };
+        std::vector<Entry>::const_iterator it = std::upper_bound(
+            m_entries.begin(), m_entries.end(), t,
+            [](double value, const Entry& e) { return value < e.start; });
+        if (it == m_entries.begin()) {
+            return pos;  // 第一条笔画还没开始
+        }
+        size_t k = size_t(it - m_entries.begin()) - 1;
+        const Entry& e = m_entries[k];
+        if (t >= e.end) {
+            pos.stroke = k + 1;
+            return pos;
+        }
+        pos.stroke = k;
+        pos.points = PointsAt(e, t - e.start);
+        return pos;
+    }
+
+    double GetStart(StrokeId id) const { return m_entries[id].start; }
+    double GetEnd(StrokeId id) const { return m_entries[id].end; }
+    double GetDuration() const { return m_entries.empty() ? 0.0 : m_entries.back().end; }
+    size_t GetStrokeCount() const { return m_entries.size(); }
+    size_t GetMemoryBytes() const {
+        return m_entries.capacity() * sizeof(Entry) + m_times.capacity() * sizeof(float);
+    }
+
+private:
+    struct Entry {
+        double start;        // 时间轴上的毫秒
+        double end;
+        uint32_t firstTime;  // 在 m_times 中的起始位置（timed 时有效）
+        uint32_t count;      // 点数
+        bool timed;          // 是否有逐点的时刻，否则按时长均匀分布
+    };
+
+    std::vector<Entry> m_entries;  // 下标就是笔画 id
+    std::vector<float> m_times;    // 各笔画逐点的时刻，相对笔画开始
+    double m_lastWall;             // 上一个事件的墙钟时刻，没有时为 -1
+    double m_strokeWall;           // 正在绘制的笔画开始时的墙钟时刻
+
+    Entry& Append(StrokeId id, double wallMs) {
+        double clock = GetDuration();
+        double gap = kMaxPlaybackGapMs;
+        if (m_entries.empty()) {
+            gap = 0;
+        } else if (wallMs >= 0 && m_lastWall >= 0) {
+            gap = std::min(kMaxPlaybackGapMs, std::max(0.0, wallMs - m_lastWall));
+        }
+        m_lastWall = wallMs;
+
+        // id 总是连续分配的；万一中间有没登记的笔画，让它们在这一刻同时出现
+        Entry e = { clock + gap, clock + gap, 0, 0, false };
+        while (m_entries.size() < size_t(id)) {
+            m_entries.push_back(e);
+        }
+        m_entries.push_back(e);
+        return m_entries.back();
+    }
+
+    size_t PointsAt(const Entry& e, double offset) const {
+        if (e.timed) {
+            const float* first = &m_times[e.firstTime];
+            return size_t(std::upper_bound(first, first + e.count, float(offset)) - first);
+        }
+        double duration = e.end - e.start;
+        return std::min(size_t(e.count), size_t(e.count * offset / duration) + 1);
+    }
+};
+
+} // namespace drawing
+
+#endif // DRAWING_STROKE_TIMELINE_H
@@ -0,0 +1,392 @@
+/*
+ * 流式 SVG 导出（custom_draw 示例使用）
+ *
+ * 与 DrawingWriter 一样边遍历边写：笔画按点块编码成 path 数据，
+ * 经 64KB 缓冲写出，不在内存里拼整个文档。内存占用与笔画数、点数无关。
+ *
+ * - 坐标先换算到输出坐标（(世界坐标 - 导出范围左上角) × scale），再量化成
+ *   precision 位小数的整数；相对坐标是量化后的整数之差，长笔画也不会累积误差
+ * - 数字由 PutFixed() 直接写进缓冲，不经过 printf；末尾的 0 和小数点都省掉，
+ *   负号本身可以分隔数字，所以 "l3 -2 4 5" 写成 "l3-2 4 5"
+ * - 量化后与前一个点重合的点不输出；只有一个点的笔画写成 "l0 0"，
+ *   配合圆形线帽显示成一个圆点
+ * - 填充区域（STROKE_FILL）的行程按 (x0, x1, y) 排好序，x 范围相同的连续行
+ *   合并成一个矩形子路径 "m.. h.. v.. h.. z"
+ * - 图层写成 <g>，不透明度和混合模式分别对应 opacity 和 mix-blend-mode
+ *
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef DRAWING_SVG_WRITER_H
+#define DRAWING_SVG_WRITER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "layers.h"
+#include "stroke_file.h"
+#include "stroke_store.h"
+
+namespace drawing {
+
+// 把 q / 10^precision 写成最短的定点小数，返回写入的字节数（最多 24 字节）
+inline size_t PutFixed(char* out, int64_t q, int precision) {
+    char* p = out;
+    uint64_t v = q < 0 ? uint64_t(0) - uint64_t(q) : uint64_t(q);
+    if (q < 0) {
+        *p++ = '-';
+    }
+    static const uint64_t kPow10[] = { 1, 10, 100, 1000, 10000 };
+    uint64_t whole = v / kPow10[precision];
+    uint64_t frac = v % kPow10[precision];
+
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = char('0' + whole % 10);
+        whole /= 10;
+    } while (whole > 0);
+    while (n > 0) {
+        *p++ = digits[--n];
+    }
+
+    if (frac != 0) {
+        int len = precision;
+        while (frac % 10 == 0) {
+            frac /= 10;
+            len--;
+        }
+        *p++ = '.';
+        for (int i = len - 1; i >= 0; i--) {
+            p[i] = char('0' + frac % 10);
+            frac /= 10;
+        }
+        p += len;
+    }
+    return size_t(p - out);
+}
+
+class SvgWriter {
+public:
+    SvgWriter()
+        : m_file(NULL), m_used(0), m_bytesWritten(0), m_ok(false), m_scale(1), m_unit(1),
+          m_precision(0), m_width(0), m_height(0), m_inPath(false), m_kind(STROKE_LINE),
+          m_pathCount(0), m_pointCount(0) {}
+    ~SvgWriter() {
+        if (m_file) {
+            std::fclose(m_file);
+        }
+    }
+
+    // area 为导出的世界坐标范围，输出尺寸为 area × scale，坐标保留 precision（0-4）位小数
+    bool Open(const PathChar* path, const StrokeBox& area, double scale, int precision = 2) {
+        m_file = OpenFileForWrite(path);
+        if (!m_file) {
+            return false;
+        }
+        m_ok = true;
+        m_buffer.resize(kBufferSize);
+        m_used = 0;
+        m_bytesWritten = 0;
+        m_area = area;
+        m_scale = scale;
+        m_precision = std::max(0, std::min(4, precision));
+        m_unit = std::pow(10.0, m_precision);
+        m_width = Quantize(area.right + 1, area.left);
+        m_height = Quantize(area.bottom + 1, area.top);
+
+        Put("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"");
+        PutNumber(m_width);
+        Put("\" height=\"");
+        PutNumber(m_height);
+        Put("\" viewBox=\"0 0 ");
+        PutNumber(m_width);
+        Put(" ");
+        PutNumber(m_height);
+        Put("\">\n");
+        return m_ok;
+    }
+
+    // 自上而下的线性渐变背景，与画布的背景层一致（不含网格）
+    void WriteBackground(uint32_t top, uint32_t bottom) {
+        Put("<defs><linearGradient id=\"bg\" x1=\"0\" y1=\"0\" x2=\"0\" y2=\"1\">"
+            "<stop offset=\"0\" stop-color=\"");
+        PutColour(top);
+        Put("\"/><stop offset=\"1\" stop-color=\"");
+        PutColour(bottom);
+        Put("\"/></linearGradient></defs>\n<rect width=\"100%\" height=\"100%\" fill=\"url(#bg)\"/>\n");
+    }
+
+    // 图层：opacity 为 0-255
+    void BeginGroup(int opacity, BlendMode blend) {
+        Put("<g");
+        if (opacity < 255) {
+            Put(" opacity=\"");
+            Reserve(32);
+            m_used += PutFixed(&m_buffer[m_used], int64_t(opacity) * 1000 / 255, 3);
+            Put("\"");
+        }
+        if (blend == BLEND_MULTIPLY) {
+            Put(" style=\"mix-blend-mode:multiply\"");
+        } else if (blend == BLEND_SCREEN) {
+            Put(" style=\"mix-blend-mode:screen\"");
+        }
+        Put(">\n");
+    }
+
+    void EndGroup() { Put("</g>\n"); }
+
+    // 一条笔画分三步写：BeginPath()，一次或多次 AddPoints()（例如每个点块一次），EndPath()
+    void BeginPath(const StrokeStyle& style, StrokeKind kind) {
+        m_kind = kind;
+        m_inPath = true;
+        m_havePoint = false;
+        m_haveRun = false;
+        m_halfSpan = false;
+        m_pointsInPath = 0;
+        m_pathCount++;
+        if (kind == STROKE_FILL) {
+            Put("<path fill=\"");
+            PutColour(style.colour);
+            Put("\" shape-rendering=\"crispEdges\" d=\"");
+            return;
+        }
+        Put("<path fill=\"none\" stroke=\"");
+        PutColour(style.colour);
+        Put("\" stroke-width=\"");
+        PutNumber(Quantize(style.width, 0));
+        Put("\" stroke-linecap=\"round\" stroke-linejoin=\"round\" d=\"");
+    }
+
+    void AddPoints(const StrokePoint* points, size_t count) {
+        m_pointCount += count;
+        if (m_kind == STROKE_FILL) {
+            for (size_t i = 0; i < count; i++) {
+                AddSpanPoint(points[i]);
+            }
+            return;
+        }
+        for (size_t i = 0; i < count; i++) {
+            int64_t x = Quantize(points[i].x, m_area.left);
+            int64_t y = Quantize(points[i].y, m_area.top);
+            if (!m_havePoint) {
+                Reserve(64);
+                m_buffer[m_used++] = 'M';
+                m_needSpace = false;
+                PutCoordinate(x);
+                PutCoordinate(y);
+                m_buffer[m_used++] = 'l';
+                m_havePoint = true;
+                m_needSpace = false;
+            } else if (x != m_lastX || y != m_lastY) {
+                Reserve(64);
+                PutCoordinate(x - m_lastX);
+                PutCoordinate(y - m_lastY);
+                m_pointsInPath++;
+            }
+            m_lastX = x;
+            m_lastY = y;
+        }
+    }
+
+    void EndPath() {
+        if (!m_inPath) {
+            return;
+        }
+        if (m_kind == STROKE_FILL) {
+            FlushRun();
+        } else if (m_havePoint && m_pointsInPath == 0) {
+            Put("0 0");  // 只有一个点：零长度线段显示成圆点
+        }
+        Put("\"/>\n");
+        m_inPath = false;
+    }
+
+    void WriteStroke(const StrokeStore& store, StrokeId id) {
+        BeginPath(store.GetStyle(id), store.Get(id).kind);
+        store.ForEachChunk(id, [this](const StrokePoint* points, size_t count) {
+            AddPoints(points, count);
+        });
+        EndPath();
+    }
+
+    // 写出结尾并关闭文件；中间任何一次写入失败都会返回 false
+    bool Close() {
+        if (!m_file) {
+            return false;
+        }
+        EndPath();
+        Put("</svg>\n");
+        Flush();
+        if (std::fclose(m_file) != 0) {
+            m_ok = false;
+        }
+        m_file = NULL;
+        return m_ok;
+    }
+
+    uint64_t GetBytesWritten() const { return m_bytesWritten + m_used; }
+    size_t GetPathCount() const { return m_pathCount; }
+    uint64_t GetPointCount() const { return m_pointCount; }
+
+private:
+    static const size_t kBufferSize = 64 * 1024;
+
+    std::FILE* m_file;
+    std::vector<char> m_buffer;
+    size_t m_used;
+    uint64_t m_bytesWritten;
+    bool m_ok;
+
+    StrokeBox m_area;
+    double m_scale;
+    double m_unit;      // 10^precision
+    int m_precision;
+    int64_t m_width;    // 量化后的输出尺寸
+    int64_t m_height;
+
+    // 当前 path 的状态
+    bool m_inPath;
+    StrokeKind m_kind;
+    bool m_havePoint;
+    bool m_needSpace;   // 下一个非负数之前要不要空格
+    int64_t m_lastX;    // 上一个点（量化后），相对坐标以它为基准
+    int64_t m_lastY;
+    size_t m_pointsInPath;
+    bool m_halfSpan;    // 已经收到一段的左端
+    StrokePoint m_spanStart;
+    bool m_haveRun;     // 正在合并的矩形 [x0, x1] × [y0, y1]
+    StrokePoint m_runMin;
+    StrokePoint m_runMax;
+
+    size_t m_pathCount;
+    uint64_t m_pointCount;
+
+    // 世界坐标 v 相对 origin 换算到输出坐标，以 10^-precision 为单位
+    int64_t Quantize(int v, int origin) const {
+        return int64_t(std::floor((double(v) - origin) * m_scale * m_unit + 0.5));
+    }
+
+    void PutNumber(int64_t q) {
+        Reserve(32);
+        m_used += PutFixed(&m_buffer[m_used], q, m_precision);
+    }
+
+    // path 数据里的数：负号可以代替分隔符
+    void PutCoordinate(int64_t q) {
+        if (q >= 0 && m_needSpace) {
+            m_buffer[m_used++] = ' ';
+        }
+        m_used += PutFixed(&m_buffer[m_used], q, m_precision);
+        m_needSpace = true;
+    }
+
+    void PutColour(uint32_t colour) {
+        static const char kHex[] = "0123456789abcdef";
+        Reserve(8);
+        m_buffer[m_used++] = '#';
+        for (int shift = 20; shift >= 0; shift -= 4) {
+            m_buffer[m_used++] = kHex[(colour >> shift) & 0xF];
+        }
+    }
+
+    void AddSpanPoint(const StrokePoint& pt) {
+        if (!m_halfSpan) {
+            m_spanStart = pt;
+            m_halfSpan = true;
+            return;
+        }
+        m_halfSpan = false;
+        int x0 = std::min(m_spanStart.x, pt.x), x1 = std::max(m_spanStart.x, pt.x);
+        int y = m_spanStart.y;
+        if (m_haveRun && x0 == m_runMin.x && x1 == m_runMax.x && y == m_runMax.y + 1) {
+            m_runMax.y = y;
+            return;
+        }
+        FlushRun();
+        m_runMin.x = x0;
+        m_runMin.y = y;
+        m_runMax.x = x1;
+        m_runMax.y = y;
+        m_haveRun = true;
+    }
+
+    // 矩形写成一个闭合子路径；z 之后当前点回到子路径起点（左上角），
+    // 下一个矩形用相对移动 m 接上
+    void FlushRun() {
+        if (!m_haveRun) {
+            return;
+        }
+        m_haveRun = false;
+        int64_t left = Quantize(m_runMin.x, m_area.left);
+        int64_t top = Quantize(m_runMin.y, m_area.top);
+        int64_t width = Quantize(m_runMax.x + 1, m_area.left) - left;
+        int64_t height = Quantize(m_runMax.y + 1, m_area.top) - top;
+
+        Reserve(160);
+        m_needSpace = false;
+        if (!m_havePoint) {
+            m_buffer[m_used++] = 'M';
+            PutCoordinate(left);
+            PutCoordinate(top);
+            m_havePoint = true;
+        } else {
+            m_buffer[m_used++] = 'm';
+            PutCoordinate(left - m_lastX);
+            PutCoordinate(top - m_lastY);
+        }
+        m_lastX = left;
+        m_lastY = top;
+        m_buffer[m_used++] = 'h';
+        m_needSpace = false;
+        PutCoordinate(width);
+        m_buffer[m_used++] = 'v';
+        m_needSpace = false;
+        PutCoordinate(height);
+        m_buffer[m_used++] = 'h';
+        m_needSpace = false;
+        PutCoordinate(-width);
+        m_buffer[m_used++] = 'z';
+    }
+
+    void Put(const char* text) {
+        size_t size = strlen(text);
+        while (size > 0) {
+            Reserve(1);
+            size_t n = std::min(size, m_buffer.size() - m_used);
+            memcpy(&m_buffer[m_used], text, n);
+            m_used += n;
+            text += n;
+            size -= n;
+        }
+    }
+
+    void Reserve(size_t bytes) {
+        if (m_used + bytes > m_buffer.size()) {
+            Flush();
+        }
+    }
+
+    void Flush() {
+        if (m_used > 0 && m_ok) {
+            if (std::fwrite(&m_buffer[0], 1, m_used, m_file) != m_used) {
+                m_ok = false;
+            }
+        }
+        m_bytesWritten += m_used;
+        m_used = 0;
+    }
+
+    SvgWriter(const SvgWriter&);
+    SvgWriter& operator=(const SvgWriter&);
+};
+
+} // namespace drawing
+
+#endif // DRAWING_SVG_WRITER_H
@@ -0,0 +1,450 @@
+/*
+ * 多线程分块软件光栅化（custom_draw 示例使用）
+ *
+ * 画布按 tileSize 切成方块，每个需要重画的块是一个独立任务：
+ * 调用线程先用空间索引把笔画分到各个块里（分箱），再由工作线程池
+ * 并行地把每个块光栅化到自己的 RGB 缓冲里（和 wxImage 的数据布局相同），
+ * 最后由调用线程把结果拷贝到屏幕。
+ *
+ * 粗线按像素中心到线段的距离计算覆盖率，得到抗锯齿的边缘。同一笔画
+ * 内各线段的覆盖率先在遮罩里取最大值再混合，转角处不会因为重复混合而变深。
+ *
+ * 块的坐标是屏幕坐标，笔画经视图变换（ViewTransform）映射到屏幕；
+ * 缩小时可以改用 StrokeLod 中已经生成的简化版本。
+ *
+ * 背景设为透明时，块的输出是预乘 alpha 的 RGBA，用来单独光栅化一个图层，
+ * 再由 layers.h 的合成器叠加。
+ *
+ * 光栅化期间只读访问 StrokeStore，调用线程会阻塞等待全部块完成。
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef DRAWING_TILE_RENDERER_H
+#define DRAWING_TILE_RENDERER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "stroke_store.h"
+#include "spatial_grid.h"
+#include "stroke_lod.h"
+#include "viewport.h"
+
+namespace drawing {
+
+// ==================== 工作线程池 ====================
+
+class WorkerPool {
+public:
+    // threads 为 0 时使用 CPU 核数减一（调用线程自己也参与计算）
+    explicit WorkerPool(unsigned threads = 0)
+        : m_fn(NULL), m_count(0), m_next(0), m_active(0), m_generation(0), m_stop(false) {
+        if (threads == 0) {
+            unsigned cores = std::thread::hardware_concurrency();
+            threads = cores > 1 ? cores - 1 : 0;
+        }
+        for (unsigned i = 0; i < threads; i++) {
+            m_threads.push_back(std::thread(&WorkerPool::WorkerMain, this));
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (size_t i = 0; i < m_threads.size(); i++) {
+            m_threads[i].join();
+        }
+    }
+
+    unsigned GetThreadCount() const { return unsigned(m_threads.size()) + 1; }
+
+    // 并行执行 fn(0) ... fn(count - 1)，全部完成后才返回
+    void ParallelFor(size_t count, const std::function<void(size_t)>& fn) {
+        if (count == 0) {
+            return;
+        }
+        if (m_threads.empty() || count == 1) {
+            for (size_t i = 0; i < count; i++) {
+                fn(i);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_fn = &fn;
+            m_count = count;
+            m_next = 0;
+            m_active = m_threads.size();
+            m_generation++;
+        }
+        m_wake.notify_all();
+
+        RunItems();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_active != 0) {
+            m_done.wait(lock);
+        }
+        m_fn = NULL;
+    }
+
+private:
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+
+    const std::function<void(size_t)>* m_fn;
+    size_t m_count;
+    std::atomic<size_t> m_next;
+    size_t m_active;            // 本轮还没做完的工作线程数
+    unsigned long m_generation;  // 每轮任务加一，用来唤醒工作线程
+    bool m_stop;
+
+    void RunItems() {
+        for (;;) {
+            size_t i = m_next.fetch_add(1);
+            if (i >= m_count) {
+                break;
+            }
+            (*m_fn)(i);
+        }
+    }
+
+    void WorkerMain() {
+        unsigned long seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                while (!m_stop && m_generation == seen) {
+                    m_wake.wait(lock);
+                }
+                if (m_stop) {
+                    return;
+                }
+                seen = m_generation;
+            }
+
+            RunItems();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_active == 0) {
+                m_done.notify_one();
+            }
+        }
+    }
+
+    WorkerPool(const WorkerPool&);
+    WorkerPool& operator=(const WorkerPool&);
+};
+
+// ==================== 分块光栅化 ====================
+
+struct TileJob {
+    int x;  // 块在画布上的位置和大小
+    int y;
+    int width;
+    int height;
+    std::vector<StrokeId> strokes;  // 分到这个块的笔画，按绘制顺序
+    std::vector<unsigned char> rgb;  // 输出：width * height * 3 字节；透明背景时为预乘的 RGBA，4 字节
+};
+
+class TileRenderer {
+public:
+    explicit TileRenderer(int tileSize = 256, unsigned threads = 0)
+        : m_tileSize(tileSize), m_pool(threads), m_bgWidth(0), m_bgHeight(0),
+          m_transparent(false), m_lod(NULL), m_lodLevel(0) {}
+
+    int GetTileSize() const { return m_tileSize; }
+    unsigned GetThreadCount() const { return m_pool.GetThreadCount(); }
+
+    // 整块画布的背景（RGB，每行 width * 3 字节），尺寸或主题变化时重新设置
+    void SetBackground(const unsigned char* rgb, int width, int height) {
+        m_background.assign(rgb, rgb + size_t(width) * height * 3);
+        m_bgWidth = width;
+        m_bgHeight = height;
+        m_filler = RowFiller();
+        m_transparent = false;
+    }
+
+    bool HasBackground(int width, int height) const {
+        return !m_background.empty() && m_bgWidth == width && m_bgHeight == height;
+    }
+
+    // 不保存整张背景，而是按行现场生成（例如导出大图时的渐变）。
+    // filler(x, y, width, rgb) 写出第 y 行从 x 开始的 width 个像素，会在多个线程上同时调用
+    typedef std::function<void(int, int, int, unsigned char*)> RowFiller;
+    void SetBackgroundFiller(const RowFiller& filler) {
+        m_background.clear();
+        m_bgWidth = m_bgHeight = 0;
+        m_filler = filler;
+        m_transparent = false;
+    }
+
+    // 没有背景：块清成全透明，输出预乘 alpha 的 RGBA（每像素 4 字节）
+    void SetTransparentBackground() {
+        m_background.clear();
+        m_bgWidth = m_bgHeight = 0;
+        m_filler = RowFiller();
+        m_transparent = true;
+    }
+
+    int GetChannels() const { return m_transparent ? 4 : 3; }
+
+    // 视图变换和细节级别。lod 中 level 级别没有生成的笔画使用原始点，
+    // 所以调用方应当在 Render() 之前先为要画的笔画生成好
+    void SetView(const ViewTransform& view, const StrokeLod* lod, int level) {
+        m_view = view;
+        m_lod = lod;
+        m_lodLevel = level;
+    }
+
+    // 把 area 切成与块网格对齐的任务，并用索引把笔画分箱。
+    // extra 中的笔画（例如还没进入索引的当前笔画）会被分到所有相交的块；
+    // layer 不是 kAllLayers 时只要这个图层上的笔画
+    void PrepareJobs(const StrokeBox& area, const StrokeStore& store, SpatialGrid& index,
+                     const std::vector<StrokeId>& extra, std::vector<TileJob>& jobs,
+                     int layer = kAllLayers) {
+        jobs.clear();
+        if (area.IsEmpty()) {
+            return;
+        }
+
+        int tx0 = FloorDiv(area.left), ty0 = FloorDiv(area.top);
+        int tx1 = FloorDiv(area.right), ty1 = FloorDiv(area.bottom);
+        for (int ty = ty0; ty <= ty1; ty++) {
+            for (int tx = tx0; tx <= tx1; tx++) {
+                TileJob job;
+                job.x = std::max(tx * m_tileSize, area.left);
+                job.y = std::max(ty * m_tileSize, area.top);
+                job.width = std::min((tx + 1) * m_tileSize - 1, area.right) - job.x + 1;
+                job.height = std::min((ty + 1) * m_tileSize - 1, area.bottom) - job.y + 1;
+
+                StrokeBox tileBox = JobBox(job);
+                index.Query(m_view.ToWorld(tileBox), m_queryIds);
+                for (size_t i = 0; i < m_queryIds.size(); i++) {
+                    StrokeId id = m_queryIds[i];
+                    if (layer != kAllLayers && store.GetLayer(id) != layer) {
+                        continue;
+                    }
+                    if (!store.IsErased(id) && BoxesIntersect(m_view.PaintedBox(store, id), tileBox)) {
+                        job.strokes.push_back(id);
+                    }
+                }
+                for (size_t i = 0; i < extra.size(); i++) {
+                    if (layer != kAllLayers && store.GetLayer(extra[i]) != layer) {
+                        continue;
+                    }
+                    if (BoxesIntersect(m_view.PaintedBox(store, extra[i]), tileBox)) {
+                        job.strokes.push_back(extra[i]);
+                    }
+                }
+                jobs.push_back(job);
+            }
+        }
+    }
+
+    // 在线程池上并行光栅化全部任务
+    void Render(const StrokeStore& store, std::vector<TileJob>& jobs) {
+        size_t n = jobs.size();
+        std::function<void(size_t)> fn = [this, &store, &jobs](size_t i) {
+            RasterizeTile(store, jobs[i]);
+        };
+        m_pool.ParallelFor(n, fn);
+    }
+
+private:
+    int m_tileSize;
+    WorkerPool m_pool;
+    std::vector<unsigned char> m_background;
+    int m_bgWidth;
+    int m_bgHeight;
+    RowFiller m_filler;
+    bool m_transparent;
+    ViewTransform m_view;
+    const StrokeLod* m_lod;
+    int m_lodLevel;
+    std::vector<StrokeId> m_queryIds;
+
+    int FloorDiv(int v) const {
+        return v >= 0 ? v / m_tileSize : -((-v + m_tileSize - 1) / m_tileSize);
+    }
+
+    static StrokeBox JobBox(const TileJob& job) {
+        StrokeBox box;
+        box.left = job.x;
+        box.top = job.y;
+        box.right = job.x + job.width - 1;
+        box.bottom = job.y + job.height - 1;
+        return box;
+    }
+
+    void FillBackground(TileJob& job) const {
+        if (m_transparent) {
+            job.rgb.assign(size_t(job.width) * job.height * 4, 0);
+            return;
+        }
+        job.rgb.resize(size_t(job.width) * job.height * 3);
+        for (int row = 0; row < job.height; row++) {
+            unsigned char* dst = &job.rgb[size_t(row) * job.width * 3];
+            int y = job.y + row;
+            if (y >= 0 && y < m_bgHeight && job.x >= 0 && job.x + job.width <= m_bgWidth) {
+                const unsigned char* src = &m_background[(size_t(y) * m_bgWidth + job.x) * 3];
+                memcpy(dst, src, size_t(job.width) * 3);
+            } else if (m_filler) {
+                m_filler(job.x, y, job.width, dst);
+            } else {
+                memset(dst, 0xFF, size_t(job.width) * 3);  // 超出背景的部分填白色
+            }
+        }
+    }
+
+    void RasterizeTile(const StrokeStore& store, TileJob& job) const {
+        FillBackground(job);
+        if (job.strokes.empty()) {
+            return;
+        }
+
+        // 覆盖率遮罩放在线程本地，每个线程复用自己的一份
+        static thread_local std::vector<float> mask;
+        mask.assign(size_t(job.width) * job.height, 0.0f);
+        StrokeBox tileBox = JobBox(job);
+
+        for (size_t s = 0; s < job.strokes.size(); s++) {
+            const StrokeStyle& style = store.GetStyle(job.strokes[s]);
+            StrokeBox box = m_view.PaintedBox(store, job.strokes[s]);
+            box.left = std::max(box.left, tileBox.left);
+            box.top = std::max(box.top, tileBox.top);
+            box.right = std::min(box.right, tileBox.right);
+            box.bottom = std::min(box.bottom, tileBox.bottom);
+            if (box.IsEmpty()) {
+                continue;
+            }
+
+            if (store.IsFill(job.strokes[s])) {
+                store.ForEachSpan(job.strokes[s], [&](const StrokePoint& a, const StrokePoint& b) {
+                    CoverSpan(a, b, box, job, mask);
+                });
+                BlendMask(style.colour, box, job, mask, GetChannels());
+                continue;
+            }
+
+            double halfWidth = std::max(0.5, m_view.ScaleWidth(style.width) / 2.0);
+            ForEachScreenSegment(store, job.strokes[s], [&](const StrokePoint& a, const StrokePoint& b) {
+                CoverSegment(a, b, halfWidth, box, job, mask);
+            });
+            BlendMask(style.colour, box, job, mask, GetChannels());
+        }
+    }
+
+    // 按屏幕坐标遍历笔画的线段，只有一个点的笔画给出一条退化线段
+    template <typename F>
+    void ForEachScreenSegment(const StrokeStore& store, StrokeId id, F f) const {
+        const std::vector<StrokePoint>* lod = m_lod ? m_lod->Find(id, m_lodLevel) : NULL;
+        if (lod) {
+            const std::vector<StrokePoint>& pts = *lod;
+            if (pts.size() == 1) {
+                StrokePoint p = m_view.ToScreen(pts[0]);
+                f(p, p);
+            }
+            for (size_t i = 1; i < pts.size(); i++) {
+                f(m_view.ToScreen(pts[i - 1]), m_view.ToScreen(pts[i]));
+            }
+            return;
+        }
+        if (store.Get(id).count == 1) {
+            StrokePoint p = m_view.ToScreen(store.GetLastPoint(id));
+            f(p, p);
+            return;
+        }
+        store.ForEachSegment(id, [&](const StrokePoint& a, const StrokePoint& b) {
+            f(m_view.ToScreen(a), m_view.ToScreen(b));
+        });
+    }
+
+    // 把线段的覆盖率（取最大值）写入遮罩，clip 为本笔画在块内的范围
+    static void CoverSegment(const StrokePoint& a, const StrokePoint& b, double halfWidth,
+                             const StrokeBox& clip, const TileJob& job, std::vector<float>& mask) {
+        int reach = int(std::ceil(halfWidth)) + 1;
+        int x0 = std::max(std::min(a.x, b.x) - reach, clip.left);
+        int x1 = std::min(std::max(a.x, b.x) + reach, clip.right);
+        int y0 = std::max(std::min(a.y, b.y) - reach, clip.top);
+        int y1 = std::min(std::max(a.y, b.y) + reach, clip.bottom);
+
+        double outer = (halfWidth + 0.5) * (halfWidth + 0.5);
+        for (int y = y0; y <= y1; y++) {
+            float* row = &mask[size_t(y - job.y) * job.width];
+            for (int x = x0; x <= x1; x++) {
+                double d2 = DistanceToSegmentSq(x, y, a, b);
+                if (d2 >= outer) {
+                    continue;
+                }
+                // 距离 d 处的覆盖率：中心全覆盖，边缘一个像素宽的线性过渡
+                float cov = float(std::min(1.0, halfWidth + 0.5 - std::sqrt(d2)));
+                float& m = row[x - job.x];
+                if (cov > m) {
+                    m = cov;
+                }
+            }
+        }
+    }
+
+    // 填充区域的一段（世界坐标）放大后覆盖的像素全覆盖，没有抗锯齿
+    void CoverSpan(const StrokePoint& a, const StrokePoint& b, const StrokeBox& clip,
+                   const TileJob& job, std::vector<float>& mask) const {
+        StrokeBox span;
+        span.Add(a);
+        span.Add(b);
+        span = m_view.SpanBox(span);
+        int x0 = std::max(span.left, clip.left), x1 = std::min(span.right, clip.right);
+        int y0 = std::max(span.top, clip.top), y1 = std::min(span.bottom, clip.bottom);
+        for (int y = y0; y <= y1; y++) {
+            float* row = &mask[size_t(y - job.y) * job.width];
+            std::fill(row + (x0 - job.x), row + (x1 - job.x + 1), 1.0f);
+        }
+    }
+
+    // 按遮罩把颜色混合到块上，同时清零遮罩供下一条笔画使用。
+    // 预乘的 RGBA 用同一个公式：颜色分量趋向 colour × 覆盖率，alpha 趋向 255
+    static void BlendMask(uint32_t colour, const StrokeBox& box,
+                          TileJob& job, std::vector<float>& mask, int channels) {
+        float r = float((colour >> 16) & 0xFF);
+        float g = float((colour >> 8) & 0xFF);
+        float b = float(colour & 0xFF);
+
+        for (int y = box.top; y <= box.bottom; y++) {
+            float* m = &mask[size_t(y - job.y) * job.width];
+            unsigned char* px = &job.rgb[(size_t(y - job.y) * job.width) * channels];
+            for (int x = box.left; x <= box.right; x++) {
+                float cov = m[x - job.x];
+                if (cov <= 0.0f) {
+                    continue;
+                }
+                m[x - job.x] = 0.0f;
+                unsigned char* p = px + size_t(x - job.x) * channels;
+                p[0] = (unsigned char)(p[0] + (r - p[0]) * cov + 0.5f);
+                p[1] = (unsigned char)(p[1] + (g - p[1]) * cov + 0.5f);
+                p[2] = (unsigned char)(p[2] + (b - p[2]) * cov + 0.5f);
+                if (channels == 4) {
+                    p[3] = (unsigned char)(p[3] + (255.0f - p[3]) * cov + 0.5f);
+                }
+            }
+        }
+    }
+};
+
+} // namespace drawing
+
+#endif // DRAWING_TILE_RENDERER_H
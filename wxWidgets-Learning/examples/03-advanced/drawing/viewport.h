@@ -0,0 +1,113 @@
+/*
+ * 视图变换：世界坐标（笔画保存的坐标）与屏幕坐标之间的缩放和平移
+ *
+ *   屏幕 = (世界 - origin) * scale
+ *
+ * 笔画始终以世界坐标保存，缩放和平移只改变这里的三个数，不修改任何点。
+ *
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef DRAWING_VIEWPORT_H
+#define DRAWING_VIEWPORT_H
+
+#include <algorithm>
+#include <cmath>
+
+#include "stroke_store.h"
+
+namespace drawing {
+
+struct ViewTransform {
+    double scale;    // 每个世界单位对应的屏幕像素数
+    double originX;  // 屏幕左上角对应的世界坐标
+    double originY;
+
+    ViewTransform() : scale(1.0), originX(0.0), originY(0.0) {}
+
+    bool IsIdentity() const { return scale == 1.0 && originX == 0.0 && originY == 0.0; }
+
+    StrokePoint ToScreen(const StrokePoint& p) const {
+        StrokePoint s = {
+            int(std::floor((p.x - originX) * scale + 0.5)),
+            int(std::floor((p.y - originY) * scale + 0.5))
+        };
+        return s;
+    }
+
+    StrokePoint ToWorld(int sx, int sy) const {
+        StrokePoint w = {
+            int(std::floor(sx / scale + originX + 0.5)),
+            int(std::floor(sy / scale + originY + 0.5))
+        };
+        return w;
+    }
+
+    // 画笔宽度也随缩放变化，但至少一个像素
+    int ScaleWidth(int width) const {
+        return std::max(1, int(std::floor(width * scale + 0.5)));
+    }
+
+    // 世界坐标的包围盒在屏幕上覆盖的范围
+    StrokeBox ToScreen(const StrokeBox& box) const {
+        if (box.IsEmpty()) {
+            return box;
+        }
+        StrokePoint a = { box.left, box.top };
+        StrokePoint b = { box.right, box.bottom };
+        StrokeBox r;
+        r.Add(ToScreen(a));
+        r.Add(ToScreen(b));
+        return r;
+    }
+
+    // 屏幕矩形覆盖的世界范围（向外取整，保证不漏掉笔画）
+    StrokeBox ToWorld(const StrokeBox& box) const {
+        if (box.IsEmpty()) {
+            return box;
+        }
+        StrokeBox r;
+        r.left = int(std::floor(box.left / scale + originX)) - 1;
+        r.top = int(std::floor(box.top / scale + originY)) - 1;
+        r.right = int(std::ceil((box.right + 1) / scale + originX)) + 1;
+        r.bottom = int(std::ceil((box.bottom + 1) / scale + originY)) + 1;
+        return r;
+    }
+
+    // 世界坐标中一块像素（闭区间）放大后覆盖的屏幕像素，相邻的块拼在一起没有缝隙。
+    // 缩小后不足一个像素的按一个像素算
+    StrokeBox SpanBox(const StrokeBox& box) const {
+        if (box.IsEmpty()) {
+            return box;
+        }
+        StrokePoint a = { box.left, box.top };
+        StrokePoint b = { box.right + 1, box.bottom + 1 };
+        StrokePoint sa = ToScreen(a), sb = ToScreen(b);
+        StrokeBox r;
+        r.left = sa.x;
+        r.top = sa.y;
+        r.right = std::max(sa.x, sb.x - 1);
+        r.bottom = std::max(sa.y, sb.y - 1);
+        return r;
+    }
+
+    // 笔画在屏幕上实际覆盖的范围：点的包围盒加上缩放后的半个画笔宽度
+    StrokeBox PaintedBox(const StrokeStore& store, StrokeId id) const {
+        if (store.IsFill(id)) {
+            return SpanBox(store.Get(id).bbox);
+        }
+        StrokeBox r = ToScreen(store.Get(id).bbox);
+        int d = ScaleWidth(store.GetStyle(id).width) / 2 + 1;
+        if (!r.IsEmpty()) {
+            r.left -= d;
+            r.top -= d;
+            r.right += d;
+            r.bottom += d;
+        }
+        return r;
+    }
+};
+
+} // namespace drawing
+
+#endif // DRAWING_VIEWPORT_H
@@ -0,0 +1,86 @@
+/*
+ * 后台行索引（text_editor 打开大文件时使用）
+ *
+ * 片段表里每个片段都要知道自己有几个换行，打开几个 GB 的文件时把它们全部数完
+ * 要把整个文件从磁盘读一遍。这里把数换行拆成按块推进：
+ *
+ * - 文件按 PieceTable::kMaxOriginalPiece 分块，正好是打开后原始片段的大小
+ * - 一个线程反复调用 Advance() 往后数，其他线程随时可以取走已经数好的块，
+ *   用 PieceTable::AppendOriginal() 接到文档末尾
+ * - 计数先写进数组，再用 release 更新已完成的块数；读取方 acquire 读到块数后，
+ *   前面这些块的计数一定可见，不需要加锁
+ *
+ * 文件内容只被读取、不被复制；内存映射的文件只有数到的页才由操作系统读入。
+ *
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef EDITOR_LINE_INDEX_H
+#define EDITOR_LINE_INDEX_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "piece_table.h"
+
+namespace editor {
+
+class LineIndexBuilder {
+public:
+    static const size_t kChunkSize = PieceTable::kMaxOriginalPiece;
+
+    explicit LineIndexBuilder(const std::shared_ptr<const TextSource>& source)
+        : m_source(source),
+          m_lineFeeds((source->GetSize() + kChunkSize - 1) / kChunkSize),
+          m_ready(0), m_cancel(false) {}
+
+    // 只能在一个线程上调用：再数最多 maxChunks 块，返回是否已经全部数完
+    bool Advance(size_t maxChunks) {
+        const char* data = m_source->GetData();
+        size_t chunk = m_ready.load(std::memory_order_relaxed);
+        size_t end = std::min(m_lineFeeds.size(), chunk + maxChunks);
+        for (; chunk < end; chunk++) {
+            if (m_cancel.load(std::memory_order_relaxed)) {
+                break;
+            }
+            m_lineFeeds[chunk] = uint32_t(CountLineFeeds(data + GetChunkOffset(chunk),
+                                                         GetChunkLength(chunk)));
+            m_ready.store(chunk + 1, std::memory_order_release);
+        }
+        return IsDone();
+    }
+
+    void Cancel() { m_cancel = true; }
+    bool IsCancelled() const { return m_cancel; }
+    bool IsDone() const { return GetReadyChunks() == m_lineFeeds.size(); }
+
+    size_t GetChunkCount() const { return m_lineFeeds.size(); }
+    size_t GetReadyChunks() const { return m_ready.load(std::memory_order_acquire); }
+    int GetPercent() const {
+        return m_lineFeeds.empty() ? 100 : int(uint64_t(GetReadyChunks()) * 100 / m_lineFeeds.size());
+    }
+
+    // 以下只对 chunk < GetReadyChunks() 的块有效
+    size_t GetChunkOffset(size_t chunk) const { return chunk * kChunkSize; }
+    size_t GetChunkLength(size_t chunk) const {
+        return std::min(size_t(kChunkSize), m_source->GetSize() - GetChunkOffset(chunk));
+    }
+    size_t GetLineFeeds(size_t chunk) const { return m_lineFeeds[chunk]; }
+
+private:
+    std::shared_ptr<const TextSource> m_source;  // 保证数换行期间内容一直有效
+    std::vector<uint32_t> m_lineFeeds;           // 每块的换行数，一块最多 64KB
+    std::atomic<size_t> m_ready;                 // 已经数好的块数
+    std::atomic<bool> m_cancel;
+
+    LineIndexBuilder(const LineIndexBuilder&);
+    LineIndexBuilder& operator=(const LineIndexBuilder&);
+};
+
+} // namespace editor
+
+#endif // EDITOR_LINE_INDEX_H
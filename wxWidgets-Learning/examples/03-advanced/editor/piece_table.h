@@ -0,0 +1,542 @@
+/*
+ * 片段表文档模型（text_editor 示例使用）
+ *
+ * 文档不保存成一整块文本，而是一串"片段"（piece），每个片段指向两块只读内存之一：
+ *
+ *   原始文件    打开时的内容（TextSource），只引用、不复制，也从不修改
+ *   追加缓冲    之后输入的所有文字，只在末尾追加（AddBuffer）
+ *
+ * 插入 = 把文字追加到追加缓冲，再在插入点把片段切开、放进一个新片段；
+ * 删除 = 切掉一段片段。两种操作都不移动已有的文字。
+ *
+ * 片段按文档顺序放在一棵平衡树（treap）里，每个节点汇总子树的字节数和换行数：
+ * - 按偏移或行号定位、插入、删除都是 O(log n)，n 为片段数
+ * - 树是持久化的：修改时只复制从根到修改点的路径，其余节点新旧版本共用。
+ *   所以复制一个 PieceTable 就是取快照，O(1)，撤销历史和后台保存都直接持有快照
+ * - 原始文件按 kMaxOriginalPiece 切成多个片段，在片段内部查找第几个换行时
+ *   最多扫描这么长，与文件大小无关
+ *
+ * 追加缓冲分块分配，块的地址不变，片段直接保存指针。快照可以交给别的线程只读：
+ * 它引用的字节在取快照之前就已经写好，之后只会在后面追加。
+ * 修改只能在一个线程上进行。
+ *
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef EDITOR_PIECE_TABLE_H
+#define EDITOR_PIECE_TABLE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace editor {
+
+// 原始文件的内容：只读，地址在整个生命周期内不变
+class TextSource {
+public:
+    virtual ~TextSource() {}
+    virtual const char* GetData() const = 0;
+    virtual size_t GetSize() const = 0;
+};
+
+// 读进内存的文件内容
+class StringSource : public TextSource {
+public:
+    explicit StringSource(std::string text) : m_text(std::move(text)) {}
+    virtual const char* GetData() const { return m_text.data(); }
+    virtual size_t GetSize() const { return m_text.size(); }
+
+private:
+    std::string m_text;
+};
+
+// 只追加的缓冲：写进去的字节不再移动，也不再修改
+class AddBuffer {
+public:
+    static const size_t kBlockSize = 64 * 1024;
+
+    AddBuffer() : m_used(0), m_capacity(0) {}
+
+    // 返回保存后的地址。当前块放不下时另开一块，一段文字总在同一块里
+    const char* Append(const char* text, size_t length) {
+        if (m_capacity - m_used < length) {
+            m_capacity = std::max(size_t(kBlockSize), length);
+            m_blocks.push_back(std::unique_ptr<char[]>(new char[m_capacity]));
+            m_used = 0;
+        }
+        char* p = m_blocks.back().get() + m_used;
+        memcpy(p, text, length);
+        m_used += length;
+        return p;
+    }
+
+    size_t GetBytes() const {
+        return m_blocks.empty() ? 0 : (m_blocks.size() - 1) * kBlockSize + m_used;
+    }
+
+private:
+    std::vector<std::unique_ptr<char[]> > m_blocks;
+    size_t m_used;      // 当前块已用的字节数
+    size_t m_capacity;  // 当前块的大小
+
+    AddBuffer(const AddBuffer&);
+    AddBuffer& operator=(const AddBuffer&);
+};
+
+// 每次比较 8 个字节（SWAR）：与 '\n' 异或后为 0 的字节就是换行，
+// 换行很密时比反复调用 memchr 快得多
+inline size_t CountLineFeeds(const char* text, size_t length) {
+    const uint64_t kOnes = 0x0101010101010101ull;
+    const uint64_t kLow7 = 0x7F7F7F7F7F7F7F7Full;
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, text + i, 8);
+        uint64_t x = word ^ (kOnes * '\n');
+        uint64_t zero = ~(((x & kLow7) + kLow7) | x) & ~kLow7;  // 每个为 0 的字节置最高位
+        count += size_t(((zero >> 7) * kOnes) >> 56);
+    }
+    for (; i < length; i++) {
+        count += text[i] == '\n';
+    }
+    return count;
+}
+
+// 第 n 个（从 1 开始）换行符的位置，text 中必须至少有 n 个换行
+inline size_t FindLineFeed(const char* text, size_t length, size_t n) {
+    const char* p = text;
+    const char* end = text + length;
+    for (;;) {
+        p = static_cast<const char*>(memchr(p, '\n', size_t(end - p)));
+        if (--n == 0) {
+            return size_t(p - text);
+        }
+        p++;
+    }
+}
+
+class PieceTable {
+public:
+    static const size_t kMaxOriginalPiece = 64 * 1024;
+    static const size_t npos = size_t(-1);
+
+    PieceTable() : m_add(std::make_shared<AddBuffer>()), m_seed(0x9E3779B9u) {}
+
+    // 换成 source 的内容，撤销历史等其他快照不受影响
+    void Open(const std::shared_ptr<const TextSource>& source) {
+        Attach(source);
+        const char* data = source->GetData();
+        size_t size = source->GetSize();
+        for (size_t pos = 0; pos < size; pos += kMaxOriginalPiece) {
+            size_t length = std::min(size_t(kMaxOriginalPiece), size - pos);
+            AppendOriginal(pos, length, CountLineFeeds(data + pos, length));
+        }
+    }
+
+    // 分段打开：Attach() 换成 source 但文档先为空，之后按文件顺序用 AppendOriginal()
+    // 把换行已经数好的块接到文档末尾，每块 O(log n)。大文件在后台建立行索引时使用，
+    // 全部接完之前文档不应修改，否则输入的文字会夹在还没接上的内容前面
+    void Attach(const std::shared_ptr<const TextSource>& source) {
+        m_source = source;
+        m_add = std::make_shared<AddBuffer>();
+        m_root.reset();
+    }
+
+    // [offset, offset + length) 是原始文件中的一块，length 不超过 kMaxOriginalPiece
+    void AppendOriginal(size_t offset, size_t length, size_t lineFeeds) {
+        if (length > 0) {
+            m_root = Merge(m_root, NewNode(m_source->GetData() + offset, length, false, lineFeeds));
+        }
+    }
+
+    void Clear() {
+        m_source.reset();
+        m_add = std::make_shared<AddBuffer>();
+        m_root.reset();
+    }
+
+    size_t GetLength() const { return Length(m_root); }
+    size_t GetLineCount() const { return LineFeeds(m_root) + 1; }
+    size_t GetPieceCount() const { return Count(m_root); }
+
+    // ==================== 修改 ====================
+
+    void Insert(size_t pos, const char* text, size_t length) {
+        if (length == 0) {
+            return;
+        }
+        pos = std::min(pos, GetLength());
+        NodePtr left, right;
+        Split(m_root, pos, left, right);
+        const char* stored = m_add->Append(text, length);
+        size_t lineFeeds = CountLineFeeds(stored, length);
+
+        // 连续输入时前一个片段正好结束在追加缓冲的末尾，直接加长它，不增加片段
+        const PieceNode* last = Rightmost(left);
+        if (last && last->added && last->text + last->length == stored) {
+            left = ExtendRightmost(left, length, lineFeeds);
+        } else {
+            left = Merge(left, NewNode(stored, length, true, lineFeeds));
+        }
+        m_root = Merge(left, right);
+    }
+
+    void Insert(size_t pos, const std::string& text) { Insert(pos, text.data(), text.size()); }
+
+    void Erase(size_t pos, size_t length) {
+        size_t size = GetLength();
+        if (pos >= size || length == 0) {
+            return;
+        }
+        length = std::min(length, size - pos);
+        NodePtr left, middle, right;
+        Split(m_root, pos, left, middle);
+        Split(middle, length, middle, right);
+        m_root = Merge(left, right);
+    }
+
+    // ==================== 读取 ====================
+
+    // 依次把 [pos, pos + length) 的内容按片段交给 f(const char*, size_t)，
+    // f 返回 false 时停止。每次给出的都是片段内的原始内存，不复制
+    template <class F>
+    void ForEachChunk(size_t pos, size_t length, F f) const {
+        size_t size = GetLength();
+        if (pos >= size || length == 0) {
+            return;
+        }
+        length = std::min(length, size - pos);
+        VisitRange(m_root.get(), 0, pos, pos + length, f);
+    }
+
+    std::string GetText(size_t pos, size_t length) const {
+        std::string out;
+        ForEachChunk(pos, length, [&out](const char* text, size_t n) {
+            out.append(text, n);
+            return true;
+        });
+        return out;
+    }
+
+    // 偏移 pos 处的字节，越界时返回 0
+    char GetByte(size_t pos) const {
+        const PieceNode* node = m_root.get();
+        while (node) {
+            size_t leftLength = Length(node->left);
+            if (pos < leftLength) {
+                node = node->left.get();
+            } else if (pos < leftLength + node->length) {
+                return node->text[pos - leftLength];
+            } else {
+                pos -= leftLength + node->length;
+                node = node->right.get();
+            }
+        }
+        return 0;
+    }
+
+    // 第 line 行（从 0 开始）的起始偏移；超过最后一行时返回文档长度
+    size_t GetLineStart(size_t line) const {
+        if (line == 0) {
+            return 0;
+        }
+        if (line > LineFeeds(m_root)) {
+            return GetLength();
+        }
+        size_t base = 0;
+        const PieceNode* node = m_root.get();
+        for (;;) {
+            size_t leftLines = LineFeeds(node->left);
+            if (line <= leftLines) {
+                node = node->left.get();
+                continue;
+            }
+            size_t leftLength = Length(node->left);
+            if (line <= leftLines + node->lineFeeds) {
+                return base + leftLength + FindLineFeed(node->text, node->length, line - leftLines) + 1;
+            }
+            line -= leftLines + node->lineFeeds;
+            base += leftLength + node->length;
+            node = node->right.get();
+        }
+    }
+
+    // 偏移 pos 所在的行号（pos 之前的换行数）
+    size_t GetLineOfOffset(size_t pos) const {
+        size_t lines = 0;
+        const PieceNode* node = m_root.get();
+        while (node) {
+            size_t leftLength = Length(node->left);
+            if (pos < leftLength) {
+                node = node->left.get();
+            } else if (pos < leftLength + node->length) {
+                return lines + LineFeeds(node->left) + CountLineFeeds(node->text, pos - leftLength);
+            } else {
+                lines += LineFeeds(node->left) + node->lineFeeds;
+                pos -= leftLength + node->length;
+                node = node->right.get();
+            }
+        }
+        return lines;
+    }
+
+    // 从第 first 行开始取出最多 count 行（不含换行符），返回实际取出的行数。
+    // starts 为各行的起始偏移；每行最多复制 maxBytes 字节，超长的行只截断显示内容。
+    // 截断的行不再往后扫描找换行，下一行的起点用 GetLineStart() 直接定位，O(log n)：
+    // 整个文件只有一行（压缩过的 JSON、单行日志）时也不会每次都扫完这一行
+    size_t ReadLines(size_t first, size_t count, std::vector<std::string>& lines,
+                     std::vector<size_t>& starts, size_t maxBytes = npos) const {
+        lines.clear();
+        starts.clear();
+        size_t total = GetLineCount();
+        while (lines.size() < count && first + lines.size() < total) {
+            size_t pos = GetLineStart(first + lines.size());
+            lines.push_back(std::string());
+            starts.push_back(pos);
+            bool truncated = false;
+            ForEachChunk(pos, npos, [&](const char* text, size_t n) {
+                const char* end = text + n;
+                while (text < end) {
+                    std::string& line = lines.back();
+                    size_t avail = size_t(end - text);
+                    size_t room = maxBytes - line.size();
+                    size_t window = room < avail ? room + 1 : avail;  // 多看一个字节：行恰好 maxBytes 长时换行就在那里
+                    const char* lf = static_cast<const char*>(memchr(text, '\n', window));
+                    if (!lf) {
+                        if (window > room) {
+                            line.append(text, room);
+                            truncated = true;
+                            return false;
+                        }
+                        line.append(text, avail);
+                        pos += avail;
+                        break;
+                    }
+                    line.append(text, size_t(lf - text));
+                    pos += size_t(lf - text) + 1;
+                    text = lf + 1;
+                    if (lines.size() == count) {
+                        return false;
+                    }
+                    lines.push_back(std::string());
+                    starts.push_back(pos);
+                }
+                return true;
+            });
+            if (!truncated) {
+                break;  // 读够了行数，或者到了文档末尾
+            }
+        }
+        return lines.size();
+    }
+
+    // 从 from 开始查找 needle，返回位置，找不到时返回 npos。
+    // 逐个片段用 memchr + memcmp 查找；跨片段的匹配在片段交界处单独检查
+    size_t Find(const std::string& needle, size_t from) const {
+        size_t size = GetLength();
+        if (needle.empty() || from >= size || needle.size() > size - from) {
+            return npos;
+        }
+        const size_t n = needle.size();
+        std::string carry;  // 上一个片段末尾不足 n 字节、可能跨片段的部分
+        size_t carryPos = from;
+        size_t pos = from;
+        size_t found = npos;
+        ForEachChunk(from, npos, [&](const char* text, size_t length) {
+            // 先检查跨片段的候选：carry + 本片段开头
+            if (!carry.empty()) {
+                std::string joint = carry;
+                joint.append(text, std::min(length, n - 1));
+                size_t hit = joint.find(needle);
+                if (hit != std::string::npos) {
+                    found = carryPos + hit;
+                    return false;
+                }
+            }
+            const char* end = text + length;
+            const char* p = text;
+            while (size_t(end - p) >= n) {
+                p = static_cast<const char*>(memchr(p, needle[0], size_t(end - p) - n + 1));
+                if (!p) {
+                    break;
+                }
+                if (memcmp(p, needle.data(), n) == 0) {
+                    found = pos + size_t(p - text);
+                    return false;
+                }
+                p++;
+            }
+            // 本片段最后 n - 1 个字节留到下一个片段一起检查
+            size_t keep = std::min(length, n - 1);
+            if (carry.size() + keep > n - 1) {
+                carry.erase(0, carry.size() + keep - (n - 1));
+            }
+            carry.append(end - keep, keep);
+            pos += length;
+            carryPos = pos - carry.size();
+            return true;
+        });
+        return found;
+    }
+
+    // 调试和统计用：追加缓冲占用的字节数
+    size_t GetAddedBytes() const { return m_add->GetBytes(); }
+
+private:
+    struct PieceNode;
+    typedef std::shared_ptr<const PieceNode> NodePtr;
+
+    struct PieceNode {
+        const char* text;
+        size_t length;
+        size_t lineFeeds;
+        bool added;          // 在追加缓冲里（可以原地加长）
+        uint32_t priority;   // treap 的堆序：父节点不小于子节点
+        size_t totalLength;  // 子树汇总
+        size_t totalLineFeeds;
+        size_t count;
+        NodePtr left;
+        NodePtr right;
+    };
+
+    std::shared_ptr<const TextSource> m_source;
+    std::shared_ptr<AddBuffer> m_add;  // 所有快照共用，只在末尾追加
+    NodePtr m_root;
+    uint32_t m_seed;
+
+    static size_t Length(const NodePtr& node) { return node ? node->totalLength : 0; }
+    static size_t LineFeeds(const NodePtr& node) { return node ? node->totalLineFeeds : 0; }
+    static size_t Count(const NodePtr& node) { return node ? node->count : 0; }
+
+    uint32_t NextPriority() {
+        // xorshift32，够用且可重复
+        m_seed ^= m_seed << 13;
+        m_seed ^= m_seed >> 17;
+        m_seed ^= m_seed << 5;
+        return m_seed;
+    }
+
+    static NodePtr Make(const char* text, size_t length, size_t lineFeeds, bool added,
+                        uint32_t priority, const NodePtr& left, const NodePtr& right) {
+        std::shared_ptr<PieceNode> node = std::make_shared<PieceNode>();
+        node->text = text;
+        node->length = length;
+        node->lineFeeds = lineFeeds;
+        node->added = added;
+        node->priority = priority;
+        node->left = left;
+        node->right = right;
+        node->totalLength = Length(left) + length + Length(right);
+        node->totalLineFeeds = LineFeeds(left) + lineFeeds + LineFeeds(right);
+        node->count = Count(left) + 1 + Count(right);
+        return node;
+    }
+
+    // 换掉子节点，片段不变
+    static NodePtr With(const NodePtr& node, const NodePtr& left, const NodePtr& right) {
+        return Make(node->text, node->length, node->lineFeeds, node->added, node->priority,
+                    left, right);
+    }
+
+    NodePtr NewNode(const char* text, size_t length, bool added, size_t lineFeeds = npos) {
+        if (lineFeeds == npos) {
+            lineFeeds = CountLineFeeds(text, length);
+        }
+        return Make(text, length, lineFeeds, added, NextPriority(), NodePtr(), NodePtr());
+    }
+
+    // 按偏移切成 [0, pos) 和 [pos, ...)，落在片段中间时把片段切开。
+    // 切开的两半沿用原节点的优先级，堆序不变。
+    // node 按值传入：调用方可能把结果写回传入的同一个变量
+    static void Split(NodePtr node, size_t pos, NodePtr& left, NodePtr& right) {
+        if (!node) {
+            left.reset();
+            right.reset();
+            return;
+        }
+        size_t leftLength = Length(node->left);
+        if (pos <= leftLength) {
+            NodePtr a, b;
+            Split(node->left, pos, a, b);
+            right = With(node, b, node->right);
+            left = a;
+        } else if (pos >= leftLength + node->length) {
+            NodePtr a, b;
+            Split(node->right, pos - leftLength - node->length, a, b);
+            left = With(node, node->left, a);
+            right = b;
+        } else {
+            // 换行数只数较短的一半
+            size_t k = pos - leftLength;
+            size_t rest = node->length - k;
+            size_t firstLines = k <= rest
+                ? CountLineFeeds(node->text, k)
+                : node->lineFeeds - CountLineFeeds(node->text + k, rest);
+            NodePtr l = node->left, r = node->right;
+            left = Make(node->text, k, firstLines, node->added, node->priority, l, NodePtr());
+            right = Make(node->text + k, rest, node->lineFeeds - firstLines, node->added,
+                         node->priority, NodePtr(), r);
+        }
+    }
+
+    static NodePtr Merge(const NodePtr& a, const NodePtr& b) {
+        if (!a) {
+            return b;
+        }
+        if (!b) {
+            return a;
+        }
+        if (a->priority >= b->priority) {
+            return With(a, a->left, Merge(a->right, b));
+        }
+        return With(b, Merge(a, b->left), b->right);
+    }
+
+    static const PieceNode* Rightmost(const NodePtr& node) {
+        const PieceNode* p = node.get();
+        while (p && p->right) {
+            p = p->right.get();
+        }
+        return p;
+    }
+
+    static NodePtr ExtendRightmost(const NodePtr& node, size_t length, size_t lineFeeds) {
+        if (node->right) {
+            return With(node, node->left, ExtendRightmost(node->right, length, lineFeeds));
+        }
+        return Make(node->text, node->length + length, node->lineFeeds + lineFeeds, node->added,
+                    node->priority, node->left, NodePtr());
+    }
+
+    // 中序遍历 [from, to) 范围内的片段，base 为该子树的起始偏移；返回 false 表示已停止
+    template <class F>
+    static bool VisitRange(const PieceNode* node, size_t base, size_t from, size_t to, F& f) {
+        if (!node || from >= base + node->totalLength || to <= base) {
+            return true;
+        }
+        size_t leftLength = Length(node->left);
+        if (!VisitRange(node->left.get(), base, from, to, f)) {
+            return false;
+        }
+        size_t start = base + leftLength;
+        size_t end = start + node->length;
+        if (from < end && to > start) {
+            size_t a = std::max(from, start) - start;
+            size_t b = std::min(to, end) - start;
+            if (!f(node->text + a, b - a)) {
+                return false;
+            }
+        }
+        return VisitRange(node->right.get(), end, from, to, f);
+    }
+};
+
+} // namespace editor
+
+#endif // EDITOR_PIECE_TABLE_H
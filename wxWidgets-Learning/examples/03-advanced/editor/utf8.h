@@ -0,0 +1,89 @@
+/*
+ * UTF-8 小工具（text_editor 示例使用）
+ *
+ * 文档按字节保存，偏移都是字节偏移；只有显示和光标移动时才需要知道字符的边界。
+ * 解码时对非法序列不报错：每个坏字节当作一个 U+FFFD，这样任何文件都能打开、
+ * 逐字节移动光标，保存时原样写回。
+ *
+ * 本文件只依赖标准库，不依赖 wxWidgets。
+ */
+
+#ifndef EDITOR_UTF8_H
+#define EDITOR_UTF8_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace editor {
+
+const uint32_t kReplacementChar = 0xFFFD;
+
+inline bool IsContinuationByte(unsigned char c) { return (c & 0xC0) == 0x80; }
+
+// 解码 text 开头的一个字符，返回消耗的字节数（至少 1）
+inline size_t DecodeUtf8(const char* text, size_t length, uint32_t& cp) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(text);
+    unsigned char c = p[0];
+    if (c < 0x80) {
+        cp = c;
+        return 1;
+    }
+    size_t n;
+    uint32_t min;
+    if ((c & 0xE0) == 0xC0) {
+        n = 2;
+        cp = c & 0x1F;
+        min = 0x80;
+    } else if ((c & 0xF0) == 0xE0) {
+        n = 3;
+        cp = c & 0x0F;
+        min = 0x800;
+    } else if ((c & 0xF8) == 0xF0) {
+        n = 4;
+        cp = c & 0x07;
+        min = 0x10000;
+    } else {
+        cp = kReplacementChar;
+        return 1;
+    }
+    if (n > length) {
+        cp = kReplacementChar;
+        return 1;
+    }
+    for (size_t i = 1; i < n; i++) {
+        if (!IsContinuationByte(p[i])) {
+            cp = kReplacementChar;
+            return 1;
+        }
+        cp = (cp << 6) | (p[i] & 0x3F);
+    }
+    // 过长编码、代理区和超出范围的码点都按坏字节处理
+    if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+        cp = kReplacementChar;
+        return 1;
+    }
+    return n;
+}
+
+inline void AppendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += char(cp);
+    } else if (cp < 0x800) {
+        out += char(0xC0 | (cp >> 6));
+        out += char(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += char(0xE0 | (cp >> 12));
+        out += char(0x80 | ((cp >> 6) & 0x3F));
+        out += char(0x80 | (cp & 0x3F));
+    } else {
+        out += char(0xF0 | (cp >> 18));
+        out += char(0x80 | ((cp >> 12) & 0x3F));
+        out += char(0x80 | ((cp >> 6) & 0x3F));
+        out += char(0x80 | (cp & 0x3F));
+    }
+}
+
+} // namespace editor
+
+#endif // EDITOR_UTF8_H
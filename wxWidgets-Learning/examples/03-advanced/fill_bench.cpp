@@ -0,0 +1,277 @@
+/*
+ * 背景填充内核基准
+ *
+ * 在 4K（3840 × 2160）画布上比较 drawing/fill_kernels.h 的各个指令集版本
+ * 与 wxDC 的对应绘制方式：纯色、纵向 / 横向线性渐变、径向渐变、棋盘格、点线网格。
+ * 每项重复若干次取中位数。
+ *
+ * 内核写的是 wxImage 的像素，显示前还要转换成 wxBitmap，所以另外单独
+ * 报告一次转换的耗时；wxDC 的结果已经在位图里，不需要转换。
+ *
+ * 计时之前先在小画布上核对各指令集的结果与标量版本一致（含半径为 0、
+ * 像素离圆心很远这类边界情况），不一致时打印出来并返回 2。
+ *
+ * 用法：fill_bench [--size 宽x高] [--repeat n] [--no-dc]
+ *   --size     画布尺寸，默认 3840x2160
+ *   --repeat   每项重复次数，默认 10
+ *   --no-dc    只测内核，不初始化图形环境（服务器上 wxDC 部分可以用 xvfb-run 运行）
+ *
+ * 编译：g++ -std=c++11 -O2 -o fill_bench fill_bench.cpp `wx-config --cxxflags --libs`
+ *       或 CMake 目标 fill_bench
+ */
+
+#include <wx/wx.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+#include "drawing/fill_kernels.h"
+#include "drawing/frame_stats.h"
+
+// 与 custom_draw 的默认主题一致
+static const uint32_t kTop = 0xFAFAFF;
+static const uint32_t kBottom = 0xDCDCF0;
+static const uint32_t kGrid = 0xC8C8C8;
+static const int kGridStep = 50;
+static const int kCell = 16;
+
+static wxColour ToWxColour(uint32_t c) {
+    return wxColour((c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF);
+}
+
+// 重复 repeat 次，返回单次耗时的中位数（毫秒）
+static double MedianMs(int repeat, const std::function<void()>& fn) {
+    std::vector<double> times;
+    fn();  // 预热：页面映射、缓存
+    for (int i = 0; i < repeat; i++) {
+        double start = drawing::NowMs();
+        fn();
+        times.push_back(drawing::NowMs() - start);
+    }
+    std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+    return times[times.size() / 2];
+}
+
+struct FillCase {
+    const char* name;
+    std::function<void(const drawing::RgbBuffer&)> kernel;
+    std::function<void(wxDC&, int, int)> dc;
+};
+
+static std::vector<FillCase> MakeCases() {
+    std::vector<FillCase> cases(6);
+
+    cases[0].name = "纯色";
+    cases[0].kernel = [](const drawing::RgbBuffer& b) { drawing::FillSolid(b, kTop); };
+    cases[0].dc = [](wxDC& dc, int w, int h) {
+        dc.SetPen(*wxTRANSPARENT_PEN);
+        dc.SetBrush(wxBrush(ToWxColour(kTop)));
+        dc.DrawRectangle(0, 0, w, h);
+    };
+
+    cases[1].name = "纵向渐变";
+    cases[1].kernel = [](const drawing::RgbBuffer& b) {
+        drawing::FillLinearGradient(b, kTop, kBottom, drawing::GRADIENT_VERTICAL);
+    };
+    cases[1].dc = [](wxDC& dc, int w, int h) {
+        dc.GradientFillLinear(wxRect(0, 0, w, h), ToWxColour(kTop), ToWxColour(kBottom), wxSOUTH);
+    };
+
+    cases[2].name = "横向渐变";
+    cases[2].kernel = [](const drawing::RgbBuffer& b) {
+        drawing::FillLinearGradient(b, 0xFF6464, 0x6464FF, drawing::GRADIENT_HORIZONTAL);
+    };
+    cases[2].dc = [](wxDC& dc, int w, int h) {
+        dc.GradientFillLinear(wxRect(0, 0, w, h), wxColour(255, 100, 100),
+                              wxColour(100, 100, 255), wxEAST);
+    };
+
+    cases[3].name = "径向渐变";
+    cases[3].kernel = [](const drawing::RgbBuffer& b) {
+        drawing::FillRadialGradient(b, b.width / 2.0, b.height / 2.0,
+                                    std::min(b.width, b.height) / 2.0, 0xFFFFFF, 0x3050A0);
+    };
+    cases[3].dc = [](wxDC& dc, int w, int h) {
+        dc.GradientFillConcentric(wxRect(0, 0, w, h), wxColour(0x30, 0x50, 0xA0), *wxWHITE);
+    };
+
+    cases[4].name = "棋盘格";
+    cases[4].kernel = [](const drawing::RgbBuffer& b) {
+        drawing::FillCheckerboard(b, kCell, 0xCCCCCC, 0xFFFFFF);
+    };
+    cases[4].dc = [](wxDC& dc, int w, int h) {
+        dc.SetPen(*wxTRANSPARENT_PEN);
+        dc.SetBrush(*wxWHITE_BRUSH);
+        dc.DrawRectangle(0, 0, w, h);
+        dc.SetBrush(wxBrush(wxColour(0xCC, 0xCC, 0xCC)));
+        for (int y = 0; y < h; y += kCell) {
+            for (int x = ((y / kCell) % 2) * kCell; x < w; x += 2 * kCell) {
+                dc.DrawRectangle(x, y, kCell, kCell);
+            }
+        }
+    };
+
+    cases[5].name = "渐变 + 网格";
+    cases[5].kernel = [](const drawing::RgbBuffer& b) {
+        drawing::FillLinearGradient(b, kTop, kBottom, drawing::GRADIENT_VERTICAL);
+        drawing::DrawDottedGrid(b, kGridStep, kGrid);
+    };
+    cases[5].dc = [](wxDC& dc, int w, int h) {
+        dc.GradientFillLinear(wxRect(0, 0, w, h), ToWxColour(kTop), ToWxColour(kBottom), wxSOUTH);
+        dc.SetPen(wxPen(ToWxColour(kGrid), 1, wxPENSTYLE_DOT));
+        for (int x = 0; x < w; x += kGridStep) {
+            dc.DrawLine(x, 0, x, h);
+        }
+        for (int y = 0; y < h; y += kGridStep) {
+            dc.DrawLine(0, y, w, y);
+        }
+    };
+    return cases;
+}
+
+// ==================== 结果核对 ====================
+
+// SIMD 用四舍六入五成双，标量用 +0.5 截断，颜色表相邻两级每个分量最多差 1
+static bool SameImage(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b) {
+    for (size_t i = 0; i < a.size(); i++) {
+        if (std::abs(int(a[i]) - int(b[i])) > 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 各指令集的内核与标量版本比较，返回不一致的项数
+static int CheckKernels(const std::vector<drawing::FillIsa>& isas) {
+    struct RadialCase {
+        const char* name;
+        double cx, cy, radius;
+    };
+    // 半径为 0 / 极小时 scale 很大，距离 × scale 超出 int 范围，
+    // 以前 SIMD 版本会得到负的下标、越界读颜色表
+    const RadialCase radials[] = {
+        {"径向渐变", 100, 60, 80},
+        {"径向渐变（半径 0）", 100, 60, 0},
+        {"径向渐变（半径 1e-6）", 100, 60, 1e-6},
+        {"径向渐变（圆心很远）", -1e6, 1e6, 0},
+    };
+    const int w = 203, h = 121;  // 不是 8 的倍数，尾部走标量
+    std::vector<FillCase> cases = MakeCases();
+    int failures = 0;
+    for (size_t c = 0; c < cases.size() + 4; c++) {
+        std::vector<unsigned char> expected(size_t(w) * h * 3), actual(expected.size());
+        std::function<void(const drawing::RgbBuffer&)> kernel;
+        const char* name;
+        if (c < cases.size()) {
+            kernel = cases[c].kernel;
+            name = cases[c].name;
+        } else {
+            const RadialCase& rc = radials[c - cases.size()];
+            kernel = [rc](const drawing::RgbBuffer& b) {
+                drawing::FillRadialGradient(b, rc.cx, rc.cy, rc.radius, 0xFFFFFF, 0x3050A0);
+            };
+            name = rc.name;
+        }
+        drawing::SetFillIsa(drawing::FILL_SCALAR);
+        kernel(drawing::RgbBuffer(expected.data(), w, h));
+        for (size_t k = 1; k < isas.size(); k++) {
+            drawing::SetFillIsa(isas[k]);
+            kernel(drawing::RgbBuffer(actual.data(), w, h));
+            if (!SameImage(expected, actual)) {
+                wxPrintf("结果不一致: %s (%s)\n", wxString::FromUTF8(name),
+                         drawing::FillIsaName(isas[k]));
+                failures++;
+            }
+        }
+    }
+    drawing::SetFillIsa(isas.back());
+    return failures;
+}
+
+static void PrintUsage() {
+    wxPrintf("用法: fill_bench [--size 宽x高] [--repeat n] [--no-dc]\n");
+}
+
+int main(int argc, char** argv) {
+    int width = 3840, height = 2160, repeat = 10;
+    bool useDc = true;
+    for (int i = 1; i < argc; i++) {
+        wxString arg = wxString::FromUTF8(argv[i]);
+        bool hasValue = i + 1 < argc;
+        if (arg == "--size" && hasValue) {
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+                PrintUsage();
+                return 1;
+            }
+        } else if (arg == "--repeat" && hasValue) {
+            repeat = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--no-dc") {
+            useDc = false;
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    // wxMemoryDC 和 wxBitmap 需要初始化 GUI（但不创建窗口）
+    if (useDc) {
+        wxApp::SetInstance(new wxApp());
+        if (!wxEntryStart(argc, argv)) {
+            wxPrintf("无法初始化图形环境。没有显示器时请用 xvfb-run 运行，或者使用 --no-dc\n");
+            return 1;
+        }
+    }
+
+    drawing::FillIsa best = drawing::DetectFillIsa();
+    wxPrintf("画布 %d x %d，每项 %d 次取中位数，CPU 支持: %s\n\n",
+             width, height, repeat, drawing::FillIsaName(best));
+
+    std::vector<drawing::FillIsa> isas;
+    for (int isa = drawing::FILL_SCALAR; isa <= best; isa++) {
+        isas.push_back(drawing::FillIsa(isa));
+    }
+    if (CheckKernels(isas) > 0) {
+        if (useDc) {
+            wxEntryCleanup();
+        }
+        return 2;
+    }
+
+    wxPrintf("%-12s", "");
+    for (size_t k = 0; k < isas.size(); k++) {
+        wxPrintf("%10s", drawing::FillIsaName(isas[k]));
+    }
+    wxPrintf(useDc ? "%10s%10s\n" : "\n", "wxDC", "加速比");
+
+    wxImage image(width, height, false);
+    drawing::RgbBuffer buffer(image.GetData(), width, height);
+    std::vector<FillCase> cases = MakeCases();
+    for (size_t c = 0; c < cases.size(); c++) {
+        const FillCase& fc = cases[c];
+        wxPrintf("%-12s", wxString::FromUTF8(fc.name));
+        double fastest = 0;
+        for (size_t k = 0; k < isas.size(); k++) {
+            drawing::SetFillIsa(isas[k]);
+            double ms = MedianMs(repeat, [&]() { fc.kernel(buffer); });
+            wxPrintf("%8.2fms", ms);
+            fastest = ms;
+        }
+        if (useDc) {
+            wxBitmap bitmap(width, height);
+            wxMemoryDC dc(bitmap);
+            double ms = MedianMs(repeat, [&]() { fc.dc(dc, width, height); });
+            wxPrintf("%8.2fms%9.1fx", ms, fastest > 0 ? ms / fastest : 0.0);
+        }
+        wxPrintf("\n");
+    }
+    drawing::SetFillIsa(best);
+
+    if (useDc) {
+        double ms = MedianMs(repeat, [&]() { wxBitmap bitmap(image); });
+        wxPrintf("\n内核结果转换成 wxBitmap: %.2f ms（每次重建背景层一次）\n", ms);
+        wxEntryCleanup();
+    }
+    return 0;
+}
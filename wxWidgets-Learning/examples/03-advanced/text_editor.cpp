@@ -1,6 +1,6 @@
 /*
  * wxWidgets 简单文本编辑器
- * 
+ *
  * 这是一个功能较完整的文本编辑器应用，综合展示：
  * - 菜单和工具栏
  * - 文件操作（新建、打开、保存）
@@ -8,13 +8,274 @@
  * - 状态栏显示
  * - 对话框使用
  * - 事件处理
- * 
+ * - 自定义文本视图：文档保存在片段表（editor/piece_table.h）里，
+ *   窗口只读取和绘制可见的那几行，几百 MB 的文件也能流畅编辑
+ * - 大文件用内存映射打开，立即显示第一屏，行索引在后台线程上建立
+ * - 保存在后台线程上进行：先写临时文件并刷到磁盘，再改名替换原文件
+ *
  * 编译：g++ -o text_editor text_editor.cpp `wx-config --cxxflags --libs`
  */
 
 #include <wx/wx.h>
 #include <wx/artprov.h>
-#include <wx/stc/stc.h>  // 使用 Scintilla 文本控件
+#include <wx/caret.h>
+#include <wx/clipbrd.h>
+#include <wx/dcbuffer.h>
+#include <wx/file.h>
+#include <wx/filename.h>
+#include <wx/fontdlg.h>
+#include <wx/numdlg.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "editor/piece_table.h"
+#include "editor/line_index.h"
+#include "editor/utf8.h"
+#include "drawing/mapped_file.h"
+
+#ifdef __WINDOWS__
+#include <io.h>        // _commit
+#include <wx/msw/wrapwin.h>  // MoveFileExW；wx/wx.h 不包含 Win32 API 的头文件
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>    // fsync
+#endif
+
+// 文档和界面之间的文字转换：文档里是 UTF-8 字节，界面上是 wxString
+static std::string ToUtf8(const wxString& text) {
+    const wxScopedCharBuffer buffer = text.utf8_str();
+    return std::string(buffer.data(), buffer.length());
+}
+
+// 坏字节显示为 U+FFFD（wxString::FromUTF8 遇到坏字节会返回空串）
+static wxString FromUtf8(const char* text, size_t length) {
+    wxString out;
+    out.reserve(length);
+    size_t i = 0;
+    while (i < length) {
+        uint32_t cp;
+        i += editor::DecodeUtf8(text + i, length - i, cp);
+        out += wxUniChar(cp);
+    }
+    return out;
+}
+
+// 内存映射的文件：打开时不读取内容，只有访问到的页才由操作系统从磁盘读入
+class MappedSource : public editor::TextSource {
+public:
+    bool Open(const wxString& path) { return m_file.Open(path.fn_str()); }
+    virtual const char* GetData() const { return reinterpret_cast<const char*>(m_file.GetData()); }
+    virtual size_t GetSize() const { return m_file.GetSize(); }
+
+private:
+    drawing::MappedFile m_file;
+};
+
+// 文档视图：只从文档里读取可见的行来绘制，光标、选区、滚动和撤销都在这里处理。
+// 文档本身属于 MyFrame，视图只持有引用；所有修改都经过 Edit()，以便记录撤销快照
+class TextView : public wxWindow {
+public:
+    TextView(wxWindow* parent, editor::PieceTable& document);
+
+    // 修改的种类：连续的同类输入合并为一步撤销
+    enum {
+        EDIT_OTHER = 0,
+        EDIT_TYPING,
+        EDIT_DELETING
+    };
+
+    // 文档整体换掉之后调用（新建、打开）：清空撤销历史，光标回到开头
+    void Reset(const std::string& eol);
+
+    // 文档末尾接上了新的内容（大文件的行索引又完成了一段），光标和撤销历史不变
+    void DocumentAppended();
+
+    // 只读时拒绝所有修改，光标移动、选择和复制照常
+    void SetReadOnly(bool readOnly) { m_readOnly = readOnly; }
+    bool IsReadOnly() const { return m_readOnly; }
+
+    // 对文档做一次修改，之后选区为 [anchor, caret]
+    void Edit(const std::function<void(editor::PieceTable&)>& change,
+              size_t anchor, size_t caret, int kind = EDIT_OTHER);
+    void ReplaceSelection(const std::string& text, int kind = EDIT_OTHER);
+
+    bool CanUndo() const { return !m_undo.empty(); }
+    bool CanRedo() const { return !m_redo.empty(); }
+    void Undo();
+    void Redo();
+
+    // 每次修改都得到一个新的版本号，撤销时回到旧的版本号。
+    // 保存时记下版本号，之后是否"已修改"只需比较版本号
+    uint64_t GetVersion() const { return m_version; }
+
+    // 选区和光标都是字节偏移
+    size_t GetCaret() const { return m_caret; }
+    bool HasSelection() const { return m_anchor != m_caret; }
+    void GetSelection(size_t& from, size_t& to) const;
+    void SetSelection(size_t anchor, size_t caret);
+    std::string GetSelectedText() const;
+
+    const std::string& GetEol() const { return m_eol; }
+    void SetTextFont(const wxFont& font);
+    const wxFont& GetTextFont() const { return m_font; }
+    void ShowLineNumbers(bool show);
+
+private:
+    // 一行可见文字的排版结果
+    struct VisibleLine {
+        size_t start;                  // 行首的字节偏移
+        size_t length;                 // 读入的字节数，不含换行符
+        wxString text;                 // 展开制表符后的显示文字
+        std::vector<size_t> offsets;   // 每个显示字符对应的行内字节偏移，末尾多一项
+        wxArrayInt widths;             // 每个显示字符右边缘的 x（GetPartialTextExtents）
+    };
+
+    struct UndoState {
+        editor::PieceTable document;   // 快照，O(1)
+        size_t anchor;
+        size_t caret;
+        uint64_t version;
+    };
+
+    static const size_t kMaxLineBytes = 16 * 1024;  // 每行最多显示这么多字节，超长的行只截断显示
+    static const size_t kMaxUndo = 1000;
+    static const int kTabWidth = 4;
+    static const int kTextMargin = 4;
+
+    editor::PieceTable& m_doc;
+    wxFont m_font;
+    int m_lineHeight;
+    int m_charWidth;
+    bool m_showLineNumbers;
+    int m_gutterWidth;
+
+    // 滚动：纵向按行，横向按像素
+    size_t m_topLine;
+    int m_scrollX;
+    int m_maxWidth;                    // 见过的最宽一行，决定横向滚动范围
+
+    // 可见行的排版缓存，滚动、修改、改变大小后失效，下次需要时重建
+    std::vector<VisibleLine> m_visible;
+    std::vector<std::string> m_lineBytes;
+    std::vector<size_t> m_lineStarts;
+    bool m_layoutValid;
+
+    size_t m_anchor;
+    size_t m_caret;
+    int m_preferredX;                  // 上下移动时保持的列位置，-1 表示按当前光标计算
+    bool m_selecting;                  // 正在用鼠标拖动选择
+    bool m_readOnly;
+    std::string m_eol;                 // 回车插入的换行符，与打开的文件一致
+
+    std::deque<UndoState> m_undo;
+    std::vector<UndoState> m_redo;
+    int m_lastEdit;                    // 上一次修改的种类，光标移动后重置为 EDIT_OTHER
+    uint64_t m_version;
+    uint64_t m_lastVersion;            // 已分配的最大版本号
+
+    // 排版
+    void EnsureLayout();
+    void Invalidate();
+    int GetTextLeft() const { return m_gutterWidth + kTextMargin - m_scrollX; }
+    size_t GetFullRows() const;
+    const VisibleLine* FindVisible(size_t line) const;
+    int GetByteX(const VisibleLine& line, size_t offset) const;
+    size_t HitTestLine(size_t line, int x);
+    void UpdateGutter();
+    void UpdateScrollbars();
+    void UpdateCaret();
+
+    // 光标
+    size_t GetLineEnd(size_t line) const;
+    size_t NextCharPos(size_t pos) const;
+    size_t PrevCharPos(size_t pos) const;
+    void MoveCaret(size_t pos, bool extend, bool keepColumn = false);
+    void MoveVertical(long lines, bool extend);
+    void ScrollToLine(size_t top);
+    void EnsureCaretVisible();
+    size_t PositionFromPoint(const wxPoint& pt);
+
+    void PushUndo();
+    void Restore(const UndoState& state);
+    void Notify(wxEventType type);
+
+    void OnPaint(wxPaintEvent& event);
+    void OnSize(wxSizeEvent& event);
+    void OnScroll(wxScrollWinEvent& event);
+    void OnMouseWheel(wxMouseEvent& event);
+    void OnMouseDown(wxMouseEvent& event);
+    void OnMouseMove(wxMouseEvent& event);
+    void OnMouseUp(wxMouseEvent& event);
+    void OnCaptureLost(wxMouseCaptureLostEvent& event);
+    void OnKeyDown(wxKeyEvent& event);
+    void OnChar(wxKeyEvent& event);
+};
+
+// TextView 向上发出的通知，MyFrame 据此更新标题和状态栏
+wxDEFINE_EVENT(EVT_DOCUMENT_CHANGED, wxCommandEvent);
+wxDEFINE_EVENT(EVT_CARET_MOVED, wxCommandEvent);
+
+// 后台建立行索引：每数完一段就通知 UI 线程，把这一段接到文档末尾
+wxDEFINE_EVENT(EVT_INDEX_PROGRESS, wxThreadEvent);
+
+class IndexThread : public wxThread {
+public:
+    IndexThread(wxEvtHandler* handler, const std::shared_ptr<editor::LineIndexBuilder>& index)
+        : wxThread(wxTHREAD_JOINABLE), m_handler(handler), m_index(index) {}
+
+protected:
+    virtual ExitCode Entry();
+
+private:
+    // 每数完 1024 块（64 MB）通知一次，文件在页缓存里时大约每秒几十次
+    static const size_t kChunksPerReport = 1024;
+
+    wxEvtHandler* m_handler;
+    std::shared_ptr<editor::LineIndexBuilder> m_index;
+};
+
+// 后台保存：从文档快照读出内容，写进临时文件，刷到磁盘后改名替换目标文件。
+// 写到一半崩溃或断电，目标文件仍是完整的旧内容
+wxDEFINE_EVENT(EVT_SAVE_PROGRESS, wxThreadEvent);  // GetInt(): 0-100
+wxDEFINE_EVENT(EVT_SAVE_DONE, wxThreadEvent);
+
+class SaveThread : public wxThread {
+public:
+    SaveThread(wxEvtHandler* handler, const editor::PieceTable& snapshot, const wxString& path)
+        : wxThread(wxTHREAD_JOINABLE), m_handler(handler), m_snapshot(snapshot),
+          m_path(path.Clone()), m_ok(false), m_finished(false) {}
+
+    // 结果在 IsFinished() 返回 true（或 Wait() 返回）之后才可以读取
+    bool IsFinished() const { return m_finished; }
+    bool Succeeded() const { return m_ok; }
+    const wxString& GetError() const { return m_error; }
+    const wxString& GetPath() const { return m_path; }
+
+protected:
+    virtual ExitCode Entry();
+
+private:
+    static const size_t kBufferSize = 4 * 1024 * 1024;  // 片段往往很小，攒满一大块再写
+
+    wxEvtHandler* m_handler;
+    editor::PieceTable m_snapshot;   // O(1) 取得；UI 线程之后的修改不影响它
+    wxString m_path;
+    bool m_ok;
+    wxString m_error;
+    std::atomic<bool> m_finished;
+
+    bool WriteTo(wxFile& file);
+    ExitCode Finish(bool ok, const wxString& error);
+};
 
 class MyApp : public wxApp {
 public:
@@ -26,21 +287,39 @@ public:
     MyFrame();
 
 private:
-    wxTextCtrl* m_textCtrl;
+    editor::PieceTable m_document;   // 文档模型，视图只读取可见部分
+    TextView* m_view;
     wxString m_currentFile;
     bool m_modified;
-    
+    uint64_t m_savedVersion;         // 最近一次打开或保存时视图的版本号
+    wxString m_findText;
+
+    // 大文件：内存映射打开，后台逐块数换行，数好的块依次接到文档末尾
+    std::shared_ptr<editor::LineIndexBuilder> m_index;
+    IndexThread* m_indexThread;
+    size_t m_indexedChunks;          // 已经接到文档里的块数
+
+    // 后台保存
+    SaveThread* m_saveThread;
+    uint64_t m_savingVersion;        // 正在保存的快照对应的版本号
+    wxStopWatch m_saveWatch;
+
+    // 达到这个大小的文件用内存映射打开，并在后台建立行索引。
+    // 小文件直接读进内存：打开后与磁盘上的文件无关，别的程序截断它也不影响
+    static const wxFileOffset kLargeFileBytes = 64 * 1024 * 1024;
+    static const size_t kFirstScreenChunks = 16;   // 同步数换行的块数（1 MB），足够显示第一屏
+    static const size_t kMaxColumnScan = 64 * 1024;  // 状态栏的列号最多数这么多字节
+
     // 菜单 ID
     enum {
         ID_NEW = wxID_HIGHEST + 1,
         ID_FIND,
         ID_REPLACE,
         ID_GOTO_LINE,
-        ID_WORD_WRAP,
         ID_FONT,
         ID_LINE_NUMBERS
     };
-    
+
     // 事件处理器
     void OnNew(wxCommandEvent& event);
     void OnOpen(wxCommandEvent& event);
@@ -48,7 +327,7 @@ private:
     void OnSaveAs(wxCommandEvent& event);
     void OnExit(wxCommandEvent& event);
     void OnClose(wxCloseEvent& event);
-    
+
     void OnUndo(wxCommandEvent& event);
     void OnRedo(wxCommandEvent& event);
     void OnCut(wxCommandEvent& event);
@@ -58,34 +337,895 @@ private:
     void OnFind(wxCommandEvent& event);
     void OnReplace(wxCommandEvent& event);
     void OnGotoLine(wxCommandEvent& event);
-    
-    void OnWordWrap(wxCommandEvent& event);
+
+    void OnLineNumbers(wxCommandEvent& event);
     void OnFont(wxCommandEvent& event);
-    
+
     void OnAbout(wxCommandEvent& event);
-    void OnTextChanged(wxCommandEvent& event);
+    void OnDocumentChanged(wxCommandEvent& event);
+    void OnCaretMoved(wxCommandEvent& event);
     void OnUpdateUI(wxUpdateUIEvent& event);
-    
+    void OnIndexProgress(wxThreadEvent& event);
+    void OnSaveProgress(wxThreadEvent& event);
+    void OnSaveDone(wxThreadEvent& event);
+
     // 辅助函数
-    bool SaveFile(const wxString& filename);
+    bool StartSave(const wxString& filename);
+    void FinishSave();
+    void WaitForSave();
     bool LoadFile(const wxString& filename);
+    bool LoadMappedFile(const wxString& filename);
+    void AppendIndexedChunks();
+    void StopIndexing();
     bool AskSaveChanges();
+    bool CopySelection();
     void UpdateTitle();
     void UpdateStatusBar();
 };
 
+// 新文档和没有换行的文件使用平台习惯的换行符
+static std::string DefaultEol() {
+#ifdef __WINDOWS__
+    return "\r\n";
+#else
+    return "\n";
+#endif
+}
+
+// 按文件开头第一个换行判断整个文件的换行风格
+static std::string DetectEol(const editor::PieceTable& document) {
+    std::string head = document.GetText(0, 64 * 1024);
+    size_t lf = head.find('\n');
+    if (lf == std::string::npos) {
+        return DefaultEol();
+    }
+    return lf > 0 && head[lf - 1] == '\r' ? "\r\n" : "\n";
+}
+
 bool MyApp::OnInit() {
     MyFrame* frame = new MyFrame();
     frame->Show(true);
     return true;
 }
 
+// ==================== TextView ====================
+
+TextView::TextView(wxWindow* parent, editor::PieceTable& document)
+    : wxWindow(parent, wxID_ANY, wxDefaultPosition, wxDefaultSize,
+               wxVSCROLL | wxHSCROLL | wxWANTS_CHARS | wxBORDER_NONE),
+      m_doc(document),
+      m_lineHeight(1), m_charWidth(1),
+      m_showLineNumbers(true), m_gutterWidth(0),
+      m_topLine(0), m_scrollX(0), m_maxWidth(0),
+      m_layoutValid(false),
+      m_anchor(0), m_caret(0), m_preferredX(-1), m_selecting(false), m_readOnly(false),
+      m_eol(DefaultEol()),
+      m_lastEdit(EDIT_OTHER), m_version(0), m_lastVersion(0) {
+    SetBackgroundStyle(wxBG_STYLE_PAINT);  // 避免闪烁
+    SetCursor(wxCursor(wxCURSOR_IBEAM));
+    SetCaret(new wxCaret(this, 2, 16));
+    SetTextFont(wxFont(10, wxFONTFAMILY_TELETYPE, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL));
+
+    Bind(wxEVT_PAINT, &TextView::OnPaint, this);
+    Bind(wxEVT_SIZE, &TextView::OnSize, this);
+    Bind(wxEVT_SCROLLWIN_TOP, &TextView::OnScroll, this);
+    Bind(wxEVT_SCROLLWIN_BOTTOM, &TextView::OnScroll, this);
+    Bind(wxEVT_SCROLLWIN_LINEUP, &TextView::OnScroll, this);
+    Bind(wxEVT_SCROLLWIN_LINEDOWN, &TextView::OnScroll, this);
+    Bind(wxEVT_SCROLLWIN_PAGEUP, &TextView::OnScroll, this);
+    Bind(wxEVT_SCROLLWIN_PAGEDOWN, &TextView::OnScroll, this);
+    Bind(wxEVT_SCROLLWIN_THUMBTRACK, &TextView::OnScroll, this);
+    Bind(wxEVT_SCROLLWIN_THUMBRELEASE, &TextView::OnScroll, this);
+    Bind(wxEVT_MOUSEWHEEL, &TextView::OnMouseWheel, this);
+    Bind(wxEVT_LEFT_DOWN, &TextView::OnMouseDown, this);
+    Bind(wxEVT_MOTION, &TextView::OnMouseMove, this);
+    Bind(wxEVT_LEFT_UP, &TextView::OnMouseUp, this);
+    Bind(wxEVT_MOUSE_CAPTURE_LOST, &TextView::OnCaptureLost, this);
+    Bind(wxEVT_KEY_DOWN, &TextView::OnKeyDown, this);
+    Bind(wxEVT_CHAR, &TextView::OnChar, this);
+}
+
+void TextView::Reset(const std::string& eol) {
+    m_eol = eol;
+    m_undo.clear();
+    m_redo.clear();
+    m_lastEdit = EDIT_OTHER;
+    m_version = ++m_lastVersion;
+    m_anchor = m_caret = 0;
+    m_preferredX = -1;
+    m_topLine = 0;
+    m_scrollX = 0;
+    m_maxWidth = 0;
+    UpdateGutter();
+    Invalidate();
+    Notify(EVT_DOCUMENT_CHANGED);
+    Notify(EVT_CARET_MOVED);
+}
+
+void TextView::DocumentAppended() {
+    UpdateGutter();
+    Invalidate();
+}
+
+void TextView::SetTextFont(const wxFont& font) {
+    m_font = font;
+    wxClientDC dc(this);
+    dc.SetFont(m_font);
+    m_charWidth = std::max(1, dc.GetTextExtent("0").x);
+    m_lineHeight = std::max(1, dc.GetCharHeight());
+    GetCaret()->SetSize(2, m_lineHeight);
+    m_maxWidth = 0;
+    UpdateGutter();
+    Invalidate();
+}
+
+void TextView::ShowLineNumbers(bool show) {
+    m_showLineNumbers = show;
+    UpdateGutter();
+    Invalidate();
+}
+
+void TextView::UpdateGutter() {
+    int width = 0;
+    if (m_showLineNumbers) {
+        int digits = 1;
+        for (size_t n = m_doc.GetLineCount(); n >= 10; n /= 10) {
+            digits++;
+        }
+        width = (std::max(digits, 3) + 2) * m_charWidth;
+    }
+    if (width != m_gutterWidth) {
+        m_gutterWidth = width;
+        m_layoutValid = false;
+    }
+}
+
+// ==================== 排版 ====================
+
+void TextView::Invalidate() {
+    m_layoutValid = false;
+    UpdateScrollbars();
+    UpdateCaret();
+    Refresh();
+}
+
+size_t TextView::GetFullRows() const {
+    return size_t(std::max(1, GetClientSize().y / m_lineHeight));
+}
+
+// 把一行的字节解码成显示文字：制表符展开成空格，控制字符显示为对应的控制图形符号
+static void DecodeLine(const std::string& bytes, size_t length,
+                       wxString& text, std::vector<size_t>& offsets, int tabWidth) {
+    text.clear();
+    offsets.clear();
+    size_t column = 0;
+    size_t i = 0;
+    while (i < length) {
+        uint32_t cp;
+        size_t n = editor::DecodeUtf8(bytes.data() + i, length - i, cp);
+        if (cp == '\t') {
+            size_t spaces = tabWidth - column % tabWidth;
+            text.append(spaces, ' ');
+            offsets.insert(offsets.end(), spaces, i);
+            column += spaces;
+        } else {
+            if (cp < 0x20) {
+                cp += 0x2400;   // ␀ ␁ ...
+            } else if (cp == 0x7F) {
+                cp = 0x2421;    // ␡
+            }
+            size_t before = text.length();
+            text += wxUniChar(cp);
+            offsets.insert(offsets.end(), text.length() - before, i);  // UTF-16 平台上可能是两个代理项
+            column++;
+        }
+        i += n;
+    }
+    offsets.push_back(length);
+}
+
+void TextView::EnsureLayout() {
+    if (m_layoutValid) {
+        return;
+    }
+    m_layoutValid = true;
+
+    // 多读一行，窗口底部露出半行时也能画出来
+    size_t count = m_doc.ReadLines(m_topLine, GetFullRows() + 1, m_lineBytes, m_lineStarts,
+                                   kMaxLineBytes);
+    size_t lastLine = m_doc.GetLineCount() - 1;
+    m_visible.resize(count);
+
+    wxClientDC dc(this);
+    dc.SetFont(m_font);
+    for (size_t i = 0; i < count; i++) {
+        VisibleLine& line = m_visible[i];
+        const std::string& bytes = m_lineBytes[i];
+        line.start = m_lineStarts[i];
+        line.length = bytes.size();
+        // CRLF 文件的行尾 \r 不显示，光标也不能停在 \r 和 \n 之间
+        if (m_topLine + i < lastLine && line.length > 0 && bytes[line.length - 1] == '\r') {
+            line.length--;
+        }
+        DecodeLine(bytes, line.length, line.text, line.offsets, kTabWidth);
+        line.widths.clear();
+        if (!line.text.empty()) {
+            dc.GetPartialTextExtents(line.text, line.widths);
+            m_maxWidth = std::max(m_maxWidth, line.widths.Last());
+        }
+    }
+}
+
+const TextView::VisibleLine* TextView::FindVisible(size_t line) const {
+    if (!m_layoutValid || line < m_topLine || line - m_topLine >= m_visible.size()) {
+        return NULL;
+    }
+    return &m_visible[line - m_topLine];
+}
+
+// 行内字节偏移 offset 处的 x（相对文字左端）
+int TextView::GetByteX(const VisibleLine& line, size_t offset) const {
+    size_t k = size_t(std::lower_bound(line.offsets.begin(), line.offsets.end(), offset) -
+                      line.offsets.begin());
+    k = std::min(k, line.offsets.size() - 1);
+    return k == 0 ? 0 : line.widths[k - 1];
+}
+
+// 第 line 行上离 x（相对文字左端）最近的字符边界
+size_t TextView::HitTestLine(size_t line, int x) {
+    EnsureLayout();
+    const VisibleLine* visible = FindVisible(line);
+    if (!visible) {
+        return m_doc.GetLineStart(line);
+    }
+    for (size_t k = 0; k < visible->widths.size(); k++) {
+        int left = k == 0 ? 0 : visible->widths[k - 1];
+        if (x < (left + visible->widths[k]) / 2) {
+            return visible->start + visible->offsets[k];
+        }
+    }
+    return visible->start + visible->offsets.back();
+}
+
+void TextView::UpdateScrollbars() {
+    size_t rows = GetFullRows();
+    size_t lines = m_doc.GetLineCount();
+    SetScrollbar(wxVERTICAL, int(m_topLine), int(rows), int(lines));
+
+    int width = std::max(1, GetClientSize().x - m_gutterWidth);
+    int range = m_maxWidth + kTextMargin + m_charWidth;
+    if (range <= width) {
+        m_scrollX = 0;
+    }
+    SetScrollbar(wxHORIZONTAL, m_scrollX, width, range);
+}
+
+void TextView::UpdateCaret() {
+    EnsureLayout();
+    wxCaret* caret = GetCaret();
+    const VisibleLine* line = FindVisible(m_doc.GetLineOfOffset(m_caret));
+    if (!line) {
+        caret->Hide();
+        return;
+    }
+    int x = GetTextLeft() + GetByteX(*line, m_caret - line->start);
+    int y = int(line - &m_visible[0]) * m_lineHeight;
+    caret->Move(x, y);
+    caret->Show(x >= m_gutterWidth);
+}
+
+void TextView::OnPaint(wxPaintEvent& event) {
+    wxAutoBufferedPaintDC dc(this);
+    EnsureLayout();
+
+    wxSize size = GetClientSize();
+    dc.SetBackground(*wxWHITE_BRUSH);
+    dc.Clear();
+    dc.SetFont(m_font);
+    dc.SetTextForeground(*wxBLACK);
+
+    size_t from, to;
+    GetSelection(from, to);
+    int left = GetTextLeft();
+    size_t lastLine = m_doc.GetLineCount() - 1;
+
+    dc.SetClippingRegion(m_gutterWidth, 0, size.x - m_gutterWidth, size.y);
+    dc.SetPen(*wxTRANSPARENT_PEN);
+    dc.SetBrush(wxBrush(wxColour(173, 214, 255)));
+    for (size_t i = 0; i < m_visible.size(); i++) {
+        const VisibleLine& line = m_visible[i];
+        int y = int(i) * m_lineHeight;
+
+        // 选区：跨过行尾时多画一个字符宽度，表示换行符也被选中
+        size_t end = line.start + line.length;
+        if (from < to && to > line.start && from <= end) {
+            int x1 = GetByteX(line, from > line.start ? from - line.start : 0);
+            int x2 = to > end && m_topLine + i < lastLine
+                ? GetByteX(line, line.length) + m_charWidth
+                : GetByteX(line, std::min(to, end) - line.start);
+            if (x2 > x1) {
+                dc.DrawRectangle(left + x1, y, x2 - x1, m_lineHeight);
+            }
+        }
+        if (!line.text.empty()) {
+            dc.DrawText(line.text, left, y);
+        }
+    }
+    dc.DestroyClippingRegion();
+
+    // 行号
+    if (m_showLineNumbers) {
+        dc.SetBrush(wxBrush(wxColour(240, 240, 240)));
+        dc.DrawRectangle(0, 0, m_gutterWidth, size.y);
+        dc.SetTextForeground(wxColour(140, 140, 140));
+        for (size_t i = 0; i < m_visible.size(); i++) {
+            wxString number = wxString::Format("%llu", (unsigned long long)(m_topLine + i + 1));
+            int width = dc.GetTextExtent(number).x;
+            dc.DrawText(number, m_gutterWidth - m_charWidth - width, int(i) * m_lineHeight);
+        }
+    }
+}
+
+void TextView::OnSize(wxSizeEvent& event) {
+    Invalidate();
+    event.Skip();
+}
+
+// ==================== 滚动 ====================
+
+void TextView::ScrollToLine(size_t top) {
+    size_t lines = m_doc.GetLineCount();
+    size_t rows = GetFullRows();
+    size_t maxTop = lines > rows ? lines - rows : 0;
+    top = std::min(top, maxTop);
+    if (top != m_topLine) {
+        m_topLine = top;
+        Invalidate();
+    }
+}
+
+void TextView::EnsureCaretVisible() {
+    size_t line = m_doc.GetLineOfOffset(m_caret);
+    size_t rows = GetFullRows();
+    if (line < m_topLine) {
+        ScrollToLine(line);
+    } else if (line >= m_topLine + rows) {
+        ScrollToLine(line - rows + 1);
+    }
+
+    EnsureLayout();
+    const VisibleLine* visible = FindVisible(line);
+    if (!visible) {
+        return;
+    }
+    int x = GetByteX(*visible, m_caret - visible->start);
+    int width = GetClientSize().x - m_gutterWidth - kTextMargin;
+    int scrollX = m_scrollX;
+    if (x < scrollX) {
+        scrollX = std::max(0, x - width / 3);
+    } else if (x > scrollX + width - m_charWidth) {
+        scrollX = x - width + width / 3;
+    }
+    if (scrollX != m_scrollX) {
+        m_scrollX = scrollX;
+        Invalidate();
+    }
+}
+
+void TextView::OnScroll(wxScrollWinEvent& event) {
+    wxEventType type = event.GetEventType();
+    bool vertical = event.GetOrientation() == wxVERTICAL;
+    long page = vertical ? long(GetFullRows()) - 1 : GetClientSize().x / 2;
+    long step = vertical ? 1 : m_charWidth * 4;
+    long current = vertical ? long(m_topLine) : m_scrollX;
+    long position = current;
+
+    if (type == wxEVT_SCROLLWIN_TOP) {
+        position = 0;
+    } else if (type == wxEVT_SCROLLWIN_BOTTOM) {
+        position = vertical ? long(m_doc.GetLineCount()) : m_maxWidth;
+    } else if (type == wxEVT_SCROLLWIN_LINEUP) {
+        position = current - step;
+    } else if (type == wxEVT_SCROLLWIN_LINEDOWN) {
+        position = current + step;
+    } else if (type == wxEVT_SCROLLWIN_PAGEUP) {
+        position = current - std::max(1L, page);
+    } else if (type == wxEVT_SCROLLWIN_PAGEDOWN) {
+        position = current + std::max(1L, page);
+    } else {
+        position = event.GetPosition();
+    }
+    position = std::max(0L, position);
+
+    if (vertical) {
+        ScrollToLine(size_t(position));
+    } else {
+        int width = GetClientSize().x - m_gutterWidth;
+        m_scrollX = int(std::min(position, long(std::max(0, m_maxWidth + kTextMargin + m_charWidth - width))));
+        Invalidate();
+    }
+}
+
+void TextView::OnMouseWheel(wxMouseEvent& event) {
+    int steps = event.GetWheelRotation() / std::max(1, event.GetWheelDelta());
+    if (event.GetWheelAxis() == wxMOUSE_WHEEL_HORIZONTAL || event.ShiftDown()) {
+        int width = GetClientSize().x - m_gutterWidth;
+        int maxX = std::max(0, m_maxWidth + kTextMargin + m_charWidth - width);
+        int sign = event.GetWheelAxis() == wxMOUSE_WHEEL_HORIZONTAL ? 1 : -1;
+        m_scrollX = std::max(0, std::min(maxX, m_scrollX + sign * steps * m_charWidth * 8));
+        Invalidate();
+        return;
+    }
+    long lines = -long(steps) * event.GetLinesPerAction();
+    long top = std::max(0L, long(m_topLine) + lines);
+    ScrollToLine(size_t(top));
+}
+
+// ==================== 光标和选区 ====================
+
+void TextView::GetSelection(size_t& from, size_t& to) const {
+    from = std::min(m_anchor, m_caret);
+    to = std::max(m_anchor, m_caret);
+}
+
+void TextView::SetSelection(size_t anchor, size_t caret) {
+    size_t length = m_doc.GetLength();
+    m_anchor = std::min(anchor, length);
+    MoveCaret(caret, true);
+}
+
+std::string TextView::GetSelectedText() const {
+    size_t from, to;
+    GetSelection(from, to);
+    return m_doc.GetText(from, to - from);
+}
+
+void TextView::MoveCaret(size_t pos, bool extend, bool keepColumn) {
+    m_caret = std::min(pos, m_doc.GetLength());
+    if (!extend) {
+        m_anchor = m_caret;
+    }
+    if (!keepColumn) {
+        m_preferredX = -1;
+    }
+    m_lastEdit = EDIT_OTHER;
+    EnsureCaretVisible();
+    UpdateCaret();
+    Refresh();
+    Notify(EVT_CARET_MOVED);
+}
+
+// 行尾：下一行行首前的换行符（CRLF 时是 \r）所在的位置
+size_t TextView::GetLineEnd(size_t line) const {
+    if (line + 1 >= m_doc.GetLineCount()) {
+        return m_doc.GetLength();
+    }
+    size_t end = m_doc.GetLineStart(line + 1) - 1;
+    if (end > m_doc.GetLineStart(line) && m_doc.GetByte(end - 1) == '\r') {
+        end--;
+    }
+    return end;
+}
+
+// 向后移动一个字符：跳过整个 UTF-8 序列，CRLF 当作一个字符
+size_t TextView::NextCharPos(size_t pos) const {
+    std::string bytes = m_doc.GetText(pos, 4);
+    if (bytes.empty()) {
+        return pos;
+    }
+    if (bytes[0] == '\r' && bytes.size() > 1 && bytes[1] == '\n') {
+        return pos + 2;
+    }
+    uint32_t cp;
+    return pos + editor::DecodeUtf8(bytes.data(), bytes.size(), cp);
+}
+
+size_t TextView::PrevCharPos(size_t pos) const {
+    if (pos == 0) {
+        return 0;
+    }
+    size_t from = pos >= 4 ? pos - 4 : 0;
+    std::string bytes = m_doc.GetText(from, pos - from);
+    size_t n = bytes.size();
+    if (n >= 2 && bytes[n - 2] == '\r' && bytes[n - 1] == '\n') {
+        return pos - 2;
+    }
+    // 退过续字节找到序列开头，只有它恰好解码到 pos 时才整体退回，否则按坏字节退一个
+    size_t start = n - 1;
+    while (start > 0 && editor::IsContinuationByte((unsigned char)bytes[start])) {
+        start--;
+    }
+    uint32_t cp;
+    if (editor::DecodeUtf8(bytes.data() + start, n - start, cp) == n - start) {
+        return from + start;
+    }
+    return pos - 1;
+}
+
+void TextView::MoveVertical(long lines, bool extend) {
+    size_t line = m_doc.GetLineOfOffset(m_caret);
+    if (m_preferredX < 0) {
+        EnsureLayout();
+        const VisibleLine* visible = FindVisible(line);
+        m_preferredX = visible ? GetByteX(*visible, m_caret - visible->start) : 0;
+    }
+    long target = long(line) + lines;
+    target = std::max(0L, std::min(target, long(m_doc.GetLineCount()) - 1));
+
+    // 先把目标行滚进窗口，才能按 x 在那一行上定位
+    size_t rows = GetFullRows();
+    if (size_t(target) < m_topLine) {
+        ScrollToLine(size_t(target));
+    } else if (size_t(target) >= m_topLine + rows) {
+        ScrollToLine(size_t(target) - rows + 1);
+    }
+    MoveCaret(HitTestLine(size_t(target), m_preferredX), extend, true);
+}
+
+size_t TextView::PositionFromPoint(const wxPoint& pt) {
+    long row = pt.y >= 0 ? pt.y / m_lineHeight : -1;   // 拖出窗口上方时指向上一行
+    long line = long(m_topLine) + row;
+    line = std::max(0L, std::min(line, long(m_doc.GetLineCount()) - 1));
+    size_t rows = GetFullRows();
+    if (size_t(line) < m_topLine) {
+        ScrollToLine(size_t(line));
+    } else if (size_t(line) >= m_topLine + rows) {
+        ScrollToLine(size_t(line) - rows + 1);
+    }
+    return HitTestLine(size_t(line), pt.x - GetTextLeft());
+}
+
+void TextView::OnMouseDown(wxMouseEvent& event) {
+    SetFocus();
+    MoveCaret(PositionFromPoint(event.GetPosition()), event.ShiftDown());
+    m_selecting = true;
+    CaptureMouse();
+}
+
+void TextView::OnMouseMove(wxMouseEvent& event) {
+    if (m_selecting && event.LeftIsDown()) {
+        MoveCaret(PositionFromPoint(event.GetPosition()), true);
+    }
+}
+
+void TextView::OnMouseUp(wxMouseEvent& event) {
+    if (m_selecting) {
+        m_selecting = false;
+        if (HasCapture()) {
+            ReleaseMouse();
+        }
+    }
+}
+
+void TextView::OnCaptureLost(wxMouseCaptureLostEvent& event) {
+    m_selecting = false;
+}
+
+// ==================== 键盘 ====================
+
+// 导航和编辑键在这里处理，可打印字符留给 OnChar
+void TextView::OnKeyDown(wxKeyEvent& event) {
+    bool shift = event.ShiftDown();
+    bool ctrl = event.CmdDown();
+    size_t from, to;
+    GetSelection(from, to);
+    size_t line = m_doc.GetLineOfOffset(m_caret);
+    long page = std::max(1L, long(GetFullRows()) - 1);
+
+    switch (event.GetKeyCode()) {
+        case WXK_LEFT:
+            MoveCaret(HasSelection() && !shift ? from : PrevCharPos(m_caret), shift);
+            break;
+        case WXK_RIGHT:
+            MoveCaret(HasSelection() && !shift ? to : NextCharPos(m_caret), shift);
+            break;
+        case WXK_UP:
+            MoveVertical(-1, shift);
+            break;
+        case WXK_DOWN:
+            MoveVertical(1, shift);
+            break;
+        case WXK_PAGEUP:
+            ScrollToLine(m_topLine > size_t(page) ? m_topLine - page : 0);
+            MoveVertical(-page, shift);
+            break;
+        case WXK_PAGEDOWN:
+            ScrollToLine(m_topLine + page);
+            MoveVertical(page, shift);
+            break;
+        case WXK_HOME:
+            MoveCaret(ctrl ? 0 : m_doc.GetLineStart(line), shift);
+            break;
+        case WXK_END:
+            MoveCaret(ctrl ? m_doc.GetLength() : GetLineEnd(line), shift);
+            break;
+        case WXK_BACK:
+            if (HasSelection()) {
+                ReplaceSelection(std::string());
+            } else if (m_caret > 0) {
+                size_t prev = PrevCharPos(m_caret);
+                size_t caret = m_caret;
+                Edit([prev, caret](editor::PieceTable& doc) { doc.Erase(prev, caret - prev); },
+                     prev, prev, EDIT_DELETING);
+            }
+            break;
+        case WXK_DELETE:
+            if (HasSelection()) {
+                ReplaceSelection(std::string());
+            } else if (m_caret < m_doc.GetLength()) {
+                size_t next = NextCharPos(m_caret);
+                size_t caret = m_caret;
+                Edit([caret, next](editor::PieceTable& doc) { doc.Erase(caret, next - caret); },
+                     caret, caret, EDIT_DELETING);
+            }
+            break;
+        case WXK_RETURN:
+        case WXK_NUMPAD_ENTER:
+            ReplaceSelection(m_eol);
+            break;
+        case WXK_TAB:
+            if (ctrl) {
+                event.Skip();   // Ctrl+Tab 留给焦点切换
+            } else {
+                ReplaceSelection("\t", EDIT_TYPING);
+            }
+            break;
+        default:
+            event.Skip();
+            break;
+    }
+}
+
+void TextView::OnChar(wxKeyEvent& event) {
+    // Ctrl 组合键交给菜单快捷键；AltGr（Ctrl+Alt）在一些键盘布局上用来输入字符
+    if (event.CmdDown() && !event.AltDown()) {
+        event.Skip();
+        return;
+    }
+    wxChar ch = event.GetUnicodeKey();
+    if (ch == WXK_NONE || ch < 0x20 || ch == 0x7F) {
+        event.Skip();
+        return;
+    }
+    std::string text;
+    editor::AppendUtf8(text, uint32_t(ch));
+    ReplaceSelection(text, EDIT_TYPING);
+}
+
+// ==================== 修改和撤销 ====================
+
+void TextView::PushUndo() {
+    UndoState state = { m_doc, m_anchor, m_caret, m_version };
+    m_undo.push_back(state);
+    if (m_undo.size() > kMaxUndo) {
+        m_undo.pop_front();
+    }
+}
+
+void TextView::Edit(const std::function<void(editor::PieceTable&)>& change,
+                    size_t anchor, size_t caret, int kind) {
+    if (m_readOnly) {
+        wxBell();
+        return;
+    }
+    // 连续输入（或连续删除）时只在第一次记录快照，撤销时整段一起撤销
+    if (kind == EDIT_OTHER || kind != m_lastEdit) {
+        PushUndo();
+    }
+    m_redo.clear();
+
+    change(m_doc);
+    m_version = ++m_lastVersion;
+
+    size_t length = m_doc.GetLength();
+    m_anchor = std::min(anchor, length);
+    m_caret = std::min(caret, length);
+    m_preferredX = -1;
+    UpdateGutter();
+    Invalidate();
+    EnsureCaretVisible();
+    UpdateCaret();
+    m_lastEdit = kind;
+    Notify(EVT_DOCUMENT_CHANGED);
+    Notify(EVT_CARET_MOVED);
+}
+
+void TextView::ReplaceSelection(const std::string& text, int kind) {
+    size_t from, to;
+    GetSelection(from, to);
+    if (from != to) {
+        kind = EDIT_OTHER;   // 替换选区总是单独的一步
+    }
+    size_t caret = from + text.size();
+    Edit([from, to, &text](editor::PieceTable& doc) {
+        doc.Erase(from, to - from);
+        doc.Insert(from, text);
+    }, caret, caret, kind);
+}
+
+void TextView::Restore(const UndoState& state) {
+    m_doc = state.document;
+    m_anchor = state.anchor;
+    m_caret = state.caret;
+    m_version = state.version;
+    m_preferredX = -1;
+    m_lastEdit = EDIT_OTHER;
+    UpdateGutter();
+    Invalidate();
+    EnsureCaretVisible();
+    UpdateCaret();
+    Notify(EVT_DOCUMENT_CHANGED);
+    Notify(EVT_CARET_MOVED);
+}
+
+void TextView::Undo() {
+    if (m_undo.empty()) {
+        return;
+    }
+    UndoState current = { m_doc, m_anchor, m_caret, m_version };
+    m_redo.push_back(current);
+    UndoState state = m_undo.back();
+    m_undo.pop_back();
+    Restore(state);
+}
+
+void TextView::Redo() {
+    if (m_redo.empty()) {
+        return;
+    }
+    PushUndo();
+    UndoState state = m_redo.back();
+    m_redo.pop_back();
+    Restore(state);
+}
+
+void TextView::Notify(wxEventType type) {
+    wxCommandEvent event(type, GetId());
+    event.SetEventObject(this);
+    ProcessWindowEvent(event);   // 命令事件会继续传给父窗口
+}
+
+// ==================== IndexThread ====================
+
+wxThread::ExitCode IndexThread::Entry() {
+    while (!m_index->IsCancelled()) {
+        bool done = m_index->Advance(kChunksPerReport);
+        wxQueueEvent(m_handler, new wxThreadEvent(EVT_INDEX_PROGRESS));
+        if (done) {
+            break;
+        }
+    }
+    return (ExitCode)0;
+}
+
+// ==================== SaveThread ====================
+
+// 把文件内容刷到磁盘：POSIX 上 wxFile::Flush() 调用 fsync，Windows 上用 _commit
+static bool SyncFile(wxFile& file) {
+#ifdef __WINDOWS__
+    return _commit(file.fd()) == 0;
+#else
+    return file.Flush();
+#endif
+}
+
+// 用写好的临时文件替换目标文件，要么换成新文件，要么原文件不动。
+// 不能用 wxRenameFile：目标已存在时它在 Windows 上会退回到 wxCopyFile 原地覆盖，
+// 复制到一半崩溃，目标文件就只剩半个
+static bool ReplaceWithTemp(const wxString& temp, const wxString& target) {
+#ifdef __WINDOWS__
+    return ::MoveFileExW(temp.wc_str(), target.wc_str(),
+                         MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(temp.fn_str(), target.fn_str()) == 0;  // 同一目录内的 rename() 是原子的
+#endif
+}
+
+// 改名本身也要落盘：POSIX 上还要 fsync 文件所在的目录
+static void SyncDirectory(const wxString& path) {
+#ifndef __WINDOWS__
+    wxString dir = wxFileName(path).GetPath();
+    int fd = open(dir.IsEmpty() ? "." : static_cast<const char*>(dir.fn_str()), O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+#endif
+}
+
+// 新建的临时文件沿用目标文件原来的权限
+static void CopyPermissions(const wxString& from, wxFile& to) {
+#ifndef __WINDOWS__
+    struct stat st;
+    if (stat(from.fn_str(), &st) == 0) {
+        fchmod(to.fd(), st.st_mode & 07777);
+    }
+#endif
+}
+
+wxThread::ExitCode SaveThread::Entry() {
+    wxLogNull noLog;  // 错误通过完成事件报告，不在工作线程上弹出日志窗口
+
+    wxString temp = m_path + ".part";
+    wxFile file;
+    if (!file.Create(temp, true)) {
+        return Finish(false, "无法创建临时文件: " + temp);
+    }
+    CopyPermissions(m_path, file);
+
+    bool ok = WriteTo(file) && SyncFile(file);
+    ok = file.Close() && ok;
+    if (!ok) {
+        wxRemoveFile(temp);
+        return Finish(false, "写入失败（磁盘已满或没有权限？）: " + temp);
+    }
+    if (!ReplaceWithTemp(temp, m_path)) {
+        wxRemoveFile(temp);
+        return Finish(false, "无法替换文件: " + m_path);
+    }
+    SyncDirectory(m_path);
+    return Finish(true, "");
+}
+
+// 片段内容复制进一块大缓冲，满了才写一次；进度按百分比变化通知
+bool SaveThread::WriteTo(wxFile& file) {
+    std::unique_ptr<char[]> buffer(new char[kBufferSize]);
+    size_t used = 0;
+    size_t written = 0;
+    size_t total = m_snapshot.GetLength();
+    int percent = -1;
+    bool ok = true;
+
+    m_snapshot.ForEachChunk(0, editor::PieceTable::npos, [&](const char* text, size_t length) {
+        while (length > 0) {
+            size_t n = std::min(length, size_t(kBufferSize) - used);
+            memcpy(buffer.get() + used, text, n);
+            used += n;
+            text += n;
+            length -= n;
+            if (used < kBufferSize) {
+                continue;
+            }
+            ok = file.Write(buffer.get(), used) == used;
+            if (!ok) {
+                return false;
+            }
+            written += used;
+            used = 0;
+            int now = int(uint64_t(written) * 100 / total);
+            if (now != percent) {
+                percent = now;
+                wxThreadEvent* event = new wxThreadEvent(EVT_SAVE_PROGRESS);
+                event->SetInt(percent);
+                wxQueueEvent(m_handler, event);
+            }
+        }
+        return true;
+    });
+    if (ok && used > 0) {
+        ok = file.Write(buffer.get(), used) == used;
+    }
+    return ok;
+}
+
+wxThread::ExitCode SaveThread::Finish(bool ok, const wxString& error) {
+    m_snapshot = editor::PieceTable();  // 尽早放开快照，撤销历史之外不再多占内存
+    m_ok = ok;
+    m_error = error.Clone();
+    m_finished = true;
+    wxQueueEvent(m_handler, new wxThreadEvent(EVT_SAVE_DONE));
+    return (ExitCode)0;
+}
+
+// ==================== MyFrame ====================
+
 MyFrame::MyFrame()
     : wxFrame(NULL, wxID_ANY, "文本编辑器", wxDefaultPosition, wxSize(800, 600)),
-      m_modified(false) {
-    
+      m_modified(false), m_savedVersion(0), m_indexThread(NULL), m_indexedChunks(0),
+      m_saveThread(NULL), m_savingVersion(0) {
+
     // ==================== 创建菜单栏 ====================
-    
+
     // 文件菜单
     wxMenu* menuFile = new wxMenu;
     menuFile->Append(ID_NEW, "新建\tCtrl-N", "创建新文档");
@@ -95,7 +1235,7 @@ MyFrame::MyFrame()
     menuFile->Append(wxID_SAVEAS, "另存为...\tCtrl-Shift-S", "另存为新文件");
     menuFile->AppendSeparator();
     menuFile->Append(wxID_EXIT, "退出\tAlt-F4", "退出程序");
-    
+
     // 编辑菜单
     wxMenu* menuEdit = new wxMenu;
     menuEdit->Append(wxID_UNDO, "撤销\tCtrl-Z", "撤销上一步操作");
@@ -110,17 +1250,18 @@ MyFrame::MyFrame()
     menuEdit->Append(ID_FIND, "查找...\tCtrl-F", "查找文本");
     menuEdit->Append(ID_REPLACE, "替换...\tCtrl-H", "替换文本");
     menuEdit->Append(ID_GOTO_LINE, "转到行...\tCtrl-G", "跳转到指定行");
-    
+
     // 视图菜单
     wxMenu* menuView = new wxMenu;
-    menuView->AppendCheckItem(ID_WORD_WRAP, "自动换行", "启用/禁用自动换行");
+    menuView->AppendCheckItem(ID_LINE_NUMBERS, "行号", "显示/隐藏行号");
+    menuView->Check(ID_LINE_NUMBERS, true);
     menuView->AppendSeparator();
     menuView->Append(ID_FONT, "字体...", "选择字体");
-    
+
     // 帮助菜单
     wxMenu* menuHelp = new wxMenu;
     menuHelp->Append(wxID_ABOUT, "关于", "关于此程序");
-    
+
     // 创建菜单栏
     wxMenuBar* menuBar = new wxMenuBar;
     menuBar->Append(menuFile, "文件(&F)");
@@ -128,10 +1269,10 @@ MyFrame::MyFrame()
     menuBar->Append(menuView, "视图(&V)");
     menuBar->Append(menuHelp, "帮助(&H)");
     SetMenuBar(menuBar);
-    
+
     // ==================== 创建工具栏 ====================
     wxToolBar* toolBar = CreateToolBar();
-    
+
     toolBar->AddTool(ID_NEW, "新建",
                     wxArtProvider::GetBitmap(wxART_NEW, wxART_TOOLBAR),
                     "新建文件");
@@ -142,7 +1283,7 @@ MyFrame::MyFrame()
                     wxArtProvider::GetBitmap(wxART_FILE_SAVE, wxART_TOOLBAR),
                     "保存文件");
     toolBar->AddSeparator();
-    
+
     toolBar->AddTool(wxID_CUT, "剪切",
                     wxArtProvider::GetBitmap(wxART_CUT, wxART_TOOLBAR),
                     "剪切");
@@ -153,7 +1294,7 @@ MyFrame::MyFrame()
                     wxArtProvider::GetBitmap(wxART_PASTE, wxART_TOOLBAR),
                     "粘贴");
     toolBar->AddSeparator();
-    
+
     toolBar->AddTool(wxID_UNDO, "撤销",
                     wxArtProvider::GetBitmap(wxART_UNDO, wxART_TOOLBAR),
                     "撤销");
@@ -161,31 +1302,26 @@ MyFrame::MyFrame()
                     wxArtProvider::GetBitmap(wxART_REDO, wxART_TOOLBAR),
                     "重做");
     toolBar->AddSeparator();
-    
+
     toolBar->AddTool(ID_FIND, "查找",
                     wxArtProvider::GetBitmap(wxART_FIND, wxART_TOOLBAR),
                     "查找");
-    
+
     toolBar->Realize();
-    
+
     // ==================== 创建状态栏 ====================
     CreateStatusBar(3);
     SetStatusText("就绪", 0);
     SetStatusText("行 1, 列 1", 1);
     SetStatusText("长度: 0", 2);
-    
-    int widths[3] = {-1, 120, 100};
+
+    int widths[3] = {-1, 120, 160};
     SetStatusWidths(3, widths);
-    
-    // ==================== 创建文本编辑器 ====================
-    m_textCtrl = new wxTextCtrl(this, wxID_ANY, "",
-                               wxDefaultPosition, wxDefaultSize,
-                               wxTE_MULTILINE | wxTE_RICH2 | wxTE_PROCESS_TAB);
-    
-    // 设置默认字体
-    wxFont font(10, wxFONTFAMILY_TELETYPE, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL);
-    m_textCtrl->SetFont(font);
-    
+
+    // ==================== 创建文本视图 ====================
+    // 视图只持有文档的引用：打开、保存、查找替换都由 MyFrame 直接操作 m_document
+    m_view = new TextView(this, m_document);
+
     // ==================== 绑定事件 ====================
     Bind(wxEVT_MENU, &MyFrame::OnNew, this, ID_NEW);
     Bind(wxEVT_MENU, &MyFrame::OnOpen, this, wxID_OPEN);
@@ -193,7 +1329,7 @@ MyFrame::MyFrame()
     Bind(wxEVT_MENU, &MyFrame::OnSaveAs, this, wxID_SAVEAS);
     Bind(wxEVT_MENU, &MyFrame::OnExit, this, wxID_EXIT);
     Bind(wxEVT_CLOSE_WINDOW, &MyFrame::OnClose, this);
-    
+
     Bind(wxEVT_MENU, &MyFrame::OnUndo, this, wxID_UNDO);
     Bind(wxEVT_MENU, &MyFrame::OnRedo, this, wxID_REDO);
     Bind(wxEVT_MENU, &MyFrame::OnCut, this, wxID_CUT);
@@ -203,15 +1339,32 @@ MyFrame::MyFrame()
     Bind(wxEVT_MENU, &MyFrame::OnFind, this, ID_FIND);
     Bind(wxEVT_MENU, &MyFrame::OnReplace, this, ID_REPLACE);
     Bind(wxEVT_MENU, &MyFrame::OnGotoLine, this, ID_GOTO_LINE);
-    
-    Bind(wxEVT_MENU, &MyFrame::OnWordWrap, this, ID_WORD_WRAP);
+
+    Bind(wxEVT_MENU, &MyFrame::OnLineNumbers, this, ID_LINE_NUMBERS);
     Bind(wxEVT_MENU, &MyFrame::OnFont, this, ID_FONT);
-    
+
     Bind(wxEVT_MENU, &MyFrame::OnAbout, this, wxID_ABOUT);
-    
-    m_textCtrl->Bind(wxEVT_TEXT, &MyFrame::OnTextChanged, this);
-    m_textCtrl->Bind(wxEVT_UPDATE_UI, &MyFrame::OnUpdateUI, this);
-    
+
+    Bind(EVT_DOCUMENT_CHANGED, &MyFrame::OnDocumentChanged, this);
+    Bind(EVT_CARET_MOVED, &MyFrame::OnCaretMoved, this);
+    Bind(EVT_INDEX_PROGRESS, &MyFrame::OnIndexProgress, this);
+    Bind(EVT_SAVE_PROGRESS, &MyFrame::OnSaveProgress, this);
+    Bind(EVT_SAVE_DONE, &MyFrame::OnSaveDone, this);
+    Bind(wxEVT_UPDATE_UI, &MyFrame::OnUpdateUI, this, ID_NEW);
+    Bind(wxEVT_UPDATE_UI, &MyFrame::OnUpdateUI, this, wxID_OPEN);
+    Bind(wxEVT_UPDATE_UI, &MyFrame::OnUpdateUI, this, wxID_SAVE);
+    Bind(wxEVT_UPDATE_UI, &MyFrame::OnUpdateUI, this, wxID_SAVEAS);
+    Bind(wxEVT_UPDATE_UI, &MyFrame::OnUpdateUI, this, wxID_UNDO);
+    Bind(wxEVT_UPDATE_UI, &MyFrame::OnUpdateUI, this, wxID_REDO);
+    Bind(wxEVT_UPDATE_UI, &MyFrame::OnUpdateUI, this, wxID_CUT);
+    Bind(wxEVT_UPDATE_UI, &MyFrame::OnUpdateUI, this, wxID_COPY);
+    Bind(wxEVT_UPDATE_UI, &MyFrame::OnUpdateUI, this, wxID_PASTE);
+    Bind(wxEVT_UPDATE_UI, &MyFrame::OnUpdateUI, this, ID_REPLACE);
+
+    m_view->Reset(DefaultEol());
+    m_savedVersion = m_view->GetVersion();
+    m_view->SetFocus();
+
     Centre();
     UpdateTitle();
 }
@@ -220,9 +1373,12 @@ void MyFrame::OnNew(wxCommandEvent& event) {
     if (!AskSaveChanges()) {
         return;
     }
-    
-    m_textCtrl->Clear();
+
+    StopIndexing();
+    m_document.Clear();
+    m_view->Reset(DefaultEol());
     m_currentFile.Clear();
+    m_savedVersion = m_view->GetVersion();
     m_modified = false;
     UpdateTitle();
     SetStatusText("新建文档", 0);
@@ -232,51 +1388,55 @@ void MyFrame::OnOpen(wxCommandEvent& event) {
     if (!AskSaveChanges()) {
         return;
     }
-    
+
     wxFileDialog openFileDialog(this, "打开文件", "", "",
                                "文本文件 (*.txt)|*.txt|所有文件 (*.*)|*.*",
                                wxFD_OPEN | wxFD_FILE_MUST_EXIST);
-    
+
     if (openFileDialog.ShowModal() == wxID_CANCEL) {
         return;
     }
-    
+
     wxString filename = openFileDialog.GetPath();
+    wxStopWatch watch;
     if (LoadFile(filename)) {
         m_currentFile = filename;
+        m_savedVersion = m_view->GetVersion();
         m_modified = false;
         UpdateTitle();
-        SetStatusText("已打开: " + filename, 0);
+        if (m_indexThread) {
+            SetStatusText(wxString::Format("已打开: %s (%ld ms)，正在建立行索引...",
+                                           filename, watch.Time()), 0);
+        } else {
+            SetStatusText(wxString::Format("已打开: %s (%ld ms)", filename, watch.Time()), 0);
+        }
     }
 }
 
 void MyFrame::OnSave(wxCommandEvent& event) {
+    if (m_saveThread) {
+        return;
+    }
     if (m_currentFile.IsEmpty()) {
         OnSaveAs(event);
     } else {
-        SaveFile(m_currentFile);
-        m_modified = false;
-        UpdateTitle();
-        SetStatusText("已保存", 0);
+        StartSave(m_currentFile);
     }
 }
 
 void MyFrame::OnSaveAs(wxCommandEvent& event) {
+    if (m_saveThread) {
+        return;
+    }
     wxFileDialog saveFileDialog(this, "另存为", "", "",
                                "文本文件 (*.txt)|*.txt",
                                wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
-    
+
     if (saveFileDialog.ShowModal() == wxID_CANCEL) {
         return;
     }
-    
-    wxString filename = saveFileDialog.GetPath();
-    if (SaveFile(filename)) {
-        m_currentFile = filename;
-        m_modified = false;
-        UpdateTitle();
-        SetStatusText("已保存: " + filename, 0);
-    }
+
+    StartSave(saveFileDialog.GetPath());
 }
 
 void MyFrame::OnExit(wxCommandEvent& event) {
@@ -284,46 +1444,82 @@ void MyFrame::OnExit(wxCommandEvent& event) {
 }
 
 void MyFrame::OnClose(wxCloseEvent& event) {
+    WaitForSave();   // 正在进行的保存不能中途放弃，否则目标文件得不到新内容
     if (!AskSaveChanges()) {
         event.Veto();
         return;
     }
+    StopIndexing();  // 索引线程还持有本窗口的指针，先让它停下
     event.Skip();
 }
 
 void MyFrame::OnUndo(wxCommandEvent& event) {
-    m_textCtrl->Undo();
+    m_view->Undo();
 }
 
 void MyFrame::OnRedo(wxCommandEvent& event) {
-    m_textCtrl->Redo();
+    m_view->Redo();
 }
 
 void MyFrame::OnCut(wxCommandEvent& event) {
-    m_textCtrl->Cut();
+    if (CopySelection()) {
+        m_view->ReplaceSelection(std::string());
+    }
 }
 
 void MyFrame::OnCopy(wxCommandEvent& event) {
-    m_textCtrl->Copy();
+    CopySelection();
 }
 
 void MyFrame::OnPaste(wxCommandEvent& event) {
-    m_textCtrl->Paste();
+    if (!wxTheClipboard->Open()) {
+        return;
+    }
+    wxTextDataObject data;
+    bool ok = wxTheClipboard->IsSupported(wxDF_UNICODETEXT) && wxTheClipboard->GetData(data);
+    wxTheClipboard->Close();
+    if (!ok) {
+        return;
+    }
+
+    // 剪贴板里的换行统一换成文档的换行风格
+    std::string text = ToUtf8(data.GetText());
+    std::string converted;
+    converted.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '\r') {
+            continue;
+        }
+        if (text[i] == '\n') {
+            converted += m_view->GetEol();
+        } else {
+            converted += text[i];
+        }
+    }
+    m_view->ReplaceSelection(converted);
 }
 
 void MyFrame::OnSelectAll(wxCommandEvent& event) {
-    m_textCtrl->SelectAll();
+    m_view->SetSelection(0, m_document.GetLength());
 }
 
 void MyFrame::OnFind(wxCommandEvent& event) {
-    wxString text = wxGetTextFromUser("查找:", "查找", "", this);
+    wxString text = wxGetTextFromUser("查找:", "查找", m_findText, this);
     if (!text.IsEmpty()) {
-        long pos = m_textCtrl->GetInsertionPoint();
-        long found = m_textCtrl->GetValue().Find(text, pos);
-        
-        if (found != wxNOT_FOUND) {
-            m_textCtrl->SetSelection(found, found + text.Length());
-            m_textCtrl->SetFocus();
+        m_findText = text;
+        std::string needle = ToUtf8(text);
+
+        // 从当前选区之后开始找，反复查找会依次跳到下一处；到末尾后从头再找一遍
+        size_t from, to;
+        m_view->GetSelection(from, to);
+        size_t found = m_document.Find(needle, to);
+        if (found == editor::PieceTable::npos && to > 0) {
+            found = m_document.Find(needle, 0);
+        }
+
+        if (found != editor::PieceTable::npos) {
+            m_view->SetSelection(found, found + needle.size());
+            m_view->SetFocus();
             SetStatusText("找到: " + text, 0);
         } else {
             wxMessageBox("未找到: " + text, "查找", wxOK | wxICON_INFORMATION);
@@ -333,21 +1529,36 @@ void MyFrame::OnFind(wxCommandEvent& event) {
 }
 
 void MyFrame::OnReplace(wxCommandEvent& event) {
-    // 简单实现
-    wxTextEntryDialog findDlg(this, "查找:", "查找和替换");
+    // 全部替换
+    wxTextEntryDialog findDlg(this, "查找:", "查找和替换", m_findText);
     if (findDlg.ShowModal() != wxID_OK) return;
     wxString findText = findDlg.GetValue();
-    
+    if (findText.IsEmpty()) return;
+    m_findText = findText;
+
     wxTextEntryDialog replaceDlg(this, "替换为:", "查找和替换");
     if (replaceDlg.ShowModal() != wxID_OK) return;
     wxString replaceText = replaceDlg.GetValue();
-    
-    wxString content = m_textCtrl->GetValue();
-    int count = content.Replace(findText, replaceText);
-    
-    if (count > 0) {
-        m_textCtrl->SetValue(content);
-        wxMessageBox(wxString::Format("替换了 %d 处", count),
+
+    // 先找出所有位置，再从后往前替换，前面的位置不受影响；整个替换是一步撤销
+    std::string needle = ToUtf8(findText);
+    std::string replacement = ToUtf8(replaceText);
+    std::vector<size_t> hits;
+    size_t pos = m_document.Find(needle, 0);
+    while (pos != editor::PieceTable::npos) {
+        hits.push_back(pos);
+        pos = m_document.Find(needle, pos + needle.size());
+    }
+
+    if (!hits.empty()) {
+        size_t caret = m_view->GetCaret();
+        m_view->Edit([&](editor::PieceTable& doc) {
+            for (size_t i = hits.size(); i-- > 0; ) {
+                doc.Erase(hits[i], needle.size());
+                doc.Insert(hits[i], replacement);
+            }
+        }, caret, caret);
+        wxMessageBox(wxString::Format("替换了 %lu 处", (unsigned long)hits.size()),
                     "替换", wxOK | wxICON_INFORMATION);
     } else {
         wxMessageBox("未找到要替换的内容", "替换", wxOK | wxICON_INFORMATION);
@@ -355,30 +1566,29 @@ void MyFrame::OnReplace(wxCommandEvent& event) {
 }
 
 void MyFrame::OnGotoLine(wxCommandEvent& event) {
-    long lineCount = m_textCtrl->GetNumberOfLines();
+    long lineCount = long(m_document.GetLineCount());
     long lineNum = wxGetNumberFromUser("跳转到行:", "行号:",
                                       "跳转到行", 1, 1, lineCount, this);
-    
+
     if (lineNum >= 1) {
-        long pos = m_textCtrl->XYToPosition(0, lineNum - 1);
-        m_textCtrl->SetInsertionPoint(pos);
-        m_textCtrl->ShowPosition(pos);
+        size_t pos = m_document.GetLineStart(size_t(lineNum - 1));
+        m_view->SetSelection(pos, pos);
+        m_view->SetFocus();
     }
 }
 
-void MyFrame::OnWordWrap(wxCommandEvent& event) {
-    // 注意：切换自动换行需要重新创建控件
-    wxMessageBox("自动换行功能需要重启应用生效", "提示", wxOK | wxICON_INFORMATION);
+void MyFrame::OnLineNumbers(wxCommandEvent& event) {
+    m_view->ShowLineNumbers(event.IsChecked());
 }
 
 void MyFrame::OnFont(wxCommandEvent& event) {
     wxFontData fontData;
-    fontData.SetInitialFont(m_textCtrl->GetFont());
-    
+    fontData.SetInitialFont(m_view->GetTextFont());
+
     wxFontDialog dialog(this, fontData);
     if (dialog.ShowModal() == wxID_OK) {
         wxFont font = dialog.GetFontData().GetChosenFont();
-        m_textCtrl->SetFont(font);
+        m_view->SetTextFont(font);
         SetStatusText("字体已更改", 0);
     }
 }
@@ -386,39 +1596,238 @@ void MyFrame::OnFont(wxCommandEvent& event) {
 void MyFrame::OnAbout(wxCommandEvent& event) {
     wxMessageBox("简单文本编辑器\n\n"
                 "使用 wxWidgets 开发\n"
-                "功能：新建、打开、保存、编辑、查找、替换",
+                "功能：新建、打开、保存、编辑、查找、替换\n"
+                "文档保存在片段表中，只绘制可见的行",
                 "关于",
                 wxOK | wxICON_INFORMATION);
 }
 
-void MyFrame::OnTextChanged(wxCommandEvent& event) {
-    if (!m_modified) {
-        m_modified = true;
+void MyFrame::OnDocumentChanged(wxCommandEvent& event) {
+    bool modified = m_view->GetVersion() != m_savedVersion;
+    if (modified != m_modified) {
+        m_modified = modified;
         UpdateTitle();
     }
+}
+
+void MyFrame::OnCaretMoved(wxCommandEvent& event) {
     UpdateStatusBar();
 }
 
 void MyFrame::OnUpdateUI(wxUpdateUIEvent& event) {
-    UpdateStatusBar();
+    switch (event.GetId()) {
+        case wxID_UNDO:
+            event.Enable(m_view->CanUndo());
+            break;
+        case wxID_REDO:
+            event.Enable(m_view->CanRedo());
+            break;
+        case wxID_SAVE:
+        case wxID_SAVEAS:
+            // 文档还没接完整时保存会丢掉后面的内容；同一时间只进行一次保存
+            event.Enable(m_indexThread == NULL && m_saveThread == NULL);
+            break;
+        case ID_NEW:
+        case wxID_OPEN:
+            event.Enable(m_saveThread == NULL);
+            break;
+        case wxID_PASTE:
+        case ID_REPLACE:
+            event.Enable(!m_view->IsReadOnly());
+            break;
+        case wxID_CUT:
+            event.Enable(m_view->HasSelection() && !m_view->IsReadOnly());
+            break;
+        default:
+            event.Enable(m_view->HasSelection());
+            break;
+    }
+}
+
+bool MyFrame::CopySelection() {
+    if (!m_view->HasSelection() || !wxTheClipboard->Open()) {
+        return false;
+    }
+    std::string text = m_view->GetSelectedText();
+    wxTheClipboard->SetData(new wxTextDataObject(FromUtf8(text.data(), text.size())));
+    wxTheClipboard->Close();
+    return true;
+}
+
+// 取文档快照交给保存线程，之后可以继续编辑
+bool MyFrame::StartSave(const wxString& filename) {
+    m_savingVersion = m_view->GetVersion();
+    m_saveThread = new SaveThread(this, m_document, filename);
+    if (m_saveThread->Run() != wxTHREAD_NO_ERROR) {
+        delete m_saveThread;
+        m_saveThread = NULL;
+        wxLogError("无法启动保存线程");
+        return false;
+    }
+    m_saveWatch.Start();
+    SetStatusText("正在保存: " + filename, 0);
+    return true;
+}
+
+void MyFrame::OnSaveProgress(wxThreadEvent& event) {
+    if (m_saveThread) {
+        SetStatusText(wxString::Format("正在保存 %d%%: %s", event.GetInt(), m_saveThread->GetPath()), 0);
+    }
 }
 
-bool MyFrame::SaveFile(const wxString& filename) {
-    return m_textCtrl->SaveFile(filename);
+void MyFrame::OnSaveDone(wxThreadEvent& event) {
+    // WaitForSave() 可能已经处理过这次保存，留在队列里的完成事件不能算到下一次保存上
+    if (m_saveThread && m_saveThread->IsFinished()) {
+        FinishSave();
+    }
 }
 
+void MyFrame::FinishSave() {
+    m_saveThread->Wait();  // 完成事件是线程发出的最后一件事，这里很快返回
+    bool ok = m_saveThread->Succeeded();
+    wxString path = m_saveThread->GetPath();
+    wxString error = m_saveThread->GetError();
+    delete m_saveThread;
+    m_saveThread = NULL;
+
+    if (!ok) {
+        SetStatusText("保存失败", 0);
+        wxMessageBox(error, "保存失败", wxOK | wxICON_ERROR, this);
+        return;
+    }
+
+    // 保存的是开始时的快照：期间又有修改的话，文档仍是已修改状态
+    m_currentFile = path;
+    m_savedVersion = m_savingVersion;
+    m_modified = m_view->GetVersion() != m_savedVersion;
+    UpdateTitle();
+    wxString status = wxString::Format("已保存: %s (%ld ms)", path, m_saveWatch.Time());
+    if (m_modified) {
+        status += "，保存期间的修改尚未保存";
+    }
+    SetStatusText(status, 0);
+}
+
+// 关闭窗口或在提示中选择保存时，需要等保存真正完成
+void MyFrame::WaitForSave() {
+    if (m_saveThread) {
+        wxBusyCursor busy;
+        SetStatusText("正在等待保存完成...", 0);
+        FinishSave();
+    }
+}
+
+// 小文件整个读进一个 std::string，交给片段表引用；之后的编辑都不复制原文。
+// 大文件改用内存映射，见 LoadMappedFile()
 bool MyFrame::LoadFile(const wxString& filename) {
-    return m_textCtrl->LoadFile(filename);
+    wxFile file;
+    if (!file.Open(filename)) {
+        return false;
+    }
+    wxFileOffset length = file.Length();
+    if (length < 0) {
+        return false;
+    }
+    if (length >= kLargeFileBytes) {
+        file.Close();
+        return LoadMappedFile(filename);
+    }
+    std::string text(size_t(length), '\0');
+    if (length > 0 && file.Read(&text[0], size_t(length)) != ssize_t(length)) {
+        wxLogError("读取文件 %s 失败", filename);
+        return false;
+    }
+
+    StopIndexing();
+    m_document.Open(std::make_shared<editor::StringSource>(std::move(text)));
+    m_view->Reset(DetectEol(m_document));
+    return true;
+}
+
+// 映射文件后只同步数开头几块的换行，第一屏立即可以显示；其余的块交给后台线程，
+// 数好一段就接到文档末尾。接完之前文档只读
+bool MyFrame::LoadMappedFile(const wxString& filename) {
+    std::shared_ptr<MappedSource> source = std::make_shared<MappedSource>();
+    if (!source->Open(filename)) {
+        wxLogError("无法映射文件 %s", filename);
+        return false;
+    }
+
+    StopIndexing();
+    m_index = std::make_shared<editor::LineIndexBuilder>(source);
+    m_document.Attach(source);
+    m_indexedChunks = 0;
+    m_index->Advance(kFirstScreenChunks);
+    AppendIndexedChunks();
+    m_view->Reset(DetectEol(m_document));
+
+    if (!m_index->IsDone()) {
+        m_indexThread = new IndexThread(this, m_index);
+        if (m_indexThread->Run() != wxTHREAD_NO_ERROR) {
+            // 起不了线程就在这里数完，只是慢一些
+            delete m_indexThread;
+            m_indexThread = NULL;
+            m_index->Advance(m_index->GetChunkCount());
+            AppendIndexedChunks();
+        } else {
+            m_view->SetReadOnly(true);
+        }
+    }
+    return true;
+}
+
+void MyFrame::AppendIndexedChunks() {
+    size_t ready = m_index->GetReadyChunks();
+    if (ready == m_indexedChunks) {
+        return;
+    }
+    for (; m_indexedChunks < ready; m_indexedChunks++) {
+        m_document.AppendOriginal(m_index->GetChunkOffset(m_indexedChunks),
+                                  m_index->GetChunkLength(m_indexedChunks),
+                                  m_index->GetLineFeeds(m_indexedChunks));
+    }
+    m_view->DocumentAppended();
+    UpdateStatusBar();
+}
+
+void MyFrame::OnIndexProgress(wxThreadEvent& event) {
+    // 取消后线程可能还留下一两个事件在队列里，以当前的索引状态为准
+    if (!m_indexThread) {
+        return;
+    }
+    AppendIndexedChunks();
+    if (!m_index->IsDone()) {
+        SetStatusText(wxString::Format("正在建立行索引 %d%%（完成前只读）", m_index->GetPercent()), 0);
+        return;
+    }
+    m_indexThread->Wait();  // 完成后的事件是线程发出的最后一件事，这里很快返回
+    delete m_indexThread;
+    m_indexThread = NULL;
+    m_view->SetReadOnly(false);
+    SetStatusText(wxString::Format("行索引已完成，共 %llu 行",
+                                   (unsigned long long)m_document.GetLineCount()), 0);
+}
+
+void MyFrame::StopIndexing() {
+    if (m_indexThread) {
+        m_index->Cancel();
+        m_indexThread->Wait();
+        delete m_indexThread;
+        m_indexThread = NULL;
+    }
+    m_index.reset();
+    m_view->SetReadOnly(false);
 }
 
 bool MyFrame::AskSaveChanges() {
     if (m_modified) {
         int result = wxMessageBox("文档已修改。是否保存？",
                                  "确认", wxYES_NO | wxCANCEL | wxICON_QUESTION, this);
-        
+
         if (result == wxYES) {
             wxCommandEvent evt;
             OnSave(evt);
+            WaitForSave();
             return !m_modified;  // 如果保存失败，modified 仍为 true
         } else if (result == wxCANCEL) {
             return false;
@@ -429,50 +1838,97 @@ bool MyFrame::AskSaveChanges() {
 
 void MyFrame::UpdateTitle() {
     wxString title = "文本编辑器 - ";
-    
+
     if (m_currentFile.IsEmpty()) {
         title += "未命名";
     } else {
         title += m_currentFile;
     }
-    
+
     if (m_modified) {
         title += " *";
     }
-    
+
     SetTitle(title);
 }
 
 void MyFrame::UpdateStatusBar() {
-    // 更新光标位置
-    long pos = m_textCtrl->GetInsertionPoint();
-    long col, line;
-    m_textCtrl->PositionToXY(pos, &col, &line);
-    SetStatusText(wxString::Format("行 %ld, 列 %ld", line + 1, col + 1), 1);
-    
+    // 更新光标位置：行号 O(log n)，列号数行首到光标之间的字符（不数 UTF-8 续字节）。
+    // 光标离行首太远时（单行的大文件）不再逐字节数，按字节数估计，前面加 ~
+    size_t caret = m_view->GetCaret();
+    size_t line = m_document.GetLineOfOffset(caret);
+    size_t lineStart = m_document.GetLineStart(line);
+    size_t column = caret - lineStart;
+    bool exact = column <= kMaxColumnScan;
+    if (exact) {
+        column = 0;
+        m_document.ForEachChunk(lineStart, caret - lineStart, [&column](const char* text, size_t length) {
+            for (size_t i = 0; i < length; i++) {
+                column += !editor::IsContinuationByte((unsigned char)text[i]);
+            }
+            return true;
+        });
+    }
+    SetStatusText(wxString::Format(exact ? "行 %llu, 列 %llu" : "行 %llu, 列 ~%llu",
+                                   (unsigned long long)(line + 1),
+                                   (unsigned long long)(column + 1)), 1);
+
     // 更新文本长度
-    long length = m_textCtrl->GetLastPosition();
-    SetStatusText(wxString::Format("长度: %ld", length), 2);
+    SetStatusText(wxString::Format("长度: %llu 字节",
+                                   (unsigned long long)m_document.GetLength()), 2);
 }
 
 wxIMPLEMENT_APP(MyApp);
 
 /*
  * 这个文本编辑器展示了：
- * 
+ *
  * 1. 完整的文件操作流程
  * 2. 修改状态追踪
  * 3. 关闭前提示保存
  * 4. 查找和替换功能
  * 5. 状态栏实时更新
  * 6. 工具栏和菜单整合
- * 
+ * 7. 片段表文档模型（editor/piece_table.h）
+ *    - 文档 = 原始文件 + 只追加的缓冲，中间用一串片段描述当前内容。
+ *      打开文件后原文只引用不复制，插入、删除只切分片段，不移动文字
+ *    - 片段放在按偏移和换行数汇总的平衡树里，按偏移、按行号定位和修改都是 O(log n)
+ *    - 树是持久化的，复制 PieceTable 就是取快照：撤销历史直接保存每一步的快照，
+ *      撤销 / 重做只是换回旧的根节点
+ *    - 原先每次查找、替换都要 GetValue() 复制整个文本；现在查找逐片段扫描，
+ *      全部替换先找出所有位置再从后往前改，整个替换是一步撤销
+ * 8. 只绘制可见行的文本视图（TextView）
+ *    - 每次只用 ReadLines() 取出窗口里那几十行，解码、测量宽度也只对这些行做，
+ *      与文件大小无关；超长的行只显示前 16 KB
+ *    - 文档按 UTF-8 字节处理，坏字节显示为 U+FFFD，保存时原样写回；
+ *      CRLF 文件保持 CRLF，回车插入与文件一致的换行符
+ *    - 连续输入合并成一步撤销；修改状态按版本号比较，撤销回保存时的状态后标题上的 * 会消失
+ * 9. 大文件的延迟打开（editor/line_index.h）
+ *    - 达到 64 MB 的文件用内存映射打开，不读取、不转换；原先 LoadFile 要把整个文件读进来
+ *      转成 wxString，几 GB 的日志会让界面卡住几十秒
+ *    - 打开时只同步数前 1 MB 的换行，第一屏立即显示；其余部分由后台线程按 64 KB 一块地数，
+ *      每数完一段就把这些块接到片段表末尾，滚动条随之变长。建完之前文档只读，也不能保存
+ *    - 只有显示的那几行才被解码成 wxString，映射的页也只在被访问时才从磁盘读入
+ *    - 保存总是先写临时文件再改名替换（见第 10 条），不会截断还在映射中的内容
+ * 10. 后台原子保存（SaveThread）
+ *    - 原先在 UI 线程上同步写，而且直接覆盖原文件，写到一半崩溃文件就坏了
+ *    - 现在保存时取一个文档快照（O(1)）交给工作线程：按 4 MB 的块写进 "文件名.part"，
+ *      fsync 后改名替换原文件，再 fsync 所在目录；任何一步失败都保留原文件
+ *    - 进度显示在状态栏；保存期间可以继续输入，修改的是新版本，不影响正在写的快照
+ *    - 保存完成时记下的是快照的版本号，期间输入的内容仍算"已修改"；
+ *      关闭窗口时先等正在进行的保存完成，再询问是否保存剩下的修改
+ *    - 替换用 POSIX 的 rename() 或 Windows 的 MoveFileExW(MOVEFILE_REPLACE_EXISTING |
+ *      MOVEFILE_WRITE_THROUGH)，不会像 wxRenameFile 那样在目标已存在时退回到原地复制
+ *    - Windows 上被映射的文件（第 9 条的大文件）正在使用中，不能被替换：
+ *      这时保存失败并提示，临时文件被删除，原文件不受影响
+ *
  * 可以继续扩展的功能：
  * 1. 最近文件列表
  * 2. 语法高亮
  * 3. 多标签页编辑
  * 4. 打印功能
- * 5. 行号显示
+ * 5. 自动换行（需要按窗口宽度把逻辑行拆成多个显示行）
  * 6. 配置保存
  * 7. 拖放文件打开
+ * 8. 其他编码（GBK、UTF-16）的文件：目前按 UTF-8 字节处理
  */